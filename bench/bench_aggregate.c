@@ -0,0 +1,132 @@
+/*
+* esp-just-slip - bench_aggregate.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "aggregate.h"
+#include "slipcodec.h"
+
+// time to send one byte at 57600 bps [us]
+#define BENCH_BYTE_US (10 * 1000000 / 57600)
+#define BENCH_MESSAGES 1000
+// messages arrive at random, 3 ms apart on average
+#define BENCH_INTERVAL_US 6000
+// aggregator is polled this often [us]
+#define BENCH_POLL_US 100
+
+static Aggregator benchAggregator;
+
+
+//
+// SLIP wire bytes of a frame together with crc16, whose value does not matter here
+//
+static uint32_t ICACHE_FLASH_ATTR benchAggregateWire(uint8_t *frameBuffer, uint8_t nCount)
+{
+	uint8_t encoded[SLIP_MAX_ENCODED(AGGREGATE_MAX_FRAME + 2)];
+
+	frameBuffer[nCount] = frameBuffer[nCount + 1] = 0;
+	return slipEncodeFrame(frameBuffer, nCount + 2, encoded);
+}
+
+
+//
+// send BENCH_MESSAGES diag messages of 12 bytes with given deadline
+// deadline 0 sends each message in a frame of its own
+// print messages per frame, wire bytes per message, link load at 57600 bps,
+// average / maximum delay added by aggregation [ms]
+// and cycles per message spent in adding and polling every BENCH_POLL_US
+//
+static void ICACHE_FLASH_ATTR benchAggregateRun(uint32_t deadline)
+{
+	uint8_t message[BENCH_FRAME_SIZE];
+	uint8_t frameBuffer[AGGREGATE_MAX_FRAME + 2];
+	uint8_t nCount, nFrame;
+	uint16_t i;
+	uint32_t now = 0, arrival = 0, nWire = 0;
+	BenchCycles start, cycles = 0;
+	AggregateStats *stats = &benchAggregator.stats;
+
+	aggregateInit(&benchAggregator, deadline ? AGGREGATE_MAX_FRAME : 1, deadline);
+	for (i = 0; i < BENCH_MESSAGES; )
+	{
+		nFrame = 0;
+		if (now >= arrival)
+		{
+			nCount = benchMakeFrame(BENCH_DATA_DIAG, i++, message);
+			start = benchCycles();
+			nFrame = aggregateAdd(&benchAggregator, message, nCount, now, frameBuffer);
+			cycles += benchCycles() - start;
+			arrival += benchRandom() % BENCH_INTERVAL_US;
+		}
+		if (nFrame > 0)
+			nWire += benchAggregateWire(frameBuffer, nFrame);
+
+		start = benchCycles();
+		nFrame = aggregatePoll(&benchAggregator, now, frameBuffer);
+		cycles += benchCycles() - start;
+		if (nFrame > 0)
+			nWire += benchAggregateWire(frameBuffer, nFrame);
+		if (now >= arrival)
+			continue;
+		now += BENCH_POLL_US;
+	}
+	nFrame = aggregateFlush(&benchAggregator, now, frameBuffer);
+	if (nFrame > 0)
+		nWire += benchAggregateWire(frameBuffer, nFrame);
+
+	os_printf("aggregate: ");
+	benchPrintFixed(deadline, 1000);
+	os_printf(" %u %u ", (unsigned) stats->nMessages, (unsigned) stats->nFrames);
+	benchPrintFixed(stats->nMessages, stats->nFrames);
+	os_printf(" ");
+	benchPrintFixed(nWire, stats->nMessages);
+	os_printf(" ");
+	benchPrintFixed((uint64_t) nWire * BENCH_BYTE_US * 100, now);
+	os_printf(" ");
+	benchPrintFixed(stats->delaySum, (uint64_t) stats->nMessages * 1000);
+	os_printf(" ");
+	benchPrintFixed(stats->delayMax, 1000);
+	os_printf(" ");
+	benchPrintFixed(cycles, stats->nMessages);
+	os_printf("\r\n");
+}
+
+
+//
+// compare a frame per message with aggregation under deadlines of 2, 5 and 10 ms
+//
+void ICACHE_FLASH_ATTR benchAggregate(void)
+{
+	os_printf("aggregate: deadline[ms] messages frames msg/frame wire[B/msg] load[%%] delay[ms] max[ms] cpu[c/msg]\r\n");
+	benchAggregateRun(0);
+	benchAggregateRun(2000);
+	benchAggregateRun(5000);
+	benchAggregateRun(10000);
+}
@@ -0,0 +1,162 @@
+/*
+* esp-just-slip - bench_bus.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "bus.h"
+#include "slipcodec.h"
+
+// time to send one byte by Softuart at 57600 bps [us]
+// start, 8 data bits and 6 bit times of delay after the byte
+#define BENCH_BUS_BYTE_US (15 * 1000000 / 57600)
+// time for a slave to notice the poll and start replying [us]
+#define BENCH_BUS_TURNAROUND_US 1000
+// master gives up on a slave after [us]
+#define BENCH_BUS_TIMEOUT_US 5000
+// simulated time [us]
+#define BENCH_BUS_TIME 10000000
+// each slave has a message to send this often [us]
+#define BENCH_BUS_PERIOD 50000
+// messages waiting in each slave
+#define BENCH_BUS_QUEUE 4
+
+static BusMaster benchMaster;
+
+
+//
+// time to put a bus frame on the wire, including crc16 and SLIP framing [us]
+//
+static uint32_t ICACHE_FLASH_ATTR benchBusWire(uint8_t *frameBuffer, uint8_t nCount)
+{
+	frameBuffer[nCount] = frameBuffer[nCount + 1] = 0;
+	return slipEncodedSize(frameBuffer, nCount + 2) * BENCH_BUS_BYTE_US;
+}
+
+
+//
+// master polls nNodes slaves on one bus, each slave has a diag message
+// every BENCH_BUS_PERIOD and replies to a poll with the oldest one, if any
+//
+// config - name of configuration
+// nNodes - number of slaves, up to BUS_MAX_NODES
+// nDead - number of slaves that never reply
+//
+static void ICACHE_FLASH_ATTR benchBusRun(const char *config, uint8_t nNodes, uint8_t nDead)
+{
+	uint8_t address[BUS_MAX_NODES];
+	uint8_t nQueued[BUS_MAX_NODES];
+	uint32_t created[BUS_MAX_NODES][BENCH_BUS_QUEUE];
+	uint32_t nextMessage[BUS_MAX_NODES];
+	uint8_t frameBuffer[BUS_MAX_PAYLOAD + 3];
+	uint8_t messageBuffer[BENCH_FRAME_SIZE];
+	uint8_t i, nCount, nMessage;
+	uint16_t nFrame = 0;
+	uint32_t now = 0, wire = 0, latency, latencySum = 0, latencyMax = 0;
+	uint32_t nDelivered = 0, nDropped = 0, nTimeouts = 0;
+
+	for (i = 0; i < nNodes; i++)
+	{
+		address[i] = i + 1;
+		nQueued[i] = 0;
+		// spread messages of slaves over the period
+		nextMessage[i] = i * BENCH_BUS_PERIOD / nNodes;
+	}
+	busMasterInit(&benchMaster, address, nNodes, BENCH_BUS_TIMEOUT_US);
+
+	while (now < BENCH_BUS_TIME)
+	{
+		for (i = 0; i < nNodes; i++)
+			while (nextMessage[i] <= now)
+			{
+				if (nQueued[i] < BENCH_BUS_QUEUE)
+					created[i][nQueued[i]++] = nextMessage[i];
+				else
+					nDropped++;
+				nextMessage[i] += BENCH_BUS_PERIOD;
+			}
+
+		nCount = busMasterPoll(&benchMaster, now, frameBuffer);
+		if (nCount == 0)
+		{
+			// no reply, wait for timeout
+			now = benchMaster.sent + benchMaster.timeout;
+			continue;
+		}
+		latency = benchBusWire(frameBuffer, nCount);
+		wire += latency;
+		now += latency;
+		// receiver of the master is not turned off while it sends, its own poll comes back
+		busMasterReceive(&benchMaster, frameBuffer, nCount, now);
+
+		i = benchMaster.nCurrent;
+		if (i < nDead || !busSlaveReceive(address[i], frameBuffer, nCount))
+			continue;
+
+		// slave replies with the oldest message or an empty frame
+		nMessage = 0;
+		if (nQueued[i] > 0)
+			nMessage = benchMakeFrame(BENCH_DATA_DIAG, nFrame++, messageBuffer);
+		nCount = busSlaveReply(address[i], messageBuffer, nMessage, frameBuffer);
+		latency = benchBusWire(frameBuffer, nCount);
+		wire += latency;
+		now += BENCH_BUS_TURNAROUND_US + latency;
+
+		if (busMasterReceive(&benchMaster, frameBuffer, nCount, now) > 0)
+		{
+			latency = now - created[i][0];
+			latencySum += latency;
+			if (latency > latencyMax)
+				latencyMax = latency;
+			nDelivered++;
+			nQueued[i]--;
+			os_memmove(created[i], created[i] + 1, nQueued[i] * sizeof(uint32_t));
+		}
+	}
+
+	for (i = 0; i < nNodes; i++)
+		nTimeouts += benchMaster.stats[i].nTimeouts;
+	os_printf("bus: %s %d %u %u %u %u %u %u\r\n", config, nNodes, (unsigned) (nDelivered * 1000000ull / now),
+		(unsigned) nDropped, (unsigned) nTimeouts, (unsigned) (nDelivered ? latencySum / nDelivered : 0),
+		(unsigned) latencyMax, (unsigned) (wire * 100ull / now));
+}
+
+
+//
+// throughput and latency of master polling a growing number of slaves
+//
+void ICACHE_FLASH_ATTR benchBus(void)
+{
+	os_printf("bus: config nodes messages/s dropped timeouts latency[us] latency_max[us] wire[%%]\r\n");
+	benchBusRun("nodes_1", 1, 0);
+	benchBusRun("nodes_4", 4, 0);
+	benchBusRun("nodes_8", 8, 0);
+	benchBusRun("nodes_16", 16, 0);
+	benchBusRun("dead_1_of_8", 8, 1);
+}
@@ -0,0 +1,113 @@
+/*
+* esp-just-slip - bench_channel.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "channel.h"
+
+// time to send one frame of BENCH_FRAME_SIZE bytes at 57600 bps [us]
+#define BENCH_SLOT_US (BENCH_FRAME_SIZE * 10 * 1000000 / 57600)
+#define BENCH_SLOTS 1000
+
+static ChannelMux benchMux;
+
+
+//
+// offer mixed traffic to the multiplexer, one frame leaves per slot
+// - two log frames per slot, more than the link carries
+// - telemetry every 3rd slot, a command every 7th slot
+// print frames sent, dropped and average / maximum queueing delay [ms] per channel
+//
+// config - name of scheduling
+//
+static void ICACHE_FLASH_ATTR benchChannelRun(const char *config)
+{
+	uint8_t frameBuffer[CHANNEL_MAX_PAYLOAD + 1];
+	uint8_t id, nCount;
+	uint16_t slot;
+	uint32_t now;
+	BenchCycles start, cycles = 0;
+	uint32_t nFrames = 0;
+
+	for (slot = 0; slot < BENCH_SLOTS; slot++)
+	{
+		now = (uint32_t) slot * BENCH_SLOT_US;
+		nCount = benchMakeFrame(BENCH_DATA_LOG, slot, frameBuffer);
+		channelQueue(&benchMux, CHANNEL_LOG, frameBuffer, nCount, now);
+		channelQueue(&benchMux, CHANNEL_LOG, frameBuffer, nCount, now);
+		if (slot % 3 == 0)
+		{
+			nCount = benchMakeFrame(BENCH_DATA_SENSOR, slot, frameBuffer);
+			channelQueue(&benchMux, CHANNEL_TELEMETRY, frameBuffer, nCount, now);
+		}
+		if (slot % 7 == 0)
+		{
+			nCount = benchMakeFrame(BENCH_DATA_DIAG, slot, frameBuffer);
+			channelQueue(&benchMux, CHANNEL_CONTROL, frameBuffer, nCount, now);
+		}
+
+		start = benchCycles();
+		if (channelNext(&benchMux, frameBuffer, now) > 0)
+			nFrames++;
+		cycles += benchCycles() - start;
+	}
+
+	for (id = 0; id < CHANNEL_COUNT; id++)
+	{
+		ChannelStats *stats = &benchMux.channel[id].stats;
+
+		os_printf("channel: %s %d %u %u ", config, id, (unsigned) stats->nSent, (unsigned) stats->nDropped);
+		benchPrintFixed(stats->delaySum, (uint64_t) stats->nSent * 1000);
+		os_printf(" ");
+		benchPrintFixed(stats->delayMax, 1000);
+		os_printf(" ");
+		benchPrintFixed(cycles, nFrames);
+		os_printf("\r\n");
+	}
+}
+
+
+//
+// compare plain round robin of all channels with default priorities of channelInit()
+//
+void ICACHE_FLASH_ATTR benchChannel(void)
+{
+	uint8_t id;
+
+	os_printf("channel: config id sent dropped delay[ms] max[ms] next[c/frame]\r\n");
+
+	channelInit(&benchMux);
+	for (id = 0; id < CHANNEL_COUNT; id++)
+		channelConfig(&benchMux, id, 0, 1);
+	benchChannelRun("roundrobin");
+
+	channelInit(&benchMux);
+	benchChannelRun("priority");
+}
@@ -0,0 +1,197 @@
+/*
+* esp-just-slip - bench_codec.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "slipcodec.h"
+#include "crc16.h"
+#include "crc32.h"
+
+// largest frame, each measurement processes about BENCH_REPEAT times this many bytes
+#ifdef __ets__
+#define BENCH_CODEC_MAX 512
+#else
+#define BENCH_CODEC_MAX 1024
+#endif
+
+typedef enum {
+	BENCH_CODEC_ENCODE,
+	BENCH_CODEC_DECODE_SPAN,
+	BENCH_CODEC_DECODE_BYTE,
+	BENCH_CODEC_CRC16,
+	BENCH_CODEC_CRC16_FRAME,
+	BENCH_CODEC_COUNT
+} BenchCodecOp;
+
+static const char *benchCodecNames[BENCH_CODEC_COUNT] = { "encode", "decode_span", "decode_byte", "crc16", "crc16_frame" };
+
+static uint8_t rawBuffer[BENCH_CODEC_MAX];
+static uint8_t wireBuffer[SLIP_MAX_ENCODED(BENCH_CODEC_MAX)];
+static uint8_t checkBuffer[BENCH_CODEC_MAX + CRC_MAX_SIZE];
+// keeps results alive so the compiler does not drop the calculation
+static volatile uint32_t benchCodecSink;
+
+
+//
+// fill rawBuffer with nCount bytes of a data set, frames of it back to back
+//
+static void ICACHE_FLASH_ATTR benchCodecFill(BenchData data, uint16_t nCount)
+{
+	uint8_t frame[BENCH_FRAME_SIZE];
+	uint16_t nPos = 0, nFrame = 0, nTake;
+	uint8_t n;
+
+	while (nPos < nCount)
+	{
+		n = benchMakeFrame(data, nFrame++, frame);
+		nTake = (nCount - nPos < n) ? nCount - nPos : n;
+		os_memcpy(rawBuffer + nPos, frame, nTake);
+		nPos += nTake;
+	}
+}
+
+
+//
+// run one operation nRepeat times over the frame in rawBuffer / wireBuffer
+//
+// returned value - cycles taken
+//
+static BenchCycles ICACHE_FLASH_ATTR benchCodecRun(BenchCodecOp op, uint16_t nCount, uint16_t nWire, uint32_t nRepeat)
+{
+	SlipDecoder decoder;
+	BenchCycles start;
+	uint32_t n, sink = 0;
+	uint16_t i, nUsed;
+
+	slipDecoderInit(&decoder);
+	start = benchCycles();
+	for (n = 0; n < nRepeat; n++)
+	{
+		switch (op)
+		{
+			case BENCH_CODEC_ENCODE:
+				sink += slipEncodeFrame(rawBuffer, nCount, wireBuffer);
+				break;
+			case BENCH_CODEC_DECODE_SPAN:
+				sink += slipDecodeSpan(&decoder, wireBuffer, nWire, &nUsed, checkBuffer, sizeof(checkBuffer));
+				break;
+			case BENCH_CODEC_DECODE_BYTE:
+				for (i = 0; i < nWire; i++)
+					sink += slipDecodeByte(&decoder, wireBuffer[i], checkBuffer, sizeof(checkBuffer));
+				break;
+			case BENCH_CODEC_CRC16:
+				sink += crc16_data(rawBuffer, nCount, 0x00);
+				break;
+			default:
+				// what a sender and a receiver of a frame do, same bytes as appendCrc16() / checkCrc16()
+				sink += appendCrc(CRC_16, checkBuffer, nCount, sizeof(checkBuffer));
+				sink += checkCrc(CRC_16, checkBuffer, nCount + 2);
+				break;
+		}
+	}
+	benchCodecSink = sink;
+	return benchCycles() - start;
+}
+
+
+//
+// SLIP encode, decode and CRC-16 of slipcodec.h and crc16.c
+// for frames of 8 bytes to 1 KB of each data set
+//
+// wire - bytes of encoded frame, SLIP_END included
+// expansion - (wire - bytes) / bytes
+// c/B - cycles per payload byte
+// MB/s - payload bytes per second, from benchCycleRate()
+// crc16_frame - appendCrc() and checkCrc() with CRC_16 as sender and receiver of a frame
+//
+// With benchCsv set one line per operation is printed instead:
+// codec,op,data,bytes,wire,processed,cycles,khz
+// processed - payload bytes processed, cycles - cycles taken, khz - cycles per ms
+//
+void ICACHE_FLASH_ATTR benchCodec(void)
+{
+	static const BenchData sets[] = { BENCH_DATA_DIAG, BENCH_DATA_SENSOR, BENCH_DATA_ASCII,
+		BENCH_DATA_RANDOM, BENCH_DATA_SLIP_END, BENCH_DATA_SLIP_ESC };
+	static const uint16_t sizes[] = { 8, 16, 64, 256, BENCH_CODEC_MAX };
+	uint64_t rate = benchCycleRate();
+	BenchCycles cycles[BENCH_CODEC_COUNT];
+	SlipDecoder decoder;
+	uint16_t s, z, nCount, nWire, nUsed;
+	uint32_t nRepeat;
+	uint64_t nProcessed;
+	int op;
+
+	if (benchCsv)
+		os_printf("codec,op,data,bytes,wire,processed,cycles,khz\r\n");
+	else
+		os_printf("codec: data bytes wire expansion encode[c/B] decode_span[c/B] decode_byte[c/B] crc16[c/B] crc16_frame[c/B] encode[MB/s] decode_span[MB/s]\r\n");
+
+	for (s = 0; s < sizeof(sets) / sizeof(sets[0]); s++)
+		for (z = 0; z < sizeof(sizes) / sizeof(sizes[0]); z++)
+		{
+			nCount = sizes[z];
+			nRepeat = BENCH_REPEAT * (BENCH_CODEC_MAX / nCount);
+			nProcessed = (uint64_t) nRepeat * nCount;
+			benchCodecFill(sets[s], nCount);
+			nWire = slipEncodeFrame(rawBuffer, nCount, wireBuffer);
+			os_memcpy(checkBuffer, rawBuffer, nCount);
+
+			for (op = 0; op < BENCH_CODEC_COUNT; op++)
+				cycles[op] = benchCodecRun((BenchCodecOp) op, nCount, nWire, nRepeat);
+
+			// decoded frame must match the one encoded
+			slipDecoderInit(&decoder);
+			if (slipDecodeSpan(&decoder, wireBuffer, nWire, &nUsed, checkBuffer, sizeof(checkBuffer)) != nCount
+				|| os_memcmp(checkBuffer, rawBuffer, nCount) != 0)
+				os_printf("codec: %s %u round trip FAILED!\r\n", benchDataName(sets[s]), nCount);
+
+			if (benchCsv)
+			{
+				for (op = 0; op < BENCH_CODEC_COUNT; op++)
+					os_printf("codec,%s,%s,%u,%u,%u,%u,%u\r\n", benchCodecNames[op], benchDataName(sets[s]),
+						nCount, nWire, (unsigned) nProcessed, (unsigned) cycles[op], (unsigned) (rate / 1000));
+				continue;
+			}
+
+			os_printf("codec: %s %u %u ", benchDataName(sets[s]), nCount, nWire);
+			benchPrintFixed(100 * (uint64_t) (nWire - nCount), nCount);
+			os_printf("%%");
+			for (op = 0; op < BENCH_CODEC_COUNT; op++)
+			{
+				os_printf(" ");
+				benchPrintFixed(cycles[op], nProcessed);
+			}
+			os_printf(" ");
+			benchPrintFixed(nProcessed * rate, (uint64_t) cycles[BENCH_CODEC_ENCODE] * 1000000);
+			os_printf(" ");
+			benchPrintFixed(nProcessed * rate, (uint64_t) cycles[BENCH_CODEC_DECODE_SPAN] * 1000000);
+			os_printf("\r\n");
+		}
+}
@@ -0,0 +1,119 @@
+/*
+* esp-just-slip - bench_const.cpp
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "slipconst.h"
+#include "crc32.h"
+
+//
+// fixed frames of a typical protocol, kept in flash on ESP8266
+//
+// ping - type, sequence 0
+// ack - type, frame acknowledged 0xC0, needs escaping
+// mode - type, mode number, parameter 0xDB, needs escaping
+//
+static const SlipWire benchConstPing ICACHE_RODATA_ATTR = SLIP_CONST_WIRE(0x50, 0x00);
+static const SlipWire benchConstAck ICACHE_RODATA_ATTR = SLIP_CONST_WIRE(0x41, 0xC0);
+static const SlipWire benchConstMode ICACHE_RODATA_ATTR = SLIP_CONST_WIRE(0x4D, 0x02, 0xDB, 0x10);
+
+typedef struct {
+	const char *name;
+	const SlipWire *frame;
+	uint8_t payload[4];
+	uint8_t nCount;
+} BenchConstFrame;
+
+static const BenchConstFrame benchConstFrames[] =
+{
+	{ "ping", &benchConstPing, { 0x50, 0x00 }, 2 },
+	{ "ack", &benchConstAck, { 0x41, 0xC0 }, 2 },
+	{ "mode", &benchConstMode, { 0x4D, 0x02, 0xDB, 0x10 }, 4 },
+};
+
+static volatile uint32_t benchConstSink;
+
+
+//
+// frame built at run time, as for any other frame: payload copied,
+// CRC16 appended as by appendCrc16() and SLIP encoded
+//
+static uint16_t ICACHE_FLASH_ATTR benchConstRuntime(const BenchConstFrame *frame, uint8_t *wireBuffer)
+{
+	uint8_t dataBuffer[sizeof(frame->payload) + 2];
+	uint16_t nCount;
+
+	os_memcpy(dataBuffer, frame->payload, frame->nCount);
+	nCount = appendCrc(CRC_16, dataBuffer, frame->nCount, sizeof(dataBuffer));
+	return slipEncodeFrame(dataBuffer, nCount, wireBuffer);
+}
+
+
+//
+// fixed frames encoded at compile time (slipconst.h) against encoding them on each send
+//
+// Wire bytes of SlipWire in flash must match appendCrc16() and slipEncodeFrame().
+// runtime[c] - cycles to copy payload, append CRC16 and SLIP encode
+// const[c] - cycles to copy wire bytes of frame encoded at compile time
+//
+void ICACHE_FLASH_ATTR benchConst(void)
+{
+	uint8_t wireBuffer[SLIP_WIRE_MAX], checkBuffer[SLIP_WIRE_MAX];
+	BenchCycles runtime, constant, start;
+	uint32_t n, nRepeat = BENCH_REPEAT * 100, sink = 0;
+	uint16_t nWire;
+	uint8_t f;
+
+	os_printf("const: frame bytes wire runtime[c] const[c]\r\n");
+	for (f = 0; f < sizeof(benchConstFrames) / sizeof(benchConstFrames[0]); f++)
+	{
+		const BenchConstFrame *frame = &benchConstFrames[f];
+
+		nWire = benchConstRuntime(frame, wireBuffer);
+		if (slipWireCopy(frame->frame, checkBuffer) != nWire || os_memcmp(wireBuffer, checkBuffer, nWire) != 0)
+			os_printf("const: %s wire bytes differ FAILED!\r\n", frame->name);
+
+		start = benchCycles();
+		for (n = 0; n < nRepeat; n++)
+			sink += benchConstRuntime(frame, wireBuffer);
+		runtime = benchCycles() - start;
+		start = benchCycles();
+		for (n = 0; n < nRepeat; n++)
+			sink += slipWireCopy(frame->frame, checkBuffer);
+		constant = benchCycles() - start;
+		benchConstSink = sink;
+
+		os_printf("const: %s %u %u ", frame->name, frame->nCount, nWire);
+		benchPrintFixed(runtime, nRepeat);
+		os_printf(" ");
+		benchPrintFixed(constant, nRepeat);
+		os_printf("\r\n");
+	}
+}
@@ -0,0 +1,102 @@
+/*
+* esp-just-slip - bench_crc.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "crc16.h"
+#include "crc32.h"
+
+#ifdef __ets__
+#define BENCH_CRC_MAX 512
+#else
+#define BENCH_CRC_MAX 1024
+#endif
+
+static uint8_t benchCrcData[BENCH_CRC_MAX];
+// keeps results alive so the compiler does not drop the calculation
+static volatile uint32_t benchCrcSink;
+
+
+//
+// time one check over nCount bytes and print cycles per byte
+//
+// mode - CRC_16, CRC_32 or CRC_32C
+//
+static void ICACHE_FLASH_ATTR benchCrcRun(CrcMode mode, uint16_t nCount)
+{
+	BenchCycles start, cycles;
+	uint16_t repeat;
+	uint32_t crc = 0;
+
+	start = benchCycles();
+	for (repeat = 0; repeat < BENCH_REPEAT; repeat++)
+	{
+		if (mode == CRC_16)
+			crc ^= crc16_data(benchCrcData, nCount, 0x00);
+		else if (mode == CRC_32)
+			crc ^= crc32Data(benchCrcData, nCount, 0);
+		else
+			crc ^= crc32cData(benchCrcData, nCount, 0);
+	}
+	cycles = benchCycles() - start;
+	benchCrcSink = crc;
+
+	os_printf(" ");
+	benchPrintFixed(cycles, (uint64_t) nCount * BENCH_REPEAT);
+}
+
+
+//
+// cost of CRC-16 against CRC-32 and CRC-32C calculated with tables
+// and with CPU instructions (same as tables where there are none)
+// for a diag frame, a full SLIP_BUFFER_SIZE frame and longer blocks
+//
+void ICACHE_FLASH_ATTR benchCrc(void)
+{
+	static const uint16_t sizes[] = { 12, 64, 256, BENCH_CRC_MAX };
+	uint16_t i;
+
+	for (i = 0; i < BENCH_CRC_MAX; i++)
+		benchCrcData[i] = (uint8_t) benchRandom();
+
+	os_printf("crc: bytes crc16[c/B] crc32[c/B] crc32c[c/B] crc32_hw[c/B] crc32c_hw[c/B]\r\n");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		os_printf("crc: %d", sizes[i]);
+		benchCrcRun(CRC_16, sizes[i]);
+		crc32Hardware(false);
+		benchCrcRun(CRC_32, sizes[i]);
+		benchCrcRun(CRC_32C, sizes[i]);
+		crc32Hardware(true);
+		benchCrcRun(CRC_32, sizes[i]);
+		benchCrcRun(CRC_32C, sizes[i]);
+		os_printf("\r\n");
+	}
+}
@@ -0,0 +1,228 @@
+/*
+* esp-just-slip - bench_data.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+
+#ifdef __ets__
+#include "user_interface.h"
+#endif
+
+bool benchCsv = false;
+
+
+//
+// xorshift32 pseudo random numbers
+// fixed seed so that every run processes the same data
+//
+uint32_t ICACHE_FLASH_ATTR benchRandom(void)
+{
+	static uint32_t state = 2463534242u;
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+
+//
+// store value in dataBuffer as little endian, the way ESP8266 and AVR keep it in memory
+//
+static void ICACHE_FLASH_ATTR benchPut16(uint8_t *dataBuffer, uint16_t value)
+{
+	dataBuffer[0] = (uint8_t) value;
+	dataBuffer[1] = (uint8_t) (value >> 8);
+}
+
+static void ICACHE_FLASH_ATTR benchPut32(uint8_t *dataBuffer, uint32_t value)
+{
+	benchPut16(dataBuffer, (uint16_t) value);
+	benchPut16(dataBuffer + 2, (uint16_t) (value >> 16));
+}
+
+
+//
+// name of data set for printing results
+//
+const char * ICACHE_FLASH_ATTR benchDataName(BenchData data)
+{
+	switch (data)
+	{
+		case BENCH_DATA_DIAG:
+			return "diag";
+		case BENCH_DATA_SENSOR:
+			return "sensor";
+		case BENCH_DATA_ASCII:
+			return "ascii";
+		case BENCH_DATA_LOG:
+			return "log";
+		case BENCH_DATA_RANDOM:
+			return "random";
+		case BENCH_DATA_SLIP_END:
+			return "c0";
+		case BENCH_DATA_SLIP_ESC:
+			return "db";
+		case BENCH_DATA_ZERO:
+			return "00";
+		case BENCH_DATA_HDLC_FLAG:
+			return "7e";
+		default:
+			return "?";
+	}
+}
+
+
+//
+// prepare one frame of representative telemetry
+//
+// data - data set to take the frame from
+// nFrame - sequence number of the frame within the data set
+// *dataBuffer - pointer to data buffer of at least BENCH_FRAME_SIZE bytes
+//
+// returned value - number of bytes stored in dataBuffer
+//
+uint8_t ICACHE_FLASH_ATTR benchMakeFrame(BenchData data, uint16_t nFrame, uint8_t *dataBuffer)
+{
+	uint8_t i;
+	int temperature = 2351 + (int) (benchRandom() % 7) - 3;
+	int humidity = 4520 + (int) (benchRandom() % 21) - 10;
+
+	switch (data)
+	{
+		case BENCH_DATA_DIAG:
+			benchPut32(dataBuffer, nFrame + 1);
+			for (i = 0; i < 8; i++)
+				dataBuffer[4 + i] = (uint8_t) benchRandom();
+			return 4 + 8;
+
+		case BENCH_DATA_SENSOR:
+			// packet number, time stamp [ms], acceleration x, y, z [mg],
+			// temperature, humidity [0.01], pressure [0.1 hPa], supply [mV], status
+			benchPut32(dataBuffer, nFrame + 1);
+			benchPut32(dataBuffer + 4, 30 * (uint32_t) nFrame);
+			benchPut16(dataBuffer + 8, (uint16_t) (int16_t) ((int) (benchRandom() % 9) - 4));
+			benchPut16(dataBuffer + 10, (uint16_t) (int16_t) ((int) (benchRandom() % 9) - 4));
+			benchPut16(dataBuffer + 12, (uint16_t) (1000 + (benchRandom() % 9) - 4));
+			benchPut16(dataBuffer + 14, (uint16_t) temperature);
+			benchPut16(dataBuffer + 16, (uint16_t) humidity);
+			benchPut16(dataBuffer + 18, 10132);
+			benchPut16(dataBuffer + 20, 3300 - nFrame / 16);
+			dataBuffer[22] = 0;
+			dataBuffer[23] = 0;
+			return 24;
+
+		case BENCH_DATA_ASCII:
+			return (uint8_t) os_sprintf((char *) dataBuffer, "T=%d.%d%d;H=%d.%d%d;P=1013.25;V=3.30;S=OK\r\n",
+				temperature / 100, temperature / 10 % 10, temperature % 10,
+				humidity / 100, humidity / 10 % 10, humidity % 10);
+
+		case BENCH_DATA_LOG:
+			return (uint8_t) os_sprintf((char *) dataBuffer, "[%d] uart0: rx frame %d bytes, crc ok\r\n",
+				100000 + 30 * nFrame, 12 + (int) (benchRandom() % 4));
+
+		case BENCH_DATA_RANDOM:
+			for (i = 0; i < BENCH_FRAME_SIZE; i++)
+				dataBuffer[i] = (uint8_t) benchRandom();
+			return BENCH_FRAME_SIZE;
+
+		case BENCH_DATA_SLIP_END:
+			os_memset(dataBuffer, 0xC0, BENCH_FRAME_SIZE);
+			return BENCH_FRAME_SIZE;
+
+		case BENCH_DATA_SLIP_ESC:
+			os_memset(dataBuffer, 0xDB, BENCH_FRAME_SIZE);
+			return BENCH_FRAME_SIZE;
+
+		case BENCH_DATA_ZERO:
+			os_memset(dataBuffer, 0x00, BENCH_FRAME_SIZE);
+			return BENCH_FRAME_SIZE;
+
+		case BENCH_DATA_HDLC_FLAG:
+			os_memset(dataBuffer, 0x7E, BENCH_FRAME_SIZE);
+			return BENCH_FRAME_SIZE;
+
+		default:
+			return 0;
+	}
+}
+
+
+//
+// print numerator / denominator with two decimal places
+// os_printf() on ESP8266 does not handle floating point nor field widths
+//
+void ICACHE_FLASH_ATTR benchPrintFixed(uint64_t numerator, uint64_t denominator)
+{
+	uint64_t hundredths;
+
+	if (denominator == 0)
+	{
+		os_printf("-");
+		return;
+	}
+	hundredths = (numerator * 100 + denominator / 2) / denominator;
+	os_printf("%u.%s%u", (unsigned) (hundredths / 100), (hundredths % 100 < 10) ? "0" : "", (unsigned) (hundredths % 100));
+}
+
+
+//
+// benchCycles() counted per second
+//
+// ESP8266 - CPU clock
+// x86 host - time stamp counter measured against CLOCK_MONOTONIC once, for 20 ms
+// other hosts - benchCycles() counts nanoseconds
+//
+uint64_t ICACHE_FLASH_ATTR benchCycleRate(void)
+{
+#ifdef __ets__
+	return (uint64_t) system_get_cpu_freq() * 1000000;
+#elif defined(__x86_64__) || defined(__i386__)
+	static uint64_t rate;
+	struct timespec begin, now;
+	BenchCycles start;
+	uint64_t ns;
+
+	if (rate == 0)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+		start = benchCycles();
+		do
+		{
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			ns = (uint64_t) (now.tv_sec - begin.tv_sec) * 1000000000u + now.tv_nsec - begin.tv_nsec;
+		} while (ns < 20000000);
+		rate = (benchCycles() - start) * 1000000000u / ns;
+	}
+	return rate;
+#else
+	return 1000000000u;
+#endif
+}
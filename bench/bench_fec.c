@@ -0,0 +1,130 @@
+/*
+* esp-just-slip - bench_fec.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "rs.h"
+
+// frames of BENCH_DATA_RANDOM with room for parity
+static uint8_t codeFrames[BENCH_FRAMES][BENCH_FRAME_SIZE + RS_MAX_PARITY];
+static uint8_t codeCount[BENCH_FRAMES];
+static uint8_t rawFrames[BENCH_FRAMES][BENCH_FRAME_SIZE];
+static uint8_t rawCount[BENCH_FRAMES];
+static uint8_t errorFrame[BENCH_FRAME_SIZE + RS_MAX_PARITY];
+
+
+//
+// flip one bit in nErrors different bytes of frame, like Softuart timing jitter does
+//
+static void ICACHE_FLASH_ATTR benchFecDamage(uint8_t *dataBuffer, uint8_t nCount, uint8_t nErrors)
+{
+	uint8_t n = 0, i, position;
+	uint8_t used[RS_MAX_PARITY];
+
+	while (n < nErrors)
+	{
+		position = benchRandom() % nCount;
+		for (i = 0; i < n; i++)
+			if (used[i] == position)
+				break;
+		if (i < n)
+			continue;
+		used[n++] = position;
+		dataBuffer[position] ^= 1 << (benchRandom() % 8);
+	}
+}
+
+
+//
+// encode random frames with 4 and 8 parity bytes, damage 0 .. 5 bytes per frame
+// print frames repaired, dropped as uncorrectable, wrongly repaired
+// (left for the CRC check), and cycles per byte to encode / decode
+//
+void ICACHE_FLASH_ATTR benchFec(void)
+{
+	static const uint8_t parities[] = { 4, 8 };
+	RsCodec codec;
+	uint8_t p, nErrors, nCorrected;
+	uint16_t i, n;
+
+	os_printf("fec: parity errors frames repaired dropped wrong encode[c/B] decode[c/B]\r\n");
+	for (p = 0; p < sizeof(parities); p++)
+	{
+		BenchCycles start, encodeCycles;
+		uint32_t nBytes = 0;
+
+		rsInit(&codec, parities[p]);
+		for (i = 0; i < BENCH_FRAMES; i++)
+		{
+			rawCount[i] = benchMakeFrame(BENCH_DATA_RANDOM, i, rawFrames[i]);
+			nBytes += rawCount[i];
+		}
+
+		start = benchCycles();
+		for (n = 0; n < BENCH_REPEAT; n++)
+			for (i = 0; i < BENCH_FRAMES; i++)
+			{
+				os_memcpy(codeFrames[i], rawFrames[i], rawCount[i]);
+				codeCount[i] = rsEncode(&codec, codeFrames[i], rawCount[i]);
+			}
+		encodeCycles = benchCycles() - start;
+
+		for (nErrors = 0; nErrors <= 5; nErrors++)
+		{
+			BenchCycles decodeCycles = 0;
+			uint32_t nRepaired = 0, nDropped = 0, nWrong = 0;
+
+			for (n = 0; n < BENCH_REPEAT; n++)
+				for (i = 0; i < BENCH_FRAMES; i++)
+				{
+					uint8_t nData;
+
+					os_memcpy(errorFrame, codeFrames[i], codeCount[i]);
+					benchFecDamage(errorFrame, codeCount[i], nErrors);
+					start = benchCycles();
+					nData = rsDecode(&codec, errorFrame, codeCount[i], &nCorrected);
+					decodeCycles += benchCycles() - start;
+					if (nData == 0)
+						nDropped++;
+					else if (os_memcmp(errorFrame, rawFrames[i], rawCount[i]) == 0)
+						nRepaired++;
+					else
+						nWrong++;
+				}
+
+			os_printf("fec: %d %d %u %u %u %u ", parities[p], nErrors,
+				(unsigned) (BENCH_FRAMES * BENCH_REPEAT), (unsigned) nRepaired, (unsigned) nDropped, (unsigned) nWrong);
+			benchPrintFixed(encodeCycles, (uint64_t) nBytes * BENCH_REPEAT);
+			os_printf(" ");
+			benchPrintFixed(decodeCycles, (uint64_t) nBytes * BENCH_REPEAT);
+			os_printf("\r\n");
+		}
+	}
+}
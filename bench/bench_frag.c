@@ -0,0 +1,127 @@
+/*
+* esp-just-slip - bench_frag.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "frag.h"
+#include "slipcodec.h"
+#include "crc32.h"
+
+// config blob sent in fragments
+#ifdef __ets__
+#define BENCH_BLOB_SIZE 1024
+#else
+#define BENCH_BLOB_SIZE 4096
+#endif
+// time to send one frame of BENCH_FRAME_SIZE bytes at 57600 bps [us]
+#define BENCH_SLOT_US (BENCH_FRAME_SIZE * 10 * 1000000 / 57600)
+
+static ChannelMux benchMux;
+static uint8_t benchBlob[BENCH_BLOB_SIZE];
+static uint8_t benchReassembled[BENCH_BLOB_SIZE];
+
+
+//
+// send BENCH_BLOB_SIZE bytes in fragments over CHANNEL_BULK
+// while a command is queued on CHANNEL_CONTROL every 5th slot
+// print fragments, wire bytes of blob, overhead [%], maximum delay of commands [ms],
+// cycles per byte to fragment, and to SLIP decode and reassemble in place,
+// and whether blob and commands arrived intact
+//
+void ICACHE_FLASH_ATTR benchFrag(void)
+{
+	uint8_t frameBuffer[CHANNEL_MAX_PAYLOAD + 1 + 2];
+	uint8_t commandBuffer[CHANNEL_MAX_PAYLOAD + 1 + 2];
+	uint8_t encoded[SLIP_MAX_ENCODED(sizeof(frameBuffer))];
+	uint8_t nCount, id, *queued;
+	uint16_t i, nEncoded, nMessage = 0, nReceived, slot;
+	uint32_t nFragments = 0, nWire = 0, nCommands = 0, nCommandsOk = 0;
+	BenchCycles start, cycles = 0;
+	FragSender sender;
+	FragReassembler reassembler;
+
+	for (i = 0; i < BENCH_BLOB_SIZE; i++)
+		benchBlob[i] = (uint8_t) benchRandom();
+	os_memset(benchReassembled, 0, BENCH_BLOB_SIZE);
+
+	channelInit(&benchMux);
+	fragSenderInit(&sender, 1, benchBlob, BENCH_BLOB_SIZE, FRAG_MAX_PAYLOAD);
+	fragReassemblerInit(&reassembler, benchReassembled, BENCH_BLOB_SIZE);
+
+	for (slot = 0; nMessage == 0 && slot < 0xFFFF; slot++)
+	{
+		uint32_t now = (uint32_t) slot * BENCH_SLOT_US;
+
+		if (slot % 5 == 0)
+		{
+			nCount = benchMakeFrame(BENCH_DATA_DIAG, slot, frameBuffer);
+			channelQueue(&benchMux, CHANNEL_CONTROL, frameBuffer, nCount, now);
+		}
+		// fragments are built right in the queue of CHANNEL_BULK
+		start = benchCycles();
+		while ((queued = channelSlot(&benchMux, CHANNEL_BULK)) != NULL && (nCount = fragNext(&sender, queued)) > 0)
+			channelCommit(&benchMux, CHANNEL_BULK, nCount, now);
+		cycles += benchCycles() - start;
+
+		nCount = channelNext(&benchMux, frameBuffer, now);
+		if (nCount == 0)
+			continue;
+		nCount = appendCrc(CRC_16, frameBuffer, nCount, sizeof(frameBuffer));
+		nEncoded = slipEncodeFrame(frameBuffer, nCount, encoded);
+		if (frameBuffer[0] == CHANNEL_BULK)
+		{
+			nFragments++;
+			nWire += nEncoded;
+		}
+		else
+			nCommands++;
+
+		start = benchCycles();
+		for (i = 0; i < nEncoded; i++)
+		{
+			nReceived = fragDecodeByte(&reassembler, encoded[i], commandBuffer, sizeof(commandBuffer), &id);
+			if (nReceived > 0 && id == CHANNEL_BULK)
+				nMessage = nReceived;
+			else if (nReceived > 0 && nReceived == nCount && os_memcmp(commandBuffer, frameBuffer, nCount) == 0)
+				nCommandsOk++;
+		}
+		cycles += benchCycles() - start;
+	}
+
+	os_printf("frag: bytes fragments wire overhead[%%] command_max[ms] frag[c/B] result\r\n");
+	os_printf("frag: %d %u %u ", BENCH_BLOB_SIZE, (unsigned) nFragments, (unsigned) nWire);
+	benchPrintFixed((uint64_t) (nWire - BENCH_BLOB_SIZE) * 100, BENCH_BLOB_SIZE);
+	os_printf(" ");
+	benchPrintFixed(benchMux.channel[CHANNEL_CONTROL].stats.delayMax, 1000);
+	os_printf(" ");
+	benchPrintFixed(cycles, BENCH_BLOB_SIZE);
+	os_printf(" %s\r\n", (nMessage == BENCH_BLOB_SIZE && os_memcmp(benchBlob, benchReassembled, BENCH_BLOB_SIZE) == 0
+		&& nCommandsOk == nCommands) ? "ok" : "FAILED");
+}
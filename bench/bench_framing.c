@@ -0,0 +1,115 @@
+/*
+* esp-just-slip - bench_framing.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "framing.h"
+
+static uint8_t rawFrames[BENCH_FRAMES][BENCH_FRAME_SIZE];
+static uint8_t rawCount[BENCH_FRAMES];
+static uint8_t wireFrames[BENCH_FRAMES][FRAMING_MAX_ENCODED(BENCH_FRAME_SIZE)];
+static uint16_t wireCount[BENCH_FRAMES];
+static uint8_t checkBuffer[BENCH_FRAME_SIZE];
+
+
+//
+// feed encoded frame to decoder byte by byte
+// returned value - number of decoded bytes
+//
+static uint16_t ICACHE_FLASH_ATTR benchDecodeFrame(FramingDecoder *decoder, const uint8_t *wireBuffer, uint16_t nWire)
+{
+	uint16_t i, nCount = 0;
+
+	for (i = 0; i < nWire; i++)
+		nCount = framingDecodeByte(decoder, wireBuffer[i], checkBuffer, sizeof(checkBuffer));
+	return nCount;
+}
+
+
+//
+// encode and decode each data set with every framing mode BENCH_REPEAT times
+// print wire overhead and cycles per payload byte
+//
+// overhead - (wire bytes - payload bytes) / payload bytes, delimiters included
+// worst - largest overhead of a single frame in bytes
+//
+void ICACHE_FLASH_ATTR benchFraming(void)
+{
+	FramingMode mode;
+	BenchData data;
+
+	os_printf("framing: mode data frames bytes wire overhead worst encode[c/B] decode[c/B]\r\n");
+	for (mode = FRAMING_SLIP; mode <= FRAMING_HDLC; mode++)
+		for (data = 0; data < BENCH_DATA_COUNT; data++)
+		{
+			FramingDecoder decoder;
+			BenchCycles start, encodeCycles, decodeCycles;
+			uint32_t nBytes = 0, nWire = 0, nErrors = 0;
+			uint16_t i, n, nWorst = 0;
+
+			for (i = 0; i < BENCH_FRAMES; i++)
+			{
+				rawCount[i] = benchMakeFrame(data, i, rawFrames[i]);
+				nBytes += rawCount[i];
+			}
+
+			start = benchCycles();
+			for (n = 0; n < BENCH_REPEAT; n++)
+				for (i = 0; i < BENCH_FRAMES; i++)
+					wireCount[i] = framingEncode(mode, rawFrames[i], rawCount[i], wireFrames[i]);
+			encodeCycles = benchCycles() - start;
+
+			framingDecoderInit(&decoder, mode);
+			start = benchCycles();
+			for (n = 0; n < BENCH_REPEAT; n++)
+				for (i = 0; i < BENCH_FRAMES; i++)
+					benchDecodeFrame(&decoder, wireFrames[i], wireCount[i]);
+			decodeCycles = benchCycles() - start;
+
+			for (i = 0; i < BENCH_FRAMES; i++)
+			{
+				nWire += wireCount[i];
+				if (wireCount[i] - rawCount[i] > nWorst)
+					nWorst = wireCount[i] - rawCount[i];
+				if (benchDecodeFrame(&decoder, wireFrames[i], wireCount[i]) != rawCount[i]
+					|| os_memcmp(checkBuffer, rawFrames[i], rawCount[i]) != 0)
+					nErrors++;
+			}
+
+			os_printf("framing: %s %s %d %u %u ", framingName(mode), benchDataName(data),
+				BENCH_FRAMES, (unsigned) nBytes, (unsigned) nWire);
+			benchPrintFixed(100 * (uint64_t) (nWire - nBytes), nBytes);
+			os_printf("%% %u ", nWorst);
+			benchPrintFixed(encodeCycles, (uint64_t) nBytes * BENCH_REPEAT);
+			os_printf(" ");
+			benchPrintFixed(decodeCycles, (uint64_t) nBytes * BENCH_REPEAT);
+			os_printf(nErrors ? " round trip FAILED!\r\n" : "\r\n");
+		}
+}
@@ -0,0 +1,119 @@
+/*
+* esp-just-slip - bench_lzss.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "lzss.h"
+
+static uint8_t rawFrames[BENCH_FRAMES][BENCH_FRAME_SIZE];
+static uint8_t rawCount[BENCH_FRAMES];
+static uint8_t packedFrames[BENCH_FRAMES][BENCH_FRAME_SIZE + 1];
+static uint8_t packedCount[BENCH_FRAMES];
+static uint8_t checkBuffer[BENCH_FRAME_SIZE];
+
+
+//
+// compress and decompress each data set BENCH_REPEAT times
+// print compression ratio and cycles per input byte
+//
+// dict - whether the preset dictionary has been set
+// ratio - compressed bytes including flag byte / raw bytes
+// raw - number of frames sent with COMPRESS_FLAG_RAW
+//
+static void ICACHE_FLASH_ATTR benchLzssRun(const char *dict)
+{
+	BenchData data;
+
+	for (data = 0; data < BENCH_DATA_COUNT; data++)
+	{
+		BenchCycles start, compressCycles, decompressCycles;
+		uint32_t nBytes = 0, nPacked = 0, nRaw = 0, nErrors = 0;
+		uint16_t i, n;
+
+		for (i = 0; i < BENCH_FRAMES; i++)
+		{
+			rawCount[i] = benchMakeFrame(data, i, rawFrames[i]);
+			nBytes += rawCount[i];
+		}
+
+		start = benchCycles();
+		for (n = 0; n < BENCH_REPEAT; n++)
+			for (i = 0; i < BENCH_FRAMES; i++)
+				packedCount[i] = compressFrame(rawFrames[i], rawCount[i], packedFrames[i]);
+		compressCycles = benchCycles() - start;
+
+		start = benchCycles();
+		for (n = 0; n < BENCH_REPEAT; n++)
+			for (i = 0; i < BENCH_FRAMES; i++)
+				decompressFrame(packedFrames[i], packedCount[i], checkBuffer, sizeof(checkBuffer));
+		decompressCycles = benchCycles() - start;
+
+		for (i = 0; i < BENCH_FRAMES; i++)
+		{
+			nPacked += packedCount[i];
+			if (packedFrames[i][0] == COMPRESS_FLAG_RAW)
+				nRaw++;
+			if (decompressFrame(packedFrames[i], packedCount[i], checkBuffer, sizeof(checkBuffer)) != rawCount[i]
+				|| os_memcmp(checkBuffer, rawFrames[i], rawCount[i]) != 0)
+				nErrors++;
+		}
+
+		os_printf("lzss: %s %s %d %u %u ", benchDataName(data), dict, BENCH_FRAMES, (unsigned) nBytes, (unsigned) nPacked);
+		benchPrintFixed(100 * (uint64_t) nPacked, nBytes);
+		os_printf("%% %u ", (unsigned) nRaw);
+		benchPrintFixed(compressCycles, (uint64_t) nBytes * BENCH_REPEAT);
+		os_printf(" ");
+		benchPrintFixed(decompressCycles, (uint64_t) nBytes * BENCH_REPEAT);
+		os_printf(nErrors ? " round trip FAILED!\r\n" : "\r\n");
+	}
+}
+
+
+//
+// run LZSS benchmark without and with a preset dictionary
+// the dictionary holds one sample frame of each telemetry data set
+//
+void ICACHE_FLASH_ATTR benchLzss(void)
+{
+	uint8_t dictionary[3 * BENCH_FRAME_SIZE];
+	uint8_t nCount = 0;
+
+	os_printf("lzss: data dict frames bytes packed ratio raw compress[c/B] decompress[c/B]\r\n");
+
+	lzssSetDictionary(NULL, 0);
+	benchLzssRun("none");
+
+	nCount += benchMakeFrame(BENCH_DATA_SENSOR, 0, dictionary + nCount);
+	nCount += benchMakeFrame(BENCH_DATA_LOG, 0, dictionary + nCount);
+	nCount += benchMakeFrame(BENCH_DATA_ASCII, 0, dictionary + nCount);
+	lzssSetDictionary(dictionary, nCount);
+	benchLzssRun("preset");
+	lzssSetDictionary(NULL, 0);
+}
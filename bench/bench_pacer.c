@@ -0,0 +1,146 @@
+/*
+* esp-just-slip - bench_pacer.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "pacer.h"
+#include "slipcodec.h"
+
+// time to send one byte at 57600 bps [us]
+#define BENCH_BYTE_US (10 * 1000000 / 57600)
+// simulated time [us]
+#define BENCH_PACER_TIME 10000000
+// receiver takes bytes out of its input buffer at this rate [bytes per second]
+#define BENCH_RECEIVER_RATE 2000
+#define BENCH_RECEIVER_BUFFER 64
+// receiver reports its counters this often [us]
+#define BENCH_REPORT_US 100000
+// frames waiting to go out on the wire
+#define BENCH_TX_FRAMES 8
+
+static Pacer benchBucket;
+
+
+//
+// send diag frames over a 57600 bps link to a receiver that takes
+// BENCH_RECEIVER_RATE bytes per second into a buffer of BENCH_RECEIVER_BUFFER bytes,
+// like a sketch polling its serial port in a busy loop
+// a frame with any byte dropped on buffer overflow is lost
+//
+// config - name of configuration
+// period - send one frame every period [us], 0 to use the pacer
+// rate - initial rate of pacer [bytes per second]
+// adaptive - let the pacer follow reports of the receiver
+//
+static void ICACHE_FLASH_ATTR benchPacerRun(const char *config, uint32_t period, uint32_t rate, bool adaptive)
+{
+	uint8_t frameBuffer[BENCH_FRAME_SIZE + 2];
+	uint8_t nLength[BENCH_TX_FRAMES];
+	bool damaged[BENCH_TX_FRAMES];
+	uint8_t nHead = 0, nQueued = 0, nCount;
+	uint16_t nFrame = 0;
+	uint32_t now, nextSend = 0, nextReport = BENCH_REPORT_US;
+	uint32_t nSent = 0, nDelivered = 0, nLost = 0, nOverflow = 0;
+	uint32_t nBuffered = 0, drained = 0;
+
+	pacerInit(&benchBucket, rate, BENCH_FRAME_SIZE, 0);
+	if (adaptive)
+		pacerAdapt(&benchBucket, 100, 57600 / 10);
+
+	for (now = 0; now < BENCH_PACER_TIME; now += BENCH_BYTE_US)
+	{
+		// sender
+		if (nQueued < BENCH_TX_FRAMES && (period ? now >= nextSend : pacerReady(&benchBucket, now)))
+		{
+			uint8_t nTail = (nHead + nQueued) % BENCH_TX_FRAMES;
+
+			nCount = benchMakeFrame(BENCH_DATA_DIAG, nFrame++, frameBuffer);
+			frameBuffer[nCount] = frameBuffer[nCount + 1] = 0;
+			nLength[nTail] = (uint8_t) slipEncodedSize(frameBuffer, nCount + 2);
+			damaged[nTail] = false;
+			nQueued++;
+			nSent++;
+			nextSend += period;
+			pacerCharge(&benchBucket, nLength[nTail]);
+		}
+
+		// one byte on the wire
+		if (nQueued > 0)
+		{
+			if (nBuffered < BENCH_RECEIVER_BUFFER)
+				nBuffered++;
+			else
+			{
+				damaged[nHead] = true;
+				nOverflow++;
+			}
+			if (--nLength[nHead] == 0)
+			{
+				if (damaged[nHead])
+					nLost++;
+				else
+					nDelivered++;
+				nHead = (nHead + 1) % BENCH_TX_FRAMES;
+				nQueued--;
+			}
+		}
+
+		// receiver
+		drained += BENCH_RECEIVER_RATE * BENCH_BYTE_US;
+		while (drained >= 1000000)
+		{
+			drained -= 1000000;
+			if (nBuffered > 0)
+				nBuffered--;
+		}
+		if (now >= nextReport)
+		{
+			nextReport += BENCH_REPORT_US;
+			pacerFeedback(&benchBucket, nLost, nOverflow);
+		}
+	}
+
+	os_printf("pacer: %s %u %u %u %u %u\r\n", config, (unsigned) nSent, (unsigned) nDelivered, (unsigned) nLost,
+		(unsigned) (nDelivered * 1000000ull / BENCH_PACER_TIME), (unsigned) (period ? 0 : benchBucket.rate));
+}
+
+
+//
+// compare fixed send periods with fixed and adaptive token bucket pacing
+//
+void ICACHE_FLASH_ATTR benchPacer(void)
+{
+	os_printf("pacer: config sent delivered lost frames/s rate[B/s]\r\n");
+	benchPacerRun("timer_30ms", 30000, 0, false);
+	benchPacerRun("timer_5ms", 5000, 0, false);
+	benchPacerRun("bucket_500", 0, 500, false);
+	benchPacerRun("bucket_5760", 0, 5760, false);
+	benchPacerRun("adaptive", 0, 500, true);
+}
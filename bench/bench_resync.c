@@ -0,0 +1,164 @@
+/*
+* esp-just-slip - bench_resync.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "slipcodec.h"
+
+// time to send one byte at 57600 bps [us]
+#define BENCH_BYTE_US (10 * 1000000 / 57600)
+// bytes taken from the line per poll
+#define BENCH_POLL_BYTES 16
+// frame that gets damaged
+#define BENCH_FAULT_FRAME (BENCH_FRAMES / 2)
+
+typedef enum {
+	BENCH_FAULT_NONE,
+	BENCH_FAULT_ESCAPE,
+	BENCH_FAULT_END,
+	BENCH_FAULT_RESET,
+	BENCH_FAULT_NOISE,
+	BENCH_FAULT_COUNT
+} BenchFault;
+
+static const char *benchFaultNames[BENCH_FAULT_COUNT] = { "none", "bad_escape", "lost_end", "peer_reset", "noise" };
+
+static uint8_t rawFrames[BENCH_FRAMES][BENCH_FRAME_SIZE];
+static uint8_t rawCount[BENCH_FRAMES];
+static uint8_t wireBuffer[BENCH_FRAMES * SLIP_MAX_ENCODED(BENCH_FRAME_SIZE) + 32];
+
+
+//
+// build the stream of SLIP frames with one fault in frame BENCH_FAULT_FRAME
+// - bad_escape - SLIP_ESC followed by a plain byte in the middle of the frame
+// - lost_end - SLIP_END of the frame missing, it runs into the next one
+// - peer_reset - sender stops in the middle of the frame, then starts over after a pause
+// - noise - burst of random bytes on the line between frames
+//
+// *nGap - offset in stream where the line goes quiet for 100 ms, 0 if it does not
+//
+// returned value - number of bytes in wireBuffer
+//
+static uint16_t ICACHE_FLASH_ATTR benchResyncStream(BenchFault fault, uint16_t *nGap)
+{
+	uint16_t i, n, nWire = 0;
+
+	*nGap = 0;
+	for (i = 0; i < BENCH_FRAMES; i++)
+	{
+		n = slipEncodeFrame(rawFrames[i], rawCount[i], wireBuffer + nWire);
+		if (i == BENCH_FAULT_FRAME)
+		{
+			switch (fault)
+			{
+				case BENCH_FAULT_ESCAPE:
+					os_memmove(wireBuffer + nWire + n / 2 + 1, wireBuffer + nWire + n / 2, n - n / 2);
+					wireBuffer[nWire + n / 2] = SLIP_ESC;
+					wireBuffer[nWire + n / 2 + 1] = 'x';
+					n++;
+					break;
+				case BENCH_FAULT_END:
+					n--;
+					break;
+				case BENCH_FAULT_RESET:
+					n /= 2;
+					*nGap = nWire + n;
+					break;
+				case BENCH_FAULT_NOISE:
+					for (; n < rawCount[i] + 16; n++)
+						wireBuffer[nWire + n] = (uint8_t) benchRandom();
+					break;
+				default:
+					break;
+			}
+		}
+		nWire += n;
+	}
+	return nWire;
+}
+
+
+//
+// feed damaged streams to the decoder polled BENCH_POLL_BYTES at a time
+// print frames delivered intact, frames lost and frames delivered damaged
+//
+void ICACHE_FLASH_ATTR benchResync(void)
+{
+	BenchFault fault;
+	uint16_t i;
+
+	for (i = 0; i < BENCH_FRAMES; i++)
+		rawCount[i] = benchMakeFrame(BENCH_DATA_SENSOR, i, rawFrames[i]);
+
+	os_printf("resync: fault frames intact lost damaged\r\n");
+	for (fault = 0; fault < BENCH_FAULT_COUNT; fault++)
+	{
+		SlipDecoder decoder;
+		uint8_t dataBuffer[BENCH_FRAME_SIZE];
+		uint16_t nGap, nWire, nPos = 0, nUsed, nCount, nNext = 0;
+		uint32_t nIntact = 0, nDamaged = 0, now;
+
+		nWire = benchResyncStream(fault, &nGap);
+		slipDecoderInit(&decoder);
+		decoder.time = 0;
+		while (nPos < nWire)
+		{
+			uint16_t nPoll = (nWire - nPos < BENCH_POLL_BYTES) ? nWire - nPos : BENCH_POLL_BYTES;
+
+			// stop polling at the quiet moment
+			if (nGap > nPos && nPos + nPoll > nGap)
+				nPoll = nGap - nPos;
+			now = (uint32_t) nPos * BENCH_BYTE_US + ((nGap > 0 && nPos >= nGap) ? 100000 : 0);
+			slipDecoderGap(&decoder, now, SLIP_GAP_US);
+
+			while (nPoll > 0)
+			{
+				nCount = slipDecodeSpan(&decoder, wireBuffer + nPos, nPoll, &nUsed, dataBuffer, sizeof(dataBuffer));
+				nPos += nUsed;
+				nPoll -= nUsed;
+				if (nCount == 0)
+					continue;
+				// look for the frame among the ones not yet delivered
+				for (i = nNext; i < BENCH_FRAMES; i++)
+					if (rawCount[i] == nCount && os_memcmp(rawFrames[i], dataBuffer, nCount) == 0)
+						break;
+				if (i < BENCH_FRAMES)
+				{
+					nIntact++;
+					nNext = i + 1;
+				}
+				else
+					nDamaged++;
+			}
+		}
+		os_printf("resync: %s %d %u %u %u\r\n", benchFaultNames[fault], BENCH_FRAMES,
+			(unsigned) nIntact, (unsigned) (BENCH_FRAMES - nIntact), (unsigned) nDamaged);
+	}
+}
@@ -0,0 +1,194 @@
+/*
+* esp-just-slip - bench_stream.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "slipcodec.h"
+#include "slipstream.h"
+#include "crc32.h"
+
+// size of image streamed as a single frame, much larger than RAM available to a buffered decoder
+#ifdef __ets__
+#define BENCH_STREAM_SIZE (64 * 1024UL)
+#else
+#define BENCH_STREAM_SIZE (1024 * 1024UL)
+#endif
+// wire bytes fed at a time, like a span of UART0 receive buffer
+#define BENCH_STREAM_SPAN 128
+
+//
+// consumer of decoded payload, stands in for a flash writer or a hash
+//
+typedef struct {
+	uint32_t hash;
+	uint32_t nTotal;
+	uint32_t nChunks;
+	uint16_t nMaxChunk;
+	uint8_t nFrames;
+	SlipStreamStatus status;
+} BenchStreamSink;
+
+static uint8_t benchStreamWire[BENCH_STREAM_SPAN + 2];
+
+
+static void ICACHE_FLASH_ATTR benchStreamBegin(void *context)
+{
+	BenchStreamSink *sink = (BenchStreamSink *) context;
+
+	sink->hash = 0;
+	sink->nChunks = 0;
+}
+
+
+static void ICACHE_FLASH_ATTR benchStreamData(void *context, const uint8_t *chunk, uint16_t nCount)
+{
+	BenchStreamSink *sink = (BenchStreamSink *) context;
+
+	sink->hash = crc32Data(chunk, nCount, sink->hash);
+	sink->nChunks++;
+	if (nCount > sink->nMaxChunk)
+		sink->nMaxChunk = nCount;
+}
+
+
+static void ICACHE_FLASH_ATTR benchStreamEnd(void *context, SlipStreamStatus status, uint32_t nTotal)
+{
+	BenchStreamSink *sink = (BenchStreamSink *) context;
+
+	sink->status = status;
+	sink->nTotal = nTotal;
+	sink->nFrames++;
+}
+
+
+//
+// send an image of BENCH_STREAM_SIZE bytes of data set as one frame with check value crc,
+// SLIP encoded in spans of BENCH_STREAM_SPAN wire bytes, to stream decoder
+// the image is generated on the fly, no buffer holds it
+//
+// nCorrupt - wire byte to flip, 0 for none
+// *hash - crc32Data() of the image sent
+//
+// returned value - cycles taken by slipStreamFeed()
+//
+static BenchCycles ICACHE_FLASH_ATTR benchStreamSend(SlipStream *stream, BenchData data, CrcMode crc,
+	uint32_t nCorrupt, uint32_t *hash)
+{
+	uint8_t frame[BENCH_FRAME_SIZE + CRC_MAX_SIZE];
+	BenchCycles cycles = 0, start;
+	uint32_t nSent = 0, nWire = 0, acc = 0;
+	uint16_t nFrame = 0, nPos = 0;
+	uint8_t n, i, nCrc;
+
+	*hash = 0;
+	while (nSent < BENCH_STREAM_SIZE)
+	{
+		n = benchMakeFrame(data, nFrame++, frame);
+		if (n > BENCH_STREAM_SIZE - nSent)
+			n = BENCH_STREAM_SIZE - nSent;
+		*hash = crc32Data(frame, n, *hash);
+		acc = crcUpdate(crc, acc, frame, n);
+		nSent += n;
+		if (nSent == BENCH_STREAM_SIZE)
+		{
+			// check value goes after the last payload byte, most significant byte first
+			nCrc = crcSize(crc);
+			for (i = 0; i < nCrc; i++)
+				frame[n + i] = (uint8_t) (acc >> (8 * (nCrc - 1 - i)));
+			n += nCrc;
+		}
+		for (i = 0; i < n; i++)
+		{
+			nPos += slipEncodeByte(frame[i], benchStreamWire + nPos);
+			if (nPos >= BENCH_STREAM_SPAN)
+			{
+				if (nCorrupt > nWire && nCorrupt <= nWire + nPos)
+					benchStreamWire[nCorrupt - nWire - 1] ^= 0x01;
+				nWire += nPos;
+				start = benchCycles();
+				slipStreamFeed(stream, benchStreamWire, nPos);
+				cycles += benchCycles() - start;
+				nPos = 0;
+			}
+		}
+	}
+	benchStreamWire[nPos++] = SLIP_END;
+	start = benchCycles();
+	slipStreamFeed(stream, benchStreamWire, nPos);
+	cycles += benchCycles() - start;
+	return cycles;
+}
+
+
+//
+// stream decode of a large frame with slipStreamFeed() and chunk callbacks
+//
+// An image of BENCH_STREAM_SIZE bytes (1 MB on host, 64 KB on ESP8266) is sent
+// as a single SLIP frame and hashed by the consumer as chunks arrive.
+// The only memory used is SlipStream, printed as RAM[B].
+//
+// chunks - data() callbacks per frame, c/B - cycles per payload byte
+// including callbacks, MB/s - payload bytes per second from benchCycleRate()
+// The same image with one wire byte flipped must end with status SLIP_STREAM_BAD_CRC.
+//
+void ICACHE_FLASH_ATTR benchStream(void)
+{
+	static const BenchData sets[] = { BENCH_DATA_SENSOR, BENCH_DATA_ASCII, BENCH_DATA_RANDOM, BENCH_DATA_SLIP_END };
+	static const CrcMode modes[] = { CRC_16, CRC_32C };
+	static const char *modeNames[] = { "crc16", "crc32c" };
+	uint64_t rate = benchCycleRate();
+	BenchStreamSink sink;
+	SlipStream stream;
+	BenchCycles cycles;
+	uint32_t hash;
+	uint8_t s, m;
+
+	os_printf("stream: image %u B, RAM %u B\r\n", (unsigned) BENCH_STREAM_SIZE, (unsigned) sizeof(SlipStream));
+	os_printf("stream: data check chunks max_chunk c/B MB/s corrupted\r\n");
+	for (s = 0; s < sizeof(sets) / sizeof(sets[0]); s++)
+		for (m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+		{
+			os_memset(&sink, 0, sizeof(sink));
+			slipStreamInit(&stream, modes[m], benchStreamBegin, benchStreamData, benchStreamEnd, &sink);
+			cycles = benchStreamSend(&stream, sets[s], modes[m], 0, &hash);
+			if (sink.nFrames != 1 || sink.status != SLIP_STREAM_OK || sink.nTotal != BENCH_STREAM_SIZE || sink.hash != hash)
+				os_printf("stream: %s %s round trip FAILED!\r\n", benchDataName(sets[s]), modeNames[m]);
+
+			os_printf("stream: %s %s %u %u ", benchDataName(sets[s]), modeNames[m], (unsigned) sink.nChunks, sink.nMaxChunk);
+			benchPrintFixed(cycles, BENCH_STREAM_SIZE);
+			os_printf(" ");
+			benchPrintFixed((uint64_t) BENCH_STREAM_SIZE * rate, (uint64_t) cycles * 1000000);
+
+			// one bit flipped in the middle of the image
+			os_memset(&sink, 0, sizeof(sink));
+			benchStreamSend(&stream, sets[s], modes[m], BENCH_STREAM_SIZE / 2, &hash);
+			os_printf(" %s\r\n", sink.nFrames == 1 && sink.status != SLIP_STREAM_OK ? "detected" : "MISSED!");
+		}
+}
@@ -0,0 +1,171 @@
+/*
+* esp-just-slip - bench_vector.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "slipcodec.h"
+#include "slipvec.h"
+#include "crc32.h"
+
+#ifdef __ets__
+#define BENCH_VECTOR_MAX 256
+#else
+#define BENCH_VECTOR_MAX 512
+#endif
+#define BENCH_VECTOR_HEADER 4
+
+// constant trailer, kept in flash on ESP8266 to take the aligned read path
+static const uint8_t benchVectorTrailer[8] ICACHE_RODATA_ATTR __attribute__((aligned(4))) =
+	{ 'E', 'S', 'P', 0xC0, 0xDB, 0x01, 0x02, 0x03 };
+
+static uint8_t payload[BENCH_VECTOR_MAX];
+static uint8_t frameBuffer[BENCH_VECTOR_HEADER + BENCH_VECTOR_MAX + sizeof(benchVectorTrailer) + CRC_MAX_SIZE] __attribute__((aligned(4)));
+static uint8_t wireBuffer[SLIP_MAX_ENCODED(sizeof(frameBuffer))];
+static uint8_t checkBuffer[SLIP_MAX_ENCODED(sizeof(frameBuffer))];
+static volatile uint32_t benchVectorSink;
+
+//
+// stands in for a port, wire bytes are copied to buffer given as context
+//
+typedef struct {
+	uint8_t *wire;
+	uint16_t nPos;
+} BenchVectorPort;
+
+
+static void ICACHE_FLASH_ATTR benchVectorWrite(void *context, const uint8_t *wire, uint16_t nCount)
+{
+	BenchVectorPort *port = (BenchVectorPort *) context;
+
+	os_memcpy(port->wire + port->nPos, wire, nCount);
+	port->nPos += nCount;
+}
+
+
+//
+// header, payload and trailer put together in a buffer, crc appended, SLIP encoded
+// and written to the port, as sendDiagBuffer() used to do
+//
+static uint16_t ICACHE_FLASH_ATTR benchVectorAssemble(uint32_t header, uint16_t nCount, CrcMode crc, uint8_t *wire)
+{
+	static uint8_t encoded[SLIP_MAX_ENCODED(sizeof(frameBuffer))];
+	BenchVectorPort port = { wire, 0 };
+	uint16_t nFrame = 0;
+
+	os_memcpy(frameBuffer, &header, BENCH_VECTOR_HEADER);
+	nFrame += BENCH_VECTOR_HEADER;
+	os_memcpy(frameBuffer + nFrame, payload, nCount);
+	nFrame += nCount;
+	// trailer and its place in frameBuffer are both 4 byte aligned, so memcpy reads flash in words
+	os_memcpy(frameBuffer + nFrame, benchVectorTrailer, sizeof(benchVectorTrailer));
+	nFrame += sizeof(benchVectorTrailer);
+	nFrame = appendCrc(crc, frameBuffer, nFrame, sizeof(frameBuffer));
+	benchVectorWrite(&port, encoded, slipEncodeFrame(frameBuffer, nFrame, encoded));
+	return port.nPos;
+}
+
+
+//
+// the same frame sent with slipEncodeVector(), no assembly buffer
+//
+static uint16_t ICACHE_FLASH_ATTR benchVectorEncode(uint32_t header, uint16_t nCount, CrcMode crc, uint8_t *wire)
+{
+	SlipSegment frame[] =
+	{
+		{ &header, BENCH_VECTOR_HEADER },
+		{ payload, nCount },
+		{ benchVectorTrailer, sizeof(benchVectorTrailer) }
+	};
+	BenchVectorPort port = { wire, 0 };
+
+	slipEncodeVector(frame, 3, crc, benchVectorWrite, &port);
+	return port.nPos;
+}
+
+
+//
+// scatter-gather encode of slipvec.h against building the frame in a buffer first
+//
+// A frame of 4 byte header, payload of sensor data and 8 byte constant trailer
+// (in flash on ESP8266) with CRC-16 or CRC-32C is encoded to wire bytes
+// both ways. Output must be the same.
+// RAM[B] - buffer the caller needs to assemble the frame, 0 with segments
+// c/B - cycles per data byte
+//
+void ICACHE_FLASH_ATTR benchVector(void)
+{
+	static const uint16_t sizes[] = { 8, 32, 128, BENCH_VECTOR_MAX };
+	static const CrcMode modes[] = { CRC_16, CRC_32C };
+	static const char *modeNames[] = { "crc16", "crc32c" };
+	uint16_t z, nCount, nWire, nFrame, nPos = 0, nRepeat;
+	BenchCycles assembled, vector, start;
+	uint32_t n, sink = 0;
+	uint8_t m, f = 0, frame[BENCH_FRAME_SIZE];
+
+	// payload of sensor records back to back
+	while (nPos < BENCH_VECTOR_MAX)
+	{
+		nFrame = benchMakeFrame(BENCH_DATA_SENSOR, f++, frame);
+		if (nFrame > BENCH_VECTOR_MAX - nPos)
+			nFrame = BENCH_VECTOR_MAX - nPos;
+		os_memcpy(payload + nPos, frame, nFrame);
+		nPos += nFrame;
+	}
+
+	os_printf("vector: check payload wire assembled[RAM B] assembled[c/B] vector[c/B]\r\n");
+	for (m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+		for (z = 0; z < sizeof(sizes) / sizeof(sizes[0]); z++)
+		{
+			nCount = sizes[z];
+			nFrame = BENCH_VECTOR_HEADER + nCount + sizeof(benchVectorTrailer);
+			nRepeat = BENCH_REPEAT * (BENCH_VECTOR_MAX / nCount);
+
+			nWire = benchVectorAssemble(0x12345678, nCount, modes[m], wireBuffer);
+			if (benchVectorEncode(0x12345678, nCount, modes[m], checkBuffer) != nWire
+				|| os_memcmp(wireBuffer, checkBuffer, nWire) != 0)
+				os_printf("vector: %s %u output differs FAILED!\r\n", modeNames[m], nCount);
+
+			start = benchCycles();
+			for (n = 0; n < nRepeat; n++)
+				sink += benchVectorAssemble(n, nCount, modes[m], wireBuffer);
+			assembled = benchCycles() - start;
+			start = benchCycles();
+			for (n = 0; n < nRepeat; n++)
+				sink += benchVectorEncode(n, nCount, modes[m], checkBuffer);
+			vector = benchCycles() - start;
+			benchVectorSink = sink;
+
+			os_printf("vector: %s %u %u %u ", modeNames[m], nCount, nWire, nFrame + crcSize(modes[m]));
+			benchPrintFixed(assembled, (uint64_t) nRepeat * nFrame);
+			os_printf(" ");
+			benchPrintFixed(vector, (uint64_t) nRepeat * nFrame);
+			os_printf("\r\n");
+		}
+}
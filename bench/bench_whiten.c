@@ -0,0 +1,93 @@
+/*
+* esp-just-slip - bench_whiten.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bench.h"
+#include "framing.h"
+#include "whiten.h"
+
+static uint8_t rawFrames[BENCH_FRAMES][BENCH_FRAME_SIZE];
+static uint8_t rawCount[BENCH_FRAMES];
+static uint8_t whiteFrames[BENCH_FRAMES][BENCH_FRAME_SIZE + 1];
+static uint8_t whiteCount[BENCH_FRAMES];
+static uint8_t wireBuffer[FRAMING_MAX_ENCODED(BENCH_FRAME_SIZE + 1)];
+static uint8_t checkBuffer[BENCH_FRAME_SIZE];
+
+
+//
+// whiten and unwhiten each data set BENCH_REPEAT times
+// print SLIP wire bytes without and with whitening and cycles per payload byte
+//
+void ICACHE_FLASH_ATTR benchWhiten(void)
+{
+	BenchData data;
+
+	os_printf("whiten: data frames bytes slip whitened whiten[c/B] unwhiten[c/B]\r\n");
+	for (data = 0; data < BENCH_DATA_COUNT; data++)
+	{
+		BenchCycles start, whitenCycles, unwhitenCycles;
+		uint32_t nBytes = 0, nPlain = 0, nWhite = 0, nErrors = 0;
+		uint16_t i, n;
+
+		for (i = 0; i < BENCH_FRAMES; i++)
+		{
+			rawCount[i] = benchMakeFrame(data, i, rawFrames[i]);
+			nBytes += rawCount[i];
+		}
+
+		start = benchCycles();
+		for (n = 0; n < BENCH_REPEAT; n++)
+			for (i = 0; i < BENCH_FRAMES; i++)
+				whiteCount[i] = whitenFrame(rawFrames[i], rawCount[i], whiteFrames[i]);
+		whitenCycles = benchCycles() - start;
+
+		start = benchCycles();
+		for (n = 0; n < BENCH_REPEAT; n++)
+			for (i = 0; i < BENCH_FRAMES; i++)
+				unwhitenFrame(whiteFrames[i], whiteCount[i], checkBuffer);
+		unwhitenCycles = benchCycles() - start;
+
+		for (i = 0; i < BENCH_FRAMES; i++)
+		{
+			nPlain += framingEncode(FRAMING_SLIP, rawFrames[i], rawCount[i], wireBuffer);
+			nWhite += framingEncode(FRAMING_SLIP, whiteFrames[i], whiteCount[i], wireBuffer);
+			if (unwhitenFrame(whiteFrames[i], whiteCount[i], checkBuffer) != rawCount[i]
+				|| os_memcmp(checkBuffer, rawFrames[i], rawCount[i]) != 0)
+				nErrors++;
+		}
+
+		os_printf("whiten: %s %d %u %u %u ", benchDataName(data), BENCH_FRAMES,
+			(unsigned) nBytes, (unsigned) nPlain, (unsigned) nWhite);
+		benchPrintFixed(whitenCycles, (uint64_t) nBytes * BENCH_REPEAT);
+		os_printf(" ");
+		benchPrintFixed(unwhitenCycles, (uint64_t) nBytes * BENCH_REPEAT);
+		os_printf(nErrors ? " round trip FAILED!\r\n" : "\r\n");
+	}
+}
@@ -0,0 +1,148 @@
+/*
+* esp-just-slip - bench.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BENCH_INCLUDE_BENCH_H_
+#define BENCH_INCLUDE_BENCH_H_
+
+#include "slipport.h"
+
+//
+// cycle counter used to time benchmarks
+//
+// ESP8266 - CCOUNT special register, CPU clock cycles
+// x86 host - time stamp counter
+// other hosts - CLOCK_MONOTONIC in nanoseconds
+//
+#ifdef __ets__
+
+typedef uint32_t BenchCycles;
+
+static inline BenchCycles benchCycles(void)
+{
+	uint32_t ccount;
+	__asm__ __volatile__("rsr %0, ccount" : "=a" (ccount));
+	return ccount;
+}
+
+// number of times each data set is processed by a benchmark
+#define BENCH_REPEAT 10
+
+#else
+
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+typedef uint64_t BenchCycles;
+
+static inline BenchCycles benchCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (BenchCycles) ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+#define BENCH_REPEAT 1000
+
+#endif
+
+//
+// data sets used by the benchmarks
+//
+// BENCH_DATA_DIAG - packet number and 8 random bytes, as sent by sendDiagBuffer()
+// BENCH_DATA_SENSOR - binary sensor record, slowly changing 16 bit readings
+// BENCH_DATA_ASCII - text telemetry line, e.g. "T=23.51;H=45.20;P=1013.25;V=3.30;S=OK"
+// BENCH_DATA_LOG - text log line with repeating prefix
+// BENCH_DATA_RANDOM - BENCH_FRAME_SIZE random bytes
+// BENCH_DATA_SLIP_END, BENCH_DATA_SLIP_ESC, BENCH_DATA_ZERO, BENCH_DATA_HDLC_FLAG -
+//   BENCH_FRAME_SIZE bytes of 0xC0, 0xDB, 0x00 or 0x7E, worst cases for framing
+//
+typedef enum {
+	BENCH_DATA_DIAG,
+	BENCH_DATA_SENSOR,
+	BENCH_DATA_ASCII,
+	BENCH_DATA_LOG,
+	BENCH_DATA_RANDOM,
+	BENCH_DATA_SLIP_END,
+	BENCH_DATA_SLIP_ESC,
+	BENCH_DATA_ZERO,
+	BENCH_DATA_HDLC_FLAG,
+	BENCH_DATA_COUNT
+} BenchData;
+
+// frames generated per data set, fewer on ESP8266 to keep the frame buffers of all benchmarks in DRAM
+#ifdef __ets__
+#define BENCH_FRAMES 16
+#else
+#define BENCH_FRAMES 32
+#endif
+// largest frame produced by benchMakeFrame()
+#define BENCH_FRAME_SIZE 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// print machine readable lines for regression tracking, benchmarks that support it
+extern bool benchCsv;
+
+const char * ICACHE_FLASH_ATTR benchDataName(BenchData data);
+uint8_t ICACHE_FLASH_ATTR benchMakeFrame(BenchData data, uint16_t nFrame, uint8_t *dataBuffer);
+uint32_t ICACHE_FLASH_ATTR benchRandom(void);
+void ICACHE_FLASH_ATTR benchPrintFixed(uint64_t numerator, uint64_t denominator);
+uint64_t ICACHE_FLASH_ATTR benchCycleRate(void);
+
+void ICACHE_FLASH_ATTR benchLzss(void);
+void ICACHE_FLASH_ATTR benchFraming(void);
+void ICACHE_FLASH_ATTR benchWhiten(void);
+void ICACHE_FLASH_ATTR benchChannel(void);
+void ICACHE_FLASH_ATTR benchFrag(void);
+void ICACHE_FLASH_ATTR benchCrc(void);
+void ICACHE_FLASH_ATTR benchFec(void);
+void ICACHE_FLASH_ATTR benchResync(void);
+void ICACHE_FLASH_ATTR benchAggregate(void);
+void ICACHE_FLASH_ATTR benchPacer(void);
+void ICACHE_FLASH_ATTR benchBus(void);
+void ICACHE_FLASH_ATTR benchCodec(void);
+void ICACHE_FLASH_ATTR benchStream(void);
+void ICACHE_FLASH_ATTR benchVector(void);
+void ICACHE_FLASH_ATTR benchConst(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCH_INCLUDE_BENCH_H_ */
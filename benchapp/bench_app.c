@@ -0,0 +1,116 @@
+/*
+* esp-just-slip - bench_app.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <ets_sys.h>
+#include <osapi.h>
+#include <os_type.h>
+#include <user_interface.h>
+
+#include "driver/uart.h"
+#include "bench.h"
+#include "bench_board.h"
+
+//
+// firmware image that runs the benchmarks of bench/ and of bench_board.c on ESP8266
+// build with "make bench", results are printed on UART1 (GPIO2)
+//
+// set to true to print machine readable lines for a script reading UART1
+//
+#define BENCH_CSV false
+
+// time between benchmarks, lets the system tasks and watchdog run
+#define BENCH_NEXT_TIME 100
+
+typedef struct {
+	const char *name;
+	void (*run)(void);
+} FirmwareBench;
+
+static const FirmwareBench benchmarks[] =
+{
+	{ "codec", benchCodec },
+	{ "stream", benchStream },
+	{ "vector", benchVector },
+	{ "const", benchConst },
+	{ "framing", benchFraming },
+	{ "crc", benchCrc },
+	{ "resync", benchResync },
+	{ "whiten", benchWhiten },
+	{ "lzss", benchLzss },
+	{ "channel", benchChannel },
+	{ "frag", benchFrag },
+	{ "fec", benchFec },
+	{ "aggregate", benchAggregate },
+	{ "pacer", benchPacer },
+	{ "bus", benchBus },
+	{ "ring", benchRing },
+	{ "uart0", benchUart0 },
+	{ "softuart", benchSoftuart },
+};
+
+#define BENCH_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+static os_timer_t benchTimer;
+static uint8_t nextBench;
+
+
+//
+// run one benchmark per timer tick, a single long run would trip the watchdog
+//
+void ICACHE_FLASH_ATTR bench_cb(void *arg)
+{
+	if (nextBench == BENCH_COUNT)
+	{
+		benchBoardResults();
+		os_printf("bench: done\r\n");
+		return;
+	}
+	os_printf("bench: %s\r\n", benchmarks[nextBench].name);
+	system_soft_wdt_feed();
+	benchmarks[nextBench++].run();
+	os_timer_arm(&benchTimer, BENCH_NEXT_TIME, 0);
+}
+
+
+void ICACHE_FLASH_ATTR user_init(void)
+{
+	// UART1 Tx (no Rx) - GPIO2, bit rate != 0 directs os_printf() to UART1
+	uart_init(BIT_RATE_115200, BIT_RATE_115200);
+	system_set_os_print(1);
+
+	os_printf("\r\n");
+	os_printf("ESP8266 benchmarks (esp-just-slip), CPU %d MHz\r\n", system_get_cpu_freq());
+
+	benchCsv = BENCH_CSV;
+	os_timer_disarm(&benchTimer);
+	os_timer_setfn(&benchTimer, (os_timer_func_t *)bench_cb, (void *)0);
+	os_timer_arm(&benchTimer, BENCH_NEXT_TIME, 0);
+}
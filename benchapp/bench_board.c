@@ -0,0 +1,407 @@
+/*
+* esp-just-slip - bench_board.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <ets_sys.h>
+#include <osapi.h>
+#include <os_type.h>
+#include <user_interface.h>
+
+#include "driver/uart.h"
+#include "softuart.h"
+#include "justslip.h"
+#include "slipcodec.h"
+#include "bench.h"
+#include "bench_board.h"
+
+// UartDev is defined and initialized in rom code
+extern UartDevice UartDev;
+
+// rows of results table
+#define BENCH_RESULTS 32
+// ring is filled and read that many times
+#define BENCH_RING_ROUNDS (BENCH_REPEAT * 10)
+// time frames are sent at each UART0 rate [us]
+#define BENCH_UART0_TIME 250000
+// time to wait for the last frames sent or for the first frame to come back [us]
+#define BENCH_UART0_WAIT 20000
+// payload of UART0 test frames, packet number included
+#define BENCH_UART0_PAYLOAD 40
+// bytes sent to Softuart at each rate, in chunks that fit its receive buffer
+#define BENCH_SOFTUART_BYTES 256
+#define BENCH_SOFTUART_CHUNK 32
+// bytes timed at each rate of Softuart_Putchar()
+#define BENCH_SOFTUART_TX_BYTES 32
+
+//
+// row of results table
+//
+// name - what was measured
+// rate - bit rate of the link [bps], 0 if not a link
+// value - value * 100, printed with 2 decimals
+// unit - of value
+//
+typedef struct {
+	const char *name;
+	uint32_t rate;
+	uint32_t value;
+	const char *unit;
+} BenchBoardResult;
+
+static BenchBoardResult benchResults[BENCH_RESULTS];
+static uint8_t nResults;
+static Softuart benchSoftuartPort;
+
+
+//
+// keep a row of results table, value is numerator / denominator
+//
+static void ICACHE_FLASH_ATTR benchBoardResult(const char *name, uint32_t rate, uint64_t numerator,
+	uint64_t denominator, const char *unit)
+{
+	if (nResults == BENCH_RESULTS)
+		return;
+	benchResults[nResults].name = name;
+	benchResults[nResults].rate = rate;
+	benchResults[nResults].value = denominator ? (uint32_t) (numerator * 100 / denominator) : 0;
+	benchResults[nResults].unit = unit;
+	nResults++;
+}
+
+
+//
+// put bytes into UART0 receive ring the way uart0_rx_intr_handler() does,
+// including the check for a full ring, kept in IRAM like the handler
+//
+static void benchRingStore(const uint8_t *data, uint16_t nCount)
+{
+	RcvMsgBuff *ring = &UartDev.rcv_buff;
+	uint8_t *pNextPos;
+
+	while (nCount--)
+	{
+		pNextPos = ring->pWritePos + 1;
+		if (pNextPos == ring->pRcvMsgBuff + RX_BUFF_SIZE)
+			pNextPos = ring->pRcvMsgBuff;
+		if (pNextPos == ring->pReadPos)
+		{
+			data++;
+			continue;
+		}
+		*ring->pWritePos = *data++;
+		ring->pWritePos = pNextPos;
+	}
+}
+
+
+//
+// drop everything received on UART0 so far
+//
+static void ICACHE_FLASH_ATTR benchUart0Drain(void)
+{
+	uint8_t *rxData;
+	uint16_t nCount;
+
+	while ((nCount = uart0_rx_peek(&rxData)) > 0)
+		uart0_rx_skip(nCount);
+}
+
+
+//
+// UART0 receive ring operations, cycles per byte
+//
+// store - byte put in ring as by the interrupt handler
+// one_char - uart0_rx_one_char()
+// peek_skip - uart0_rx_peek() / uart0_rx_skip() of contiguous spans
+// decode - slipDecodeSerialUart0() of diag frames straight from the ring
+//
+void ICACHE_FLASH_ATTR benchRing(void)
+{
+	uint8_t wire[RX_BUFF_SIZE - 1], frame[BENCH_FRAME_SIZE + 2];
+	BenchCycles store = 0, oneChar = 0, peekSkip = 0, decode = 0, start;
+	uint32_t r, nFrames = 0, sink = 0;
+	uint16_t n, nWire = 0, nFrame = 0;
+	uint8_t *rxData;
+	int c;
+
+	// SLIP encoded diag frames with CRC16, as many as the ring holds
+	while (true)
+	{
+		n = appendCrc16(frame, benchMakeFrame(BENCH_DATA_DIAG, nFrame, frame));
+		if (nWire + slipEncodedSize(frame, n) > sizeof(wire))
+			break;
+		nWire += slipEncodeFrame(frame, n, wire + nWire);
+		nFrame++;
+	}
+
+	// nothing received may get in while the ring is filled here
+	ETS_UART_INTR_DISABLE();
+	benchUart0Drain();
+	for (r = 0; r < BENCH_RING_ROUNDS; r++)
+	{
+		start = benchCycles();
+		benchRingStore(wire, nWire);
+		store += benchCycles() - start;
+		start = benchCycles();
+		while ((c = uart0_rx_one_char()) != -1)
+			sink += c;
+		oneChar += benchCycles() - start;
+
+		benchRingStore(wire, nWire);
+		start = benchCycles();
+		while ((n = uart0_rx_peek(&rxData)) > 0)
+		{
+			sink += rxData[0];
+			uart0_rx_skip(n);
+		}
+		peekSkip += benchCycles() - start;
+
+		benchRingStore(wire, nWire);
+		start = benchCycles();
+		while (uart0_rx_peek(&rxData) > 0)
+			if (slipDecodeSerialUart0(frame) > 0)
+				nFrames++;
+		decode += benchCycles() - start;
+	}
+	ETS_UART_INTR_ENABLE();
+
+	if (nFrames != (uint32_t) nFrame * BENCH_RING_ROUNDS)
+		os_printf("ring: decoded %u of %u frames FAILED!\r\n", nFrames, (unsigned) nFrame * BENCH_RING_ROUNDS);
+	os_printf("ring: bytes store[c/B] one_char[c/B] peek_skip[c/B] decode[c/B]\r\n");
+	os_printf("ring: %u ", nWire);
+	benchPrintFixed(store, (uint64_t) nWire * BENCH_RING_ROUNDS);
+	os_printf(" ");
+	benchPrintFixed(oneChar, (uint64_t) nWire * BENCH_RING_ROUNDS);
+	os_printf(" ");
+	benchPrintFixed(peekSkip, (uint64_t) nWire * BENCH_RING_ROUNDS);
+	os_printf(" ");
+	benchPrintFixed(decode, (uint64_t) nWire * BENCH_RING_ROUNDS);
+	os_printf("\r\n");
+
+	benchBoardResult("ring_store", 0, store, (uint64_t) nWire * BENCH_RING_ROUNDS, "c/B");
+	benchBoardResult("ring_one_char", 0, oneChar, (uint64_t) nWire * BENCH_RING_ROUNDS, "c/B");
+	benchBoardResult("ring_peek_skip", 0, peekSkip, (uint64_t) nWire * BENCH_RING_ROUNDS, "c/B");
+	benchBoardResult("ring_decode", 0, decode, (uint64_t) nWire * BENCH_RING_ROUNDS, "c/B");
+}
+
+
+//
+// UART0 loopback, GPIO1 (TX) wired to GPIO3 (RX)
+//
+// Frames of BENCH_UART0_PAYLOAD bytes with CRC16 are written to TX FIFO as long as
+// it has room and decoded back from the receive ring in the same loop,
+// for BENCH_UART0_TIME at each rate.
+//
+// sent / received / crc_failed / lost - frames
+// payload[B/s] - payload of frames received per second
+// wire_load[%] - wire bytes sent / bytes the link carries in the same time
+//
+void ICACHE_FLASH_ATTR benchUart0(void)
+{
+	static const UartBautRate rates[] = { BIT_RATE_115200, BIT_RATE_230400, BIT_RATE_460800, BIT_RATE_921600 };
+	uint8_t frame[SLIP_BUFFER_SIZE], rxFrame[SLIP_BUFFER_SIZE];
+	uint8_t wire[SLIP_MAX_ENCODED(SLIP_BUFFER_SIZE)];
+	uint32_t nSent, nGood, nBad, nWireSent, start, now, last, maxRate = 0;
+	uint16_t i, nWire, nPos, nFree, nCount;
+	uint8_t r;
+
+	os_printf("uart0: rate sent received crc_failed lost payload[B/s] wire_load[%%]\r\n");
+	for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+	{
+		uart0_set_baud(rates[r]);
+		benchUart0Drain();
+		nSent = nGood = nBad = nWireSent = 0;
+		nWire = nPos = 0;
+		start = last = now = system_get_time();
+		while ((uint32_t) (now - start) < BENCH_UART0_TIME + BENCH_UART0_WAIT)
+		{
+			// next frame once the previous one is in TX FIFO
+			if (nPos == nWire && (uint32_t) (now - start) < BENCH_UART0_TIME)
+			{
+				os_memcpy(frame, &nSent, 4);
+				for (i = 4; i < BENCH_UART0_PAYLOAD; i++)
+					frame[i] = (uint8_t) benchRandom();
+				nWire = slipEncodeFrame(frame, appendCrc16(frame, BENCH_UART0_PAYLOAD), wire);
+				nPos = 0;
+				nSent++;
+			}
+			for (nFree = uart0_tx_free(); nFree > 0 && nPos < nWire; nFree--, nWireSent++)
+				uart0_tx_one_char(wire[nPos++]);
+			while ((nCount = slipDecodeSerialUart0(rxFrame)) > 0)
+			{
+				if (nCount == BENCH_UART0_PAYLOAD + 2 && checkCrc16(rxFrame, nCount))
+					nGood++;
+				else
+					nBad++;
+				last = system_get_time();
+			}
+			now = system_get_time();
+			if (nGood + nBad == 0 && (uint32_t) (now - start) > BENCH_UART0_WAIT)
+				break;
+			system_soft_wdt_feed();
+		}
+		if (nGood + nBad == 0)
+		{
+			os_printf("uart0: nothing received at %u bps, wire GPIO1 (TX) to GPIO3 (RX)\r\n", (unsigned) rates[r]);
+			break;
+		}
+		if (nGood == nSent)
+			maxRate = rates[r];
+
+		os_printf("uart0: %u %u %u %u %u ", (unsigned) rates[r], nSent, nGood, nBad, nSent - nGood - nBad);
+		benchPrintFixed((uint64_t) nGood * BENCH_UART0_PAYLOAD * 1000000, last - start);
+		os_printf(" ");
+		benchPrintFixed((uint64_t) nWireSent * 10 * 100 * 1000000, (uint64_t) rates[r] * (last - start));
+		os_printf("\r\n");
+		benchBoardResult("uart0_payload", rates[r], (uint64_t) nGood * BENCH_UART0_PAYLOAD * 1000000, last - start, "B/s");
+		benchBoardResult("uart0_lost", rates[r], (uint64_t) (nSent - nGood) * 100, nSent, "%");
+	}
+	uart0_set_baud(BIT_RATE_115200);
+	benchUart0Drain();
+	benchBoardResult("uart0_max", 0, maxRate, 1, "bps no loss");
+}
+
+
+//
+// Softuart on BENCH_SOFTUART_TX / BENCH_SOFTUART_RX
+//
+// tx[us/B] - Softuart_Putchar() of BENCH_SOFTUART_TX_BYTES bytes, nominal is 10 bit times
+// bit_time[us] - bit time Softuart_Init() rounded the rate to
+// rx / rx_os - bytes of BENCH_SOFTUART_BYTES received in place from UART0 TX,
+// without and with oversampling, and framing errors counted on the way
+//
+void ICACHE_FLASH_ATTR benchSoftuart(void)
+{
+	static const uint16_t rates[] = { 9600, 19200, 38400, 57600 };
+	Softuart *s = &benchSoftuartPort;
+	uint8_t pattern[BENCH_SOFTUART_BYTES];
+	uint32_t maxRate[2] = { 0, 0 };
+	uint32_t nOk, nErrors, nWait, start;
+	uint64_t rate = benchCycleRate();
+	BenchCycles cycles, startCycles;
+	uint16_t i, n, nPos;
+	uint8_t r, os;
+	bool looped = true;
+
+	// every byte value once, 0xC0 and 0xDB included
+	for (i = 0; i < BENCH_SOFTUART_BYTES; i++)
+		pattern[i] = (uint8_t) (i * 97 + 13);
+
+	Softuart_SetPinRx(s, BENCH_SOFTUART_RX);
+	Softuart_SetPinTx(s, BENCH_SOFTUART_TX);
+	os_printf("softuart: rate tx[us/B] nominal[us/B] bit_time[us] rx framing_errors rx_os framing_errors_os\r\n");
+	for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+	{
+		Softuart_Init(s, rates[r]);
+		system_soft_wdt_feed();
+
+		startCycles = benchCycles();
+		for (i = 0; i < BENCH_SOFTUART_TX_BYTES; i++)
+			Softuart_Putchar(s, pattern[i]);
+		cycles = benchCycles() - startCycles;
+
+		os_printf("softuart: %u ", rates[r]);
+		benchPrintFixed((uint64_t) cycles * 1000000, rate * BENCH_SOFTUART_TX_BYTES);
+		os_printf(" ");
+		benchPrintFixed(10 * 1000000, rates[r]);
+		os_printf(" %u", s->bit_time);
+		benchBoardResult("softuart_tx", rates[r], rate * BENCH_SOFTUART_TX_BYTES, cycles, "B/s");
+
+		// UART0 sends at the same rate, Softuart receives it
+		uart0_set_baud((UartBautRate) rates[r]);
+		// wait for a chunk - its bytes on the wire and 5 ms more
+		nWait = (uint32_t) BENCH_SOFTUART_CHUNK * 10 * 1000000 / rates[r] + 5000;
+		for (os = 0; os < 2 && looped; os++)
+		{
+			Softuart_EnableOversampling(s, os);
+			nOk = 0;
+			nErrors = s->framing_errors;
+			for (nPos = 0; nPos < BENCH_SOFTUART_BYTES; nPos += BENCH_SOFTUART_CHUNK)
+			{
+				while (Softuart_Available(s))
+					Softuart_Read(s);
+				uart0_tx_buffer(pattern + nPos, BENCH_SOFTUART_CHUNK);
+				n = 0;
+				start = system_get_time();
+				while (n < BENCH_SOFTUART_CHUNK && (uint32_t) (system_get_time() - start) < nWait)
+					if (Softuart_Available(s))
+						if (Softuart_Read(s) == pattern[nPos + n++])
+							nOk++;
+				// UART0 receives the same bytes
+				benchUart0Drain();
+				system_soft_wdt_feed();
+			}
+			nErrors = s->framing_errors - nErrors;
+			if (nOk == 0 && nErrors == 0)
+			{
+				looped = false;
+				break;
+			}
+			if (nOk == BENCH_SOFTUART_BYTES && nErrors == 0)
+				maxRate[os] = rates[r];
+			os_printf(" %u %u", nOk, nErrors);
+			benchBoardResult(os ? "softuart_rx_os" : "softuart_rx", rates[r], (uint64_t) nOk * 100, BENCH_SOFTUART_BYTES, "%");
+		}
+		os_printf("\r\n");
+	}
+	uart0_set_baud(BIT_RATE_115200);
+	benchUart0Drain();
+
+	if (looped == false)
+		os_printf("softuart: nothing received, wire GPIO1 (UART0 TX) to GPIO%u\r\n", BENCH_SOFTUART_RX);
+	else
+	{
+		benchBoardResult("softuart_rx_max", 0, maxRate[0], 1, "bps no errors");
+		benchBoardResult("softuart_rx_os_max", 0, maxRate[1], 1, "bps no errors");
+	}
+}
+
+
+//
+// table of results kept by benchRing(), benchUart0() and benchSoftuart()
+//
+// With benchCsv set one line per row is printed instead:
+// result,name,rate,value,unit
+//
+void ICACHE_FLASH_ATTR benchBoardResults(void)
+{
+	uint8_t i;
+
+	os_printf("results: chip %08x, SDK %s, CPU %d MHz\r\n", system_get_chip_id(),
+		system_get_sdk_version(), system_get_cpu_freq());
+	if (benchCsv)
+		os_printf("result,name,rate,value,unit\r\n");
+	else
+		os_printf("results: name rate value unit\r\n");
+	for (i = 0; i < nResults; i++)
+		os_printf(benchCsv ? "result,%s,%u,%u.%02u,%s\r\n" : "results: %-18s %6u %10u.%02u %s\r\n",
+			benchResults[i].name, benchResults[i].rate, benchResults[i].value / 100,
+			benchResults[i].value % 100, benchResults[i].unit);
+}
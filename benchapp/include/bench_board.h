@@ -0,0 +1,61 @@
+/*
+* esp-just-slip - bench_board.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef BENCHAPP_INCLUDE_BENCH_BOARD_H_
+#define BENCHAPP_INCLUDE_BENCH_BOARD_H_
+
+#include "os_type.h"
+
+//
+// Benchmarks of the ESP8266 peripherals used by the link, firmware only
+//
+// ring - UART0 receive ring buffer of driver/uart.c: store as the interrupt
+//   handler does, uart0_rx_one_char(), uart0_rx_peek() / uart0_rx_skip()
+//   and SLIP decode straight from the ring with slipDecodeSerialUart0()
+// uart0 - SLIP frames with CRC16 sent on UART0 TX and received back on UART0 RX
+//   at 115200 to 921600 bps, needs GPIO1 (TX) wired to GPIO3 (RX)
+// softuart - Softuart_Putchar() byte time and Softuart reception of bytes sent
+//   by UART0 at 9600 to 57600 bps, with and without oversampling,
+//   needs GPIO1 (UART0 TX) wired to BENCH_SOFTUART_RX as well
+//
+// Key numbers of each are kept and printed as one table by benchBoardResults()
+// after all benchmarks ran, to compare boards and releases.
+//
+#define BENCH_SOFTUART_RX 14  // LoLin D5
+#define BENCH_SOFTUART_TX 12  // LoLin D6
+
+
+void ICACHE_FLASH_ATTR benchRing(void);
+void ICACHE_FLASH_ATTR benchUart0(void);
+void ICACHE_FLASH_ATTR benchSoftuart(void);
+void ICACHE_FLASH_ATTR benchBoardResults(void);
+
+#endif /* BENCHAPP_INCLUDE_BENCH_BOARD_H_ */
@@ -19,6 +19,11 @@
 // UartDev is defined and initialized in rom code.
 extern UartDevice UartDev;
 
+// bit rate UART0 runs at, UartDev.baut_rate is left at the one of UART1 by uart_init
+LOCAL UartBautRate uart0_baut_rate = BIT_RATE_115200;
+// bytes dropped by uart0_rx_intr_handler because the rx ring buffer was full
+LOCAL volatile uint32 uart0_rx_overflow = 0;
+
 LOCAL void uart0_rx_intr_handler(void *para);
 
 /******************************************************************************
@@ -53,13 +58,13 @@ uart_config(uint8 uart_no)
     SET_PERI_REG_MASK(UART_CONF0(uart_no), UART_RXFIFO_RST | UART_TXFIFO_RST);
     CLEAR_PERI_REG_MASK(UART_CONF0(uart_no), UART_RXFIFO_RST | UART_TXFIFO_RST);
 
-    //set rx fifo trigger
-    WRITE_PERI_REG(UART_CONF1(uart_no), (UartDev.rcv_buff.TrigLvl & UART_RXFIFO_FULL_THRHD) << UART_RXFIFO_FULL_THRHD_S);
-
     //clear all interrupt
     WRITE_PERI_REG(UART_INT_CLR(uart_no), 0xffff);
-    //enable rx_interrupt
-    SET_PERI_REG_MASK(UART_INT_ENA(uart_no), UART_RXFIFO_FULL_INT_ENA);
+
+    if (uart_no == UART0) {
+        //set rx fifo trigger and timeout, enable rx interrupts
+        uart0_set_rx_trigger(UART0_RX_FULL_THRESHOLD, UART0_RX_TOUT_THRESHOLD);
+    }
 }
 
 
@@ -70,7 +75,7 @@ uart_config(uint8 uart_no)
  * Parameters   : char c - character to tx
  * Returns      : NONE
 *******************************************************************************/
-ICACHE_FLASH_ATTR
+void ICACHE_FLASH_ATTR
 uart0_tx_one_char(uint8 TxChar)
 {
     while (true)
@@ -159,36 +164,60 @@ uart0_rx_intr_handler(void *para)
      */
     RcvMsgBuff *pRxBuff = (RcvMsgBuff *)para;
     uint8 RcvChar;
+    uint8 fifo_cnt;
+    uint8 *pNextPos;
+    uint32 int_st = READ_PERI_REG(UART_INT_ST(UART0));
 
-    if (UART_RXFIFO_FULL_INT_ST != (READ_PERI_REG(UART_INT_ST(UART0)) & UART_RXFIFO_FULL_INT_ST)) {
+    // fifo reached threshold or line went idle with data left in fifo
+    if (0 == (int_st & (UART_RXFIFO_FULL_INT_ST | UART_RXFIFO_TOUT_INT_ST))) {
         return;
     }
 
-    WRITE_PERI_REG(UART_INT_CLR(UART0), UART_RXFIFO_FULL_INT_CLR);
-
-    while (READ_PERI_REG(UART_STATUS(UART0)) & (UART_RXFIFO_CNT << UART_RXFIFO_CNT_S)) {
-        RcvChar = READ_PERI_REG(UART_FIFO(UART0)) & 0xFF;
+    // clear before draining, a byte that comes in meanwhile raises timeout again
+    WRITE_PERI_REG(UART_INT_CLR(UART0), UART_RXFIFO_FULL_INT_CLR | UART_RXFIFO_TOUT_INT_CLR);
 
-        /* you can add your handle code below.*/
+    // drain in bursts of the count read, until the fifo reads empty
+    while ((fifo_cnt = (READ_PERI_REG(UART_STATUS(UART0)) >> UART_RXFIFO_CNT_S) & UART_RXFIFO_CNT) > 0) {
+        while (fifo_cnt--) {
+            RcvChar = READ_PERI_REG(UART_FIFO(UART0)) & 0xFF;
 
-        *(pRxBuff->pWritePos) = RcvChar;
+            pNextPos = pRxBuff->pWritePos + 1;
+            if (pNextPos == (pRxBuff->pRcvMsgBuff + RX_BUFF_SIZE)) {
+                pNextPos = pRxBuff->pRcvMsgBuff;
+            }
+            // ring full, drop the byte instead of writing over unread data
+            if (pNextPos == pRxBuff->pReadPos) {
+                uart0_rx_overflow++;
+                continue;
+            }
 
-        // insert here for get one command line from uart
-        if (RcvChar == '\r') {
-            pRxBuff->BuffState = WRITE_OVER;
-        }
+            *(pRxBuff->pWritePos) = RcvChar;
 
-        pRxBuff->pWritePos++;
+            // insert here for get one command line from uart
+            if (RcvChar == '\r') {
+                pRxBuff->BuffState = WRITE_OVER;
+            }
 
-        // if we hit the end of the buffer, loop back to the beginning
-        if (pRxBuff->pWritePos == (pRxBuff->pRcvMsgBuff + RX_BUFF_SIZE)) {
-            // overflow ...we may need more error handle here.
-            pRxBuff->pWritePos = pRxBuff->pRcvMsgBuff ;
+            pRxBuff->pWritePos = pNextPos;
         }
     }
 }
 
 
+/******************************************************************************
+ * FunctionName : uart0_rx_overflows
+ * Description  : bytes dropped because the rx ring buffer was full,
+ *                e.g. uart_read_cb() does not keep up with the bit rate
+ * Parameters   : NONE
+ * Returns      : number of bytes dropped since start
+*******************************************************************************/
+uint32 ICACHE_FLASH_ATTR
+uart0_rx_overflows(void)
+{
+    return uart0_rx_overflow;
+}
+
+
 /******************************************************************************
  ref. http://41j.com/blog/2015/01/esp8266-serial-uart0-txrx/
 *******************************************************************************/
@@ -205,6 +234,59 @@ int uart0_rx_one_char()
   return ret;
 }
 
+/******************************************************************************
+ * FunctionName : uart0_rx_peek
+ * Description  : get received data straight from the rx ring buffer
+ *                without copying, see uart0_rx_skip
+ * Parameters   : uint8 **buf - set to the first received byte
+ * Returns      : number of contiguous bytes at *buf, 0 if nothing received
+*******************************************************************************/
+uint16 ICACHE_FLASH_ATTR
+uart0_rx_peek(uint8 **buf)
+{
+    // read write position once, interrupt handler may advance it meanwhile
+    uint8 *pWritePos = UartDev.rcv_buff.pWritePos;
+
+    *buf = UartDev.rcv_buff.pReadPos;
+    if (pWritePos >= UartDev.rcv_buff.pReadPos) {
+        return pWritePos - UartDev.rcv_buff.pReadPos;
+    }
+    // data wraps around, return the part up to the end of the buffer
+    return UartDev.rcv_buff.pRcvMsgBuff + RX_BUFF_SIZE - UartDev.rcv_buff.pReadPos;
+}
+
+/******************************************************************************
+ * FunctionName : uart0_rx_skip
+ * Description  : release bytes of rx ring buffer consumed after uart0_rx_peek
+ * Parameters   : uint16 len - number of bytes, up to the value returned by uart0_rx_peek
+ * Returns      : NONE
+*******************************************************************************/
+void ICACHE_FLASH_ATTR
+uart0_rx_skip(uint16 len)
+{
+    uint8 *pReadPos = UartDev.rcv_buff.pReadPos + len;
+
+    if (pReadPos == (UartDev.rcv_buff.pRcvMsgBuff + RX_BUFF_SIZE)) {
+        pReadPos = UartDev.rcv_buff.pRcvMsgBuff;
+    }
+    UartDev.rcv_buff.pReadPos = pReadPos;
+}
+
+/******************************************************************************
+ * FunctionName : uart0_tx_free
+ * Description  : room left in uart0 tx fifo, that many bytes are taken
+ *                by uart0_tx_one_char without waiting
+ * Parameters   : NONE
+ * Returns      : number of bytes
+*******************************************************************************/
+uint16 ICACHE_FLASH_ATTR
+uart0_tx_free(void)
+{
+    uint32 fifo_cnt = (READ_PERI_REG(UART_STATUS(UART0)) >> UART_TXFIFO_CNT_S) & UART_TXFIFO_CNT;
+
+    return (fifo_cnt < 126) ? 126 - fifo_cnt : 0;
+}
+
 /******************************************************************************
  * FunctionName : uart0_tx_buffer
  * Description  : use uart0 to transfer buffer
@@ -222,6 +304,70 @@ uart0_tx_buffer(uint8 *buf, uint16 len)
     }
 }
 
+/******************************************************************************
+ * FunctionName : uart1_tx_buffer
+ * Description  : use uart1 to transfer buffer as it is, no '\n' translation
+ *                e.g. binary capture of the link next to debug output
+ * Parameters   : uint8 *buf - point to send buffer
+ *                uint16 len - buffer len
+ * Returns      : NONE
+*******************************************************************************/
+void ICACHE_FLASH_ATTR
+uart1_tx_buffer(uint8 *buf, uint16 len)
+{
+    uint16 i;
+
+    for (i = 0; i < len; i++) {
+        uart1_tx_one_char(buf[i]);
+    }
+}
+
+/******************************************************************************
+ * FunctionName : uart0_set_rx_trigger
+ * Description  : set when UART0 rx interrupt fires
+ *                a high fifo threshold gives fewer interrupts for bulk traffic,
+ *                the timeout still picks up the tail of a short frame
+ * Parameters   : uint8 full - number of bytes in rx fifo (1..127) that trigger interrupt
+ *                uint8 timeout - idle time in character times (1..127) after which
+ *                                bytes left in rx fifo trigger interrupt, 0 to disable
+ * Returns      : NONE
+*******************************************************************************/
+void ICACHE_FLASH_ATTR
+uart0_set_rx_trigger(uint8 full, uint8 timeout)
+{
+    uint32 conf1 = (full & UART_RXFIFO_FULL_THRHD) << UART_RXFIFO_FULL_THRHD_S;
+
+    if (timeout > 0) {
+        conf1 |= ((timeout & UART_RX_TOUT_THRHD) << UART_RX_TOUT_THRHD_S) | UART_RX_TOUT_EN;
+    }
+    WRITE_PERI_REG(UART_CONF1(UART0), conf1);
+
+    if (timeout > 0) {
+        SET_PERI_REG_MASK(UART_INT_ENA(UART0), UART_RXFIFO_FULL_INT_ENA | UART_RXFIFO_TOUT_INT_ENA);
+    } else {
+        CLEAR_PERI_REG_MASK(UART_INT_ENA(UART0), UART_RXFIFO_TOUT_INT_ENA);
+        SET_PERI_REG_MASK(UART_INT_ENA(UART0), UART_RXFIFO_FULL_INT_ENA);
+    }
+}
+
+/******************************************************************************
+ * FunctionName : uart0_set_baud
+ * Description  : change bit rate of UART0 once pending data has been sent
+ * Parameters   : UartBautRate baud - new bit rate
+ * Returns      : NONE
+*******************************************************************************/
+void ICACHE_FLASH_ATTR
+uart0_set_baud(UartBautRate baud)
+{
+    // wait until tx fifo is empty and the last character leaves shift register
+    while (READ_PERI_REG(UART_STATUS(UART0)) & (UART_TXFIFO_CNT << UART_TXFIFO_CNT_S)) {
+    }
+    os_delay_us(10 * 1000000 / uart0_baut_rate + 1);
+
+    uart0_baut_rate = baud;
+    uart_div_modify(UART0, UART_CLK_FREQ / baud);
+}
+
 /******************************************************************************
  * FunctionName : uart_init
  * Description  : user interface for init uart
@@ -234,6 +380,7 @@ uart_init(UartBautRate uart0_br, UartBautRate uart1_br)
 {
     // rom use 74880 baut_rate, here reinitialise
     UartDev.baut_rate = uart0_br;
+    uart0_baut_rate = uart0_br;
     uart_config(UART0);
 
     if(uart1_br != 0){
@@ -0,0 +1,103 @@
+/*
+* esp-just-slip - bench_main.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+//
+// host front end for the benchmarks in bench/
+// run all benchmarks or only the ones named on the command line
+// -c - machine readable output of benchmarks that support it
+//
+typedef struct {
+	const char *name;
+	void (*run)(void);
+} HostBench;
+
+static const HostBench benchmarks[] =
+{
+	{ "lzss", benchLzss },
+	{ "framing", benchFraming },
+	{ "whiten", benchWhiten },
+	{ "channel", benchChannel },
+	{ "frag", benchFrag },
+	{ "crc", benchCrc },
+	{ "fec", benchFec },
+	{ "resync", benchResync },
+	{ "aggregate", benchAggregate },
+	{ "pacer", benchPacer },
+	{ "bus", benchBus },
+	{ "codec", benchCodec },
+	{ "stream", benchStream },
+	{ "vector", benchVector },
+	{ "const", benchConst },
+};
+
+#define BENCH_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+
+int main(int argc, char *argv[])
+{
+	unsigned i;
+	int n, first = 1;
+
+	if (argc > 1 && strcmp(argv[1], "-c") == 0)
+	{
+		benchCsv = true;
+		first = 2;
+	}
+
+	if (argc == first)
+	{
+		for (i = 0; i < BENCH_COUNT; i++)
+			benchmarks[i].run();
+		return 0;
+	}
+
+	for (n = first; n < argc; n++)
+	{
+		for (i = 0; i < BENCH_COUNT; i++)
+			if (strcmp(argv[n], benchmarks[i].name) == 0)
+				break;
+		if (i == BENCH_COUNT)
+		{
+			fprintf(stderr, "usage: %s [-c] [benchmark...]\nbenchmarks:", argv[0]);
+			for (i = 0; i < BENCH_COUNT; i++)
+				fprintf(stderr, " %s", benchmarks[i].name);
+			fprintf(stderr, "\n");
+			return 1;
+		}
+		benchmarks[i].run();
+	}
+	return 0;
+}
@@ -0,0 +1,767 @@
+/*
+* esp-just-slip - linksim.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "framing.h"
+#include "crc32.h"
+#include "pacer.h"
+#include "autobaud.h"
+
+//
+// Link simulator - two codec endpoints connected by a simulated serial wire
+//
+// sender: frame every period, each at random time within one poll of receiver,
+//   or when pacer allows -> appendCrc() -> framingEncode()
+//   -> TX buffer of txSize bytes, frame dropped if it does not fit
+// wire: one byte per 10 bit times at baud, random idle gap of up to gap us
+//   before each byte, each bit flipped with probability ber,
+//   each byte lost with probability drop
+// receiver: FIFO of rxSize bytes, bytes arriving when it is full are dropped,
+//   polled every poll us like uart_read_cb() -> framingDecoderGap()
+//   -> framingDecodeByte() -> checkCrc(), which like slipDecodeSerialUart0()
+//   takes bytes only up to the end of one frame per poll
+//
+// Each frame carries its sequence number, so the receiver counts lost frames
+// and compares frames that passed the check with what was sent. A frame that
+// passed the check but differs is an undetected error, the exit status is 1.
+// With -a the receiver reports its loss counters every 100 ms as slipd -r does
+// (pacerMakeReport()) and the pacer of the sender follows them (pacerReport()),
+// the reverse channel is ideal.
+//
+// With -A autobaud.c runs instead, a leader and a follower each polled every
+// poll us like user_main.c, over a wire in both directions that carries rates
+// up to -L and, from the middle of the run, up to -D. Both ends must settle
+// at the same rate each time, on a wire without -e and -d at the fastest one
+// it carries, otherwise the exit status is 1.
+//
+// Time is simulated, results depend only on options and seed.
+// Decoder prints its messages as it does on ESP8266, e.g. on invalid escape.
+//
+#define SIM_MAX_PAYLOAD 255
+#define SIM_MAX_TX 4096
+#define SIM_MAX_RX 4096
+// sent frames kept to compare with received ones, a power of 2
+#define SIM_HISTORY 1024
+#define SIM_REPORT_US 100000
+// longest time frames still on the way are delivered after the sender stops
+#define SIM_DRAIN_US 1000000
+// probability of a bit flip at rates above what the wire carries, see -L
+#define SIM_OVER_BER 1e-2
+
+typedef struct {
+	// options
+	unsigned baud;
+	unsigned gap;
+	double ber;
+	double drop;
+	unsigned txSize;
+	unsigned rxSize;
+	unsigned poll;
+	unsigned payload;
+	unsigned period;
+	unsigned rate;
+	bool adaptive;
+	bool autobaud;
+	unsigned limit;
+	unsigned limitLater;
+	unsigned seconds;
+	uint64_t seed;
+	FramingMode mode;
+	CrcMode crc;
+	// state of random generator
+	uint64_t state;
+	// sender
+	Pacer pacer;
+	uint32_t nSeq;
+	uint8_t tx[SIM_MAX_TX];
+	unsigned nTxHead;
+	unsigned nTxCount;
+	uint8_t sent[SIM_HISTORY][SIM_MAX_PAYLOAD];
+	uint64_t sentTime[SIM_HISTORY];
+	// receiver
+	uint8_t rx[SIM_MAX_RX];
+	unsigned nRxHead;
+	unsigned nRxCount;
+	FramingDecoder decoder;
+	uint8_t frame[SIM_MAX_PAYLOAD + CRC_MAX_SIZE];
+	uint32_t nExpected;
+	// counters
+	uint32_t nSent;
+	uint32_t nTxFull;
+	uint32_t nWireBytes;
+	uint32_t nFlipped;
+	uint32_t nDropped;
+	uint32_t nOverflow;
+	uint32_t nDelivered;
+	uint32_t nCheckFailed;
+	uint32_t nLost;
+	uint32_t nUndetected;
+	uint64_t latencyMin;
+	uint64_t latencySum;
+	uint64_t latencyMax;
+	uint64_t busyTime;
+} LinkSim;
+
+static LinkSim sim;
+
+
+//
+// xorshift64* - the same sequence on every host for the same seed
+//
+static uint64_t simRandom(LinkSim *s)
+{
+	s->state ^= s->state >> 12;
+	s->state ^= s->state << 25;
+	s->state ^= s->state >> 27;
+	return s->state * 2685821657736338717ull;
+}
+
+
+static double simChance(LinkSim *s)
+{
+	return (simRandom(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+//
+// make next frame, keep a copy and queue it for the wire
+//
+static void simSend(LinkSim *s, uint64_t now)
+{
+	uint8_t data[SIM_MAX_PAYLOAD + CRC_MAX_SIZE];
+	uint8_t wire[FRAMING_MAX_ENCODED(SIM_MAX_PAYLOAD + CRC_MAX_SIZE)];
+	uint16_t nCount, nWire, i;
+	uint8_t *copy = s->sent[s->nSeq % SIM_HISTORY];
+
+	os_memcpy(data, &s->nSeq, 4);
+	for (i = 4; i < s->payload; i++)
+		data[i] = (uint8_t) simRandom(s);
+	nCount = appendCrc(s->crc, data, s->payload, sizeof(data));
+	nWire = framingEncode(s->mode, data, nCount, wire);
+
+	os_memcpy(copy, data, s->payload);
+	s->sentTime[s->nSeq % SIM_HISTORY] = now;
+	s->nSeq++;
+	s->nSent++;
+	if (s->nTxCount + nWire > s->txSize)
+	{
+		s->nTxFull++;
+		return;
+	}
+	if (s->rate)
+		pacerCharge(&s->pacer, nWire);
+	for (i = 0; i < nWire; i++)
+		s->tx[(s->nTxHead + s->nTxCount + i) % SIM_MAX_TX] = wire[i];
+	s->nTxCount += nWire;
+}
+
+
+//
+// check decoded frame against what was sent
+//
+static void simReceive(LinkSim *s, uint16_t nCount, uint64_t now)
+{
+	uint8_t nCrc = crcSize(s->crc);
+	uint64_t latency;
+	uint32_t nSeq;
+
+	if (nCount <= nCrc || !checkCrc(s->crc, s->frame, nCount))
+	{
+		s->nCheckFailed++;
+		return;
+	}
+	nCount -= nCrc;
+	os_memcpy(&nSeq, s->frame, 4);
+	if (nCount != s->payload || s->nSeq - nSeq > SIM_HISTORY || nSeq >= s->nSeq ||
+		os_memcmp(s->frame, s->sent[nSeq % SIM_HISTORY], nCount) != 0)
+	{
+		s->nUndetected++;
+		return;
+	}
+	if (nSeq > s->nExpected)
+		s->nLost += nSeq - s->nExpected;
+	s->nExpected = nSeq + 1;
+	s->nDelivered++;
+	latency = now - s->sentTime[nSeq % SIM_HISTORY];
+	s->latencySum += latency;
+	if (latency < s->latencyMin)
+		s->latencyMin = latency;
+	if (latency > s->latencyMax)
+		s->latencyMax = latency;
+}
+
+
+//
+// run simulation, all times in ns
+//
+static void simRun(LinkSim *s)
+{
+	uint64_t end = (uint64_t) s->seconds * 1000000000ull;
+	uint64_t byteTime = 10000000000ull / s->baud;
+	uint64_t now = 0, frameBase = 0, nextFrame = 0, nextPoll, nextReport = SIM_REPORT_US * 1000ull;
+	uint64_t wireDone = 0;
+	bool onWire = false;
+	uint8_t wireByte = 0;
+	uint8_t report[PACER_REPORT_SIZE];
+	uint16_t nCount;
+	int bit;
+
+	// receiver polls at random phase to frames of sender, drawn again for each frame
+	// below, otherwise with period a multiple of poll every frame waits the same
+	nextPoll = simRandom(s) % (s->poll * 1000ull);
+	s->latencyMin = UINT64_MAX;
+	framingDecoderInit(&s->decoder, s->mode);
+	if (s->rate)
+	{
+		pacerInit(&s->pacer, s->rate, 64, 0);
+		if (s->adaptive)
+			pacerAdapt(&s->pacer, s->rate / 8 + 1, s->baud / 10);
+	}
+
+	// after the end wire and receiver drain, so frames on the way are not counted as lost
+	while (now < end || ((onWire || s->nTxCount > 0 || s->nRxCount > 0) && now < end + SIM_DRAIN_US * 1000ull))
+	{
+		// sender
+		if (now < end && (s->rate ? pacerReady(&s->pacer, (uint32_t) (now / 1000)) : now >= nextFrame))
+		{
+			simSend(s, now);
+			frameBase += s->period * 1000ull;
+			nextFrame = frameBase + simRandom(s) % (s->poll * 1000ull);
+		}
+
+		// wire, byte goes out after a random idle gap
+		if (!onWire && s->nTxCount > 0)
+		{
+			wireByte = s->tx[s->nTxHead];
+			s->nTxHead = (s->nTxHead + 1) % SIM_MAX_TX;
+			s->nTxCount--;
+			wireDone = now + byteTime + (s->gap ? simRandom(s) % (s->gap * 1000ull + 1) : 0);
+			s->busyTime += byteTime;
+			onWire = true;
+		}
+		if (onWire && now >= wireDone)
+		{
+			onWire = false;
+			s->nWireBytes++;
+			for (bit = 0; bit < 8; bit++)
+				if (s->ber > 0 && simChance(s) < s->ber)
+				{
+					wireByte ^= 1 << bit;
+					s->nFlipped++;
+				}
+			if (s->drop > 0 && simChance(s) < s->drop)
+				s->nDropped++;
+			else if (s->nRxCount == s->rxSize)
+				s->nOverflow++;
+			else
+				s->rx[(s->nRxHead + s->nRxCount++) % SIM_MAX_RX] = wireByte;
+		}
+
+		// receiver
+		if (now >= nextPoll)
+		{
+			nextPoll += s->poll * 1000ull;
+			if (s->nRxCount > 0)
+				framingDecoderGap(&s->decoder, (uint32_t) (now / 1000), SLIP_GAP_US);
+			nCount = 0;
+			while (s->nRxCount > 0 && nCount == 0)
+			{
+				nCount = framingDecodeByte(&s->decoder, s->rx[s->nRxHead], s->frame, sizeof(s->frame));
+				s->nRxHead = (s->nRxHead + 1) % SIM_MAX_RX;
+				s->nRxCount--;
+			}
+			if (nCount > 0)
+				simReceive(s, nCount, now);
+		}
+		if (s->adaptive && now >= nextReport)
+		{
+			nextReport += SIM_REPORT_US * 1000ull;
+			nCount = pacerMakeReport(report, s->nLost + s->nCheckFailed, s->nOverflow);
+			pacerReport(&s->pacer, report, (uint8_t) nCount);
+		}
+
+		// jump to the next event
+		{
+			uint64_t next = nextPoll;
+
+			if (onWire && wireDone < next)
+				next = wireDone;
+			if (!onWire && s->nTxCount > 0)
+				next = now;
+			if (!s->rate && now < end && nextFrame < next)
+				next = nextFrame;
+			if (s->rate && now < end)
+			{
+				// pacer is checked every byte time
+				if (now + byteTime < next)
+					next = now + byteTime;
+			}
+			if (s->adaptive && nextReport < next)
+				next = nextReport;
+			now = next;
+		}
+	}
+}
+
+
+static void simPrint(LinkSim *s)
+{
+	uint64_t time = (uint64_t) s->seconds * 1000000000ull;
+	uint32_t nMissing = s->nSent - s->nDelivered;
+
+	printf("linksim: %s crc %s baud %u gap %u us ber %g drop %g tx %u rx %u poll %u us payload %u seed %llu\n",
+		framingName(s->mode), crcName(s->crc), s->baud, s->gap, s->ber, s->drop,
+		s->txSize, s->rxSize, s->poll, s->payload, (unsigned long long) s->seed);
+	printf("linksim: sent %u delivered %u missing %u (tx full %u, check failed %u) undetected %u\n",
+		(unsigned) s->nSent, (unsigned) s->nDelivered, (unsigned) nMissing, (unsigned) s->nTxFull,
+		(unsigned) s->nCheckFailed, (unsigned) s->nUndetected);
+	printf("linksim: wire bytes %u flipped bits %u dropped %u overflow %u wire busy %.1f%%\n",
+		(unsigned) s->nWireBytes, (unsigned) s->nFlipped, (unsigned) s->nDropped, (unsigned) s->nOverflow,
+		100.0 * s->busyTime / time);
+	printf("linksim: goodput %.0f B/s loss %.2f%% latency %.0f / %.0f / %.0f us",
+		(double) s->nDelivered * s->payload * 1e9 / time, s->nSent ? 100.0 * nMissing / s->nSent : 0.0,
+		s->nDelivered ? s->latencyMin / 1e3 : 0.0, s->nDelivered ? s->latencySum / 1e3 / s->nDelivered : 0.0,
+		s->latencyMax / 1e3);
+	if (s->rate)
+		printf(" rate %u B/s", (unsigned) s->pacer.rate);
+	printf("\n");
+}
+
+
+//
+// endpoint of autobaud simulation, UART0 and firmware loop of one side
+//
+// rate - bit rate UART0 is set to
+// tx / txRate - bytes to send and the rate each goes out at,
+//   bytes queued before a rate change leave at the old rate like uart0_set_baud() waits for
+// wireByte / wireRate / wireDone - byte being sent, its rate and when it is received
+// rx - FIFO of received bytes
+// nextSend - time of next data frame [ns]
+// nRateChanges - times rate was changed
+//
+typedef struct {
+	const char *name;
+	Autobaud autobaud;
+	UartBautRate rate;
+	uint8_t tx[SIM_MAX_TX];
+	UartBautRate txRate[SIM_MAX_TX];
+	unsigned nTxHead;
+	unsigned nTxCount;
+	bool onWire;
+	uint8_t wireByte;
+	UartBautRate wireRate;
+	uint64_t wireDone;
+	uint8_t rx[SIM_MAX_RX];
+	unsigned nRxHead;
+	unsigned nRxCount;
+	SlipDecoder decoder;
+	uint8_t frame[SIM_MAX_PAYLOAD + CRC_MAX_SIZE];
+	uint64_t nextPoll;
+	uint64_t nextSend;
+	uint32_t nSeq;
+	uint32_t nSent;
+	uint32_t nDelivered;
+	uint32_t nCheckFailed;
+	uint32_t nOverflow;
+	uint32_t nRateChanges;
+} SimEnd;
+
+// leader and follower, the one autobaud.c is called for and simulated time [ns]
+static SimEnd simEnds[2];
+static SimEnd *simCurrent;
+static uint64_t simNow;
+
+
+//
+// queue bytes to send at rate UART0 is set to now
+//
+static void simEndQueue(SimEnd *e, const uint8_t *wire, uint16_t nWire)
+{
+	uint16_t i;
+	unsigned nPos;
+
+	if (e->nTxCount + nWire > sim.txSize)
+		return;
+	for (i = 0; i < nWire; i++)
+	{
+		nPos = (e->nTxHead + e->nTxCount++) % SIM_MAX_TX;
+		e->tx[nPos] = wire[i];
+		e->txRate[nPos] = e->rate;
+	}
+}
+
+
+uint32_t autobaudHalTime(void)
+{
+	return (uint32_t) (simNow / 1000);
+}
+
+
+void autobaudHalSetRate(UartBautRate rate)
+{
+	if (rate != simCurrent->rate)
+	{
+		printf("linksim: %.3f s %s at %u baud\n", simNow / 1e9, simCurrent->name, (unsigned) rate);
+		simCurrent->nRateChanges++;
+	}
+	simCurrent->rate = rate;
+}
+
+
+void autobaudHalSend(const uint8_t *dataBuffer, uint8_t nCount)
+{
+	uint8_t wire[SLIP_MAX_ENCODED(255)];
+
+	simEndQueue(simCurrent, wire, slipEncodeFrame(dataBuffer, nCount, wire));
+}
+
+
+void autobaudHalSendWire(const SlipWire *frame)
+{
+	uint8_t wire[SLIP_WIRE_MAX];
+
+	simEndQueue(simCurrent, wire, slipWireCopy(frame, wire));
+}
+
+
+//
+// move bytes of one direction over the wire, from tx of e to rx of peer
+//
+// A byte sent at a rate other than the receiver is set to arrives as garbage.
+// At rates above limit each bit flips with probability SIM_OVER_BER,
+// as if the line could not carry them.
+//
+static void simWire(LinkSim *s, SimEnd *e, SimEnd *peer, unsigned limit)
+{
+	int bit;
+
+	if (!e->onWire && e->nTxCount > 0)
+	{
+		e->wireByte = e->tx[e->nTxHead];
+		e->wireRate = e->txRate[e->nTxHead];
+		e->nTxHead = (e->nTxHead + 1) % SIM_MAX_TX;
+		e->nTxCount--;
+		e->wireDone = simNow + 10000000000ull / e->wireRate + (s->gap ? simRandom(s) % (s->gap * 1000ull + 1) : 0);
+		e->onWire = true;
+	}
+	if (!e->onWire || simNow < e->wireDone)
+		return;
+
+	e->onWire = false;
+	s->nWireBytes++;
+	if (e->wireRate != peer->rate)
+		e->wireByte = (uint8_t) simRandom(s);
+	for (bit = 0; bit < 8; bit++)
+		if ((s->ber > 0 && simChance(s) < s->ber) || ((unsigned) e->wireRate > limit && simChance(s) < SIM_OVER_BER))
+		{
+			e->wireByte ^= 1 << bit;
+			s->nFlipped++;
+		}
+	if (s->drop > 0 && simChance(s) < s->drop)
+		s->nDropped++;
+	else if (peer->nRxCount == s->rxSize)
+		peer->nOverflow++;
+	else
+		peer->rx[(peer->nRxHead + peer->nRxCount++) % SIM_MAX_RX] = e->wireByte;
+}
+
+
+//
+// timer of firmware on one side, like uart_read_cb() and uart_send_cb() of user_main.c:
+// autobaudPoll(), decode of one frame, autobaudFrame(), then a data frame
+// every period while negotiation is not busy
+//
+static void simEndPoll(LinkSim *s, SimEnd *e)
+{
+	uint8_t data[SIM_MAX_PAYLOAD + CRC_MAX_SIZE];
+	uint16_t nCount = 0, i;
+
+	simCurrent = e;
+	autobaudPoll(&e->autobaud);
+
+	if (e->nRxCount > 0)
+		slipDecoderGap(&e->decoder, (uint32_t) (simNow / 1000), SLIP_GAP_US);
+	while (e->nRxCount > 0 && nCount == 0)
+	{
+		nCount = slipDecodeByte(&e->decoder, e->rx[e->nRxHead], e->frame, sizeof(e->frame));
+		e->nRxHead = (e->nRxHead + 1) % SIM_MAX_RX;
+		e->nRxCount--;
+	}
+	if (nCount > 0 && !autobaudFrame(&e->autobaud, e->frame, (uint8_t) nCount))
+	{
+		if (nCount > 2 && checkCrc(CRC_16, e->frame, nCount))
+			e->nDelivered++;
+		else
+			e->nCheckFailed++;
+	}
+
+	if (simNow >= e->nextSend && !autobaudBusy(&e->autobaud))
+	{
+		e->nextSend = simNow + s->period * 1000ull;
+		// sequence number first, like packet number of diag frames
+		os_memcpy(data, &e->nSeq, 4);
+		for (i = 4; i < s->payload; i++)
+			data[i] = (uint8_t) simRandom(s);
+		nCount = appendCrc(CRC_16, data, s->payload, sizeof(data));
+		e->nSeq++;
+		e->nSent++;
+		autobaudHalSend(data, (uint8_t) nCount);
+	}
+	simCurrent = NULL;
+}
+
+
+//
+// fastest rate of negotiation the wire carries below limit
+//
+static unsigned simExpectedRate(unsigned limit)
+{
+	static const unsigned rates[] = { 921600, 460800, 230400, 115200 };
+	unsigned i;
+
+	for (i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+		if (rates[i] <= limit)
+			return rates[i];
+	return AUTOBAUD_BASE_RATE;
+}
+
+
+//
+// both ends must be at the fastest rate the wire carries, unless -e or -d
+// spoil probes at lower rates as well
+//
+static bool simCheckRate(LinkSim *s, unsigned limit)
+{
+	unsigned expected = simExpectedRate(limit);
+	bool ok = simEnds[0].rate == simEnds[1].rate
+		&& !autobaudBusy(&simEnds[0].autobaud) && !autobaudBusy(&simEnds[1].autobaud);
+
+	printf("linksim: %.3f s wire carries %u baud, leader at %u, follower at %u",
+		simNow / 1e9, limit, (unsigned) simEnds[0].rate, (unsigned) simEnds[1].rate);
+	if (s->ber == 0 && s->drop == 0)
+	{
+		ok = ok && simEnds[0].rate == expected;
+		printf(", expected %u", expected);
+	}
+	printf("%s\n", ok ? "" : " FAILED");
+	return ok;
+}
+
+
+//
+// run autobaud.c leader against follower, all times in ns
+//
+// The wire carries rates up to s->limit, from the middle of the run
+// up to s->limitLater if given. Rates both ends settled at are checked at the
+// middle and at the end of the run.
+//
+// returned value - true if both ends settled at the expected rate each time
+//
+static bool simAutobaud(LinkSim *s)
+{
+	uint64_t end = (uint64_t) s->seconds * 1000000000ull;
+	uint64_t half = s->limitLater ? end / 2 : end;
+	unsigned limit = s->limit;
+	bool ok = true;
+	int i;
+
+	simEnds[0].name = "leader";
+	simEnds[1].name = "follower";
+	for (i = 0; i < 2; i++)
+	{
+		simCurrent = &simEnds[i];
+		simEnds[i].rate = AUTOBAUD_BASE_RATE;
+		autobaudInit(&simEnds[i].autobaud, i == 0 ? AUTOBAUD_LEADER : AUTOBAUD_FOLLOWER);
+		slipDecoderInit(&simEnds[i].decoder);
+		// timers of both sides run at random phase
+		simEnds[i].nextPoll = simRandom(s) % (s->poll * 1000ull);
+		simEnds[i].nextSend = simEnds[i].nextPoll;
+	}
+	simCurrent = &simEnds[0];
+	autobaudStart(&simEnds[0].autobaud);
+	simCurrent = NULL;
+
+	while (simNow < end)
+	{
+		if (simNow >= half && half < end)
+		{
+			ok = simCheckRate(s, limit) && ok;
+			limit = s->limitLater;
+			half = end;
+		}
+		for (i = 0; i < 2; i++)
+		{
+			simWire(s, &simEnds[i], &simEnds[1 - i], limit);
+			if (simNow >= simEnds[i].nextPoll)
+			{
+				simEnds[i].nextPoll += s->poll * 1000ull;
+				simEndPoll(s, &simEnds[i]);
+			}
+		}
+
+		// jump to the next event
+		{
+			uint64_t next = half < end ? half : end;
+
+			for (i = 0; i < 2; i++)
+			{
+				if (simEnds[i].nextPoll < next)
+					next = simEnds[i].nextPoll;
+				if (simEnds[i].onWire && simEnds[i].wireDone < next)
+					next = simEnds[i].wireDone;
+				if (!simEnds[i].onWire && simEnds[i].nTxCount > 0)
+					next = simNow;
+			}
+			simNow = next;
+		}
+	}
+	ok = simCheckRate(s, limit) && ok;
+
+	for (i = 0; i < 2; i++)
+		printf("linksim: %s sent %u delivered %u check failed %u overflow %u rate changes %u\n",
+			simEnds[i].name, (unsigned) simEnds[i].nSent, (unsigned) simEnds[i].nDelivered,
+			(unsigned) simEnds[i].nCheckFailed, (unsigned) simEnds[i].nOverflow, (unsigned) simEnds[i].nRateChanges);
+	printf("linksim: wire bytes %u flipped bits %u dropped %u\n",
+		(unsigned) s->nWireBytes, (unsigned) s->nFlipped, (unsigned) s->nDropped);
+	return ok;
+}
+
+
+static void simUsage(const char *name)
+{
+	fprintf(stderr, "usage: %s [options]\n"
+		"  -b baud      bit rate of wire, default 57600\n"
+		"  -g us        longest random idle gap before each byte, default 0\n"
+		"  -e ber       probability of a bit flip, default 0\n"
+		"  -d p         probability of a byte lost, default 0\n"
+		"  -T bytes     TX buffer of sender, default 256, up to %d\n"
+		"  -R bytes     RX FIFO of receiver, default 128, up to %d\n"
+		"  -P us        receiver drains its FIFO every, default 10000\n"
+		"  -n bytes     payload of each frame, 4 .. %d, default 12\n"
+		"  -p us        send a frame every, default 30000\n"
+		"  -r B/s       pace frames with token bucket instead of -p\n"
+		"  -a           adapt pacer rate to reports of receiver\n"
+		"  -m mode      framing, slip, cobs or hdlc, default slip\n"
+		"  -c crc       none, 16, 32 or 32c, default 16\n"
+		"  -A           negotiate rate with autobaud.c leader and follower instead\n"
+		"  -L baud      with -A, fastest rate the wire carries, default 921600\n"
+		"  -D baud      with -A, fastest rate from the middle of the run on\n"
+		"  -t s         simulated time, default 10\n"
+		"  -s seed      random seed, default 1\n",
+		name, SIM_MAX_TX, SIM_MAX_RX, SIM_MAX_PAYLOAD);
+}
+
+
+int main(int argc, char *argv[])
+{
+	LinkSim *s = &sim;
+	int opt;
+
+	s->baud = 57600;
+	s->txSize = 256;
+	s->rxSize = 128;
+	s->poll = 10000;
+	s->payload = 12;
+	s->period = 30000;
+	s->seconds = 10;
+	s->seed = 1;
+	s->mode = FRAMING_SLIP;
+	s->crc = CRC_16;
+	s->limit = 921600;
+	while ((opt = getopt(argc, argv, "b:g:e:d:T:R:P:n:p:r:aAL:D:m:c:t:s:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'b': s->baud = atoi(optarg); break;
+			case 'g': s->gap = atoi(optarg); break;
+			case 'e': s->ber = atof(optarg); break;
+			case 'd': s->drop = atof(optarg); break;
+			case 'T': s->txSize = atoi(optarg); break;
+			case 'R': s->rxSize = atoi(optarg); break;
+			case 'P': s->poll = atoi(optarg); break;
+			case 'n': s->payload = atoi(optarg); break;
+			case 'p': s->period = atoi(optarg); break;
+			case 'r': s->rate = atoi(optarg); break;
+			case 'a': s->adaptive = true; break;
+			case 'A': s->autobaud = true; break;
+			case 'L': s->limit = atoi(optarg); break;
+			case 'D': s->limitLater = atoi(optarg); break;
+			case 't': s->seconds = atoi(optarg); break;
+			case 's': s->seed = strtoull(optarg, NULL, 0); break;
+			case 'm':
+				if (strcmp(optarg, "cobs") == 0)
+					s->mode = FRAMING_COBS;
+				else if (strcmp(optarg, "hdlc") == 0)
+					s->mode = FRAMING_HDLC;
+				else if (strcmp(optarg, "slip") != 0)
+				{
+					simUsage(argv[0]);
+					return 2;
+				}
+				break;
+			case 'c':
+				if (strcmp(optarg, "none") == 0)
+					s->crc = CRC_NONE;
+				else if (strcmp(optarg, "32") == 0)
+					s->crc = CRC_32;
+				else if (strcmp(optarg, "32c") == 0)
+					s->crc = CRC_32C;
+				else if (strcmp(optarg, "16") != 0)
+				{
+					simUsage(argv[0]);
+					return 2;
+				}
+				break;
+			default:
+				simUsage(argv[0]);
+				return 2;
+		}
+	}
+	if (optind != argc || s->baud == 0 || s->poll == 0 || s->period == 0 || s->seed == 0 ||
+		s->payload < 4 || s->payload > SIM_MAX_PAYLOAD || s->txSize > SIM_MAX_TX || s->rxSize > SIM_MAX_RX)
+	{
+		simUsage(argv[0]);
+		return 2;
+	}
+	if (s->adaptive && !s->rate)
+		s->rate = 500;
+
+	s->state = s->seed;
+	if (s->autobaud)
+		return simAutobaud(s) ? 0 : 1;
+	simRun(s);
+	simPrint(s);
+	return s->nUndetected ? 1 : 0;
+}
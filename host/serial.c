@@ -0,0 +1,190 @@
+/*
+* esp-just-slip - serial.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+
+#include "serial.h"
+
+//
+// bit rates the C library has constants for, up to those of USB serial adapters
+//
+typedef struct {
+	unsigned baud;
+	speed_t speed;
+} SerialSpeed;
+
+static const SerialSpeed serialSpeeds[] =
+{
+	{ 9600, B9600 },
+	{ 19200, B19200 },
+	{ 38400, B38400 },
+	{ 57600, B57600 },
+	{ 115200, B115200 },
+	{ 230400, B230400 },
+#ifdef B460800
+	{ 460800, B460800 },
+#endif
+#ifdef B921600
+	{ 921600, B921600 },
+#endif
+#ifdef B1000000
+	{ 1000000, B1000000 },
+	{ 1500000, B1500000 },
+	{ 2000000, B2000000 },
+	{ 3000000, B3000000 },
+	{ 4000000, B4000000 },
+#endif
+};
+
+
+//
+// look up speed_t of bit rate
+//
+// returned value - index in serialSpeeds, -1 if the rate is not supported
+//
+static int serialSpeed(unsigned baud)
+{
+	unsigned i;
+
+	for (i = 0; i < sizeof(serialSpeeds) / sizeof(serialSpeeds[0]); i++)
+		if (serialSpeeds[i].baud == baud)
+			return (int) i;
+	return -1;
+}
+
+
+//
+// open serial port for SLIP, see serial.h
+//
+// *path - device, e.g. /dev/ttyUSB0 or /dev/pts/3
+// baud - bit rate, one of serialSpeeds
+//
+// returned value - non-blocking file descriptor, -1 on error with message printed
+//
+int serialOpen(const char *path, unsigned baud)
+{
+	struct termios tio;
+	int i, fd;
+
+	i = serialSpeed(baud);
+	if (i < 0)
+	{
+		fprintf(stderr, "%s: bit rate %u not supported\n", path, baud);
+		return -1;
+	}
+
+	fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (tcgetattr(fd, &tio) < 0)
+	{
+		fprintf(stderr, "%s: not a serial port: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+	tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+	tio.c_cc[VMIN] = 1;
+	tio.c_cc[VTIME] = 0;
+	cfsetispeed(&tio, serialSpeeds[i].speed);
+	cfsetospeed(&tio, serialSpeeds[i].speed);
+	if (tcsetattr(fd, TCSANOW, &tio) < 0)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	tcflush(fd, TCIOFLUSH);
+	return fd;
+}
+
+
+//
+// change bit rate once bytes already written are out, see serial.h
+//
+// fd - serial port opened with serialOpen()
+// baud - bit rate, one of serialSpeeds
+//
+// returned value - false on error with message printed
+//
+bool serialSetBaud(int fd, unsigned baud)
+{
+	struct termios tio;
+	int i = serialSpeed(baud);
+
+	if (i < 0)
+	{
+		fprintf(stderr, "serial: bit rate %u not supported\n", baud);
+		return false;
+	}
+	if (tcdrain(fd) < 0 || tcgetattr(fd, &tio) < 0)
+	{
+		fprintf(stderr, "serial: %s\n", strerror(errno));
+		return false;
+	}
+	cfsetispeed(&tio, serialSpeeds[i].speed);
+	cfsetospeed(&tio, serialSpeeds[i].speed);
+	if (tcsetattr(fd, TCSANOW, &tio) < 0)
+	{
+		fprintf(stderr, "serial: %s\n", strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+
+//
+// bytes lost on receive so far, see serial.h
+//
+// fd - serial port opened with serialOpen()
+//
+// returned value - overruns of the UART and of the tty buffer, 0 if the driver has no counters
+//
+uint32_t serialOverruns(int fd)
+{
+	struct serial_icounter_struct icount;
+
+	if (ioctl(fd, TIOCGICOUNT, &icount) < 0)
+		return 0;
+	return (uint32_t) (icount.overrun + icount.buf_overrun);
+}
@@ -0,0 +1,54 @@
+/*
+* esp-just-slip - serial.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef HOST_SERIAL_H_
+#define HOST_SERIAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//
+// Serial ports of the host for tools in this folder
+//
+// A tty, e.g. /dev/ttyUSB0, or a pty is opened non-blocking in raw mode:
+// 8N1, no flow control, no echo, no translation of CR / LF or of
+// control characters, so SLIP bytes pass unchanged.
+// The bit rate is ignored by a pty.
+// serialSetBaud() waits until bytes written so far are sent, then changes
+// the bit rate, e.g. when the peer negotiates a faster one, see autobaud.h.
+// serialOverruns() counts bytes lost by the UART or the tty buffer
+// so far, 0 for a pty or a driver that does not count them.
+//
+int serialOpen(const char *path, unsigned baud);
+bool serialSetBaud(int fd, unsigned baud);
+uint32_t serialOverruns(int fd);
+
+#endif /* HOST_SERIAL_H_ */
@@ -0,0 +1,469 @@
+/*
+* esp-just-slip - slipcap.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// decoder errors are counted, not printed for each frame
+#define SLIP_CODEC_LOG(message)
+#include "slipcodec.h"
+#include "crc32.h"
+#include "capture.h"
+#include "serial.h"
+
+//
+// Capture tool - records, replays and exports captures of wire bytes, see capture.h
+//
+// record: reads capture ESP8266 streams over its debug UART (slipCaptureUart1())
+//   SLIP decode -> checkCrc(CRC_16) -> captureParse() -> record appended to file,
+//   debug text printed on the same UART fails the check and goes to stderr
+// replay: maps capture file into memory and feeds the wire bytes of each direction
+//   to its own decoder with slipDecodeSpan(), as fast as it goes, -n times,
+//   pauses between records longer than SLIP_GAP_US reset the decoder as on the link
+// pcap: decodes frames as replay does and writes them to a pcap file
+//   with LINKTYPE_SLIP, for Wireshark, tcpdump and the like
+//
+// With -c the check value of each frame is verified and removed,
+// frames that fail it are counted and not exported.
+//
+#define SLIPCAP_MAX_FRAME 4096
+#define SLIPCAP_READ_SIZE 4096
+#define SLIPCAP_DEFAULT_BAUD 921600
+
+// pcap file, see https://www.tcpdump.org/linktypes/LINKTYPE_SLIP.html
+#define PCAP_MAGIC 0xA1B2C3D4
+#define PCAP_LINKTYPE_SLIP 8
+// direction, type of packet and compressed header before each frame
+#define PCAP_SLIP_HEADER 16
+#define PCAP_SLIP_IN 0
+#define PCAP_SLIP_OUT 1
+#define PCAP_SLIP_TYPE_IP 0x40
+
+typedef struct {
+	uint32_t magic;
+	uint16_t versionMajor;
+	uint16_t versionMinor;
+	int32_t thisZone;
+	uint32_t sigFigs;
+	uint32_t snapLen;
+	uint32_t network;
+} PcapHeader;
+
+typedef struct {
+	uint32_t seconds;
+	uint32_t micros;
+	uint32_t nIncluded;
+	uint32_t nOriginal;
+} PcapRecord;
+
+//
+// counters of a pass over a capture, index is direction, 1 for CAPTURE_TX
+//
+typedef struct {
+	uint64_t nRecords;
+	uint64_t nBytes[2];
+	uint64_t nFrames[2];
+	uint64_t nFailed[2];
+	uint64_t nFrameBytes[2];
+} SlipcapStats;
+
+//
+// crc - check value of frames, CRC_NONE to take frames as they are
+// pcap - file frames are exported to, NULL on replay
+// decoder / frame - state and frame being decoded of each direction
+//
+typedef struct {
+	CrcMode crc;
+	FILE *pcap;
+	SlipDecoder decoder[2];
+	uint8_t frame[2][SLIPCAP_MAX_FRAME];
+	SlipcapStats stats;
+} Slipcap;
+
+static Slipcap slipcap;
+static volatile sig_atomic_t slipcapStop;
+
+
+static void slipcapSignal(int sig)
+{
+	slipcapStop = 1;
+}
+
+
+static double slipcapSeconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+//
+// frame decoded from capture, check it and export it
+//
+// direction - 0 received, 1 sent
+// time - time of record the frame ended in [us since 1970]
+//
+static void slipcapFrame(Slipcap *c, uint8_t direction, uint64_t time, uint8_t *frame, uint16_t nCount)
+{
+	uint8_t header[PCAP_SLIP_HEADER];
+	PcapRecord record;
+
+	c->stats.nFrames[direction]++;
+	if (c->crc != CRC_NONE)
+	{
+		if (nCount <= crcSize(c->crc) || !checkCrc(c->crc, frame, nCount))
+		{
+			c->stats.nFailed[direction]++;
+			return;
+		}
+		nCount -= crcSize(c->crc);
+	}
+	c->stats.nFrameBytes[direction] += nCount;
+	if (!c->pcap)
+		return;
+
+	os_memset(header, 0, sizeof(header));
+	header[0] = direction ? PCAP_SLIP_OUT : PCAP_SLIP_IN;
+	header[1] = PCAP_SLIP_TYPE_IP;
+	record.seconds = (uint32_t) (time / 1000000);
+	record.micros = (uint32_t) (time % 1000000);
+	record.nIncluded = PCAP_SLIP_HEADER + nCount;
+	record.nOriginal = record.nIncluded;
+	fwrite(&record, sizeof(record), 1, c->pcap);
+	fwrite(header, sizeof(header), 1, c->pcap);
+	fwrite(frame, 1, nCount, c->pcap);
+}
+
+
+//
+// one pass over a capture in memory, decoding wire bytes of both directions
+//
+// returned value - false if the capture is malformed, with message printed
+//
+static bool slipcapDecode(Slipcap *c, const uint8_t *map, size_t nSize)
+{
+	CaptureRecord record;
+	uint64_t time;
+	size_t nPos = CAPTURE_HEADER_SIZE;
+	uint32_t nRecord;
+	uint16_t nUsed, nCount, i;
+	uint8_t direction;
+
+	if (!captureCheckHeader(map, nSize > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t) nSize, &time))
+	{
+		fprintf(stderr, "slipcap: not a capture file\n");
+		return false;
+	}
+	slipDecoderInit(&c->decoder[0]);
+	slipDecoderInit(&c->decoder[1]);
+	while (nPos < nSize)
+	{
+		nRecord = captureParse(map + nPos, nSize - nPos > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t) (nSize - nPos), &record);
+		if (nRecord == 0)
+		{
+			fprintf(stderr, "slipcap: record at %llu is malformed or cut short\n", (unsigned long long) nPos);
+			return false;
+		}
+		nPos += nRecord;
+		time += record.delta;
+		direction = record.flags & CAPTURE_TX;
+		c->stats.nRecords++;
+		c->stats.nBytes[direction] += record.nCount;
+		// frame cut by a pause of the sender is dropped as it was on the live link
+		slipDecoderGap(&c->decoder[direction], (uint32_t) time, SLIP_GAP_US);
+		for (i = 0; i < record.nCount; i += nUsed)
+		{
+			nCount = slipDecodeSpan(&c->decoder[direction], record.data + i, record.nCount - i, &nUsed,
+				c->frame[direction], SLIPCAP_MAX_FRAME);
+			if (nCount > 0)
+				slipcapFrame(c, direction, time, c->frame[direction], nCount);
+		}
+	}
+	return true;
+}
+
+
+//
+// map capture file into memory
+//
+// returned value - start of file, NULL on error with message printed
+//
+static const uint8_t *slipcapMap(const char *path, size_t *nSize)
+{
+	struct stat st;
+	void *map;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0 || fstat(fd, &st) < 0)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		return NULL;
+	}
+	*nSize = st.st_size;
+	map = mmap(NULL, *nSize ? *nSize : 1, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return NULL;
+	}
+	madvise(map, *nSize, MADV_SEQUENTIAL);
+	return map;
+}
+
+
+static void slipcapPrintStats(SlipcapStats *stats, unsigned nPasses)
+{
+	static const char *names[2] = { "rx", "tx" };
+	int i;
+
+	printf("slipcap: %llu records\n", (unsigned long long) (stats->nRecords / nPasses));
+	for (i = 0; i < 2; i++)
+		printf("slipcap: %s %llu wire bytes, %llu frames, %llu failed check, %llu frame bytes\n", names[i],
+			(unsigned long long) (stats->nBytes[i] / nPasses), (unsigned long long) (stats->nFrames[i] / nPasses),
+			(unsigned long long) (stats->nFailed[i] / nPasses), (unsigned long long) (stats->nFrameBytes[i] / nPasses));
+}
+
+
+static int slipcapReplay(Slipcap *c, const char *path, unsigned nPasses)
+{
+	const uint8_t *map;
+	size_t nSize;
+	double start, seconds;
+	unsigned n;
+
+	map = slipcapMap(path, &nSize);
+	if (!map)
+		return 1;
+	start = slipcapSeconds();
+	for (n = 0; n < nPasses; n++)
+		if (!slipcapDecode(c, map, nSize))
+			return 1;
+	seconds = slipcapSeconds() - start;
+	slipcapPrintStats(&c->stats, nPasses);
+	printf("slipcap: %u passes over %llu bytes in %.3f s, %.1f MB/s of wire bytes\n", nPasses,
+		(unsigned long long) nSize, seconds,
+		seconds > 0 ? (double) (c->stats.nBytes[0] + c->stats.nBytes[1]) / seconds / 1e6 : 0.0);
+	return 0;
+}
+
+
+static int slipcapExport(Slipcap *c, const char *path, const char *pcapPath)
+{
+	PcapHeader header;
+	const uint8_t *map;
+	size_t nSize;
+	bool ok;
+
+	map = slipcapMap(path, &nSize);
+	if (!map)
+		return 1;
+	c->pcap = fopen(pcapPath, "wb");
+	if (!c->pcap)
+	{
+		fprintf(stderr, "%s: %s\n", pcapPath, strerror(errno));
+		return 1;
+	}
+	header.magic = PCAP_MAGIC;
+	header.versionMajor = 2;
+	header.versionMinor = 4;
+	header.thisZone = 0;
+	header.sigFigs = 0;
+	header.snapLen = PCAP_SLIP_HEADER + SLIPCAP_MAX_FRAME;
+	header.network = PCAP_LINKTYPE_SLIP;
+	fwrite(&header, sizeof(header), 1, c->pcap);
+	ok = slipcapDecode(c, map, nSize);
+	if (fclose(c->pcap) != 0)
+	{
+		fprintf(stderr, "%s: %s\n", pcapPath, strerror(errno));
+		return 1;
+	}
+	slipcapPrintStats(&c->stats, 1);
+	return ok ? 0 : 1;
+}
+
+
+//
+// record capture streamed by ESP8266 over its debug UART until interrupted
+//
+static int slipcapRecord(const char *port, unsigned baud, const char *path)
+{
+	uint8_t rxBuffer[SLIPCAP_READ_SIZE];
+	uint8_t frame[CAPTURE_MAX_RECORD(SLIPCAP_MAX_FRAME) + 2];
+	uint8_t header[CAPTURE_HEADER_SIZE];
+	uint64_t nRecords = 0, nText = 0;
+	SlipDecoder decoder;
+	CaptureRecord record;
+	struct sigaction sa;
+	struct timespec ts;
+	uint16_t nPos, nUsed, nCount;
+	ssize_t n;
+	FILE *file;
+	int fd;
+
+	fd = serialOpen(port, baud);
+	if (fd < 0)
+		return 1;
+	file = fopen(path, "wb");
+	if (!file)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	// ESP8266 does not know the time of day, records start now
+	clock_gettime(CLOCK_REALTIME, &ts);
+	captureHeader(header, ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+	fwrite(header, sizeof(header), 1, file);
+
+	os_memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = slipcapSignal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	slipDecoderInit(&decoder);
+	while (!slipcapStop)
+	{
+		n = read(fd, rxBuffer, sizeof(rxBuffer));
+		if (n < 0 && (errno == EAGAIN || errno == EINTR))
+		{
+			usleep(1000);
+			continue;
+		}
+		if (n <= 0)
+			break;
+		for (nPos = 0; nPos < n; nPos += nUsed)
+		{
+			nCount = slipDecodeSpan(&decoder, rxBuffer + nPos, (uint16_t) (n - nPos), &nUsed, frame, sizeof(frame));
+			if (nCount == 0)
+				continue;
+			if (nCount > 2 && checkCrc(CRC_16, frame, nCount)
+				&& captureParse(frame, nCount - 2, &record) == (uint32_t) (nCount - 2))
+			{
+				fwrite(frame, 1, nCount - 2, file);
+				nRecords++;
+			}
+			else
+			{
+				// debug output printed between records
+				fwrite(frame, 1, nCount, stderr);
+				nText++;
+			}
+		}
+	}
+	fclose(file);
+	close(fd);
+	fprintf(stderr, "slipcap: %llu records, %llu other frames\n",
+		(unsigned long long) nRecords, (unsigned long long) nText);
+	return 0;
+}
+
+
+static void slipcapUsage(const char *name)
+{
+	fprintf(stderr, "usage: %s record [-b baud] port file\n"
+		"       %s replay [-c crc] [-n passes] file\n"
+		"       %s pcap [-c crc] file pcap-file\n"
+		"  record  capture streamed by ESP8266 over its debug UART, until Ctrl+C\n"
+		"  replay  decode capture at full speed and print frames and decoding rate\n"
+		"  pcap    export decoded frames to pcap file with LINKTYPE_SLIP\n"
+		"  -b baud   bit rate of debug UART, default %u\n"
+		"  -c crc    none|16|32|32c, check value verified and removed from frames, default none\n"
+		"  -n passes times the capture is decoded, default 1\n",
+		name, name, name, SLIPCAP_DEFAULT_BAUD);
+}
+
+
+int main(int argc, char *argv[])
+{
+	Slipcap *c = &slipcap;
+	unsigned baud = SLIPCAP_DEFAULT_BAUD, nPasses = 1;
+	const char *command;
+	int opt;
+
+	if (argc < 2)
+	{
+		slipcapUsage(argv[0]);
+		return 1;
+	}
+	command = argv[1];
+	optind = 2;
+	c->crc = CRC_NONE;
+	while ((opt = getopt(argc, argv, "b:c:n:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'b':
+				baud = (unsigned) strtoul(optarg, NULL, 10);
+				break;
+			case 'n':
+				nPasses = (unsigned) strtoul(optarg, NULL, 10);
+				break;
+			case 'c':
+				if (strcmp(optarg, "16") == 0)
+					c->crc = CRC_16;
+				else if (strcmp(optarg, "32") == 0)
+					c->crc = CRC_32;
+				else if (strcmp(optarg, "32c") == 0)
+					c->crc = CRC_32C;
+				else if (strcmp(optarg, "none") != 0)
+				{
+					slipcapUsage(argv[0]);
+					return 1;
+				}
+				break;
+			default:
+				slipcapUsage(argv[0]);
+				return 1;
+		}
+	}
+
+	if (strcmp(command, "record") == 0 && optind == argc - 2)
+		return slipcapRecord(argv[optind], baud, argv[optind + 1]);
+	if (strcmp(command, "replay") == 0 && optind == argc - 1 && nPasses > 0)
+		return slipcapReplay(c, argv[optind], nPasses);
+	if (strcmp(command, "pcap") == 0 && optind == argc - 2)
+		return slipcapExport(c, argv[optind], argv[optind + 1]);
+	slipcapUsage(argv[0]);
+	return 1;
+}
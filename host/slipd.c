@@ -0,0 +1,781 @@
+/*
+* esp-just-slip - slipd.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+// decoder errors are counted, not printed for each frame
+#define SLIP_CODEC_LOG(message)
+#include "slipcodec.h"
+#include "crc32.h"
+#include "capture.h"
+#include "autobaud.h"
+#include "pacer.h"
+#include "serial.h"
+
+//
+// SLIP link daemon - connects a serial port to a local datagram socket
+//
+// serial port -> read() of up to SLIPD_READ_SIZE bytes -> slipDecodeSpan()
+//   -> checkCrc() -> sendmmsg() of up to SLIPD_BATCH frames, one datagram each
+// recvmmsg() of up to SLIPD_BATCH datagrams -> appendCrc() -> slipEncodeFrame()
+//   -> writev() of all frames at once to serial port
+//
+// Both file descriptors wait in one epoll set, so the daemon sleeps until
+// the port or the socket has data and handles all of it in a few system calls.
+// If the port does not take all frames at once, the rest is written when it
+// becomes writable and the socket is not read until then. A write error other
+// than EAGAIN / EINTR is printed and stops the daemon, frames not written are
+// counted as nTxLost.
+//
+// With -w wire bytes read from and written to the port are recorded
+// to a capture file, see capture.h, for "slipcap replay" or "slipcap pcap".
+//
+// With -A the daemon answers bit rate negotiation of the firmware as
+// AUTOBAUD_FOLLOWER, see autobaud.h. The port starts at AUTOBAUD_BASE_RATE,
+// control frames are answered and not delivered, autobaudPoll() runs every
+// SLIPD_POLL_MS and the socket is not read while negotiation is busy.
+// Control frames carry CRC16, so -A needs -c 16.
+//
+// With -r the daemon sends a loss report of pacer.h every given ms, so the
+// firmware paces its frames to what the daemon takes in: frames that failed
+// the check and bytes the port overran, see serialOverruns(). Reports carry
+// CRC16 as well, so -r needs -c 16.
+//
+#define SLIPD_READ_SIZE 16384
+#define SLIPD_MAX_FRAME 2048
+#define SLIPD_BATCH 64
+#define SLIPD_WIRE_SIZE SLIP_MAX_ENCODED(SLIPD_MAX_FRAME + CRC_MAX_SIZE)
+
+#define SLIPD_DEFAULT_BAUD 115200
+// autobaudPoll() and loss report check period with -A / -r, like the timer of the firmware
+#define SLIPD_POLL_MS 10
+#define SLIPD_DEFAULT_PEER "127.0.0.1:5555"
+
+//
+// nReads / nReadBytes - read() calls on serial port and bytes they returned
+// nFrames - frames decoded, nDropped - of them failed check
+// nDatagrams - frames delivered to socket, nSendCalls - sendmmsg() calls
+// nLost - frames socket did not take, e.g. nobody listens
+// nTxFrames / nTxBytes / nWrites - frames completely written and wire bytes to serial port, writev() calls
+// nTxLost - frames not written because of a write error
+// nReports - loss reports sent, see -r
+//
+typedef struct {
+	uint64_t nReads;
+	uint64_t nReadBytes;
+	uint64_t nFrames;
+	uint64_t nDropped;
+	uint64_t nDatagrams;
+	uint64_t nSendCalls;
+	uint64_t nLost;
+	uint64_t nTxFrames;
+	uint64_t nTxBytes;
+	uint64_t nWrites;
+	uint64_t nTxLost;
+	uint64_t nReports;
+} SlipdStats;
+
+//
+// result of slipdFlush()
+//
+typedef enum {
+	SLIPD_FLUSH_DONE,
+	SLIPD_FLUSH_PENDING,
+	SLIPD_FLUSH_FAILED
+} SlipdFlush;
+
+//
+// serial - serial port, sock - datagram socket, epoll - both of them
+// peerAddr / peerLen - socket of the consumer frames are delivered to
+// crc - check value of frames, checked and removed on the way in, appended on the way out
+// nFrames - decoded frames waiting in frames to be sent to socket
+// nTxFirst / nTxCount - part of txIov still to be written to serial port
+// writing / sockEvents - epoll events of serial port and socket now, see slipdWatch()
+// negotiate / autobaud - answer bit rate negotiation, see -A
+// reportMs / nextReport - period and time of next loss report [us], see -r
+// capture - file wire bytes are recorded to, NULL if not recording
+//
+typedef struct {
+	int serial;
+	int sock;
+	int epoll;
+	CrcMode crc;
+	SlipDecoder decoder;
+	uint8_t rxBuffer[SLIPD_READ_SIZE];
+	uint16_t nFrames;
+	uint8_t frames[SLIPD_BATCH][SLIPD_MAX_FRAME];
+	struct iovec rxIov[SLIPD_BATCH];
+	struct mmsghdr rxMsg[SLIPD_BATCH];
+	uint8_t datagrams[SLIPD_BATCH][SLIPD_MAX_FRAME + CRC_MAX_SIZE];
+	struct iovec dgIov[SLIPD_BATCH];
+	struct mmsghdr dgMsg[SLIPD_BATCH];
+	uint8_t wire[SLIPD_BATCH][SLIPD_WIRE_SIZE];
+	struct iovec txIov[SLIPD_BATCH];
+	int nTxFirst;
+	int nTxCount;
+	bool writing;
+	uint32_t sockEvents;
+	bool negotiate;
+	Autobaud autobaud;
+	uint32_t reportMs;
+	uint32_t nextReport;
+	struct sockaddr_storage peerAddr;
+	socklen_t peerLen;
+	SlipdStats stats;
+	FILE *capture;
+	Capture captureState;
+	uint8_t record[CAPTURE_MAX_RECORD(SLIPD_READ_SIZE)];
+} Slipd;
+
+static Slipd slipd;
+static volatile sig_atomic_t slipdStop;
+static volatile sig_atomic_t slipdPrint;
+
+
+static void slipdSignal(int sig)
+{
+	if (sig == SIGUSR1)
+		slipdPrint = 1;
+	else
+		slipdStop = 1;
+}
+
+
+//
+// current time [us] for inter-byte gap of decoder
+//
+static uint32_t slipdMicros(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) (ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+}
+
+
+//
+// record wire bytes to capture file
+//
+static void slipdCapture(Slipd *d, uint8_t flags, const uint8_t *data, uint16_t nCount)
+{
+	uint16_t nRecord;
+
+	if (!d->capture || nCount == 0)
+		return;
+	nRecord = captureRecord(&d->captureState, flags, slipdMicros(), data, nCount, d->record);
+	if (fwrite(d->record, 1, nRecord, d->capture) != nRecord)
+	{
+		fprintf(stderr, "slipd: capture file: %s, recording stopped\n", strerror(errno));
+		fclose(d->capture);
+		d->capture = NULL;
+	}
+}
+
+
+//
+// open capture file and write its header
+//
+// returned value - false on error with message printed
+//
+static bool slipdCaptureOpen(Slipd *d, const char *path)
+{
+	uint8_t header[CAPTURE_HEADER_SIZE];
+	struct timespec ts;
+
+	d->capture = fopen(path, "wb");
+	if (!d->capture)
+	{
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return false;
+	}
+	clock_gettime(CLOCK_REALTIME, &ts);
+	captureHeader(header, ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+	fwrite(header, 1, sizeof(header), d->capture);
+	captureInit(&d->captureState, slipdMicros());
+	return true;
+}
+
+
+static void slipdPrintStats(SlipdStats *stats)
+{
+	fprintf(stderr, "slipd: rx %llu bytes in %llu reads, %llu frames, %llu dropped, %llu delivered in %llu calls, %llu lost\n",
+		(unsigned long long) stats->nReadBytes, (unsigned long long) stats->nReads,
+		(unsigned long long) stats->nFrames, (unsigned long long) stats->nDropped,
+		(unsigned long long) stats->nDatagrams, (unsigned long long) stats->nSendCalls,
+		(unsigned long long) stats->nLost);
+	fprintf(stderr, "slipd: tx %llu frames, %llu bytes in %llu writes, %llu lost, %llu reports\n",
+		(unsigned long long) stats->nTxFrames, (unsigned long long) stats->nTxBytes,
+		(unsigned long long) stats->nWrites, (unsigned long long) stats->nTxLost,
+		(unsigned long long) stats->nReports);
+}
+
+
+//
+// open datagram socket and look up address of consumer
+// the socket is not connected, so the consumer may start and stop any time
+//
+// *d - daemon state, peer address is stored in it
+// *peer - "host:port" for UDP, a path for Unix domain socket
+// *local - UDP port or path to bind to, so the consumer may send frames back,
+//   NULL to let the system choose
+//
+// returned value - file descriptor, -1 on error with message printed
+//
+static int slipdSocket(Slipd *d, const char *peer, const char *local)
+{
+	struct addrinfo hints, *addr, *bindAddr;
+	struct sockaddr_un unixAddr;
+	char host[256];
+	const char *port;
+	int fd;
+
+	if (strchr(peer, '/'))
+	{
+		fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (fd < 0)
+			return -1;
+		os_memset(&unixAddr, 0, sizeof(unixAddr));
+		unixAddr.sun_family = AF_UNIX;
+		if (local)
+		{
+			unlink(local);
+			strncpy(unixAddr.sun_path, local, sizeof(unixAddr.sun_path) - 1);
+			if (bind(fd, (struct sockaddr *) &unixAddr, sizeof(unixAddr)) < 0)
+			{
+				fprintf(stderr, "%s: %s\n", local, strerror(errno));
+				close(fd);
+				return -1;
+			}
+		}
+		else
+			// autobind to an abstract address the consumer sees in recvfrom()
+			bind(fd, (struct sockaddr *) &unixAddr, sizeof(sa_family_t));
+		strncpy(unixAddr.sun_path, peer, sizeof(unixAddr.sun_path) - 1);
+		os_memcpy(&d->peerAddr, &unixAddr, sizeof(unixAddr));
+		d->peerLen = sizeof(unixAddr);
+		return fd;
+	}
+
+	port = strrchr(peer, ':');
+	if (!port || (size_t) (port - peer) >= sizeof(host))
+	{
+		fprintf(stderr, "%s: expected host:port or a path\n", peer);
+		return -1;
+	}
+	os_memcpy(host, peer, port - peer);
+	host[port - peer] = 0;
+	os_memset(&hints, 0, sizeof(hints));
+	hints.ai_socktype = SOCK_DGRAM;
+	if (getaddrinfo(host, port + 1, &hints, &addr) != 0)
+	{
+		fprintf(stderr, "%s: unknown address\n", peer);
+		return -1;
+	}
+	os_memcpy(&d->peerAddr, addr->ai_addr, addr->ai_addrlen);
+	d->peerLen = addr->ai_addrlen;
+	hints.ai_family = addr->ai_family;
+	hints.ai_flags = AI_PASSIVE;
+	freeaddrinfo(addr);
+
+	fd = socket(hints.ai_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd >= 0 && local)
+	{
+		if (getaddrinfo(NULL, local, &hints, &bindAddr) != 0)
+		{
+			fprintf(stderr, "%s: unknown port\n", local);
+			close(fd);
+			return -1;
+		}
+		if (bind(fd, bindAddr->ai_addr, bindAddr->ai_addrlen) < 0)
+		{
+			fprintf(stderr, "port %s: %s\n", local, strerror(errno));
+			close(fd);
+			fd = -1;
+		}
+		freeaddrinfo(bindAddr);
+	}
+	return fd;
+}
+
+
+//
+// hand decoded frames over to socket in one call
+//
+static void slipdDeliver(Slipd *d)
+{
+	uint16_t nPartial = d->decoder.nPos;
+	int i, n;
+
+	for (i = 0; i < d->nFrames; )
+	{
+		n = sendmmsg(d->sock, d->rxMsg + i, d->nFrames - i, MSG_DONTWAIT);
+		d->stats.nSendCalls++;
+		if (n <= 0)
+		{
+			// nobody listens or socket buffer is full, do not hold up the serial port
+			d->stats.nLost += d->nFrames - i;
+			break;
+		}
+		d->stats.nDatagrams += n;
+		i += n;
+	}
+	// frame being decoded continues at the start of the pool
+	if (d->nFrames > 0 && nPartial > 0)
+		os_memmove(d->frames[0], d->frames[d->nFrames], nPartial);
+	d->nFrames = 0;
+}
+
+
+//
+// read all the serial port has and decode frames from it
+//
+static void slipdReceive(Slipd *d)
+{
+	uint16_t nPos, nUsed, nCount;
+	ssize_t n;
+
+	do
+	{
+		n = read(d->serial, d->rxBuffer, sizeof(d->rxBuffer));
+		if (n <= 0)
+			break;
+		d->stats.nReads++;
+		d->stats.nReadBytes += n;
+		slipdCapture(d, 0, d->rxBuffer, (uint16_t) n);
+		slipDecoderGap(&d->decoder, slipdMicros(), SLIP_GAP_US);
+
+		for (nPos = 0; nPos < n; nPos += nUsed)
+		{
+			nCount = slipDecodeSpan(&d->decoder, d->rxBuffer + nPos, (uint16_t) (n - nPos), &nUsed,
+				d->frames[d->nFrames], SLIPD_MAX_FRAME);
+			if (nCount == 0)
+				continue;
+			d->stats.nFrames++;
+			// control frames of bit rate negotiation are answered, not delivered
+			if (d->negotiate && nCount <= 255 && autobaudFrame(&d->autobaud, d->frames[d->nFrames], (uint8_t) nCount))
+				continue;
+			if (nCount <= crcSize(d->crc) || !checkCrc(d->crc, d->frames[d->nFrames], nCount))
+			{
+				d->stats.nDropped++;
+				continue;
+			}
+			d->rxIov[d->nFrames].iov_len = nCount - crcSize(d->crc);
+			if (++d->nFrames == SLIPD_BATCH)
+				slipdDeliver(d);
+		}
+	}
+	while (n == sizeof(d->rxBuffer));
+	slipdDeliver(d);
+}
+
+
+//
+// write frames waiting in txIov, as much as serial port takes
+//
+// returned value - SLIPD_FLUSH_DONE once all is written,
+//   SLIPD_FLUSH_PENDING if the port takes no more now,
+//   SLIPD_FLUSH_FAILED on other write errors, frames left are counted as lost
+//
+static SlipdFlush slipdFlush(Slipd *d)
+{
+	struct iovec *iov;
+	ssize_t n, nLeft;
+	size_t nChunk;
+	int i;
+
+	while (d->nTxCount > 0)
+	{
+		n = writev(d->serial, d->txIov + d->nTxFirst, d->nTxCount);
+		if (n < 0 && (errno == EAGAIN || errno == EINTR))
+			return SLIPD_FLUSH_PENDING;
+		if (n < 0)
+		{
+			fprintf(stderr, "slipd: write to port: %s\n", strerror(errno));
+			d->stats.nTxLost += d->nTxCount;
+			d->nTxCount = 0;
+			return SLIPD_FLUSH_FAILED;
+		}
+		d->stats.nWrites++;
+		d->stats.nTxBytes += n;
+		for (i = d->nTxFirst, nLeft = n; d->capture && nLeft > 0; i++)
+		{
+			nChunk = (size_t) nLeft < d->txIov[i].iov_len ? (size_t) nLeft : d->txIov[i].iov_len;
+			slipdCapture(d, CAPTURE_TX, d->txIov[i].iov_base, (uint16_t) nChunk);
+			nLeft -= nChunk;
+		}
+		while (d->nTxCount > 0 && (size_t) n >= d->txIov[d->nTxFirst].iov_len)
+		{
+			n -= d->txIov[d->nTxFirst].iov_len;
+			d->nTxFirst++;
+			d->nTxCount--;
+			d->stats.nTxFrames++;
+		}
+		if (d->nTxCount > 0)
+		{
+			iov = &d->txIov[d->nTxFirst];
+			iov->iov_base = (uint8_t *) iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return SLIPD_FLUSH_DONE;
+}
+
+
+//
+// wait for serial port to become writable while txIov holds frames,
+// read socket only when they are out and bit rate negotiation is not busy
+//
+static void slipdWatch(Slipd *d)
+{
+	struct epoll_event ev;
+	bool writing = d->nTxCount > 0;
+	uint32_t sockEvents = (writing || (d->negotiate && autobaudBusy(&d->autobaud))) ? 0 : EPOLLIN;
+
+	if (writing != d->writing)
+	{
+		ev.events = EPOLLIN | (writing ? EPOLLOUT : 0);
+		ev.data.fd = d->serial;
+		epoll_ctl(d->epoll, EPOLL_CTL_MOD, d->serial, &ev);
+		d->writing = writing;
+	}
+	if (sockEvents != d->sockEvents)
+	{
+		ev.events = sockEvents;
+		ev.data.fd = d->sock;
+		epoll_ctl(d->epoll, EPOLL_CTL_MOD, d->sock, &ev);
+		d->sockEvents = sockEvents;
+	}
+}
+
+
+//
+// write control frame of bit rate negotiation or loss report after the frames still in txIov,
+// so it does not land in the middle of one, waiting for the port as control frames are short
+//
+static void slipdWriteControl(Slipd *d, const uint8_t *wire, uint16_t nWire)
+{
+	struct pollfd pfd;
+	SlipdFlush result;
+	ssize_t n;
+
+	pfd.fd = d->serial;
+	pfd.events = POLLOUT;
+	while (d->nTxCount > 0 && !slipdStop)
+	{
+		result = slipdFlush(d);
+		if (result == SLIPD_FLUSH_FAILED)
+			slipdStop = 1;
+		else if (result == SLIPD_FLUSH_PENDING)
+			poll(&pfd, 1, SLIPD_POLL_MS);
+	}
+	slipdCapture(d, CAPTURE_TX, wire, nWire);
+	while (nWire > 0 && !slipdStop)
+	{
+		n = write(d->serial, wire, nWire);
+		if (n < 0 && (errno == EAGAIN || errno == EINTR))
+		{
+			poll(&pfd, 1, SLIPD_POLL_MS);
+			continue;
+		}
+		if (n < 0)
+		{
+			fprintf(stderr, "slipd: write to port: %s\n", strerror(errno));
+			slipdStop = 1;
+			return;
+		}
+		d->stats.nWrites++;
+		d->stats.nTxBytes += n;
+		wire += n;
+		nWire -= n;
+	}
+}
+
+
+//
+// UART0 of autobaud.c is the serial port of the daemon, see autobaudhal.h
+//
+uint32_t autobaudHalTime(void)
+{
+	return slipdMicros();
+}
+
+
+void autobaudHalSetRate(UartBautRate rate)
+{
+	if (serialSetBaud(slipd.serial, (unsigned) rate))
+		fprintf(stderr, "slipd: port at %u baud\n", (unsigned) rate);
+	else
+		slipdStop = 1;
+}
+
+
+void autobaudHalSend(const uint8_t *dataBuffer, uint8_t nCount)
+{
+	uint8_t wire[SLIP_MAX_ENCODED(255)];
+
+	slipdWriteControl(&slipd, wire, slipEncodeFrame(dataBuffer, nCount, wire));
+}
+
+
+void autobaudHalSendWire(const SlipWire *frame)
+{
+	uint8_t wire[SLIP_WIRE_MAX];
+
+	slipdWriteControl(&slipd, wire, slipWireCopy(frame, wire));
+}
+
+
+//
+// send loss report of pacer.h once reportMs passed, not while bit rates are probed
+//
+static void slipdReport(Slipd *d)
+{
+	uint8_t frame[PACER_REPORT_SIZE + CRC_MAX_SIZE];
+	uint8_t wire[SLIP_MAX_ENCODED(sizeof(frame))];
+	uint32_t now = slipdMicros();
+	uint16_t nCount;
+
+	if (d->reportMs == 0 || (int32_t) (now - d->nextReport) < 0)
+		return;
+	d->nextReport = now + d->reportMs * 1000;
+	if (d->negotiate && autobaudBusy(&d->autobaud))
+		return;
+	nCount = pacerMakeReport(frame, (uint32_t) d->stats.nDropped, serialOverruns(d->serial));
+	nCount = appendCrc(d->crc, frame, nCount, sizeof(frame));
+	slipdWriteControl(d, wire, slipEncodeFrame(frame, nCount, wire));
+	d->stats.nReports++;
+}
+
+
+//
+// take datagrams from socket and write them to serial port as SLIP frames
+//
+static void slipdTransmit(Slipd *d)
+{
+	SlipdFlush result;
+	int i, n;
+	uint16_t nCount;
+
+	// txIov still holds frames to write or rates are negotiated, the socket is read later
+	if (d->nTxCount > 0 || (d->negotiate && autobaudBusy(&d->autobaud)))
+		return;
+	n = recvmmsg(d->sock, d->dgMsg, SLIPD_BATCH, MSG_DONTWAIT, NULL);
+	if (n <= 0)
+		return;
+	for (i = 0; i < n; i++)
+	{
+		nCount = d->dgMsg[i].msg_len;
+		if (nCount > SLIPD_MAX_FRAME)
+			nCount = SLIPD_MAX_FRAME;
+		nCount = appendCrc(d->crc, d->datagrams[i], nCount, sizeof(d->datagrams[i]));
+		d->txIov[i].iov_base = d->wire[i];
+		d->txIov[i].iov_len = slipEncodeFrame(d->datagrams[i], nCount, d->wire[i]);
+	}
+	d->nTxFirst = 0;
+	d->nTxCount = n;
+	result = slipdFlush(d);
+	if (result == SLIPD_FLUSH_FAILED)
+		slipdStop = 1;
+}
+
+
+static void slipdUsage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-b baud] [-c none|16|32|32c] [-p peer] [-l local] [-w file] [-A] [-r ms] port\n"
+		"  -b baud   bit rate of serial port, default %u\n"
+		"  -c crc    check value of frames, checked and removed from frames received,\n"
+		"            appended to frames sent, default none\n"
+		"  -p peer   host:port of UDP socket or path of Unix domain socket\n"
+		"            frames are delivered to, default %s\n"
+		"  -l local  UDP port or Unix socket path to take frames to send from\n"
+		"  -w file   record wire bytes of the port to a capture file\n"
+		"  -A        follow bit rate negotiation of the firmware, port starts\n"
+		"            at %u and -b is ignored, needs -c 16\n"
+		"  -r ms     send loss reports to the pacer of the firmware every ms,\n"
+		"            needs -c 16\n"
+		"  port      serial port, e.g. /dev/ttyUSB0\n"
+		"kill -USR1 prints counters, they are printed on exit too\n",
+		name, SLIPD_DEFAULT_BAUD, SLIPD_DEFAULT_PEER, (unsigned) AUTOBAUD_BASE_RATE);
+}
+
+
+int main(int argc, char *argv[])
+{
+	Slipd *d = &slipd;
+	const char *peer = SLIPD_DEFAULT_PEER;
+	const char *local = NULL;
+	const char *capturePath = NULL;
+	unsigned baud = SLIPD_DEFAULT_BAUD;
+	struct epoll_event ev, events[2];
+	struct sigaction sa;
+	int i, n, opt;
+
+	d->crc = CRC_NONE;
+	while ((opt = getopt(argc, argv, "b:c:p:l:w:Ar:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'b':
+				baud = (unsigned) strtoul(optarg, NULL, 10);
+				break;
+			case 'c':
+				if (strcmp(optarg, "16") == 0)
+					d->crc = CRC_16;
+				else if (strcmp(optarg, "32") == 0)
+					d->crc = CRC_32;
+				else if (strcmp(optarg, "32c") == 0)
+					d->crc = CRC_32C;
+				else if (strcmp(optarg, "none") != 0)
+				{
+					slipdUsage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'p':
+				peer = optarg;
+				break;
+			case 'l':
+				local = optarg;
+				break;
+			case 'w':
+				capturePath = optarg;
+				break;
+			case 'A':
+				d->negotiate = true;
+				break;
+			case 'r':
+				d->reportMs = (uint32_t) strtoul(optarg, NULL, 10);
+				break;
+			default:
+				slipdUsage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind != argc - 1 || ((d->negotiate || d->reportMs > 0) && d->crc != CRC_16))
+	{
+		slipdUsage(argv[0]);
+		return 1;
+	}
+	if (d->negotiate)
+		baud = AUTOBAUD_BASE_RATE;
+
+	d->serial = serialOpen(argv[optind], baud);
+	if (d->serial < 0)
+		return 1;
+	d->sock = slipdSocket(d, peer, local);
+	if (d->sock < 0)
+		return 1;
+	if (capturePath && !slipdCaptureOpen(d, capturePath))
+		return 1;
+
+	for (i = 0; i < SLIPD_BATCH; i++)
+	{
+		d->rxIov[i].iov_base = d->frames[i];
+		d->rxMsg[i].msg_hdr.msg_iov = &d->rxIov[i];
+		d->rxMsg[i].msg_hdr.msg_iovlen = 1;
+		d->rxMsg[i].msg_hdr.msg_name = &d->peerAddr;
+		d->rxMsg[i].msg_hdr.msg_namelen = d->peerLen;
+		d->dgIov[i].iov_base = d->datagrams[i];
+		d->dgIov[i].iov_len = SLIPD_MAX_FRAME;
+		d->dgMsg[i].msg_hdr.msg_iov = &d->dgIov[i];
+		d->dgMsg[i].msg_hdr.msg_iovlen = 1;
+	}
+	slipDecoderInit(&d->decoder);
+
+	d->epoll = epoll_create1(EPOLL_CLOEXEC);
+	ev.events = EPOLLIN;
+	ev.data.fd = d->serial;
+	epoll_ctl(d->epoll, EPOLL_CTL_ADD, d->serial, &ev);
+	ev.data.fd = d->sock;
+	epoll_ctl(d->epoll, EPOLL_CTL_ADD, d->sock, &ev);
+	d->sockEvents = EPOLLIN;
+	if (d->negotiate)
+		autobaudInit(&d->autobaud, AUTOBAUD_FOLLOWER);
+	d->nextReport = slipdMicros() + d->reportMs * 1000;
+
+	os_memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = slipdSignal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGUSR1, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	while (!slipdStop)
+	{
+		n = epoll_wait(d->epoll, events, 2, (d->negotiate || d->reportMs > 0) ? SLIPD_POLL_MS : -1);
+		if (slipdPrint)
+		{
+			slipdPrint = 0;
+			slipdPrintStats(&d->stats);
+		}
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+			break;
+		for (i = 0; i < n; i++)
+		{
+			if (events[i].data.fd == d->serial)
+			{
+				if (events[i].events & (EPOLLHUP | EPOLLERR))
+				{
+					fprintf(stderr, "%s: port closed\n", argv[optind]);
+					slipdStop = 1;
+				}
+				if (events[i].events & EPOLLIN)
+					slipdReceive(d);
+				if ((events[i].events & EPOLLOUT) && slipdFlush(d) == SLIPD_FLUSH_FAILED)
+					slipdStop = 1;
+			}
+			else if (events[i].events & EPOLLIN)
+				slipdTransmit(d);
+		}
+		if (d->negotiate)
+			autobaudPoll(&d->autobaud);
+		slipdReport(d);
+		slipdWatch(d);
+	}
+	slipdPrintStats(&d->stats);
+	if (d->capture)
+		fclose(d->capture);
+	return 0;
+}
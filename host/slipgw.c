@@ -0,0 +1,624 @@
+/*
+* esp-just-slip - slipgw.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+// decoder errors are counted, not printed for each frame
+#define SLIP_CODEC_LOG(message)
+#include "slipcodec.h"
+#include "crc32.h"
+#include "serial.h"
+#include "spsc.h"
+
+//
+// SLIP gateway - many serial ports served by a fixed pool of worker threads
+//
+// Ports are split into shards, port i belongs to worker i % nWorkers.
+// Each worker has its own epoll set, decoder of each of its ports and
+// a queue of decoded frames, so workers share nothing and never take a lock:
+//
+//   worker: epoll_wait() -> read() -> slipDecodeSpan() -> checkCrc() -> spscTail() / spscPush()
+//   consumer: spscHead() of each worker -> sendmmsg() -> spscPop()
+//
+// The consumer thread drains the queues of all workers. Frames of port i go to
+// UDP port base + i of the peer. If a queue is full the frame is dropped and
+// counted, a slow consumer never holds up the serial ports.
+//
+// With -B the gateway runs a benchmark instead: it opens pty pairs, load
+// threads write SLIP frames into them as fast as they are taken, and
+// frames / s, loss and CPU use of each worker are printed.
+//
+#define GW_MAX_PORTS 256
+#define GW_MAX_WORKERS 64
+#define GW_MAX_FRAME 512
+#define GW_READ_SIZE 16384
+// frames in queue of each worker, a power of 2
+#define GW_QUEUE_SLOTS 4096
+#define GW_BATCH 64
+// consumer sleeps this long when all queues are empty [us]
+#define GW_IDLE_US 100
+
+#define GW_DEFAULT_BAUD 115200
+#define GW_DEFAULT_PEER "127.0.0.1:6000"
+#define GW_BENCH_PORTS 64
+#define GW_BENCH_SECONDS 5
+#define GW_BENCH_PAYLOAD 12
+
+typedef struct {
+	uint16_t nPort;
+	uint16_t nCount;
+	uint8_t data[GW_MAX_FRAME];
+} GwFrame;
+
+//
+// fd - serial port, or pty slave in benchmark
+// buffer - frame being decoded, copied into queue when complete
+// nFrames / nDropped - frames decoded / failed check or queue full
+//
+typedef struct {
+	int fd;
+	uint16_t nPort;
+	SlipDecoder decoder;
+	uint8_t buffer[GW_MAX_FRAME];
+	uint64_t nFrames;
+	uint64_t nDropped;
+} GwPort;
+
+//
+// cpu - core the worker is pinned to
+// cpuTime - CPU time the worker used [ns]
+//
+typedef struct {
+	pthread_t thread;
+	int id;
+	int cpu;
+	int epoll;
+	int nPorts;
+	SpscQueue queue;
+	GwFrame *slots;
+	uint64_t nReads;
+	uint64_t nFull;
+	uint64_t cpuTime;
+} GwWorker;
+
+typedef struct {
+	int nPorts;
+	int nWorkers;
+	CrcMode crc;
+	GwPort ports[GW_MAX_PORTS];
+	GwWorker workers[GW_MAX_WORKERS];
+	// consumer
+	int sock;
+	struct sockaddr_storage peerAddr[GW_MAX_PORTS];
+	socklen_t peerLen;
+	uint64_t nDelivered;
+	uint64_t nLost;
+	uint64_t nSendCalls;
+	// benchmark
+	bool bench;
+	int master[GW_MAX_PORTS];
+	uint32_t nNext[GW_MAX_PORTS];
+	uint64_t nOutOfOrder;
+} Gateway;
+
+static Gateway gateway;
+static volatile sig_atomic_t gwStop;
+
+
+static void gwSignal(int sig)
+{
+	gwStop = 1;
+}
+
+
+static uint64_t gwNanos(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+//
+// take one frame of port out of its decoder into queue of worker
+//
+static void gwFrame(Gateway *gw, GwWorker *worker, GwPort *port, uint16_t nCount)
+{
+	uint8_t nCrc = crcSize(gw->crc);
+	GwFrame *frame;
+
+	if (nCount <= nCrc || !checkCrc(gw->crc, port->buffer, nCount))
+	{
+		port->nDropped++;
+		return;
+	}
+	frame = (GwFrame *) spscTail(&worker->queue);
+	if (!frame)
+	{
+		worker->nFull++;
+		port->nDropped++;
+		return;
+	}
+	frame->nPort = port->nPort;
+	frame->nCount = nCount - nCrc;
+	os_memcpy(frame->data, port->buffer, frame->nCount);
+	spscPush(&worker->queue);
+	port->nFrames++;
+}
+
+
+//
+// worker thread - read and decode ports of its shard
+//
+static void *gwWorker(void *arg)
+{
+	GwWorker *worker = (GwWorker *) arg;
+	Gateway *gw = &gateway;
+	struct epoll_event events[GW_BATCH];
+	uint8_t *rxBuffer = malloc(GW_READ_SIZE);
+	uint16_t nPos, nUsed, nCount;
+	uint32_t now;
+	GwPort *port;
+	ssize_t n;
+	int i, nEvents;
+
+	while (!gwStop)
+	{
+		nEvents = epoll_wait(worker->epoll, events, GW_BATCH, 100);
+		now = (uint32_t) (gwNanos(CLOCK_MONOTONIC) / 1000);
+		for (i = 0; i < nEvents; i++)
+		{
+			port = &gw->ports[events[i].data.u32];
+			do
+			{
+				n = read(port->fd, rxBuffer, GW_READ_SIZE);
+				if (n <= 0)
+					break;
+				worker->nReads++;
+				slipDecoderGap(&port->decoder, now, SLIP_GAP_US);
+				for (nPos = 0; nPos < n; nPos += nUsed)
+				{
+					nCount = slipDecodeSpan(&port->decoder, rxBuffer + nPos, (uint16_t) (n - nPos), &nUsed,
+						port->buffer, GW_MAX_FRAME);
+					if (nCount > 0)
+						gwFrame(gw, worker, port, nCount);
+				}
+			}
+			while (n == GW_READ_SIZE);
+		}
+	}
+	worker->cpuTime = gwNanos(CLOCK_THREAD_CPUTIME_ID);
+	free(rxBuffer);
+	return NULL;
+}
+
+
+//
+// benchmark - frames carry number of port and a sequence number, check they come in order
+//
+static void gwBenchCheck(Gateway *gw, GwFrame *frame)
+{
+	uint32_t nSeq;
+
+	os_memcpy(&nSeq, frame->data + 2, sizeof(nSeq));
+	if (nSeq != gw->nNext[frame->nPort])
+		gw->nOutOfOrder++;
+	gw->nNext[frame->nPort] = nSeq + 1;
+}
+
+
+//
+// consumer - drain queues of all workers until stopped
+//
+static void gwConsume(Gateway *gw)
+{
+	struct mmsghdr msg[GW_BATCH];
+	struct iovec iov[GW_BATCH];
+	GwWorker *worker;
+	GwFrame *frame;
+	int i, n, nBatch, nSent;
+	bool idle;
+
+	os_memset(msg, 0, sizeof(msg));
+	for (i = 0; i < GW_BATCH; i++)
+	{
+		msg[i].msg_hdr.msg_iov = &iov[i];
+		msg[i].msg_hdr.msg_iovlen = 1;
+		msg[i].msg_hdr.msg_namelen = gw->peerLen;
+	}
+
+	while (!gwStop)
+	{
+		idle = true;
+		for (i = 0; i < gw->nWorkers; i++)
+		{
+			worker = &gw->workers[i];
+			if (gw->bench)
+			{
+				while ((frame = (GwFrame *) spscHead(&worker->queue)) != NULL)
+				{
+					gwBenchCheck(gw, frame);
+					gw->nDelivered++;
+					spscPop(&worker->queue);
+					idle = false;
+				}
+				continue;
+			}
+
+			// frames stay in queue slots until sendmmsg() is done with them
+			for (nBatch = 0; nBatch < GW_BATCH; nBatch++)
+			{
+				frame = (GwFrame *) spscPeek(&worker->queue, nBatch);
+				if (!frame)
+					break;
+				iov[nBatch].iov_base = frame->data;
+				iov[nBatch].iov_len = frame->nCount;
+				msg[nBatch].msg_hdr.msg_name = &gw->peerAddr[frame->nPort];
+			}
+			for (n = 0; n < nBatch; n += nSent)
+			{
+				nSent = sendmmsg(gw->sock, msg + n, nBatch - n, MSG_DONTWAIT);
+				gw->nSendCalls++;
+				if (nSent <= 0)
+				{
+					gw->nLost += nBatch - n;
+					break;
+				}
+				gw->nDelivered += nSent;
+			}
+			for (n = 0; n < nBatch; n++)
+				spscPop(&worker->queue);
+			if (nBatch > 0)
+				idle = false;
+		}
+		if (idle)
+			usleep(GW_IDLE_US);
+	}
+}
+
+
+//
+// SLIP frames of one pty master not yet taken by the pty
+//
+typedef struct {
+	uint8_t wire[512];
+	uint16_t nPos;
+	uint16_t nWire;
+	uint32_t nSeq;
+} GwLoadPort;
+
+//
+// benchmark load - write SLIP frames into pty masters as fast as they are taken
+// each thread feeds the masters of ports of one worker
+// a frame carries number of port and sequence number, the rest are SLIP_END bytes to escape
+//
+static void *gwLoad(void *arg)
+{
+	GwWorker *worker = (GwWorker *) arg;
+	Gateway *gw = &gateway;
+	struct pollfd fds[GW_MAX_PORTS];
+	GwLoadPort *load = calloc(GW_MAX_PORTS, sizeof(GwLoadPort));
+	uint8_t frame[GW_BENCH_PAYLOAD + CRC_MAX_SIZE];
+	uint16_t nFrame, nPort;
+	GwLoadPort *port;
+	int i, nFds = 0;
+	ssize_t n;
+
+	for (i = worker->id; i < gw->nPorts; i += gw->nWorkers)
+	{
+		fds[nFds].fd = gw->master[i];
+		fds[nFds].events = POLLOUT;
+		nFds++;
+	}
+
+	while (!gwStop)
+	{
+		if (poll(fds, nFds, 100) <= 0)
+			continue;
+		for (i = 0; i < nFds; i++)
+		{
+			if (!(fds[i].revents & POLLOUT))
+				continue;
+			port = &load[i];
+			// a few frames per write, as a USB serial adapter delivers them
+			if (port->nPos == port->nWire)
+			{
+				port->nPos = port->nWire = 0;
+				nPort = i * gw->nWorkers + worker->id;
+				while (port->nWire + SLIP_MAX_ENCODED(sizeof(frame)) <= sizeof(port->wire))
+				{
+					os_memset(frame, SLIP_END, sizeof(frame));
+					os_memcpy(frame, &nPort, 2);
+					os_memcpy(frame + 2, &port->nSeq, 4);
+					nFrame = appendCrc(gw->crc, frame, GW_BENCH_PAYLOAD, sizeof(frame));
+					port->nWire += slipEncodeFrame(frame, nFrame, port->wire + port->nWire);
+					port->nSeq++;
+				}
+			}
+			n = write(fds[i].fd, port->wire + port->nPos, port->nWire - port->nPos);
+			if (n > 0)
+				port->nPos += n;
+		}
+	}
+	free(load);
+	return NULL;
+}
+
+
+//
+// open pty pair for benchmark, master is kept for load thread, slave is the port
+//
+static int gwBenchPty(Gateway *gw, int nPort)
+{
+	int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+
+	if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0)
+	{
+		fprintf(stderr, "pty: %s\n", strerror(errno));
+		return -1;
+	}
+	gw->master[nPort] = master;
+	return serialOpen(ptsname(master), GW_DEFAULT_BAUD);
+}
+
+
+//
+// address of peer for each port, UDP port of peer is base + port number
+//
+static bool gwPeer(Gateway *gw, const char *peer)
+{
+	struct addrinfo hints, *addr;
+	char host[256];
+	const char *port;
+	int i, nBase;
+
+	port = strrchr(peer, ':');
+	if (!port || (size_t) (port - peer) >= sizeof(host))
+	{
+		fprintf(stderr, "%s: expected host:port\n", peer);
+		return false;
+	}
+	os_memcpy(host, peer, port - peer);
+	host[port - peer] = 0;
+	nBase = atoi(port + 1);
+	os_memset(&hints, 0, sizeof(hints));
+	hints.ai_socktype = SOCK_DGRAM;
+	if (getaddrinfo(host, port + 1, &hints, &addr) != 0)
+	{
+		fprintf(stderr, "%s: unknown address\n", peer);
+		return false;
+	}
+	gw->sock = socket(addr->ai_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	gw->peerLen = addr->ai_addrlen;
+	for (i = 0; i < gw->nPorts; i++)
+	{
+		os_memcpy(&gw->peerAddr[i], addr->ai_addr, addr->ai_addrlen);
+		if (addr->ai_family == AF_INET6)
+			((struct sockaddr_in6 *) &gw->peerAddr[i])->sin6_port = htons(nBase + i);
+		else
+			((struct sockaddr_in *) &gw->peerAddr[i])->sin_port = htons(nBase + i);
+	}
+	freeaddrinfo(addr);
+	return gw->sock >= 0;
+}
+
+
+static void gwPrintStats(Gateway *gw, uint64_t wallTime)
+{
+	uint64_t nFrames = 0, nDropped = 0;
+	GwWorker *worker;
+	int i, j;
+
+	for (i = 0; i < gw->nPorts; i++)
+	{
+		nFrames += gw->ports[i].nFrames;
+		nDropped += gw->ports[i].nDropped;
+	}
+	fprintf(stderr, "slipgw: %d ports, %d workers, %.1f s\n", gw->nPorts, gw->nWorkers, wallTime / 1e9);
+	fprintf(stderr, "slipgw: %llu frames, %llu dropped, %llu delivered, %llu lost, %.0f frames/s\n",
+		(unsigned long long) nFrames, (unsigned long long) nDropped, (unsigned long long) gw->nDelivered,
+		(unsigned long long) gw->nLost, nFrames * 1e9 / wallTime);
+	if (gw->bench)
+		fprintf(stderr, "slipgw: %llu frames out of order\n", (unsigned long long) gw->nOutOfOrder);
+	fprintf(stderr, "slipgw: worker cpu ports frames frames/s reads cpu%%\n");
+	for (i = 0; i < gw->nWorkers; i++)
+	{
+		worker = &gw->workers[i];
+		nFrames = 0;
+		for (j = i; j < gw->nPorts; j += gw->nWorkers)
+			nFrames += gw->ports[j].nFrames;
+		fprintf(stderr, "slipgw: %d %d %d %llu %.0f %llu %.1f\n", i, worker->cpu, worker->nPorts,
+			(unsigned long long) nFrames, nFrames * 1e9 / wallTime, (unsigned long long) worker->nReads,
+			100.0 * worker->cpuTime / wallTime);
+	}
+}
+
+
+static void gwUsage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-w workers] [-b baud] [-c none|16|32|32c] [-p peer] port...\n"
+		"       %s -B [-w workers] [-n ports] [-t seconds] [-c none|16|32|32c]\n"
+		"  -w workers  worker threads, default number of cores\n"
+		"  -b baud     bit rate of serial ports, default %u\n"
+		"  -c crc      check value of frames, checked and removed, default none\n"
+		"  -p peer     host:port frames of the first port are sent to,\n"
+		"              the next port to port + 1 and so on, default %s\n"
+		"  -B          benchmark with pty pairs, -n of them (default %d) for -t seconds (default %d)\n",
+		name, name, GW_DEFAULT_BAUD, GW_DEFAULT_PEER, GW_BENCH_PORTS, GW_BENCH_SECONDS);
+}
+
+
+int main(int argc, char *argv[])
+{
+	Gateway *gw = &gateway;
+	const char *peer = GW_DEFAULT_PEER;
+	unsigned baud = GW_DEFAULT_BAUD;
+	int nCores = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	int nSeconds = GW_BENCH_SECONDS;
+	pthread_t load[GW_MAX_WORKERS];
+	struct epoll_event ev;
+	struct sigaction sa;
+	uint64_t start;
+	GwWorker *worker;
+	int i, opt;
+
+	gw->crc = CRC_NONE;
+	gw->nWorkers = nCores;
+	gw->nPorts = GW_BENCH_PORTS;
+	while ((opt = getopt(argc, argv, "w:b:c:p:Bn:t:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'w':
+				gw->nWorkers = atoi(optarg);
+				break;
+			case 'b':
+				baud = (unsigned) strtoul(optarg, NULL, 10);
+				break;
+			case 'c':
+				if (strcmp(optarg, "16") == 0)
+					gw->crc = CRC_16;
+				else if (strcmp(optarg, "32") == 0)
+					gw->crc = CRC_32;
+				else if (strcmp(optarg, "32c") == 0)
+					gw->crc = CRC_32C;
+				else if (strcmp(optarg, "none") != 0)
+				{
+					gwUsage(argv[0]);
+					return 1;
+				}
+				break;
+			case 'p':
+				peer = optarg;
+				break;
+			case 'B':
+				gw->bench = true;
+				break;
+			case 'n':
+				gw->nPorts = atoi(optarg);
+				break;
+			case 't':
+				nSeconds = atoi(optarg);
+				break;
+			default:
+				gwUsage(argv[0]);
+				return 1;
+		}
+	}
+	if (!gw->bench)
+		gw->nPorts = argc - optind;
+	if (gw->nPorts < 1 || gw->nPorts > GW_MAX_PORTS || gw->nWorkers < 1 || gw->nWorkers > GW_MAX_WORKERS)
+	{
+		gwUsage(argv[0]);
+		return 1;
+	}
+	if (gw->nWorkers > gw->nPorts)
+		gw->nWorkers = gw->nPorts;
+
+	for (i = 0; i < gw->nPorts; i++)
+	{
+		gw->ports[i].nPort = i;
+		gw->ports[i].fd = gw->bench ? gwBenchPty(gw, i) : serialOpen(argv[optind + i], baud);
+		if (gw->ports[i].fd < 0)
+			return 1;
+		slipDecoderInit(&gw->ports[i].decoder);
+	}
+	if (!gw->bench && !gwPeer(gw, peer))
+		return 1;
+
+	for (i = 0; i < gw->nWorkers; i++)
+	{
+		worker = &gw->workers[i];
+		worker->id = i;
+		worker->cpu = i % nCores;
+		worker->epoll = epoll_create1(EPOLL_CLOEXEC);
+		worker->slots = malloc(GW_QUEUE_SLOTS * sizeof(GwFrame));
+		spscInit(&worker->queue, worker->slots, GW_QUEUE_SLOTS, sizeof(GwFrame));
+	}
+	for (i = 0; i < gw->nPorts; i++)
+	{
+		worker = &gw->workers[i % gw->nWorkers];
+		ev.events = EPOLLIN;
+		ev.data.u32 = i;
+		epoll_ctl(worker->epoll, EPOLL_CTL_ADD, gw->ports[i].fd, &ev);
+		worker->nPorts++;
+	}
+
+	os_memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = gwSignal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	if (gw->bench)
+	{
+		sigaction(SIGALRM, &sa, NULL);
+		alarm(nSeconds);
+	}
+
+	start = gwNanos(CLOCK_MONOTONIC);
+	for (i = 0; i < gw->nWorkers; i++)
+	{
+		cpu_set_t cpus;
+
+		worker = &gw->workers[i];
+		pthread_create(&worker->thread, NULL, gwWorker, worker);
+		// one worker per core, its ports and queue stay in the caches of that core
+		CPU_ZERO(&cpus);
+		CPU_SET(worker->cpu, &cpus);
+		pthread_setaffinity_np(worker->thread, sizeof(cpus), &cpus);
+		if (gw->bench)
+			pthread_create(&load[i], NULL, gwLoad, worker);
+	}
+
+	gwConsume(gw);
+
+	for (i = 0; i < gw->nWorkers; i++)
+	{
+		pthread_join(gw->workers[i].thread, NULL);
+		if (gw->bench)
+			pthread_join(load[i], NULL);
+	}
+	gwPrintStats(gw, gwNanos(CLOCK_MONOTONIC) - start);
+	return 0;
+}
@@ -0,0 +1,470 @@
+/*
+* esp-just-slip - softsim.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include "softuart.h"
+
+//
+// Softuart simulator - softuart.c running against a virtual GPIO line
+//
+// The hardware access of softuart.c goes through softuart_hal.h, here it is
+// served by a virtual clock and a recorded line:
+// sender: Softuart_Putchar() on its own clock, every change of tx pin
+//   is stored as an edge of the line
+// line: optional glitches, each bit time gets with probability glitch
+//   a pulse of inverted level, width us long, at a random place
+// receiver: Softuart_Intr_Handler() is called on every edge of the line
+//   that comes while the pin interrupt is enabled, after an interrupt
+//   latency of latency us plus up to jitter us; it samples the line
+//   on a clock running skew faster or slower than the one of the sender
+//
+// Reading the clock or a pin and setting a pin costs cost us, so the
+// busy waits of softuart.c advance time as they do on ESP8266.
+// Edges that come while the handler runs are lost, like on ESP8266
+// where the handler disables the interrupt of its pin.
+//
+// Each baud rate and skew gets frames of length random bytes, both with
+// one sample per bit and with Softuart_EnableOversampling(). The table
+// shows bit error rate: bits that differ, counting a missing or
+// an extra byte as 8 bits, over all bits sent. Then the maximum baud rate
+// without errors for each skew.
+//
+// Time is simulated, results depend only on options and seed.
+//
+#define SIM_TX_GPIO 12
+#define SIM_RX_GPIO 14
+#define SIM_MAX_LENGTH 64
+// two per bit, start and stop bit included, and two per glitch
+#define SIM_MAX_EDGES (SIM_MAX_LENGTH * 10 * 4 + 16)
+#define SIM_SKEWS 7
+
+// Softuart_Init() takes baud rate as uint16_t
+static const uint16_t simBauds[] = { 4800, 9600, 19200, 28800, 38400, 57600 };
+#define SIM_BAUDS (sizeof(simBauds) / sizeof(simBauds[0]))
+
+typedef struct {
+	double time;
+	uint8_t level;
+} SimEdge;
+
+typedef struct {
+	// options
+	unsigned frames;
+	unsigned length;
+	double latency;
+	double jitter;
+	double cost;
+	double skew;
+	double glitch;
+	double width;
+	int verbose;
+	uint64_t seed;
+	// state of random generator
+	uint64_t state;
+
+	// device running now, real time in us and clock rate
+	double now;
+	double rate;
+	// interrupt of rx pin enabled
+	int intrEnabled;
+	// line as sent and as received, with glitches
+	SimEdge sent[SIM_MAX_EDGES];
+	unsigned nSent;
+	SimEdge line[SIM_MAX_EDGES];
+	unsigned nLine;
+	unsigned nCursor;
+
+	// results of a baud rate / skew
+	uint64_t nBits;
+	uint64_t nBitErrors;
+	uint32_t nFrameErrors;
+	uint32_t nFramingErrors;
+} SoftSim;
+
+static SoftSim sim;
+
+
+//
+// xorshift64* - the same sequence on every host for the same seed
+//
+static uint64_t simRandom(SoftSim *s)
+{
+	s->state ^= s->state >> 12;
+	s->state ^= s->state << 25;
+	s->state ^= s->state >> 27;
+	return s->state * 2685821657736338717ull;
+}
+
+
+static double simChance(SoftSim *s)
+{
+	return (simRandom(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+//
+// level of line at real time, edges are visited in time order
+//
+static uint8_t simLevel(SoftSim *s, double time)
+{
+	if (s->nCursor > 0 && s->line[s->nCursor - 1].time > time)
+		s->nCursor = 0;
+	while (s->nCursor < s->nLine && s->line[s->nCursor].time <= time)
+		s->nCursor++;
+	return s->nCursor ? s->line[s->nCursor - 1].level : 1;
+}
+
+
+//
+// softuart_hal.h for host
+//
+int softuart_hal_printf(const char *format, ...)
+{
+	va_list args;
+	int n = 0;
+
+	if (sim.verbose)
+	{
+		va_start(args, format);
+		n = vprintf(format, args);
+		va_end(args);
+	}
+	return n;
+}
+
+
+void softuart_hal_pin_set(uint8_t gpio_id, uint8_t level)
+{
+	SoftSim *s = &sim;
+	uint8_t last = s->nSent ? s->sent[s->nSent - 1].level : 1;
+
+	if (gpio_id == SIM_TX_GPIO && level != last && s->nSent < SIM_MAX_EDGES)
+	{
+		s->sent[s->nSent].time = s->now;
+		s->sent[s->nSent].level = level;
+		s->nSent++;
+	}
+	s->now += s->cost;
+}
+
+
+uint8_t softuart_hal_pin_get(uint8_t gpio_id)
+{
+	SoftSim *s = &sim;
+	uint8_t level = simLevel(s, s->now);
+
+	s->now += s->cost;
+	return level;
+}
+
+
+uint32_t softuart_hal_time(void)
+{
+	SoftSim *s = &sim;
+	uint32_t time = (uint32_t) (s->now * s->rate);
+
+	s->now += s->cost;
+	return time;
+}
+
+
+void softuart_hal_delay_us(uint32_t us)
+{
+	sim.now += us / sim.rate;
+}
+
+
+uint32_t softuart_hal_intr_status(void)
+{
+	return BIT(SIM_RX_GPIO);
+}
+
+
+void softuart_hal_intr_pin(uint8_t gpio_id, uint8_t state)
+{
+	sim.intrEnabled = state != GPIO_PIN_INTR_DISABLE;
+}
+
+
+static int simCompareEdges(const void *a, const void *b)
+{
+	double ta = ((const SimEdge *) a)->time;
+	double tb = ((const SimEdge *) b)->time;
+
+	return (ta > tb) - (ta < tb);
+}
+
+
+//
+// line as received: edges as sent, each glitch inverts level between its two edges
+//
+static void simGlitch(SoftSim *s, double bitTime)
+{
+	SimEdge glitches[SIM_MAX_EDGES];
+	unsigned nGlitches = 0, i, g = 0;
+	double end = s->nSent ? s->sent[s->nSent - 1].time : 0;
+	double t;
+	uint8_t inverted = 0, level = 1;
+
+	if (s->glitch > 0 && s->nSent > 0)
+		for (t = s->sent[0].time; t < end && nGlitches + 2 <= SIM_MAX_EDGES; t += bitTime)
+			if (simChance(s) < s->glitch)
+			{
+				glitches[nGlitches++].time = t + simChance(s) * bitTime;
+				glitches[nGlitches].time = glitches[nGlitches - 1].time + s->width;
+				nGlitches++;
+			}
+	// wide glitches may overlap the next one
+	qsort(glitches, nGlitches, sizeof(SimEdge), simCompareEdges);
+
+	// merge both, only changes of level are kept
+	s->nLine = 0;
+	s->nCursor = 0;
+	i = 0;
+	while (i < s->nSent || g < nGlitches)
+	{
+		if (g >= nGlitches || (i < s->nSent && s->sent[i].time <= glitches[g].time))
+		{
+			t = s->sent[i].time;
+			level = s->sent[i++].level;
+		}
+		else
+		{
+			t = glitches[g++].time;
+			inverted ^= 1;
+		}
+		if (s->nLine < SIM_MAX_EDGES && (level ^ inverted) != (s->nLine ? s->line[s->nLine - 1].level : 1))
+		{
+			s->line[s->nLine].time = t;
+			s->line[s->nLine].level = level ^ inverted;
+			s->nLine++;
+		}
+	}
+}
+
+
+static unsigned simBitCount(uint8_t x)
+{
+	unsigned n = 0;
+
+	for (; x; x >>= 1)
+		n += x & 1;
+	return n;
+}
+
+
+//
+// send and receive one frame, count bits that differ
+//
+static void simFrame(SoftSim *s, Softuart *tx, Softuart *rx, double skew)
+{
+	uint8_t data[SIM_MAX_LENGTH], received[SIM_MAX_LENGTH * 2];
+	unsigned nReceived = 0, i, nErrors = 0;
+	uint32_t framingErrors = rx->framing_errors;
+
+	for (i = 0; i < s->length; i++)
+		data[i] = (uint8_t) simRandom(s);
+
+	// sender, clock starts at a random value
+	s->rate = 1.0;
+	s->now = 1000.0 + simChance(s) * 1000.0;
+	s->nSent = 0;
+	for (i = 0; i < s->length; i++)
+		Softuart_Putchar(tx, data[i]);
+	simGlitch(s, tx->bit_time);
+
+	// receiver
+	s->rate = 1.0 + skew;
+	s->now = 0;
+	s->intrEnabled = 1;
+	for (i = 0; i < s->nLine; i++)
+	{
+		if (s->line[i].time < s->now || !s->intrEnabled)
+			continue;
+		s->now = s->line[i].time + s->latency + simChance(s) * s->jitter;
+		Softuart_Intr_Handler(rx);
+		while (Softuart_Available(rx) && nReceived < sizeof(received))
+			received[nReceived++] = Softuart_Read(rx);
+	}
+
+	for (i = 0; i < s->length && i < nReceived; i++)
+		nErrors += simBitCount(data[i] ^ received[i]);
+	nErrors += 8 * (nReceived > s->length ? nReceived - s->length : s->length - nReceived);
+
+	s->nBits += 8 * s->length;
+	s->nBitErrors += nErrors;
+	s->nFrameErrors += nErrors ? 1 : 0;
+	s->nFramingErrors += rx->framing_errors - framingErrors;
+}
+
+
+//
+// all frames at a baud rate and skew, returns bit error rate
+//
+static double simRun(SoftSim *s, uint16_t baud, double skew, uint8_t oversampling)
+{
+	Softuart tx, rx;
+	unsigned i;
+
+	memset(&tx, 0, sizeof(tx));
+	memset(&rx, 0, sizeof(rx));
+	Softuart_SetPinTx(&tx, SIM_TX_GPIO);
+	Softuart_Init(&tx, baud);
+	Softuart_SetPinRx(&rx, SIM_RX_GPIO);
+	Softuart_Init(&rx, baud);
+	Softuart_EnableOversampling(&rx, oversampling);
+
+	s->nBits = 0;
+	s->nBitErrors = 0;
+	s->nFrameErrors = 0;
+	s->nFramingErrors = 0;
+	for (i = 0; i < s->frames; i++)
+		simFrame(s, &tx, &rx, skew);
+	if (s->verbose)
+		printf("softsim: baud %u skew %+.1f%% %s frames bad %u of %u framing errors %u noise %u\n",
+			baud, skew * 100, oversampling ? "oversampling" : "single", (unsigned) s->nFrameErrors,
+			s->frames, (unsigned) s->nFramingErrors, (unsigned) rx.noise_errors);
+	return (double) s->nBitErrors / s->nBits;
+}
+
+
+static void simTable(SoftSim *s, uint8_t oversampling)
+{
+	double skews[SIM_SKEWS];
+	uint16_t maxBaud[SIM_SKEWS];
+	unsigned b, k;
+	double ber;
+
+	printf("\n%s\n  baud  bit_time", oversampling ? "oversampling, 3 votes per bit" : "one sample per bit");
+	for (k = 0; k < SIM_SKEWS; k++)
+	{
+		skews[k] = s->skew * ((double) k - SIM_SKEWS / 2) / (SIM_SKEWS / 2);
+		maxBaud[k] = 0;
+		printf("   %+5.1f%%", skews[k] * 100);
+	}
+	printf("\n");
+
+	for (b = 0; b < SIM_BAUDS; b++)
+	{
+		printf("%6u  %5u us", simBauds[b], (unsigned) (1000000 / simBauds[b]));
+		for (k = 0; k < SIM_SKEWS; k++)
+		{
+			ber = simRun(s, simBauds[b], skews[k], oversampling);
+			if (ber == 0)
+			{
+				printf("         0");
+				// reliable only if all lower baud rates are
+				if (b == 0 || maxBaud[k] == simBauds[b - 1])
+					maxBaud[k] = simBauds[b];
+			}
+			else
+				printf("   %7.1e", ber);
+		}
+		printf("\n");
+	}
+
+	printf("max baud        ");
+	for (k = 0; k < SIM_SKEWS; k++)
+		printf("    %6u", maxBaud[k]);
+	printf("\n");
+}
+
+
+static void simUsage(const char *name)
+{
+	fprintf(stderr, "usage: %s [options]\n"
+		"  -n frames    frames per baud rate and skew, default 100\n"
+		"  -l length    bytes per frame, default 16, up to %u\n"
+		"  -k skew      largest clock skew of receiver in %%, default 3\n"
+		"  -L us        interrupt latency, default 2\n"
+		"  -j us        random interrupt latency on top of it, default 2\n"
+		"  -c us        cost of reading clock or pin and setting pin, default 0.25\n"
+		"  -g chance    chance of a glitch in each bit time, default 0\n"
+		"  -w us        width of glitch, default 2\n"
+		"  -s seed      seed of random generator, default 1\n"
+		"  -v           print messages of Softuart_Init() and counters of each run\n",
+		name, SIM_MAX_LENGTH);
+}
+
+
+int main(int argc, char *argv[])
+{
+	SoftSim *s = &sim;
+	int opt;
+
+	s->frames = 100;
+	s->length = 16;
+	s->skew = 0.03;
+	s->latency = 2;
+	s->jitter = 2;
+	s->cost = 0.25;
+	s->width = 2;
+	s->seed = 1;
+	while ((opt = getopt(argc, argv, "n:l:k:L:j:c:g:w:s:v")) != -1)
+	{
+		switch (opt)
+		{
+			case 'n': s->frames = atoi(optarg); break;
+			case 'l': s->length = atoi(optarg); break;
+			case 'k': s->skew = atof(optarg) / 100; break;
+			case 'L': s->latency = atof(optarg); break;
+			case 'j': s->jitter = atof(optarg); break;
+			case 'c': s->cost = atof(optarg); break;
+			case 'g': s->glitch = atof(optarg); break;
+			case 'w': s->width = atof(optarg); break;
+			case 's': s->seed = strtoull(optarg, NULL, 0); break;
+			case 'v': s->verbose = 1; break;
+			default:
+				simUsage(argv[0]);
+				return 2;
+		}
+	}
+	if (optind != argc || s->frames == 0 || s->length == 0 || s->length > SIM_MAX_LENGTH ||
+		s->cost <= 0 || s->skew < 0 || s->skew >= 0.5 || s->seed == 0)
+	{
+		simUsage(argv[0]);
+		return 2;
+	}
+
+	s->state = s->seed;
+	printf("softsim: %u frames of %u bytes, latency %.1f + %.1f us, cost %.2f us, glitch %g of %.1f us, seed %llu\n",
+		s->frames, s->length, s->latency, s->jitter, s->cost, s->glitch, s->width,
+		(unsigned long long) s->seed);
+	printf("bit error rate by baud rate and clock skew of receiver\n");
+	simTable(s, 0);
+	simTable(s, 1);
+	return 0;
+}
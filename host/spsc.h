@@ -0,0 +1,146 @@
+/*
+* esp-just-slip - spsc.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef HOST_SPSC_H_
+#define HOST_SPSC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+//
+// Lock-free single producer / single consumer queue of fixed size slots
+//
+// Producer: slot = spscTail() ... fill slot ... spscPush()
+// Consumer: slot = spscHead() ... use slot ... spscPop()
+//   or slots spscPeek(0 .. n - 1) ... use them ... spscPop() n times
+//
+// Slots are filled and used in place, nothing is copied by the queue.
+// Indexes only grow and wrap at 2^32, nSlots must be a power of 2.
+// Each side keeps its copy of the other side's index and reads the shared one
+// only when the copy says the queue is full / empty, so the cache line of
+// the other index moves between cores once per batch, not once per slot.
+//
+// Several producers, e.g. worker threads, feed one consumer with one queue each.
+//
+#define SPSC_CACHE_LINE 64
+#define SPSC_INLINE static inline __attribute__((always_inline))
+
+typedef struct {
+	// written by producer
+	uint32_t nTail __attribute__((aligned(SPSC_CACHE_LINE)));
+	uint32_t nHeadCache;
+	// written by consumer
+	uint32_t nHead __attribute__((aligned(SPSC_CACHE_LINE)));
+	uint32_t nTailCache;
+	// constant
+	uint8_t *slots __attribute__((aligned(SPSC_CACHE_LINE)));
+	size_t nSlotSize;
+	uint32_t nMask;
+} SpscQueue;
+
+
+//
+// *slots - nSlots * nSlotSize bytes, nSlots a power of 2
+//
+SPSC_INLINE void spscInit(SpscQueue *queue, void *slots, uint32_t nSlots, size_t nSlotSize)
+{
+	queue->nTail = queue->nHeadCache = 0;
+	queue->nHead = queue->nTailCache = 0;
+	queue->slots = (uint8_t *) slots;
+	queue->nSlotSize = nSlotSize;
+	queue->nMask = nSlots - 1;
+}
+
+
+//
+// producer - free slot to fill, NULL if queue is full
+//
+SPSC_INLINE void *spscTail(SpscQueue *queue)
+{
+	if (queue->nTail - queue->nHeadCache > queue->nMask)
+	{
+		queue->nHeadCache = __atomic_load_n(&queue->nHead, __ATOMIC_ACQUIRE);
+		if (queue->nTail - queue->nHeadCache > queue->nMask)
+			return NULL;
+	}
+	return queue->slots + (queue->nTail & queue->nMask) * queue->nSlotSize;
+}
+
+
+//
+// producer - hand slot returned by spscTail() over to consumer
+//
+SPSC_INLINE void spscPush(SpscQueue *queue)
+{
+	__atomic_store_n(&queue->nTail, queue->nTail + 1, __ATOMIC_RELEASE);
+}
+
+
+//
+// consumer - oldest slot, NULL if queue is empty
+//
+SPSC_INLINE void *spscHead(SpscQueue *queue)
+{
+	if (queue->nHead == queue->nTailCache)
+	{
+		queue->nTailCache = __atomic_load_n(&queue->nTail, __ATOMIC_ACQUIRE);
+		if (queue->nHead == queue->nTailCache)
+			return NULL;
+	}
+	return queue->slots + (queue->nHead & queue->nMask) * queue->nSlotSize;
+}
+
+
+//
+// consumer - slot nOffset places after the oldest one, NULL if there are not so many
+// to use a batch of slots before giving them back, e.g. to sendmmsg() them
+//
+SPSC_INLINE void *spscPeek(SpscQueue *queue, uint32_t nOffset)
+{
+	if (queue->nTailCache - queue->nHead <= nOffset)
+	{
+		queue->nTailCache = __atomic_load_n(&queue->nTail, __ATOMIC_ACQUIRE);
+		if (queue->nTailCache - queue->nHead <= nOffset)
+			return NULL;
+	}
+	return queue->slots + ((queue->nHead + nOffset) & queue->nMask) * queue->nSlotSize;
+}
+
+
+//
+// consumer - give slot returned by spscHead() back to producer
+//
+SPSC_INLINE void spscPop(SpscQueue *queue)
+{
+	__atomic_store_n(&queue->nHead, queue->nHead + 1, __ATOMIC_RELEASE);
+}
+
+#endif /* HOST_SPSC_H_ */
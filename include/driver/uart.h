@@ -6,6 +6,15 @@
 #define RX_BUFF_SIZE    0x100
 #define TX_BUFF_SIZE    100
 
+// UART0 rx interrupt fires when this many bytes are in the 128 byte rx fifo
+#ifndef UART0_RX_FULL_THRESHOLD
+#define UART0_RX_FULL_THRESHOLD 64
+#endif
+// or when the line is idle for this many character times with data in rx fifo
+#ifndef UART0_RX_TOUT_THRESHOLD
+#define UART0_RX_TOUT_THRESHOLD 2
+#endif
+
 typedef enum {
     FIVE_BITS = 0x0,
     SIX_BITS = 0x1,
@@ -92,6 +101,14 @@ typedef struct {
 
 void uart_init(UartBautRate uart0_br, UartBautRate uart1_br);
 ICACHE_FLASH_ATTR int uart0_rx_one_char();
-ICACHE_FLASH_ATTR uart0_tx_one_char(uint8 TxChar);
+void ICACHE_FLASH_ATTR uart0_tx_one_char(uint8 TxChar);
+uint16 uart0_rx_peek(uint8 **buf);
+void uart0_rx_skip(uint16 len);
+uint32 uart0_rx_overflows(void);
+uint16 uart0_tx_free(void);
+void uart0_tx_buffer(uint8 *buf, uint16 len);
+void uart1_tx_buffer(uint8 *buf, uint16 len);
+void uart0_set_baud(UartBautRate baud);
+void uart0_set_rx_trigger(uint8 full, uint8 timeout);
 #endif
 
@@ -30,21 +30,11 @@
 */
 
 //
-// source https://en.wikipedia.org/wiki/Serial_Line_Internet_Protocol
+// SLIP encoding and decoding is done by slipcodec.h
+// the same file as in justslip/include of ESP8266 project
 //
-// SLIP_END - Frame End - distinguishes datagram boundaries in the byte stream
-// SLIP_ESC - Frame Escape
-//
-// If the END byte occurs in the data to be sent, the two byte sequence ESC, ESC_END is sent instead
-// If the ESC byte occurs in the data, the two byte sequence ESC, ESC_ESC is sent.
-//
-// SLIP_ESC_END - Transposed Frame End
-// SLIP_ESC_ESC - Transposed Frame Escape
-//
-#define SLIP_END 0xC0
-#define SLIP_ESC 0xDB
-#define SLIP_ESC_END 0xDC
-#define SLIP_ESC_ESC 0xDD
+#define SLIP_CODEC_LOG(message) Serial.print(message)
+#include "slipcodec.h"
 
 #define SLIP_BUFFER_SIZE 64
 
@@ -56,56 +46,10 @@
 //
 uint8_t slipDecodeSerial(uint8_t *dataBuffer)
 {
-  uint8_t dataByte;
-  static uint8_t previousDataByte = 0;
-  static uint8_t nPos = 0;
+  static SlipDecoder decoder;
+  SlipStreamSource<SoftwareSerial> source(espSerial);
 
-  while (espSerial.available())
-  {
-    dataByte = espSerial.read();
-    if (dataByte == SLIP_END)
-    {
-      if (nPos > 0)
-      {
-        previousDataByte = 0;
-        uint8_t result = nPos;
-        nPos = 0;
-        return result;
-      }
-      else
-      {
-        Serial.print("Orphan SLIP_END received!\n");
-        return 0;
-      }
-    }
-    else if (dataByte == SLIP_ESC)
-    {
-      previousDataByte = SLIP_ESC;
-      return 0;
-    }
-    else if (dataByte == SLIP_ESC_END && previousDataByte == SLIP_ESC)
-    {
-      previousDataByte = 0;
-      dataBuffer[nPos++] = SLIP_END;
-    }
-    else if (dataByte == SLIP_ESC_ESC && previousDataByte == SLIP_ESC)
-    {
-      previousDataByte = 0;
-      dataBuffer[nPos++] = SLIP_ESC;
-    }
-    else
-    {
-      dataBuffer[nPos++] = dataByte;
-    }
-    if (nPos == SLIP_BUFFER_SIZE - 2)
-    {
-      // purge buffer in case of overflow
-      nPos = 0;
-      previousDataByte = 0;
-      Serial.print("Input buffer purged because of overflow!\n");
-    }
-  }
-  return 0;
+  return slipDecode(decoder, source, dataBuffer, SLIP_BUFFER_SIZE, micros());
 }
 
 
@@ -115,21 +59,9 @@ uint8_t slipDecodeSerial(uint8_t *dataBuffer)
 //
 void slipEncodeSerial(uint8_t *dataBuffer, uint8_t nCount)
 {
-  for (int i = 0; i < nCount; i++)
-    switch (dataBuffer[i])
-    {
-      case SLIP_END:
-        espSerial.write(SLIP_ESC);
-        espSerial.write(SLIP_ESC_END);
-        break;
-      case SLIP_ESC:
-        espSerial.write(SLIP_ESC);
-        espSerial.write(SLIP_ESC_ESC);
-        break;
-      default:
-        espSerial.write(dataBuffer[i]);
-    }
-  espSerial.write(SLIP_END);
+  SlipStreamSink<SoftwareSerial> sink(espSerial);
+
+  slipEncode(sink, dataBuffer, nCount);
 }
 
 
@@ -0,0 +1,583 @@
+/*
+* esp-just-slip - slipcodec.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_SLIPCODEC_H_
+#define JUSTSLIP_INCLUDE_SLIPCODEC_H_
+
+//
+// SLIP codec - the one implementation of SLIP encoding and decoding
+// shared by UART0 and software serial ports of justslip, framing engine,
+// host tools and Arduino sketches (copy of this file in sketch folders)
+//
+// C part - decoder state and byte / span functions, forced inline so that
+// each port compiles its own loop around them with no calls per byte
+//
+// C++ part - slipDecode() / slipEncode() templates that take byte Source
+// and Sink policies, resolved and inlined at compile time:
+//
+// byte source - static const bool bulk = false;
+//   bool available(); uint8_t read();
+// bulk source - static const bool bulk = true;
+//   uint16_t peek(const uint8_t **data) - contiguous received bytes, 0 if none
+//   void skip(uint16_t nCount) - drop bytes consumed by decoder
+// sink - void write(const uint8_t *data, uint16_t nCount);
+//
+// Policies for Arduino Stream, memory, host file descriptors and
+// (C++ code on ESP8266) UART0 and Softuart are provided below.
+//
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "slipport.h"
+#endif
+
+//
+// source https://en.wikipedia.org/wiki/Serial_Line_Internet_Protocol
+//
+// SLIP_END - Frame End - distinguishes datagram boundaries in the byte stream
+// SLIP_ESC - Frame Escape
+//
+// If the END byte occurs in the data to be sent, the two byte sequence ESC, ESC_END is sent instead
+// If the ESC byte occurs in the data, the two byte sequence ESC, ESC_ESC is sent.
+//
+// SLIP_ESC_END - Transposed Frame End
+// SLIP_ESC_ESC - Transposed Frame Escape
+//
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+// size of buffer that will hold SLIP encoded frame of nCount bytes
+#define SLIP_MAX_ENCODED(nCount) (2 * (nCount) + 1)
+
+// quiet time on the line after which a partly received frame is dropped [us]
+// must be longer than the interval the port is polled at
+#ifndef SLIP_GAP_US
+#define SLIP_GAP_US 50000
+#endif
+
+// diagnostic messages of decoder, sketches define it before including this file
+#ifndef SLIP_CODEC_LOG
+#ifdef ARDUINO
+#define SLIP_CODEC_LOG(message)
+#else
+#define SLIP_CODEC_LOG(message) os_printf(message)
+#endif
+#endif
+
+#define SLIP_INLINE static inline __attribute__((always_inline))
+
+//
+// state of frame being decoded, all zeros is a valid initial state
+//
+// escape - previous byte was an escape
+// discard - frame exceeded buffer or is malformed, rest of it is dropped until delimiter
+// nPos - number of bytes decoded so far
+// time - when bytes were last fed, see slipDecoderGap()
+//
+typedef struct {
+	bool escape;
+	bool discard;
+	uint16_t nPos;
+	uint32_t time;
+} SlipDecoder;
+
+
+SLIP_INLINE void slipDecoderInit(SlipDecoder *decoder)
+{
+	decoder->escape = false;
+	decoder->discard = false;
+	decoder->nPos = 0;
+}
+
+
+//
+// drop partly received frame if the line was quiet for longer than gap,
+// e.g. the peer was reset in the middle of a frame or its SLIP_END was lost,
+// so that the next byte starts a new frame
+// call with current time each time received bytes are about to be fed
+//
+// *decoder - pointer to decoder state
+// now - current time [us], e.g. system_get_time() or micros()
+// gap - longest quiet time inside a frame [us], SLIP_GAP_US
+//
+// returned value - true if a partial frame was dropped
+//
+SLIP_INLINE bool slipDecoderGap(SlipDecoder *decoder, uint32_t now, uint32_t gap)
+{
+	bool partial = decoder->nPos > 0 || decoder->escape || decoder->discard;
+	bool expired = partial && (uint32_t) (now - decoder->time) > gap;
+
+	if (expired)
+	{
+		SLIP_CODEC_LOG("Partial frame dropped - inter-byte timeout!\r\n");
+		slipDecoderInit(decoder);
+	}
+	decoder->time = now;
+	return expired;
+}
+
+
+//
+// store one decoded byte, purge the frame in case of overflow
+//
+SLIP_INLINE void slipDecoderStore(SlipDecoder *decoder, uint8_t dataByte, uint8_t *dataBuffer, uint16_t nSize)
+{
+	if (decoder->discard)
+		return;
+	if (decoder->nPos == nSize)
+	{
+		// skip rest of the frame until delimiter
+		decoder->discard = true;
+		SLIP_CODEC_LOG("Input buffer purged because of overflow!\r\n");
+		return;
+	}
+	dataBuffer[decoder->nPos++] = dataByte;
+}
+
+
+//
+// complete the frame once SLIP_END is received
+// empty and purged frames are dropped
+//
+SLIP_INLINE uint16_t slipDecoderEnd(SlipDecoder *decoder)
+{
+	uint16_t result = decoder->discard ? 0 : decoder->nPos;
+
+	slipDecoderInit(decoder);
+	return result;
+}
+
+
+//
+// feed one received byte to decoder
+// a frame with invalid escape sequence is dropped, bytes up to the next SLIP_END are skipped
+//
+// *decoder - pointer to decoder state
+// dataByte - byte received from the link
+// *dataBuffer - pointer to data buffer to store decoded data, the same for each byte of a frame
+// nSize - size of dataBuffer
+//
+// returned value - number of bytes in dataBuffer once the frame is complete, otherwise 0
+//
+SLIP_INLINE uint16_t slipDecodeByte(SlipDecoder *decoder, uint8_t dataByte, uint8_t *dataBuffer, uint16_t nSize)
+{
+	if (dataByte == SLIP_END)
+	{
+		// SLIP_ESC SLIP_END is not valid either
+		if (decoder->escape)
+			decoder->discard = true;
+		return slipDecoderEnd(decoder);
+	}
+	if (decoder->discard)
+		return 0;
+	if (decoder->escape)
+	{
+		decoder->escape = false;
+		if (dataByte == SLIP_ESC_END)
+			slipDecoderStore(decoder, SLIP_END, dataBuffer, nSize);
+		else if (dataByte == SLIP_ESC_ESC)
+			slipDecoderStore(decoder, SLIP_ESC, dataBuffer, nSize);
+		else
+		{
+			decoder->discard = true;
+			SLIP_CODEC_LOG("Frame dropped - invalid escape sequence!\r\n");
+		}
+	}
+	else if (dataByte == SLIP_ESC)
+		decoder->escape = true;
+	else
+		slipDecoderStore(decoder, dataByte, dataBuffer, nSize);
+	return 0;
+}
+
+
+//
+// decode received bytes from srcBuffer until the end of frame
+// used where the source hands out received data in contiguous spans
+//
+// *decoder - pointer to decoder state
+// *srcBuffer - pointer to received bytes
+// nCount - number of bytes in srcBuffer
+// *nUsed - number of bytes taken from srcBuffer, the rest belongs to next frames
+// *dataBuffer - pointer to data buffer to store decoded data, the same for each span of a frame
+// nSize - size of dataBuffer
+//
+// returned value - number of bytes in dataBuffer once the frame is complete, otherwise 0
+//
+SLIP_INLINE uint16_t slipDecodeSpan(SlipDecoder *decoder, const uint8_t *srcBuffer, uint16_t nCount,
+	uint16_t *nUsed, uint8_t *dataBuffer, uint16_t nSize)
+{
+	uint16_t i = 0;
+	uint8_t dataByte;
+
+	while (i < nCount)
+	{
+		// copy run of plain data without looking at decoder state for each byte
+		if (!decoder->escape && !decoder->discard)
+		{
+			uint16_t nPos = decoder->nPos;
+
+			while (i < nCount && nPos < nSize && srcBuffer[i] != SLIP_END && srcBuffer[i] != SLIP_ESC)
+				dataBuffer[nPos++] = srcBuffer[i++];
+			decoder->nPos = nPos;
+			if (i == nCount)
+				break;
+		}
+		// frame is dropped, scan for its end without decoding
+		else if (decoder->discard)
+		{
+			while (i < nCount && srcBuffer[i] != SLIP_END)
+				i++;
+			if (i == nCount)
+				break;
+		}
+
+		dataByte = srcBuffer[i++];
+		if (dataByte == SLIP_END)
+		{
+			*nUsed = i;
+			return slipDecoderEnd(decoder);
+		}
+		slipDecodeByte(decoder, dataByte, dataBuffer, nSize);
+	}
+	*nUsed = nCount;
+	return 0;
+}
+
+
+//
+// SLIP encode one data byte
+//
+// *wireBuffer - pointer to buffer of 2 bytes
+//
+// returned value - number of bytes stored in wireBuffer
+//
+SLIP_INLINE uint8_t slipEncodeByte(uint8_t dataByte, uint8_t *wireBuffer)
+{
+	switch (dataByte)
+	{
+		case SLIP_END:
+			wireBuffer[0] = SLIP_ESC;
+			wireBuffer[1] = SLIP_ESC_END;
+			return 2;
+		case SLIP_ESC:
+			wireBuffer[0] = SLIP_ESC;
+			wireBuffer[1] = SLIP_ESC_ESC;
+			return 2;
+		default:
+			wireBuffer[0] = dataByte;
+			return 1;
+	}
+}
+
+
+//
+// number of wire bytes of SLIP encoded frame, SLIP_END included
+// e.g. to charge a pacer before sending
+//
+SLIP_INLINE uint16_t slipEncodedSize(const uint8_t *srcBuffer, uint16_t nCount)
+{
+	uint16_t i;
+	uint16_t nWire = nCount + 1;
+
+	for (i = 0; i < nCount; i++)
+		if (srcBuffer[i] == SLIP_END || srcBuffer[i] == SLIP_ESC)
+			nWire++;
+	return nWire;
+}
+
+
+//
+// SLIP encode data from srcBuffer into a frame terminated with SLIP_END
+//
+// *dstBuffer - pointer to data buffer of at least SLIP_MAX_ENCODED(nCount) bytes
+//
+// returned value - number of bytes stored in dstBuffer
+//
+SLIP_INLINE uint16_t slipEncodeFrame(const uint8_t *srcBuffer, uint16_t nCount, uint8_t *dstBuffer)
+{
+	uint16_t i;
+	uint16_t nPos = 0;
+
+	for (i = 0; i < nCount; i++)
+		nPos += slipEncodeByte(srcBuffer[i], dstBuffer + nPos);
+	dstBuffer[nPos++] = SLIP_END;
+	return nPos;
+}
+
+
+#ifdef __cplusplus
+
+// selects byte by byte or bulk reading of a source at compile time
+template <bool bulk> struct SlipReadMode {};
+
+template <class Source>
+SLIP_INLINE uint16_t slipDecodeFrom(SlipDecoder &decoder, Source &source, uint8_t *dataBuffer, uint16_t nSize, SlipReadMode<false>)
+{
+	uint16_t nCount;
+
+	while (source.available())
+	{
+		nCount = slipDecodeByte(&decoder, source.read(), dataBuffer, nSize);
+		if (nCount > 0)
+			return nCount;
+	}
+	return 0;
+}
+
+template <class Source>
+SLIP_INLINE uint16_t slipDecodeFrom(SlipDecoder &decoder, Source &source, uint8_t *dataBuffer, uint16_t nSize, SlipReadMode<true>)
+{
+	const uint8_t *data;
+	uint16_t nCount, nUsed;
+
+	while ((nCount = source.peek(&data)) > 0)
+	{
+		nCount = slipDecodeSpan(&decoder, data, nCount, &nUsed, dataBuffer, nSize);
+		source.skip(nUsed);
+		if (nCount > 0)
+			return nCount;
+	}
+	return 0;
+}
+
+
+//
+// read SLIP encoded data from source, decode them and store in dataBuffer
+//
+// decoder - decoder state, one per source
+// source - Source policy
+// *dataBuffer - pointer to data buffer to store decoded data, the same until the frame is complete
+// nSize - size of dataBuffer
+//
+// returned value - number of bytes in dataBuffer once the frame is complete, otherwise 0
+//
+template <class Source>
+SLIP_INLINE uint16_t slipDecode(SlipDecoder &decoder, Source &source, uint8_t *dataBuffer, uint16_t nSize)
+{
+	return slipDecodeFrom(decoder, source, dataBuffer, nSize, SlipReadMode<Source::bulk>());
+}
+
+
+template <class Source>
+SLIP_INLINE bool slipSourceReady(Source &source, SlipReadMode<false>)
+{
+	return source.available();
+}
+
+template <class Source>
+SLIP_INLINE bool slipSourceReady(Source &source, SlipReadMode<true>)
+{
+	const uint8_t *data;
+	return source.peek(&data) > 0;
+}
+
+
+//
+// as above, and drop partly received frame if the line was quiet for longer than SLIP_GAP_US
+//
+// now - current time [us], e.g. micros()
+//
+template <class Source>
+SLIP_INLINE uint16_t slipDecode(SlipDecoder &decoder, Source &source, uint8_t *dataBuffer, uint16_t nSize, uint32_t now)
+{
+	if (slipSourceReady(source, SlipReadMode<Source::bulk>()))
+		slipDecoderGap(&decoder, now, SLIP_GAP_US);
+	return slipDecode(decoder, source, dataBuffer, nSize);
+}
+
+
+//
+// SLIP encode data from dataBuffer and write them to sink
+// runs of data that need no escaping are written in one go
+//
+template <class Sink>
+SLIP_INLINE void slipEncode(Sink &sink, const uint8_t *dataBuffer, uint16_t nCount)
+{
+	uint8_t wireBuffer[2];
+	uint16_t i, nRun = 0;
+
+	for (i = 0; i < nCount; i++)
+		if (dataBuffer[i] == SLIP_END || dataBuffer[i] == SLIP_ESC)
+		{
+			if (i > nRun)
+				sink.write(dataBuffer + nRun, i - nRun);
+			sink.write(wireBuffer, slipEncodeByte(dataBuffer[i], wireBuffer));
+			nRun = i + 1;
+		}
+	if (nCount > nRun)
+		sink.write(dataBuffer + nRun, nCount - nRun);
+	wireBuffer[0] = SLIP_END;
+	sink.write(wireBuffer, 1);
+}
+
+
+//
+// Arduino Stream / Print or any class with the same methods
+//
+template <class Stream>
+struct SlipStreamSource {
+	static const bool bulk = false;
+	Stream &stream;
+	SlipStreamSource(Stream &s) : stream(s) {}
+	bool available() { return stream.available() > 0; }
+	uint8_t read() { return (uint8_t) stream.read(); }
+};
+
+template <class Stream>
+struct SlipStreamSink {
+	Stream &stream;
+	SlipStreamSink(Stream &s) : stream(s) {}
+	void write(const uint8_t *data, uint16_t nCount) { stream.write(data, nCount); }
+};
+
+
+//
+// bytes already in memory, e.g. a captured stream
+//
+struct SlipMemorySource {
+	static const bool bulk = true;
+	const uint8_t *data;
+	uint16_t nCount;
+	SlipMemorySource(const uint8_t *d, uint16_t n) : data(d), nCount(n) {}
+	uint16_t peek(const uint8_t **d) { *d = data; return nCount; }
+	void skip(uint16_t n) { data += n; nCount -= n; }
+};
+
+// bytes that do not fit are counted in nPos but not stored
+struct SlipMemorySink {
+	uint8_t *buffer;
+	uint16_t nSize;
+	uint16_t nPos;
+	SlipMemorySink(uint8_t *b, uint16_t n) : buffer(b), nSize(n), nPos(0) {}
+	void write(const uint8_t *data, uint16_t nCount)
+	{
+		uint16_t i;
+		for (i = 0; i < nCount; i++, nPos++)
+			if (nPos < nSize)
+				buffer[nPos] = data[i];
+	}
+};
+
+
+#if defined(__ets__)
+
+// SDK defines BOOL for C only
+#ifndef BOOL
+#define BOOL bool
+#endif
+
+extern "C" {
+#include "driver/uart.h"
+#include "softuart.h"
+}
+
+struct SlipUart0Source {
+	static const bool bulk = true;
+	uint16_t peek(const uint8_t **data) { return uart0_rx_peek((uint8 **) data); }
+	void skip(uint16_t nCount) { uart0_rx_skip(nCount); }
+};
+
+struct SlipUart0Sink {
+	void write(const uint8_t *data, uint16_t nCount) { uart0_tx_buffer((uint8 *) data, nCount); }
+};
+
+struct SlipSoftuartSource {
+	static const bool bulk = false;
+	Softuart *softuart;
+	SlipSoftuartSource(Softuart *s) : softuart(s) {}
+	bool available() { return Softuart_Available(softuart); }
+	uint8_t read() { return Softuart_Read(softuart); }
+};
+
+// holds RS485 driver on from construction until the sink goes out of scope
+struct SlipSoftuartSink {
+	Softuart *softuart;
+	SlipSoftuartSink(Softuart *s) : softuart(s) { Softuart_BeginFrame(softuart); }
+	~SlipSoftuartSink() { Softuart_EndFrame(softuart); }
+	void write(const uint8_t *data, uint16_t nCount)
+	{
+		uint16_t i;
+		for (i = 0; i < nCount; i++)
+			Softuart_Putchar(softuart, (char) data[i]);
+	}
+};
+
+#elif !defined(ARDUINO)
+
+#include <unistd.h>
+
+// host serial port, pipe or socket, reads whatever is available in chunks
+struct SlipFdSource {
+	static const bool bulk = true;
+	int fd;
+	uint8_t buffer[256];
+	uint16_t nHead;
+	uint16_t nTail;
+	SlipFdSource(int f) : fd(f), nHead(0), nTail(0) {}
+	uint16_t peek(const uint8_t **data)
+	{
+		if (nHead == nTail)
+		{
+			ssize_t n = ::read(fd, buffer, sizeof(buffer));
+			nHead = 0;
+			nTail = (n > 0) ? (uint16_t) n : 0;
+		}
+		*data = buffer + nHead;
+		return nTail - nHead;
+	}
+	void skip(uint16_t nCount) { nHead += nCount; }
+};
+
+struct SlipFdSink {
+	int fd;
+	SlipFdSink(int f) : fd(f) {}
+	void write(const uint8_t *data, uint16_t nCount)
+	{
+		while (nCount > 0)
+		{
+			ssize_t n = ::write(fd, data, nCount);
+			if (n <= 0)
+				return;
+			data += n;
+			nCount -= (uint16_t) n;
+		}
+	}
+};
+
+#endif
+
+#endif /* __cplusplus */
+
+#endif /* JUSTSLIP_INCLUDE_SLIPCODEC_H_ */
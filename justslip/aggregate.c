@@ -0,0 +1,178 @@
+/*
+* esp-just-slip - aggregate.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "aggregate.h"
+
+
+//
+// set up empty aggregator
+//
+// *aggregator - pointer to aggregator state
+// nThreshold - frame is sent once it holds that many bytes, up to AGGREGATE_MAX_FRAME
+// deadline - longest time a message may wait for its frame [us], e.g. AGGREGATE_DEADLINE_US
+//
+void ICACHE_FLASH_ATTR aggregateInit(Aggregator *aggregator, uint8_t nThreshold, uint32_t deadline)
+{
+	os_memset(aggregator, 0, sizeof(Aggregator));
+	if (nThreshold == 0 || nThreshold > AGGREGATE_MAX_FRAME)
+		nThreshold = AGGREGATE_MAX_FRAME;
+	aggregator->nThreshold = nThreshold;
+	aggregator->deadline = deadline;
+}
+
+
+//
+// hand out frame being filled and start a new one
+//
+// returned value - number of bytes stored in frameBuffer, 0 if there are no messages
+//
+uint8_t ICACHE_FLASH_ATTR aggregateFlush(Aggregator *aggregator, uint32_t now, uint8_t *frameBuffer)
+{
+	AggregateStats *stats = &aggregator->stats;
+	uint8_t nCount = aggregator->nCount;
+	uint32_t delay;
+
+	if (aggregator->nMessages == 0)
+		return 0;
+	os_memcpy(frameBuffer, aggregator->frame, nCount);
+
+	stats->nFrames++;
+	stats->nMessages += aggregator->nMessages;
+	if (aggregator->nMessages > stats->nMaxPacked)
+		stats->nMaxPacked = aggregator->nMessages;
+	stats->delaySum += aggregator->nMessages * now - aggregator->addedSum;
+	delay = now - aggregator->first;
+	if (delay > stats->delayMax)
+		stats->delayMax = delay;
+
+	aggregator->nCount = 0;
+	aggregator->nMessages = 0;
+	aggregator->addedSum = 0;
+	return nCount;
+}
+
+
+//
+// add message to frame being filled
+// if the message does not fit, the frame filled so far is handed out to make room
+//
+// *aggregator - pointer to aggregator state
+// *dataBuffer - pointer to message
+// nCount - number of bytes of message, 1 .. AGGREGATE_MAX_FRAME - 1
+// now - current time [us], e.g. system_get_time()
+// *frameBuffer - pointer to data buffer of AGGREGATE_MAX_FRAME bytes
+//
+// returned value - number of bytes of frame stored in frameBuffer to send now, otherwise 0
+//
+uint8_t ICACHE_FLASH_ATTR aggregateAdd(Aggregator *aggregator, const uint8_t *dataBuffer, uint8_t nCount, uint32_t now, uint8_t *frameBuffer)
+{
+	uint8_t nFrame = 0;
+
+	if (nCount == 0 || nCount >= AGGREGATE_MAX_FRAME)
+	{
+		os_printf("Unable to aggregate - message empty or too long!\r\n");
+		return 0;
+	}
+	if (aggregator->nCount + 1 + nCount > AGGREGATE_MAX_FRAME)
+		nFrame = aggregateFlush(aggregator, now, frameBuffer);
+
+	if (aggregator->nMessages == 0)
+		aggregator->first = now;
+	aggregator->frame[aggregator->nCount++] = nCount;
+	os_memcpy(aggregator->frame + aggregator->nCount, dataBuffer, nCount);
+	aggregator->nCount += nCount;
+	aggregator->nMessages++;
+	aggregator->addedSum += now;
+	return nFrame;
+}
+
+
+//
+// check if frame being filled is due to be sent
+// call after each aggregateAdd() and periodically, more often than deadline
+//
+// *aggregator - pointer to aggregator state
+// now - current time [us]
+// *frameBuffer - pointer to data buffer of AGGREGATE_MAX_FRAME bytes
+//
+// returned value - number of bytes of frame stored in frameBuffer to send now, otherwise 0
+//
+uint8_t ICACHE_FLASH_ATTR aggregatePoll(Aggregator *aggregator, uint32_t now, uint8_t *frameBuffer)
+{
+	if (aggregator->nMessages == 0)
+		return 0;
+	if (aggregator->nCount >= aggregator->nThreshold || now - aggregator->first >= aggregator->deadline)
+		return aggregateFlush(aggregator, now, frameBuffer);
+	return 0;
+}
+
+
+//
+// take the next message out of received frame
+//
+// *dataBuffer - pointer to received frame, without crc16
+// nCount - number of bytes of frame
+// *nPos - position in frame, set to 0 before the first call
+// **message - pointer to message within dataBuffer
+//
+// returned value - number of bytes of message, 0 once there are no more messages or frame is malformed
+//
+uint8_t ICACHE_FLASH_ATTR aggregateNext(const uint8_t *dataBuffer, uint8_t nCount, uint8_t *nPos, const uint8_t **message)
+{
+	uint8_t nLength;
+
+	if (*nPos >= nCount)
+		return 0;
+	nLength = dataBuffer[*nPos];
+	if (nLength == 0 || *nPos + 1 + nLength > nCount)
+	{
+		os_printf("Malformed aggregate frame!\r\n");
+		*nPos = nCount;
+		return 0;
+	}
+	*message = dataBuffer + *nPos + 1;
+	*nPos += 1 + nLength;
+	return nLength;
+}
+
+
+//
+// print counters of aggregator for diagnostic purposes
+// messages per frame and average / maximum delay added by aggregation [us]
+//
+void ICACHE_FLASH_ATTR aggregatePrintStats(Aggregator *aggregator)
+{
+	AggregateStats *stats = &aggregator->stats;
+
+	os_printf("aggregate: frames %u messages %u max %u per frame delay %u / %u us\r\n",
+		(unsigned) stats->nFrames, (unsigned) stats->nMessages, (unsigned) stats->nMaxPacked,
+		(unsigned) (stats->nMessages ? stats->delaySum / stats->nMessages : 0), (unsigned) stats->delayMax);
+}
@@ -0,0 +1,427 @@
+/*
+* esp-just-slip - autobaud.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifdef __ets__
+#include <ets_sys.h>
+#include <osapi.h>
+#include <user_interface.h>
+
+#include "justslip.h"
+#endif
+#include "crc32.h"
+#include "autobaud.h"
+
+// magic, type, rate index, sequence number
+#define AUTOBAUD_HEADER (AUTOBAUD_MAGIC_SIZE + 3)
+
+// rates tried in turn, AUTOBAUD_BASE_RATE first
+static const UartBautRate autobaudRates[AUTOBAUD_RATES] = {
+	BIT_RATE_57600,
+	BIT_RATE_115200,
+	BIT_RATE_230400,
+	BIT_RATE_460800,
+	BIT_RATE_921600
+};
+
+static const uint8_t autobaudMagic[AUTOBAUD_MAGIC_SIZE] = { AUTOBAUD_MAGIC };
+
+// bit patterns that show sampling errors first, including bytes SLIP escapes
+static const uint8_t autobaudPattern[8] = {0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0xC0, 0xDB};
+
+
+//
+// fill test pattern of probe frame, shifted by sequence number
+//
+static void ICACHE_FLASH_ATTR autobaudFillPattern(uint8_t nSeq, uint8_t *dataBuffer)
+{
+	uint8_t i;
+	for (i = 0; i < AUTOBAUD_PROBE_PATTERN; i++)
+		dataBuffer[i] = autobaudPattern[(i + nSeq) % sizeof(autobaudPattern)];
+}
+
+
+//
+// send control frame over UART0
+//
+// type - AUTOBAUD_TYPE_xxx
+// nRate - index of rate the frame refers to
+// nSeq - sequence number of probe frame
+//
+static void ICACHE_FLASH_ATTR autobaudSend(uint8_t type, uint8_t nRate, uint8_t nSeq)
+{
+	uint8_t frameBuffer[AUTOBAUD_HEADER + AUTOBAUD_PROBE_PATTERN + 2];
+	uint8_t nCount = AUTOBAUD_HEADER;
+	int8_t nControl = -1;
+
+	// frames without test pattern are encoded at compile time, see autobaudframes.cpp
+	if (type == AUTOBAUD_TYPE_PROPOSE)
+		nControl = AUTOBAUD_CONTROL_PROPOSE;
+	else if (type == AUTOBAUD_TYPE_ACK)
+		nControl = AUTOBAUD_CONTROL_ACK;
+	else if (type == AUTOBAUD_TYPE_COMMIT)
+		nControl = AUTOBAUD_CONTROL_COMMIT;
+	else if (type == AUTOBAUD_TYPE_DOWN)
+		nControl = AUTOBAUD_CONTROL_DOWN;
+	if (nControl >= 0 && nSeq == 0)
+	{
+		AUTOBAUD_SEND_WIRE(&autobaudControl[nControl][nRate]);
+		return;
+	}
+
+	os_memcpy(frameBuffer, autobaudMagic, AUTOBAUD_MAGIC_SIZE);
+	frameBuffer[AUTOBAUD_MAGIC_SIZE] = type;
+	frameBuffer[AUTOBAUD_MAGIC_SIZE + 1] = nRate;
+	frameBuffer[AUTOBAUD_MAGIC_SIZE + 2] = nSeq;
+	if (type == AUTOBAUD_TYPE_PROBE || type == AUTOBAUD_TYPE_ECHO)
+	{
+		autobaudFillPattern(nSeq, frameBuffer + AUTOBAUD_HEADER);
+		nCount += AUTOBAUD_PROBE_PATTERN;
+	}
+	nCount = (uint8_t) appendCrc(CRC_16, frameBuffer, nCount, sizeof(frameBuffer));
+	AUTOBAUD_SEND(frameBuffer, nCount);
+}
+
+
+//
+// change rate of UART0 and restart error counting
+//
+static void ICACHE_FLASH_ATTR autobaudSwitch(Autobaud *autobaud, uint8_t nRate)
+{
+	autobaud->nRate = nRate;
+	AUTOBAUD_SET_RATE(autobaudRates[nRate]);
+	autobaud->time = AUTOBAUD_TIME();
+	autobaud->lastValid = autobaud->time;
+	autobaud->nFrames = 0;
+	autobaud->nErrors = 0;
+}
+
+
+//
+// leader: propose the next rate or settle if there is none
+//
+static void ICACHE_FLASH_ATTR autobaudPropose(Autobaud *autobaud)
+{
+	if (autobaud->nGood + 1 >= AUTOBAUD_RATES)
+	{
+		autobaud->state = AUTOBAUD_SETTLED;
+		os_printf("Link settled at %d baud\r\n", (int) autobaudRates[autobaud->nRate]);
+		return;
+	}
+	autobaudSend(AUTOBAUD_TYPE_PROPOSE, autobaud->nGood + 1, 0);
+	if (autobaud->state != AUTOBAUD_PROPOSE)
+		autobaud->nTries = 0;
+	autobaud->nTries++;
+	autobaud->state = AUTOBAUD_PROPOSE;
+	autobaud->time = AUTOBAUD_TIME();
+}
+
+
+//
+// count received frame to detect rising error rate
+// the leader steps one rate down once a window has too many CRC failures
+//
+static void ICACHE_FLASH_ATTR autobaudCount(Autobaud *autobaud, bool valid)
+{
+	autobaud->nFrames++;
+	if (!valid)
+		autobaud->nErrors++;
+	if (autobaud->nFrames < AUTOBAUD_WINDOW)
+		return;
+
+	if (autobaud->role == AUTOBAUD_LEADER && autobaud->state == AUTOBAUD_SETTLED
+		&& autobaud->nErrors > AUTOBAUD_WINDOW_ERRORS && autobaud->nRate > 0)
+	{
+		uint8_t nRate = autobaud->nRate - 1;
+
+		os_printf("Link errors %d of %d, falling back to %d baud\r\n",
+			autobaud->nErrors, autobaud->nFrames, (int) autobaudRates[nRate]);
+		autobaudSend(AUTOBAUD_TYPE_DOWN, nRate, 0);
+		autobaudSwitch(autobaud, nRate);
+		autobaud->nGood = nRate;
+		return;
+	}
+	autobaud->nFrames = 0;
+	autobaud->nErrors = 0;
+}
+
+
+//
+// check that a frame with valid CRC16 is a well formed control frame
+//
+// returned value - true if magic, type, rate index and length all match
+//
+static bool ICACHE_FLASH_ATTR autobaudIsControl(const uint8_t *dataBuffer, uint8_t nCount)
+{
+	uint8_t nLength = AUTOBAUD_HEADER + 2;
+
+	if (nCount < AUTOBAUD_HEADER + 2 || os_memcmp(dataBuffer, autobaudMagic, AUTOBAUD_MAGIC_SIZE) != 0)
+		return false;
+	switch (dataBuffer[AUTOBAUD_MAGIC_SIZE])
+	{
+		case AUTOBAUD_TYPE_PROBE:
+		case AUTOBAUD_TYPE_ECHO:
+			nLength += AUTOBAUD_PROBE_PATTERN;
+			break;
+		case AUTOBAUD_TYPE_PROPOSE:
+		case AUTOBAUD_TYPE_ACK:
+		case AUTOBAUD_TYPE_COMMIT:
+		case AUTOBAUD_TYPE_DOWN:
+			break;
+		default:
+			return false;
+	}
+	return nCount == nLength && dataBuffer[AUTOBAUD_MAGIC_SIZE + 1] < AUTOBAUD_RATES;
+}
+
+
+//
+// initialise negotiation, UART0 is set to AUTOBAUD_BASE_RATE
+//
+// *autobaud - pointer to negotiation state
+// role - AUTOBAUD_LEADER drives negotiation, AUTOBAUD_FOLLOWER answers
+//
+void ICACHE_FLASH_ATTR autobaudInit(Autobaud *autobaud, AutobaudRole role)
+{
+	autobaud->role = role;
+	autobaud->state = AUTOBAUD_IDLE;
+	autobaud->nGood = 0;
+	autobaud->nPrevious = 0;
+	autobaud->nTries = 0;
+	autobaud->nProbe = 0;
+	autobaud->nEcho = 0;
+	autobaudSwitch(autobaud, 0);
+}
+
+
+//
+// leader: start negotiation from the fastest rate found so far
+//
+void ICACHE_FLASH_ATTR autobaudStart(Autobaud *autobaud)
+{
+	if (autobaud->role == AUTOBAUD_LEADER)
+		autobaudPropose(autobaud);
+}
+
+
+//
+// check received frame, process it if it is a control frame
+// call for every frame received over UART0
+//
+// *autobaud - pointer to negotiation state
+// *dataBuffer - pointer to received frame including crc16
+// nCount - number of bytes in dataBuffer
+//
+// returned value - true if the frame was a control frame and should not be processed any further,
+//   false for application frames and frames that fail the checks of autobaudIsControl()
+//
+bool ICACHE_FLASH_ATTR autobaudFrame(Autobaud *autobaud, uint8_t *dataBuffer, uint8_t nCount)
+{
+	bool valid = (nCount > 2 && checkCrc(CRC_16, dataBuffer, nCount));
+	uint8_t type, nRate, nSeq;
+
+	if (valid)
+		autobaud->lastValid = AUTOBAUD_TIME();
+	if (!valid || !autobaudIsControl(dataBuffer, nCount))
+	{
+		autobaudCount(autobaud, valid);
+		return false;
+	}
+
+	type = dataBuffer[AUTOBAUD_MAGIC_SIZE];
+	nRate = dataBuffer[AUTOBAUD_MAGIC_SIZE + 1];
+	nSeq = dataBuffer[AUTOBAUD_MAGIC_SIZE + 2];
+
+	if (autobaud->role == AUTOBAUD_LEADER)
+	{
+		switch (type)
+		{
+			case AUTOBAUD_TYPE_ACK:
+				if (autobaud->state == AUTOBAUD_PROPOSE && nRate == autobaud->nGood + 1)
+				{
+					autobaudSwitch(autobaud, nRate);
+					autobaud->state = AUTOBAUD_PROBE;
+					autobaud->nProbe = 0;
+					autobaud->nEcho = 0;
+				}
+				break;
+			case AUTOBAUD_TYPE_ECHO:
+				if (autobaud->state == AUTOBAUD_PROBE && nRate == autobaud->nRate)
+				{
+					uint8_t pattern[AUTOBAUD_PROBE_PATTERN];
+
+					autobaudFillPattern(nSeq, pattern);
+					if (os_memcmp(pattern, dataBuffer + AUTOBAUD_HEADER, AUTOBAUD_PROBE_PATTERN) == 0)
+						autobaud->nEcho++;
+				}
+				break;
+		}
+	}
+	else
+	{
+		switch (type)
+		{
+			case AUTOBAUD_TYPE_PROPOSE:
+				// the leader proposes only the rate next to the one in use
+				if (nRate != autobaud->nRate + 1)
+					break;
+				// proposal at the rate being probed means the leader committed it
+				if (autobaud->state == AUTOBAUD_PROBE)
+					autobaud->nGood = autobaud->nRate;
+				autobaudSend(AUTOBAUD_TYPE_ACK, nRate, 0);
+				autobaud->nPrevious = autobaud->nRate;
+				autobaudSwitch(autobaud, nRate);
+				autobaud->state = AUTOBAUD_PROBE;
+				break;
+			case AUTOBAUD_TYPE_PROBE:
+				if (autobaud->state == AUTOBAUD_PROBE && nRate == autobaud->nRate)
+				{
+					autobaudSend(AUTOBAUD_TYPE_ECHO, nRate, nSeq);
+					autobaud->time = AUTOBAUD_TIME();
+				}
+				break;
+			case AUTOBAUD_TYPE_COMMIT:
+				if (autobaud->state == AUTOBAUD_PROBE && nRate == autobaud->nRate)
+				{
+					autobaud->nGood = nRate;
+					autobaud->state = AUTOBAUD_IDLE;
+				}
+				break;
+			case AUTOBAUD_TYPE_DOWN:
+				// the leader steps down only once settled, one rate at a time
+				if (autobaud->state != AUTOBAUD_IDLE || nRate + 1 != autobaud->nRate)
+					break;
+				autobaudSwitch(autobaud, nRate);
+				autobaud->nGood = nRate;
+				autobaud->state = AUTOBAUD_IDLE;
+				break;
+		}
+	}
+	return true;
+}
+
+
+//
+// advance negotiation and watch for silence on the link
+// call periodically, e.g. from the timer that reads UART0
+//
+// *autobaud - pointer to negotiation state
+//
+void ICACHE_FLASH_ATTR autobaudPoll(Autobaud *autobaud)
+{
+	uint32_t now = AUTOBAUD_TIME();
+	uint32_t elapsed = now - autobaud->time;
+
+	if (autobaud->role == AUTOBAUD_LEADER)
+	{
+		switch (autobaud->state)
+		{
+			case AUTOBAUD_PROPOSE:
+				// peer did not hear the proposal, or does not negotiate
+				if (elapsed >= AUTOBAUD_REPLY_MS * 1000 && autobaud->nTries < AUTOBAUD_PROPOSE_TRIES)
+					autobaudPropose(autobaud);
+				else if (elapsed >= AUTOBAUD_REPLY_MS * 1000)
+				{
+					autobaud->state = AUTOBAUD_SETTLED;
+					os_printf("Link settled at %d baud\r\n", (int) autobaudRates[autobaud->nRate]);
+				}
+				break;
+			case AUTOBAUD_PROBE:
+				if (autobaud->nProbe < AUTOBAUD_PROBE_FRAMES)
+				{
+					autobaudSend(AUTOBAUD_TYPE_PROBE, autobaud->nRate, autobaud->nProbe++);
+					autobaud->time = now;
+				}
+				else if (elapsed >= AUTOBAUD_REPLY_MS * 1000)
+				{
+					os_printf("Link probe at %d baud, %d of %d frames echoed\r\n",
+						(int) autobaudRates[autobaud->nRate], autobaud->nEcho, autobaud->nProbe);
+					if (autobaud->nProbe - autobaud->nEcho <= AUTOBAUD_PROBE_ERRORS)
+					{
+						autobaudSend(AUTOBAUD_TYPE_COMMIT, autobaud->nRate, 0);
+						autobaud->nGood = autobaud->nRate;
+						autobaudPropose(autobaud);
+					}
+					else
+					{
+						// let the follower time out before talking at the previous rate
+						autobaudSwitch(autobaud, autobaud->nGood);
+						autobaud->state = AUTOBAUD_REVERT;
+					}
+				}
+				break;
+			case AUTOBAUD_REVERT:
+				if (elapsed >= AUTOBAUD_PROBE_TIMEOUT_MS * 1000)
+				{
+					autobaud->state = AUTOBAUD_SETTLED;
+					os_printf("Link settled at %d baud\r\n", (int) autobaudRates[autobaud->nRate]);
+				}
+				break;
+			default:
+				break;
+		}
+	}
+	else if (autobaud->state == AUTOBAUD_PROBE && elapsed >= AUTOBAUD_PROBE_TIMEOUT_MS * 1000)
+	{
+		autobaudSwitch(autobaud, autobaud->nPrevious);
+		autobaud->state = AUTOBAUD_IDLE;
+	}
+
+	// nothing valid received for too long, start again from the base rate
+	if (AUTOBAUD_SILENCE_MS > 0 && !autobaudBusy(autobaud) && autobaud->nRate > 0
+		&& now - autobaud->lastValid >= AUTOBAUD_SILENCE_MS * 1000)
+	{
+		os_printf("Link silent, back to %d baud\r\n", (int) AUTOBAUD_BASE_RATE);
+		autobaudSwitch(autobaud, 0);
+		autobaud->nGood = 0;
+		autobaud->state = AUTOBAUD_IDLE;
+		autobaudStart(autobaud);
+	}
+}
+
+
+//
+// whether negotiation is in progress
+// application frames should not be sent meanwhile
+//
+bool ICACHE_FLASH_ATTR autobaudBusy(Autobaud *autobaud)
+{
+	return autobaud->state == AUTOBAUD_PROPOSE || autobaud->state == AUTOBAUD_PROBE
+		|| autobaud->state == AUTOBAUD_REVERT;
+}
+
+
+//
+// rate currently used on UART0
+//
+UartBautRate ICACHE_FLASH_ATTR autobaudRate(Autobaud *autobaud)
+{
+	return autobaudRates[autobaud->nRate];
+}
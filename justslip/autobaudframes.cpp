@@ -0,0 +1,65 @@
+/*
+* esp-just-slip - autobaudframes.cpp
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "slipconst.h"
+
+extern "C" {
+#include "autobaud.h"
+}
+
+//
+// autobaud control frames of one type for each rate index, sequence number 0
+//
+#define AUTOBAUD_CONTROL_FRAMES(type) { \
+	SLIP_CONST_WIRE(AUTOBAUD_MAGIC, type, 0, 0), \
+	SLIP_CONST_WIRE(AUTOBAUD_MAGIC, type, 1, 0), \
+	SLIP_CONST_WIRE(AUTOBAUD_MAGIC, type, 2, 0), \
+	SLIP_CONST_WIRE(AUTOBAUD_MAGIC, type, 3, 0), \
+	SLIP_CONST_WIRE(AUTOBAUD_MAGIC, type, 4, 0) }
+
+static_assert(AUTOBAUD_RATES == 5, "AUTOBAUD_CONTROL_FRAMES() has one frame per rate");
+
+const SlipWire autobaudControl[AUTOBAUD_CONTROL_TYPES][AUTOBAUD_RATES] ICACHE_RODATA_ATTR =
+{
+	AUTOBAUD_CONTROL_FRAMES(AUTOBAUD_TYPE_PROPOSE),
+	AUTOBAUD_CONTROL_FRAMES(AUTOBAUD_TYPE_ACK),
+	AUTOBAUD_CONTROL_FRAMES(AUTOBAUD_TYPE_COMMIT),
+	AUTOBAUD_CONTROL_FRAMES(AUTOBAUD_TYPE_DOWN)
+};
+
+// wire bytes as sent by appendCrc16() and slipEncodeSerialUart0():
+// PROPOSE rate 4 - BA D5 1F 7C 01 04 00 C6 35 C0, DOWN rate 4 - BA D5 1F 7C 06 04 00 4A 30 C0
+static_assert(SlipConstFrame<AUTOBAUD_MAGIC, AUTOBAUD_TYPE_PROPOSE, 4, 0>::size() == 10
+	&& SlipConstFrame<AUTOBAUD_MAGIC, AUTOBAUD_TYPE_PROPOSE, 4, 0>::word(0) == 0x7C1FD5BA
+	&& SlipConstFrame<AUTOBAUD_MAGIC, AUTOBAUD_TYPE_PROPOSE, 4, 0>::word(1) == 0xC6000401
+	&& SlipConstFrame<AUTOBAUD_MAGIC, AUTOBAUD_TYPE_PROPOSE, 4, 0>::word(2) == 0x0000C035, "PROPOSE frame differs");
+static_assert(SlipConstFrame<AUTOBAUD_MAGIC, AUTOBAUD_TYPE_DOWN, 4, 0>::word(1) == 0x4A000406
+	&& SlipConstFrame<AUTOBAUD_MAGIC, AUTOBAUD_TYPE_DOWN, 4, 0>::word(2) == 0x0000C030, "DOWN frame differs");
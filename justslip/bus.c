@@ -0,0 +1,227 @@
+/*
+* esp-just-slip - bus.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "bus.h"
+
+
+//
+// put address in front of payload of a poll of the master
+//
+// address - slave address, BUS_BROADCAST for all slaves
+// *dataBuffer - pointer to payload, may be NULL if nCount is 0
+// nCount - number of bytes of payload, up to BUS_MAX_PAYLOAD
+// *frameBuffer - pointer to data buffer of at least nCount + 1 bytes, plus 2 for crc16
+//
+// returned value - number of bytes stored in frameBuffer
+//
+uint8_t ICACHE_FLASH_ATTR busFrame(uint8_t address, const uint8_t *dataBuffer, uint8_t nCount, uint8_t *frameBuffer)
+{
+	if (nCount > BUS_MAX_PAYLOAD)
+		nCount = BUS_MAX_PAYLOAD;
+	frameBuffer[0] = address & ~BUS_REPLY;
+	if (nCount > 0)
+		os_memcpy(frameBuffer + 1, dataBuffer, nCount);
+	return nCount + 1;
+}
+
+
+//
+// set up master that polls slaves in turn
+//
+// *master - pointer to master state
+// *address - pointer to addresses of slaves
+// nNodes - number of slaves, up to BUS_MAX_NODES
+// timeout - time to wait for a reply [us], e.g. BUS_REPLY_TIMEOUT_US
+//
+void ICACHE_FLASH_ATTR busMasterInit(BusMaster *master, const uint8_t *address, uint8_t nNodes, uint32_t timeout)
+{
+	os_memset(master, 0, sizeof(BusMaster));
+	if (nNodes > BUS_MAX_NODES)
+		nNodes = BUS_MAX_NODES;
+	os_memcpy(master->address, address, nNodes);
+	master->nNodes = nNodes;
+	master->nCurrent = nNodes - 1;
+	master->timeout = timeout;
+}
+
+
+//
+// queue data to be sent to slave with its next poll
+//
+// returned value - false if slave is unknown, data for it are still pending or too long
+//   data stay pending until the slave replies to a poll that carries them
+//
+bool ICACHE_FLASH_ATTR busMasterQueue(BusMaster *master, uint8_t address, const uint8_t *dataBuffer, uint8_t nCount)
+{
+	uint8_t i;
+
+	if (nCount == 0 || nCount > BUS_MAX_PAYLOAD)
+		return false;
+	for (i = 0; i < master->nNodes; i++)
+		if (master->address[i] == address)
+		{
+			if (master->nPending[i] > 0)
+				return false;
+			os_memcpy(master->pending[i], dataBuffer, nCount);
+			master->nPending[i] = nCount;
+			return true;
+		}
+	return false;
+}
+
+
+//
+// take the next poll once the bus is free
+// call periodically and after each frame received
+// pending data of a slave that did not reply are sent again with its next poll,
+// after BUS_MAX_TRIES polls without reply they are dropped
+//
+// *master - pointer to master state
+// now - current time [us], e.g. system_get_time()
+// *frameBuffer - pointer to data buffer of BUS_MAX_PAYLOAD + 1 bytes, plus 2 for crc16
+//
+// returned value - number of bytes stored in frameBuffer to send now, 0 if reply is awaited
+//
+uint8_t ICACHE_FLASH_ATTR busMasterPoll(BusMaster *master, uint32_t now, uint8_t *frameBuffer)
+{
+	uint8_t nCount;
+
+	if (master->nNodes == 0)
+		return 0;
+	if (master->waiting)
+	{
+		if (now - master->sent < master->timeout)
+			return 0;
+		master->stats[master->nCurrent].nTimeouts++;
+		master->waiting = false;
+		if (master->nPending[master->nCurrent] > 0 && ++master->nTries[master->nCurrent] >= BUS_MAX_TRIES)
+		{
+			master->stats[master->nCurrent].nDropped++;
+			master->nPending[master->nCurrent] = 0;
+			master->nTries[master->nCurrent] = 0;
+		}
+	}
+
+	master->nCurrent = (master->nCurrent + 1) % master->nNodes;
+	nCount = busFrame(master->address[master->nCurrent], master->pending[master->nCurrent],
+		master->nPending[master->nCurrent], frameBuffer);
+	master->stats[master->nCurrent].nPolls++;
+	master->waiting = true;
+	master->sent = now;
+	return nCount;
+}
+
+
+//
+// take reply of polled slave, data sent with the poll are then delivered
+//
+// *master - pointer to master state
+// *dataBuffer - pointer to received frame, crc16 already checked and removed
+// nCount - number of bytes of frame
+// now - current time [us]
+//
+// returned value - number of bytes of payload that follows the address in dataBuffer,
+//   0 if slave had nothing to send or frame is not the awaited reply,
+//   e.g. the poll itself heard back from the bus
+//
+uint8_t ICACHE_FLASH_ATTR busMasterReceive(BusMaster *master, const uint8_t *dataBuffer, uint8_t nCount, uint32_t now)
+{
+	BusNodeStats *stats;
+	uint32_t latency;
+
+	if (nCount == 0 || !master->waiting || dataBuffer[0] != (master->address[master->nCurrent] | BUS_REPLY))
+		return 0;
+	stats = &master->stats[master->nCurrent];
+	master->nPending[master->nCurrent] = 0;
+	master->nTries[master->nCurrent] = 0;
+	latency = now - master->sent;
+	stats->nReplies++;
+	stats->latencySum += latency;
+	if (latency > stats->latencyMax)
+		stats->latencyMax = latency;
+	master->waiting = false;
+	return nCount - 1;
+}
+
+
+//
+// check if received frame is a poll for this slave
+// a slave must reply with busSlaveReply(address, ...) to each frame with its own address,
+// even if the poll is empty and it has nothing to send
+// replies, including its own heard back from the bus, are not taken
+//
+// address - address of this slave
+// *dataBuffer - pointer to received frame, crc16 already checked and removed
+// nCount - number of bytes of frame, payload is nCount - 1 bytes at dataBuffer + 1
+//
+// returned value - true if frame is for this slave or broadcast
+//
+bool ICACHE_FLASH_ATTR busSlaveReceive(uint8_t address, const uint8_t *dataBuffer, uint8_t nCount)
+{
+	return nCount > 0 && (dataBuffer[0] == address || dataBuffer[0] == BUS_BROADCAST);
+}
+
+
+//
+// put address with BUS_REPLY in front of payload of a reply of slave
+//
+// address - address of this slave
+// *dataBuffer - pointer to payload, may be NULL if nCount is 0
+// nCount - number of bytes of payload, up to BUS_MAX_PAYLOAD
+// *frameBuffer - pointer to data buffer of at least nCount + 1 bytes, plus 2 for crc16
+//
+// returned value - number of bytes stored in frameBuffer
+//
+uint8_t ICACHE_FLASH_ATTR busSlaveReply(uint8_t address, const uint8_t *dataBuffer, uint8_t nCount, uint8_t *frameBuffer)
+{
+	nCount = busFrame(address, dataBuffer, nCount, frameBuffer);
+	frameBuffer[0] |= BUS_REPLY;
+	return nCount;
+}
+
+
+//
+// print counters of each slave for diagnostic purposes
+// latency is average / maximum time from poll to reply [us]
+//
+void ICACHE_FLASH_ATTR busPrintStats(BusMaster *master)
+{
+	uint8_t i;
+	BusNodeStats *stats;
+
+	for (i = 0; i < master->nNodes; i++)
+	{
+		stats = &master->stats[i];
+		os_printf("bus node %d: polls %u replies %u timeouts %u dropped %u latency %u / %u us\r\n", master->address[i],
+			(unsigned) stats->nPolls, (unsigned) stats->nReplies, (unsigned) stats->nTimeouts, (unsigned) stats->nDropped,
+			(unsigned) (stats->nReplies ? stats->latencySum / stats->nReplies : 0), (unsigned) stats->latencyMax);
+	}
+}
@@ -0,0 +1,187 @@
+/*
+* esp-just-slip - capture.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "capture.h"
+
+static const uint8_t captureMagic[4] = { 'S', 'L', 'C', 'P' };
+
+
+//
+// store value as LEB128, 7 bits per byte, lowest first
+//
+// returned value - number of bytes stored
+//
+static uint8_t ICACHE_FLASH_ATTR capturePutVarint(uint8_t *dataBuffer, uint32_t value)
+{
+	uint8_t n = 0;
+
+	while (value >= 0x80)
+	{
+		dataBuffer[n++] = (uint8_t) (value | 0x80);
+		value >>= 7;
+	}
+	dataBuffer[n++] = (uint8_t) value;
+	return n;
+}
+
+
+//
+// read LEB128 value of up to nMax bytes
+//
+// returned value - number of bytes taken, 0 if value does not end within nSize / nMax bytes
+//
+static uint8_t ICACHE_FLASH_ATTR captureGetVarint(const uint8_t *dataBuffer, uint32_t nSize, uint8_t nMax, uint32_t *value)
+{
+	uint8_t n;
+
+	*value = 0;
+	for (n = 0; n < nSize && n < nMax; n++)
+	{
+		*value |= (uint32_t) (dataBuffer[n] & 0x7F) << (7 * n);
+		if (!(dataBuffer[n] & 0x80))
+			return n + 1;
+	}
+	return 0;
+}
+
+
+//
+// prepare file header
+//
+// *dataBuffer - pointer to buffer of CAPTURE_HEADER_SIZE bytes
+// startTime - time of capture start [us since 1970], 0 if unknown
+//
+// returned value - CAPTURE_HEADER_SIZE
+//
+uint16_t ICACHE_FLASH_ATTR captureHeader(uint8_t *dataBuffer, uint64_t startTime)
+{
+	uint8_t i;
+
+	os_memcpy(dataBuffer, captureMagic, sizeof(captureMagic));
+	dataBuffer[4] = CAPTURE_VERSION;
+	dataBuffer[5] = 0;
+	dataBuffer[6] = 0;
+	dataBuffer[7] = 0;
+	for (i = 0; i < 8; i++)
+		dataBuffer[8 + i] = (uint8_t) (startTime >> (8 * i));
+	return CAPTURE_HEADER_SIZE;
+}
+
+
+//
+// check file header
+//
+// *dataBuffer - pointer to start of file
+// nSize - size of file
+// *startTime - time of capture start from header
+//
+// returned value - true if this is a capture of a version this code reads
+//
+bool ICACHE_FLASH_ATTR captureCheckHeader(const uint8_t *dataBuffer, uint32_t nSize, uint64_t *startTime)
+{
+	uint8_t i;
+
+	if (nSize < CAPTURE_HEADER_SIZE || os_memcmp(dataBuffer, captureMagic, sizeof(captureMagic)) != 0
+		|| dataBuffer[4] != CAPTURE_VERSION || dataBuffer[5] != 0)
+		return false;
+	*startTime = 0;
+	for (i = 0; i < 8; i++)
+		*startTime |= (uint64_t) dataBuffer[8 + i] << (8 * i);
+	return true;
+}
+
+
+//
+// start capture, first record gets its time from now
+//
+// now - current time [us], e.g. system_get_time()
+//
+void ICACHE_FLASH_ATTR captureInit(Capture *capture, uint32_t now)
+{
+	capture->time = now;
+}
+
+
+//
+// make a record of wire bytes
+//
+// *capture - pointer to capture state
+// flags - CAPTURE_TX for bytes sent, 0 for bytes received
+// now - time the bytes were read or written [us], wraps around like system_get_time()
+// *data - pointer to wire bytes
+// nCount - number of wire bytes
+// *dataBuffer - pointer to buffer of CAPTURE_MAX_RECORD(nCount) bytes
+//
+// returned value - number of bytes stored in dataBuffer
+//
+uint16_t ICACHE_FLASH_ATTR captureRecord(Capture *capture, uint8_t flags, uint32_t now,
+	const uint8_t *data, uint16_t nCount, uint8_t *dataBuffer)
+{
+	uint16_t nPos = 0;
+
+	dataBuffer[nPos++] = flags;
+	nPos += capturePutVarint(dataBuffer + nPos, now - capture->time);
+	nPos += capturePutVarint(dataBuffer + nPos, nCount);
+	os_memcpy(dataBuffer + nPos, data, nCount);
+	capture->time = now;
+	return nPos + nCount;
+}
+
+
+//
+// take next record from a capture
+//
+// *dataBuffer - pointer to record, after the file header or the previous record
+// nSize - number of bytes from dataBuffer to end of capture
+// *record - record found
+//
+// returned value - number of bytes of record, 0 if it is cut short or malformed
+//
+uint32_t ICACHE_FLASH_ATTR captureParse(const uint8_t *dataBuffer, uint32_t nSize, CaptureRecord *record)
+{
+	uint32_t nPos = 1, nCount;
+	uint8_t n;
+
+	if (nSize < 3 || (dataBuffer[0] & ~CAPTURE_TX) != 0)
+		return 0;
+	record->flags = dataBuffer[0];
+	n = captureGetVarint(dataBuffer + nPos, nSize - nPos, 5, &record->delta);
+	if (n == 0)
+		return 0;
+	nPos += n;
+	n = captureGetVarint(dataBuffer + nPos, nSize - nPos, 3, &nCount);
+	if (n == 0 || nCount > 0xFFFF || nSize - nPos - n < nCount)
+		return 0;
+	nPos += n;
+	record->nCount = (uint16_t) nCount;
+	record->data = dataBuffer + nPos;
+	return nPos + nCount;
+}
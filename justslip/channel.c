@@ -0,0 +1,262 @@
+/*
+* esp-just-slip - channel.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "channel.h"
+
+
+//
+// set up empty queues, default priorities:
+// CHANNEL_CONTROL first, then CHANNEL_TELEMETRY,
+// CHANNEL_LOG and CHANNEL_BULK share the rest 3 : 1
+//
+// *mux - pointer to channel multiplexer
+//
+void ICACHE_FLASH_ATTR channelInit(ChannelMux *mux)
+{
+	os_memset(mux, 0, sizeof(ChannelMux));
+	channelConfig(mux, CHANNEL_CONTROL, 0, 1);
+	channelConfig(mux, CHANNEL_TELEMETRY, 1, 1);
+	channelConfig(mux, CHANNEL_LOG, 2, 3);
+	channelConfig(mux, CHANNEL_BULK, 2, 1);
+}
+
+
+//
+// set scheduling of channel
+//
+// *mux - pointer to channel multiplexer
+// id - channel id, 0 .. CHANNEL_COUNT - 1
+// priority - 0 is the highest, channels with lower value always go first
+// weight - frames sent per round among channels of the same priority, at least 1
+//
+void ICACHE_FLASH_ATTR channelConfig(ChannelMux *mux, uint8_t id, uint8_t priority, uint8_t weight)
+{
+	if (id >= CHANNEL_COUNT)
+		return;
+	mux->channel[id].priority = priority;
+	mux->channel[id].weight = (weight > 0) ? weight : 1;
+	mux->channel[id].credit = mux->channel[id].weight;
+}
+
+
+//
+// put a frame in queue of channel
+//
+// *mux - pointer to channel multiplexer
+// id - channel id
+// *dataBuffer - pointer to payload
+// nCount - number of bytes of payload, up to CHANNEL_MAX_PAYLOAD
+// now - current time [us], e.g. system_get_time()
+//
+// returned value - false if queue is full or frame is too long
+//
+bool ICACHE_FLASH_ATTR channelQueue(ChannelMux *mux, uint8_t id, const uint8_t *dataBuffer, uint8_t nCount, uint32_t now)
+{
+	uint8_t *slot;
+
+	if (id >= CHANNEL_COUNT || nCount > CHANNEL_MAX_PAYLOAD)
+	{
+		os_printf("Unable to queue - invalid channel or frame too long!\r\n");
+		return false;
+	}
+	slot = channelSlot(mux, id);
+	if (slot == NULL)
+	{
+		mux->channel[id].stats.nDropped++;
+		return false;
+	}
+	os_memcpy(slot, dataBuffer, nCount);
+	return channelCommit(mux, id, nCount, now);
+}
+
+
+//
+// give free place at the end of queue of channel to build a frame in,
+// so that e.g. fragNext() stores a fragment in the queue with no extra copy
+// the frame is queued only by channelCommit()
+//
+// *mux - pointer to channel multiplexer
+// id - channel id
+//
+// returned value - pointer to CHANNEL_MAX_PAYLOAD bytes, NULL if queue is full
+//
+uint8_t * ICACHE_FLASH_ATTR channelSlot(ChannelMux *mux, uint8_t id)
+{
+	Channel *channel;
+
+	if (id >= CHANNEL_COUNT)
+		return NULL;
+	channel = &mux->channel[id];
+	if (channel->nCount == CHANNEL_QUEUE_LENGTH)
+		return NULL;
+	return channel->frames[(channel->nHead + channel->nCount) % CHANNEL_QUEUE_LENGTH];
+}
+
+
+//
+// queue the frame built in place given by channelSlot()
+//
+// *mux - pointer to channel multiplexer
+// id - channel id
+// nCount - number of bytes of payload, up to CHANNEL_MAX_PAYLOAD
+// now - current time [us], e.g. system_get_time()
+//
+// returned value - false if queue is full or frame is too long
+//
+bool ICACHE_FLASH_ATTR channelCommit(ChannelMux *mux, uint8_t id, uint8_t nCount, uint32_t now)
+{
+	Channel *channel;
+	uint8_t nTail;
+
+	if (id >= CHANNEL_COUNT || nCount > CHANNEL_MAX_PAYLOAD)
+		return false;
+	channel = &mux->channel[id];
+	if (channel->nCount == CHANNEL_QUEUE_LENGTH)
+		return false;
+	nTail = (channel->nHead + channel->nCount) % CHANNEL_QUEUE_LENGTH;
+	channel->length[nTail] = nCount;
+	channel->queued[nTail] = now;
+	channel->nCount++;
+	return true;
+}
+
+
+//
+// check how many more frames fit in queue of channel
+// e.g. to take the next fragment only when it can be queued
+//
+// *mux - pointer to channel multiplexer
+// id - channel id
+//
+// returned value - number of free places in queue
+//
+uint8_t ICACHE_FLASH_ATTR channelSpace(ChannelMux *mux, uint8_t id)
+{
+	if (id >= CHANNEL_COUNT)
+		return 0;
+	return CHANNEL_QUEUE_LENGTH - mux->channel[id].nCount;
+}
+
+
+//
+// choose channel to send from
+// the highest priority with frames pending, round robin by weight within it
+//
+// returned value - channel id, CHANNEL_COUNT if all queues are empty
+//
+static uint8_t ICACHE_FLASH_ATTR channelPick(ChannelMux *mux)
+{
+	uint8_t i, id, pass;
+	uint8_t best = 0xFF;
+	Channel *channel;
+
+	for (id = 0; id < CHANNEL_COUNT; id++)
+		if (mux->channel[id].nCount > 0 && mux->channel[id].priority < best)
+			best = mux->channel[id].priority;
+	if (best == 0xFF)
+		return CHANNEL_COUNT;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		for (i = 1; i <= CHANNEL_COUNT; i++)
+		{
+			id = (mux->nLast + i) % CHANNEL_COUNT;
+			channel = &mux->channel[id];
+			if (channel->nCount > 0 && channel->priority == best && channel->credit > 0)
+			{
+				channel->credit--;
+				mux->nLast = id;
+				return id;
+			}
+		}
+		// every channel used its share, start a new round
+		for (id = 0; id < CHANNEL_COUNT; id++)
+			if (mux->channel[id].priority == best)
+				mux->channel[id].credit = mux->channel[id].weight;
+	}
+	return CHANNEL_COUNT;
+}
+
+
+//
+// take the next frame to send
+// channel id is stored in the first byte of dataBuffer followed by payload
+//
+// *mux - pointer to channel multiplexer
+// *dataBuffer - pointer to data buffer of at least CHANNEL_MAX_PAYLOAD + 1 bytes
+// now - current time [us]
+//
+// returned value - number of bytes stored in dataBuffer, 0 if nothing to send
+//
+uint8_t ICACHE_FLASH_ATTR channelNext(ChannelMux *mux, uint8_t *dataBuffer, uint32_t now)
+{
+	uint8_t id = channelPick(mux);
+	uint8_t nCount;
+	uint32_t delay;
+	Channel *channel;
+
+	if (id == CHANNEL_COUNT)
+		return 0;
+	channel = &mux->channel[id];
+
+	nCount = channel->length[channel->nHead];
+	dataBuffer[0] = id;
+	os_memcpy(dataBuffer + 1, channel->frames[channel->nHead], nCount);
+
+	delay = now - channel->queued[channel->nHead];
+	channel->stats.nSent++;
+	channel->stats.delaySum += delay;
+	if (delay > channel->stats.delayMax)
+		channel->stats.delayMax = delay;
+
+	channel->nHead = (channel->nHead + 1) % CHANNEL_QUEUE_LENGTH;
+	channel->nCount--;
+	return nCount + 1;
+}
+
+
+//
+// print counters of each channel for diagnostic purposes
+// delay is average / maximum time in queue [us]
+//
+void ICACHE_FLASH_ATTR channelPrintStats(ChannelMux *mux)
+{
+	uint8_t id;
+	ChannelStats *stats;
+
+	for (id = 0; id < CHANNEL_COUNT; id++)
+	{
+		stats = &mux->channel[id].stats;
+		os_printf("channel %d: sent %u dropped %u delay %u / %u us\r\n", id,
+			(unsigned) stats->nSent, (unsigned) stats->nDropped,
+			(unsigned) (stats->nSent ? stats->delaySum / stats->nSent : 0), (unsigned) stats->delayMax);
+	}
+}
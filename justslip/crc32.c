@@ -0,0 +1,369 @@
+/*
+* esp-just-slip - crc32.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "crc32.h"
+#include "crc16.h"
+
+#if !defined(__ets__) && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CRC32_X86
+#include <immintrin.h>
+#endif
+
+// reflected polynomials 0xEDB88320 (IEEE) and 0x82F63B78 (Castagnoli)
+// generated at compile time in crctable.cpp
+extern const uint32_t crc32IeeeTable[256];
+extern const uint32_t crc32cTable[256];
+
+//
+// update crc with table, one byte at a time
+// crc is kept inverted, as during calculation
+//
+static uint32_t ICACHE_FLASH_ATTR crc32Table(const uint32_t *table, const uint8_t *data, uint16_t nCount, uint32_t crc)
+{
+	while (nCount--)
+		crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+	return crc;
+}
+
+
+#ifdef CRC32_X86
+
+// -1 - not checked yet, 0 - tables, 1 - CPU instructions
+static int crc32UseHardware = -1;
+
+
+//
+// check once if CPU supports SSE4.2 and PCLMULQDQ
+//
+static bool crc32HardwareAvailable(void)
+{
+	if (crc32UseHardware < 0)
+	{
+		__builtin_cpu_init();
+		crc32UseHardware = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul");
+	}
+	return crc32UseHardware > 0;
+}
+
+
+//
+// CRC-32C with SSE4.2 crc32 instruction, 8 or 4 bytes at a time
+//
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSse42(const uint8_t *data, uint16_t nCount, uint32_t crc)
+{
+#ifdef __x86_64__
+	uint64_t crc64 = crc;
+	uint64_t word;
+
+	for (; nCount >= 8; nCount -= 8, data += 8)
+	{
+		os_memcpy(&word, data, 8);
+		crc64 = _mm_crc32_u64(crc64, word);
+	}
+	crc = (uint32_t) crc64;
+#else
+	uint32_t word;
+
+	for (; nCount >= 4; nCount -= 4, data += 4)
+	{
+		os_memcpy(&word, data, 4);
+		crc = _mm_crc32_u32(crc, word);
+	}
+#endif
+	while (nCount--)
+		crc = _mm_crc32_u8(crc, *data++);
+	return crc;
+}
+
+
+//
+// CRC-32 by folding 64 bytes at a time with carry-less multiplication
+// then Barrett reduction, see Intel paper "Fast CRC Computation
+// for Generic Polynomials Using PCLMULQDQ Instruction"
+// bytes that do not make up a whole 16 byte block are left to the table
+//
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32Pclmul(const uint8_t *data, uint16_t nCount, uint32_t crc)
+{
+	static const uint64_t k1k2[2] __attribute__((aligned(16))) = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+	static const uint64_t k3k4[2] __attribute__((aligned(16))) = { 0x01751997d0ULL, 0x00ccaa009eULL };
+	static const uint64_t k5k0[2] __attribute__((aligned(16))) = { 0x0163cd6124ULL, 0x0000000000ULL };
+	static const uint64_t poly[2] __attribute__((aligned(16))) = { 0x01db710641ULL, 0x01f7011641ULL };
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+	__m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+	if (nCount < 64)
+		return crc32Table(crc32IeeeTable, data, nCount, crc);
+
+	x1 = _mm_loadu_si128((const __m128i *) (data + 0x00));
+	x2 = _mm_loadu_si128((const __m128i *) (data + 0x10));
+	x3 = _mm_loadu_si128((const __m128i *) (data + 0x20));
+	x4 = _mm_loadu_si128((const __m128i *) (data + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int) crc));
+	x0 = _mm_load_si128((const __m128i *) k1k2);
+	data += 64;
+	nCount -= 64;
+
+	// fold four 128 bit lanes 64 bytes ahead
+	while (nCount >= 64)
+	{
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *) (data + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *) (data + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *) (data + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *) (data + 0x30)));
+		data += 64;
+		nCount -= 64;
+	}
+
+	// fold lanes into one
+	x0 = _mm_load_si128((const __m128i *) k3k4);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// remaining 16 byte blocks
+	while (nCount >= 16)
+	{
+		x2 = _mm_loadu_si128((const __m128i *) data);
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+		data += 16;
+		nCount -= 16;
+	}
+
+	// 128 to 64 bits
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x0 = _mm_loadl_epi64((const __m128i *) k5k0);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits
+	x0 = _mm_load_si128((const __m128i *) poly);
+	x2 = _mm_and_si128(x1, mask);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, mask);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	crc = (uint32_t) _mm_extract_epi32(x1, 1);
+
+	return crc32Table(crc32IeeeTable, data, nCount, crc);
+}
+
+#endif
+
+
+//
+// calculate CRC-32 (IEEE 802.3) of data
+//
+// *data - pointer to data
+// nCount - number of bytes of data
+// acc - crc of preceding data to continue with, 0 to start
+//
+// returned value - crc32 of data
+//
+uint32_t ICACHE_FLASH_ATTR crc32Data(const uint8_t *data, uint16_t nCount, uint32_t acc)
+{
+#ifdef CRC32_X86
+	if (crc32HardwareAvailable())
+		return ~crc32Pclmul(data, nCount, ~acc);
+#endif
+	return ~crc32Table(crc32IeeeTable, data, nCount, ~acc);
+}
+
+
+//
+// calculate CRC-32C (Castagnoli) of data
+//
+// *data - pointer to data
+// nCount - number of bytes of data
+// acc - crc of preceding data to continue with, 0 to start
+//
+// returned value - crc32c of data
+//
+uint32_t ICACHE_FLASH_ATTR crc32cData(const uint8_t *data, uint16_t nCount, uint32_t acc)
+{
+#ifdef CRC32_X86
+	if (crc32HardwareAvailable())
+		return ~crc32cSse42(data, nCount, ~acc);
+#endif
+	return ~crc32Table(crc32cTable, data, nCount, ~acc);
+}
+
+
+//
+// allow or prevent use of CPU crc instructions, e.g. to compare speed with tables
+// has no effect where there are no such instructions
+//
+// enable - true to use them if available, false to always use tables
+//
+void ICACHE_FLASH_ATTR crc32Hardware(bool enable)
+{
+#ifdef CRC32_X86
+	crc32UseHardware = -1;
+	if (!enable)
+		crc32UseHardware = 0;
+#endif
+}
+
+
+//
+// number of bytes appended by given check
+//
+uint8_t ICACHE_FLASH_ATTR crcSize(CrcMode mode)
+{
+	switch (mode)
+	{
+	case CRC_16:
+		return 2;
+	case CRC_32:
+	case CRC_32C:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+
+//
+// name of check for diagnostic printouts, as given to -c of host tools
+//
+const char * ICACHE_FLASH_ATTR crcName(CrcMode mode)
+{
+	switch (mode)
+	{
+	case CRC_NONE:
+		return "none";
+	case CRC_16:
+		return "16";
+	case CRC_32:
+		return "32";
+	case CRC_32C:
+		return "32c";
+	default:
+		return "?";
+	}
+}
+
+
+//
+// calculate check value of nCount bytes of dataBuffer
+// continuing from acc, check value of data before, so it may be taken in parts
+//
+// mode - check to use
+// acc - 0 for the first part, returned value of previous part after that
+// *dataBuffer - pointer to data of this part
+// nCount - number of bytes in this part
+//
+// returned value - check value of all parts so far
+//
+uint32_t ICACHE_FLASH_ATTR crcUpdate(CrcMode mode, uint32_t acc, const uint8_t *dataBuffer, uint16_t nCount)
+{
+	switch (mode)
+	{
+	case CRC_16:
+		return crc16_data(dataBuffer, nCount, (unsigned short) acc);
+	case CRC_32:
+		return crc32Data(dataBuffer, nCount, acc);
+	case CRC_32C:
+		return crc32cData(dataBuffer, nCount, acc);
+	default:
+		return 0;
+	}
+}
+
+
+//
+// calculate and append check value to dataBuffer
+// for CRC_16 the result is the same as of appendCrc16()
+//
+// mode - check to use
+// *dataBuffer - pointer to data buffer to calculate and append check value
+// nCount - number of data bytes in dataBuffer
+// nSize - size of dataBuffer
+//
+// returned value - number of bytes in data buffer including check value, 0 if it does not fit
+//
+uint16_t ICACHE_FLASH_ATTR appendCrc(CrcMode mode, uint8_t *dataBuffer, uint16_t nCount, uint16_t nSize)
+{
+	uint8_t i, nCrc = crcSize(mode);
+	uint32_t crc;
+
+	if (nCount + nCrc > nSize)
+	{
+		os_printf("Unable to add crc - buffer too small!\r\n");
+		return 0;
+	}
+	crc = crcUpdate(mode, 0, dataBuffer, nCount);
+	for (i = 0; i < nCrc; i++)
+		dataBuffer[nCount + i] = (uint8_t) (crc >> (8 * (nCrc - 1 - i)));
+	return nCount + nCrc;
+}
+
+
+//
+// check value received in the last bytes of dataBuffer
+//
+// mode - check used by the sender
+// *dataBuffer - pointer to data buffer with received data
+// nCount - number of data bytes in dataBuffer including check value
+//
+// returned value - true if check value matches data
+//
+bool ICACHE_FLASH_ATTR checkCrc(CrcMode mode, const uint8_t *dataBuffer, uint16_t nCount)
+{
+	uint8_t i, nCrc = crcSize(mode);
+	uint32_t crc = 0;
+
+	if (nCount < nCrc)
+		return false;
+	for (i = 0; i < nCrc; i++)
+		crc = (crc << 8) | dataBuffer[nCount - nCrc + i];
+	return crc == crcUpdate(mode, 0, dataBuffer, nCount - nCrc);
+}
@@ -0,0 +1,356 @@
+/*
+* esp-just-slip - frag.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "frag.h"
+#include "crc16.h"
+
+// channel id and fragment header in front of payload
+#define FRAG_HEAD (1 + FRAG_HEADER)
+
+//
+// prepare message to be sent in fragments
+//
+// *sender - pointer to fragmentation state
+// msgId - message number, increase it for each message
+// *data - pointer to message, it is not copied
+// nCount - size of message
+// nPayload - payload bytes per fragment, up to FRAG_MAX_PAYLOAD for frames sent over channels
+//
+void ICACHE_FLASH_ATTR fragSenderInit(FragSender *sender, uint8_t msgId, const uint8_t *data, uint16_t nCount, uint8_t nPayload)
+{
+	sender->data = data;
+	sender->nCount = nCount;
+	sender->nOffset = 0;
+	sender->msgId = msgId;
+	sender->nPayload = (nPayload > 0) ? nPayload : 1;
+	sender->done = false;
+}
+
+
+//
+// store next fragment of message in dataBuffer
+//
+// *sender - pointer to fragmentation state
+// *dataBuffer - pointer to data buffer of at least FRAG_HEADER + nPayload bytes
+//
+// returned value - number of bytes stored in dataBuffer, 0 once all fragments are sent
+//
+uint8_t ICACHE_FLASH_ATTR fragNext(FragSender *sender, uint8_t *dataBuffer)
+{
+	uint16_t nCount;
+
+	if (sender->done)
+		return 0;
+
+	nCount = sender->nCount - sender->nOffset;
+	if (nCount > sender->nPayload)
+		nCount = sender->nPayload;
+
+	dataBuffer[0] = sender->msgId;
+	dataBuffer[1] = (sender->nOffset + nCount < sender->nCount) ? FRAG_MORE : 0;
+	dataBuffer[2] = (uint8_t) sender->nOffset;
+	dataBuffer[3] = (uint8_t) (sender->nOffset >> 8);
+	os_memcpy(dataBuffer + FRAG_HEADER, sender->data + sender->nOffset, nCount);
+
+	sender->nOffset += nCount;
+	if (sender->nOffset == sender->nCount)
+		sender->done = true;
+	return FRAG_HEADER + nCount;
+}
+
+
+//
+// prepare reassembly of messages into caller supplied buffer
+//
+// *reassembler - pointer to reassembly state
+// *buffer - pointer to buffer for reassembled message
+// nSize - size of buffer
+//
+void ICACHE_FLASH_ATTR fragReassemblerInit(FragReassembler *reassembler, uint8_t *buffer, uint16_t nSize)
+{
+	reassembler->buffer = buffer;
+	reassembler->nSize = nSize;
+	reassembler->nReceived = 0;
+	reassembler->msgId = 0;
+	reassembler->active = false;
+	slipDecoderInit(&reassembler->decoder);
+	reassembler->decoder.time = 0;
+	reassembler->nOffset = 0;
+	reassembler->bulk = false;
+	reassembler->checked = false;
+}
+
+
+//
+// copy fragment decoded into a frame buffer to its place in reassembly buffer
+//
+// *reassembler - pointer to reassembly state
+// *dataBuffer - pointer to fragment, without channel id and crc16
+// nCount - number of bytes of fragment
+//
+// returned value - size of message once its last fragment arrives, otherwise 0
+//
+uint16_t ICACHE_FLASH_ATTR fragReceive(FragReassembler *reassembler, const uint8_t *dataBuffer, uint8_t nCount)
+{
+	uint16_t nOffset, result;
+	uint8_t nPayload;
+
+	if (nCount < FRAG_HEADER)
+		return 0;
+	nOffset = dataBuffer[2] | (dataBuffer[3] << 8);
+	nPayload = nCount - FRAG_HEADER;
+
+	// first fragment starts a new message, abandoning unfinished one
+	if (nOffset == 0)
+	{
+		reassembler->active = true;
+		reassembler->msgId = dataBuffer[0];
+		reassembler->nReceived = 0;
+	}
+	if (!reassembler->active)
+		return 0;
+	if (dataBuffer[0] != reassembler->msgId || nOffset != reassembler->nReceived)
+	{
+		reassembler->active = false;
+		os_printf("Fragment lost - message dropped!\r\n");
+		return 0;
+	}
+	if (nOffset + nPayload > reassembler->nSize)
+	{
+		reassembler->active = false;
+		os_printf("Unable to reassemble - buffer too small!\r\n");
+		return 0;
+	}
+
+	os_memcpy(reassembler->buffer + nOffset, dataBuffer + FRAG_HEADER, nPayload);
+	reassembler->nReceived += nPayload;
+	if (dataBuffer[1] & FRAG_MORE)
+		return 0;
+
+	result = reassembler->nReceived;
+	reassembler->active = false;
+	return result;
+}
+
+
+//
+// accept header of fragment being decoded before its payload is stored
+// a fragment at offset 0 abandons unfinished message as its payload overwrites it
+//
+// returned value - true if payload goes to reassembler->nOffset
+//
+static bool ICACHE_FLASH_ATTR fragCheck(FragReassembler *reassembler)
+{
+	uint16_t nOffset = reassembler->head[3] | (reassembler->head[4] << 8);
+
+	reassembler->checked = true;
+	reassembler->nOffset = nOffset;
+	if (nOffset == 0)
+	{
+		reassembler->active = false;
+		return true;
+	}
+	if (!reassembler->active)
+		return false;
+	if (reassembler->head[1] != reassembler->msgId || nOffset != reassembler->nReceived)
+	{
+		reassembler->active = false;
+		os_printf("Fragment lost - message dropped!\r\n");
+		return false;
+	}
+	return true;
+}
+
+
+//
+// put decoded byte nPos of frame in place
+// channel id and fragment header go to head, payload to reassembly buffer,
+// frames of other channels to frameBuffer
+//
+static void ICACHE_FLASH_ATTR fragPlace(FragReassembler *reassembler, uint16_t nPos, uint8_t dataByte,
+	uint8_t *frameBuffer, uint16_t nSize)
+{
+	uint32_t nTarget;
+
+	if (nPos == 0)
+		reassembler->bulk = (dataByte == CHANNEL_BULK);
+	if (!reassembler->bulk)
+	{
+		if (nPos >= nSize)
+		{
+			reassembler->decoder.discard = true;
+			os_printf("Input buffer purged because of overflow!\r\n");
+			return;
+		}
+		frameBuffer[nPos] = dataByte;
+		return;
+	}
+	if (nPos < FRAG_HEAD)
+	{
+		reassembler->head[nPos] = dataByte;
+		return;
+	}
+	if (nPos == FRAG_HEAD && !fragCheck(reassembler))
+	{
+		reassembler->decoder.discard = true;
+		return;
+	}
+	nTarget = (uint32_t) reassembler->nOffset + nPos - FRAG_HEAD;
+	if (nTarget >= reassembler->nSize)
+	{
+		reassembler->decoder.discard = true;
+		os_printf("Unable to reassemble - buffer too small!\r\n");
+		return;
+	}
+	reassembler->buffer[nTarget] = dataByte;
+}
+
+
+//
+// store decoded byte, the last two are held back until the next one shows they are not crc16
+//
+static void ICACHE_FLASH_ATTR fragStore(FragReassembler *reassembler, uint8_t dataByte, uint8_t *frameBuffer, uint16_t nSize)
+{
+	uint16_t nPos = reassembler->decoder.nPos++;
+	uint8_t *held = &reassembler->tail[nPos & 1];
+
+	if (nPos >= 2)
+		fragPlace(reassembler, nPos - 2, *held, frameBuffer, nSize);
+	*held = dataByte;
+}
+
+
+//
+// complete frame once SLIP_END is received
+// check crc16 of fragment over header and payload already in place
+//
+static uint16_t ICACHE_FLASH_ATTR fragDecodeEnd(FragReassembler *reassembler, uint8_t *frameBuffer, uint16_t nSize, uint8_t *id)
+{
+	uint16_t nCount = slipDecoderEnd(&reassembler->decoder);
+	uint16_t nPayload, crc;
+	uint8_t crcHigh, crcLow;
+	bool checked = reassembler->checked;
+
+	reassembler->checked = false;
+	// channel id and crc16 at least
+	if (nCount < 3)
+		return 0;
+	crcHigh = reassembler->tail[nCount & 1];
+	crcLow = reassembler->tail[(nCount - 1) & 1];
+
+	if (!reassembler->bulk)
+	{
+		if (nCount > nSize)
+		{
+			os_printf("Input buffer purged because of overflow!\r\n");
+			return 0;
+		}
+		frameBuffer[nCount - 2] = crcHigh;
+		frameBuffer[nCount - 1] = crcLow;
+		*id = frameBuffer[0];
+		return nCount;
+	}
+
+	nCount -= 2;
+	if (nCount < FRAG_HEAD)
+		return 0;
+	// fragment with no payload, header was not looked at yet
+	if (!checked && !fragCheck(reassembler))
+		return 0;
+	nPayload = nCount - FRAG_HEAD;
+
+	crc = crc16_data(reassembler->head, FRAG_HEAD, 0x00);
+	crc = crc16_data(reassembler->buffer + reassembler->nOffset, nPayload, crc);
+	if (crc != ((crcHigh << 8) | crcLow))
+		return 0;
+
+	if (reassembler->nOffset == 0)
+	{
+		reassembler->active = true;
+		reassembler->msgId = reassembler->head[1];
+	}
+	reassembler->nReceived = reassembler->nOffset + nPayload;
+	if (reassembler->head[2] & FRAG_MORE)
+		return 0;
+
+	reassembler->active = false;
+	*id = CHANNEL_BULK;
+	return reassembler->nReceived;
+}
+
+
+//
+// feed one byte received from the link
+// payload of CHANNEL_BULK fragments is decoded straight into reassembly buffer,
+// other frames into frameBuffer with channel id first and crc16 last, as by SLIP decode
+// a damaged fragment leaves a gap, so the message is dropped with the next fragment
+//
+// *reassembler - pointer to reassembly state
+// dataByte - byte received from the link
+// *frameBuffer - pointer to data buffer for frames of other channels
+// nSize - size of frameBuffer
+// *id - channel id of completed frame, CHANNEL_BULK for reassembled message
+//
+// returned value - size of message once its last fragment arrives,
+//   number of bytes in frameBuffer once a frame of other channel ends, otherwise 0
+//
+uint16_t ICACHE_FLASH_ATTR fragDecodeByte(FragReassembler *reassembler, uint8_t dataByte, uint8_t *frameBuffer, uint16_t nSize, uint8_t *id)
+{
+	SlipDecoder *decoder = &reassembler->decoder;
+
+	if (dataByte == SLIP_END)
+	{
+		// SLIP_ESC SLIP_END is not valid either
+		if (decoder->escape)
+			decoder->discard = true;
+		return fragDecodeEnd(reassembler, frameBuffer, nSize, id);
+	}
+	if (decoder->discard)
+		return 0;
+	if (decoder->escape)
+	{
+		decoder->escape = false;
+		if (dataByte == SLIP_ESC_END)
+			fragStore(reassembler, SLIP_END, frameBuffer, nSize);
+		else if (dataByte == SLIP_ESC_ESC)
+			fragStore(reassembler, SLIP_ESC, frameBuffer, nSize);
+		else
+		{
+			decoder->discard = true;
+			os_printf("Frame dropped - invalid escape sequence!\r\n");
+		}
+	}
+	else if (dataByte == SLIP_ESC)
+		decoder->escape = true;
+	else
+		fragStore(reassembler, dataByte, frameBuffer, nSize);
+	return 0;
+}
@@ -0,0 +1,243 @@
+/*
+* esp-just-slip - framing.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "framing.h"
+
+
+//
+// reset frame decoder and select framing mode
+//
+// *decoder - pointer to decoder state
+// mode - framing used on the link
+//
+void ICACHE_FLASH_ATTR framingDecoderInit(FramingDecoder *decoder, FramingMode mode)
+{
+	decoder->mode = mode;
+	slipDecoderInit(&decoder->frame);
+	decoder->nBlock = 0;
+	decoder->zero = false;
+}
+
+
+//
+// drop partly received frame if the line was quiet for longer than gap
+// call with current time each time received bytes are about to be fed
+//
+// *decoder - pointer to decoder state
+// now - current time [us], e.g. system_get_time()
+// gap - longest quiet time inside a frame [us], SLIP_GAP_US
+//
+void ICACHE_FLASH_ATTR framingDecoderGap(FramingDecoder *decoder, uint32_t now, uint32_t gap)
+{
+	SlipDecoder *frame = &decoder->frame;
+	// COBS frame is under way once its first code byte is in
+	bool partial = frame->nPos > 0 || frame->escape || frame->discard || decoder->nBlock > 0 || decoder->zero;
+
+	if (partial && (uint32_t) (now - frame->time) > gap)
+	{
+		os_printf("Partial frame dropped - inter-byte timeout!\r\n");
+		framingDecoderInit(decoder, decoder->mode);
+	}
+	frame->time = now;
+}
+
+
+//
+// worst case size of encoded frame including delimiter
+//
+// mode - framing used on the link
+// nCount - number of data bytes
+//
+// returned value - maximum number of bytes framingEncode() stores for nCount bytes
+//
+uint16_t ICACHE_FLASH_ATTR framingMaxEncoded(FramingMode mode, uint16_t nCount)
+{
+	if (mode == FRAMING_COBS)
+		return nCount + nCount / (COBS_MAX_BLOCK - 1) + 2;
+	return 2 * nCount + 1;
+}
+
+
+//
+// name of framing mode for diagnostic printouts
+//
+const char * ICACHE_FLASH_ATTR framingName(FramingMode mode)
+{
+	switch (mode)
+	{
+		case FRAMING_SLIP:
+			return "slip";
+		case FRAMING_COBS:
+			return "cobs";
+		case FRAMING_HDLC:
+			return "hdlc";
+		default:
+			return "?";
+	}
+}
+
+
+//
+// encode data from srcBuffer into a frame ready to be sent
+// the frame is terminated with a delimiter
+//
+// mode - framing used on the link
+// *srcBuffer - pointer to data buffer to read data from
+// nCount - number of bytes to read from srcBuffer
+// *dstBuffer - pointer to data buffer of at least framingMaxEncoded(mode, nCount) bytes
+//
+// returned value - number of bytes stored in dstBuffer
+//
+uint16_t ICACHE_FLASH_ATTR framingEncode(FramingMode mode, const uint8_t *srcBuffer, uint16_t nCount, uint8_t *dstBuffer)
+{
+	uint16_t i;
+	uint16_t nPos = 0;
+
+	if (mode == FRAMING_COBS)
+	{
+		// position of the code byte of current block
+		uint16_t nCode = nPos++;
+		uint8_t code = 1;
+
+		for (i = 0; i < nCount; i++)
+		{
+			if (srcBuffer[i] == COBS_DELIMITER)
+			{
+				dstBuffer[nCode] = code;
+				nCode = nPos++;
+				code = 1;
+			}
+			else
+			{
+				dstBuffer[nPos++] = srcBuffer[i];
+				if (++code == COBS_MAX_BLOCK)
+				{
+					dstBuffer[nCode] = code;
+					nCode = nPos++;
+					code = 1;
+				}
+			}
+		}
+		dstBuffer[nCode] = code;
+		dstBuffer[nPos++] = COBS_DELIMITER;
+	}
+	else if (mode == FRAMING_HDLC)
+	{
+		for (i = 0; i < nCount; i++)
+		{
+			if (srcBuffer[i] == HDLC_FLAG || srcBuffer[i] == HDLC_ESC)
+			{
+				dstBuffer[nPos++] = HDLC_ESC;
+				dstBuffer[nPos++] = srcBuffer[i] ^ HDLC_XOR;
+			}
+			else
+			{
+				dstBuffer[nPos++] = srcBuffer[i];
+			}
+		}
+		dstBuffer[nPos++] = HDLC_FLAG;
+	}
+	else
+	{
+		nPos = slipEncodeFrame(srcBuffer, nCount, dstBuffer);
+	}
+	return nPos;
+}
+
+
+//
+// feed one received byte to frame decoder
+// decoded data is stored in dataBuffer
+//
+// *decoder - pointer to decoder state
+// dataByte - byte received from the link
+// *dataBuffer - pointer to data buffer to store decoded data, the same for each byte of a frame
+// nSize - size of dataBuffer
+//
+// returned value - number of bytes in dataBuffer once the frame is complete, otherwise 0
+//
+uint16_t ICACHE_FLASH_ATTR framingDecodeByte(FramingDecoder *decoder, uint8_t dataByte, uint8_t *dataBuffer, uint16_t nSize)
+{
+	SlipDecoder *frame = &decoder->frame;
+	bool delimiter;
+
+	switch (decoder->mode)
+	{
+		case FRAMING_COBS:
+			delimiter = (dataByte == COBS_DELIMITER);
+			if (delimiter)
+			{
+				// frame truncated inside a block
+				if (decoder->nBlock > 0)
+					frame->discard = true;
+			}
+			else if (decoder->nBlock == 0)
+			{
+				// code byte starts the next block
+				if (decoder->zero)
+					slipDecoderStore(frame, 0x00, dataBuffer, nSize);
+				decoder->nBlock = dataByte - 1;
+				decoder->zero = (dataByte != COBS_MAX_BLOCK);
+			}
+			else
+			{
+				slipDecoderStore(frame, dataByte, dataBuffer, nSize);
+				decoder->nBlock--;
+			}
+			break;
+
+		case FRAMING_HDLC:
+			delimiter = (dataByte == HDLC_FLAG);
+			if (delimiter)
+				break;
+			if (frame->escape)
+			{
+				frame->escape = false;
+				slipDecoderStore(frame, dataByte ^ HDLC_XOR, dataBuffer, nSize);
+			}
+			else if (dataByte == HDLC_ESC)
+				frame->escape = true;
+			else
+				slipDecoderStore(frame, dataByte, dataBuffer, nSize);
+			break;
+
+		default:
+			return slipDecodeByte(frame, dataByte, dataBuffer, nSize);
+	}
+
+	if (!delimiter)
+		return 0;
+
+	// empty and purged frames are dropped
+	decoder->nBlock = 0;
+	decoder->zero = false;
+	return slipDecoderEnd(frame);
+}
@@ -0,0 +1,95 @@
+/*
+* esp-just-slip - aggregate.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_AGGREGATE_H_
+#define JUSTSLIP_INCLUDE_AGGREGATE_H_
+
+#include "slipport.h"
+
+//
+// Aggregation of small messages into one frame
+//
+// Each message is stored with one byte of length in front:
+//   length, message, length, message ...
+// so a frame of several messages pays for CRC and SLIP_END only once.
+//
+// A frame is handed out for sending once it holds nThreshold bytes,
+// or once its first message waited deadline [us], whichever comes first,
+// so aggregation never delays a message by more than deadline.
+//   aggregateAdd() ... aggregatePoll() -> appendCrc16() -> SLIP encode
+//   SLIP decode -> checkCrc16() -> aggregateNext() for each message
+//
+// Both ends of the link must use it, e.g. on a channel of its own.
+//
+// frame and crc16 must still fit into SLIP_BUFFER_SIZE (64)
+#define AGGREGATE_MAX_FRAME 62
+#define AGGREGATE_DEADLINE_US 2000
+
+//
+// nFrames - frames handed out
+// nMessages - messages packed in them
+// nMaxPacked - most messages in one frame
+// delaySum / delayMax - time messages waited for their frame [us]
+//
+typedef struct {
+	uint32_t nFrames;
+	uint32_t nMessages;
+	uint8_t nMaxPacked;
+	uint32_t delaySum;
+	uint32_t delayMax;
+} AggregateStats;
+
+//
+// frame / nCount - frame being filled
+// nMessages - messages in frame
+// first - when the first message of frame was added [us]
+// addedSum - sum of times messages of frame were added [us], to get their delay
+//
+typedef struct {
+	uint8_t frame[AGGREGATE_MAX_FRAME];
+	uint8_t nCount;
+	uint8_t nMessages;
+	uint8_t nThreshold;
+	uint32_t deadline;
+	uint32_t first;
+	uint32_t addedSum;
+	AggregateStats stats;
+} Aggregator;
+
+
+void ICACHE_FLASH_ATTR aggregateInit(Aggregator *aggregator, uint8_t nThreshold, uint32_t deadline);
+uint8_t ICACHE_FLASH_ATTR aggregateAdd(Aggregator *aggregator, const uint8_t *dataBuffer, uint8_t nCount, uint32_t now, uint8_t *frameBuffer);
+uint8_t ICACHE_FLASH_ATTR aggregatePoll(Aggregator *aggregator, uint32_t now, uint8_t *frameBuffer);
+uint8_t ICACHE_FLASH_ATTR aggregateFlush(Aggregator *aggregator, uint32_t now, uint8_t *frameBuffer);
+uint8_t ICACHE_FLASH_ATTR aggregateNext(const uint8_t *dataBuffer, uint8_t nCount, uint8_t *nPos, const uint8_t **message);
+void ICACHE_FLASH_ATTR aggregatePrintStats(Aggregator *aggregator);
+
+#endif /* JUSTSLIP_INCLUDE_AGGREGATE_H_ */
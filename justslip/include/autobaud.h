@@ -0,0 +1,154 @@
+/*
+* esp-just-slip - autobaud.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_AUTOBAUD_H_
+#define JUSTSLIP_INCLUDE_AUTOBAUD_H_
+
+#include "autobaudhal.h"
+
+//
+// Baud rate negotiation of UART0 link
+//
+// Link comes up at AUTOBAUD_BASE_RATE. The leader proposes the next rate
+// of autobaudRates[], the follower acknowledges and both switch over.
+// The leader then sends AUTOBAUD_PROBE_FRAMES test frames that the follower
+// echoes back. If no more than AUTOBAUD_PROBE_ERRORS of them are lost or
+// fail the CRC check the rate is committed and the next one is tried,
+// otherwise both ends return to the last good rate.
+//
+// Once settled, CRC failures of received frames are counted over
+// AUTOBAUD_WINDOW frames. Above AUTOBAUD_WINDOW_ERRORS the leader steps one
+// rate down. If no valid frame arrives for AUTOBAUD_SILENCE_MS both ends
+// go back to AUTOBAUD_BASE_RATE and the leader negotiates again.
+//
+// A proposal that is not answered is sent again, up to AUTOBAUD_PROPOSE_TRIES
+// times, as line noise or bytes of the previous rate may have spoiled it.
+// A peer that answers none of them stays at AUTOBAUD_BASE_RATE,
+// so the link works with the Arduino sketches unchanged.
+//
+// Control frames (CRC16 appended as by appendCrc16):
+//   AUTOBAUD_MAGIC (4 bytes), type, rate index, sequence number, test pattern (PROBE / ECHO only)
+//
+// They share UART0 with application frames. A frame is taken as control frame
+// only if it has a valid CRC16, starts with all 4 bytes of AUTOBAUD_MAGIC, has
+// a known type, a rate index below AUTOBAUD_RATES and exactly the length of
+// that type. Anything else is left to the application. PROPOSE and DOWN are
+// acted on only for the rate next to the one in use and, for DOWN, only once
+// settled; control frames that come in any other state are ignored.
+//
+#define AUTOBAUD_BASE_RATE BIT_RATE_57600
+#define AUTOBAUD_RATES 5
+
+#define AUTOBAUD_PROBE_FRAMES 32
+#define AUTOBAUD_PROBE_ERRORS 1
+#define AUTOBAUD_PROBE_PATTERN 24
+// time to wait for an answer to proposal and for the last echo
+#define AUTOBAUD_REPLY_MS 100
+#define AUTOBAUD_PROPOSE_TRIES 3
+// follower returns to previous rate if probing stops for longer than that
+#define AUTOBAUD_PROBE_TIMEOUT_MS 300
+
+#define AUTOBAUD_WINDOW 64
+#define AUTOBAUD_WINDOW_ERRORS 4
+// 0 - do not fall back on silence, for links with no periodic traffic
+#define AUTOBAUD_SILENCE_MS 2000
+
+// bytes that start a control frame, none of them escaped by SLIP
+#define AUTOBAUD_MAGIC 0xBA, 0xD5, 0x1F, 0x7C
+#define AUTOBAUD_MAGIC_SIZE 4
+
+#define AUTOBAUD_TYPE_PROPOSE 0x01
+#define AUTOBAUD_TYPE_ACK 0x02
+#define AUTOBAUD_TYPE_PROBE 0x03
+#define AUTOBAUD_TYPE_ECHO 0x04
+#define AUTOBAUD_TYPE_COMMIT 0x05
+#define AUTOBAUD_TYPE_DOWN 0x06
+
+// rows of autobaudControl[]
+#define AUTOBAUD_CONTROL_PROPOSE 0
+#define AUTOBAUD_CONTROL_ACK 1
+#define AUTOBAUD_CONTROL_COMMIT 2
+#define AUTOBAUD_CONTROL_DOWN 3
+#define AUTOBAUD_CONTROL_TYPES 4
+
+typedef enum {
+	AUTOBAUD_LEADER,
+	AUTOBAUD_FOLLOWER
+} AutobaudRole;
+
+typedef enum {
+	AUTOBAUD_IDLE,
+	AUTOBAUD_PROPOSE,
+	AUTOBAUD_PROBE,
+	AUTOBAUD_REVERT,
+	AUTOBAUD_SETTLED
+} AutobaudState;
+
+//
+// state of negotiation, one per link
+//
+// nRate - index of rate in use
+// nGood - index of fastest rate that passed probing
+// nPrevious - follower: rate to return to if probing fails
+// nTries - proposals of the next rate sent
+// nProbe / nEcho - test frames sent / echoed back correctly
+// time - system_get_time() of last step of negotiation [us]
+// lastValid - system_get_time() of last frame with valid CRC [us]
+// nFrames / nErrors - frames received / failed CRC in current window
+//
+typedef struct {
+	AutobaudRole role;
+	AutobaudState state;
+	uint8_t nRate;
+	uint8_t nGood;
+	uint8_t nPrevious;
+	uint8_t nTries;
+	uint8_t nProbe;
+	uint8_t nEcho;
+	uint32_t time;
+	uint32_t lastValid;
+	uint16_t nFrames;
+	uint16_t nErrors;
+} Autobaud;
+
+// PROPOSE, ACK, COMMIT and DOWN frames for each rate index, sequence number 0,
+// encoded at compile time in flash, see autobaudframes.cpp
+extern const SlipWire autobaudControl[AUTOBAUD_CONTROL_TYPES][AUTOBAUD_RATES];
+
+
+void ICACHE_FLASH_ATTR autobaudInit(Autobaud *autobaud, AutobaudRole role);
+void ICACHE_FLASH_ATTR autobaudStart(Autobaud *autobaud);
+bool ICACHE_FLASH_ATTR autobaudFrame(Autobaud *autobaud, uint8_t *dataBuffer, uint8_t nCount);
+void ICACHE_FLASH_ATTR autobaudPoll(Autobaud *autobaud);
+bool ICACHE_FLASH_ATTR autobaudBusy(Autobaud *autobaud);
+UartBautRate ICACHE_FLASH_ATTR autobaudRate(Autobaud *autobaud);
+
+#endif /* JUSTSLIP_INCLUDE_AUTOBAUD_H_ */
@@ -0,0 +1,90 @@
+/*
+* esp-just-slip - autobaudhal.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_AUTOBAUDHAL_H_
+#define JUSTSLIP_INCLUDE_AUTOBAUDHAL_H_
+
+//
+// UART0 access of autobaud.c
+//
+// On ESP8266 (__ets__) these are the SDK and justslip.c calls, declared in
+// user_interface.h and justslip.h that autobaud.c includes.
+// Elsewhere they go to functions of a simulator, e.g. host/linksim.c,
+// that keeps a virtual clock and runs a leader and a follower over simulated
+// wires, so negotiation of autobaud.c runs unchanged on a PC. The simulator
+// tells the endpoint apart by which one it is calling into at the time.
+//
+#ifdef __ets__
+
+#include "os_type.h"
+#include "driver/uart.h"
+#include "slipwire.h"
+
+// time in us
+#define AUTOBAUD_TIME() system_get_time()
+// change bit rate once bytes already sent are out
+#define AUTOBAUD_SET_RATE(rate) uart0_set_baud(rate)
+// SLIP encode and send frame, CRC16 included
+#define AUTOBAUD_SEND(dataBuffer, nCount) slipEncodeSerialUart0(dataBuffer, nCount)
+// send frame encoded at compile time
+#define AUTOBAUD_SEND_WIRE(frame) slipSendWireUart0(frame)
+
+#else
+
+#include "slipport.h"
+#include "slipwire.h"
+
+// bit rates of UART0, as in driver/uart.h
+typedef enum {
+	BIT_RATE_9600 = 9600,
+	BIT_RATE_19200 = 19200,
+	BIT_RATE_38400 = 38400,
+	BIT_RATE_57600 = 57600,
+	BIT_RATE_74880 = 74880,
+	BIT_RATE_115200 = 115200,
+	BIT_RATE_230400 = 230400,
+	BIT_RATE_460800 = 460800,
+	BIT_RATE_921600 = 921600
+} UartBautRate;
+
+uint32_t autobaudHalTime(void);
+void autobaudHalSetRate(UartBautRate rate);
+void autobaudHalSend(const uint8_t *dataBuffer, uint8_t nCount);
+void autobaudHalSendWire(const SlipWire *frame);
+
+#define AUTOBAUD_TIME() autobaudHalTime()
+#define AUTOBAUD_SET_RATE(rate) autobaudHalSetRate(rate)
+#define AUTOBAUD_SEND(dataBuffer, nCount) autobaudHalSend(dataBuffer, nCount)
+#define AUTOBAUD_SEND_WIRE(frame) autobaudHalSendWire(frame)
+
+#endif
+
+#endif /* JUSTSLIP_INCLUDE_AUTOBAUDHAL_H_ */
@@ -0,0 +1,120 @@
+/*
+* esp-just-slip - bus.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_BUS_H_
+#define JUSTSLIP_INCLUDE_BUS_H_
+
+#include "slipport.h"
+
+//
+// Multi-drop bus, e.g. RS485 driven by Softuart (see Softuart_EnableRs485),
+// slipEncodeSerial() holds tx enable for the whole frame
+//
+// Each frame starts with one byte of slave address followed by the payload:
+//   busFrame() / busSlaveReply() -> appendCrc16() -> SLIP encode
+//   SLIP decode -> checkCrc16() -> busMasterReceive() / busSlaveReceive()
+//
+// The top bit of the address byte, BUS_REPLY, tells a reply of a slave from
+// a poll of the master. A node whose transceiver does not turn its receiver
+// off while sending hears its own frames: the master takes only replies and
+// a slave only polls, so neither mistakes its own frame for one of the other
+// side. Slave addresses are 0 .. BUS_BROADCAST - 1.
+//
+// The master polls slaves in turn. A slave sends only in reply to a frame
+// with its address, so no two nodes drive the bus at the same time.
+// The master sends data queued for a slave with its poll, an empty poll
+// is just the address. The reply carries the address of the slave and
+// whatever it has to send, possibly nothing. If no reply arrives within
+// timeout the master moves on to the next slave. Queued data stay pending
+// until the slave replies and are sent again with its next poll, up to
+// BUS_MAX_TRIES polls, then they are dropped and counted in nDropped.
+// A slave may therefore get the same data twice if only its reply is lost.
+//
+// Frames addressed to BUS_BROADCAST are taken by all slaves and not replied to.
+//
+#define BUS_MAX_NODES 16
+// address and crc16 must still fit into SLIP_BUFFER_SIZE (64)
+#define BUS_MAX_PAYLOAD 61
+#define BUS_BROADCAST 0x7F
+// set in the address byte of replies of slaves
+#define BUS_REPLY 0x80
+// time to wait for a reply [us], a slave polled every 10 ms replies within that
+#define BUS_REPLY_TIMEOUT_US 20000
+// polls that carry queued data to a slave that does not reply before the data are dropped
+#define BUS_MAX_TRIES 3
+
+//
+// nPolls - frames sent to slave
+// nReplies / nTimeouts - polls answered / not answered in time
+// nDropped - queued data given up after BUS_MAX_TRIES polls without reply
+// latencySum / latencyMax - time from poll to reply [us]
+//
+typedef struct {
+	uint32_t nPolls;
+	uint32_t nReplies;
+	uint32_t nTimeouts;
+	uint32_t nDropped;
+	uint32_t latencySum;
+	uint32_t latencyMax;
+} BusNodeStats;
+
+//
+// address - addresses of slaves polled in turn
+// nCurrent - slave polled last
+// waiting - reply of current slave is awaited
+// sent - when poll was handed out [us]
+// nPending / pending - data queued for each slave, sent with its next poll until it replies
+// nTries - polls that carried pending data of each slave without reply
+//
+typedef struct {
+	uint8_t address[BUS_MAX_NODES];
+	uint8_t nNodes;
+	uint8_t nCurrent;
+	bool waiting;
+	uint32_t sent;
+	uint32_t timeout;
+	uint8_t nPending[BUS_MAX_NODES];
+	uint8_t pending[BUS_MAX_NODES][BUS_MAX_PAYLOAD];
+	uint8_t nTries[BUS_MAX_NODES];
+	BusNodeStats stats[BUS_MAX_NODES];
+} BusMaster;
+
+
+uint8_t ICACHE_FLASH_ATTR busFrame(uint8_t address, const uint8_t *dataBuffer, uint8_t nCount, uint8_t *frameBuffer);
+void ICACHE_FLASH_ATTR busMasterInit(BusMaster *master, const uint8_t *address, uint8_t nNodes, uint32_t timeout);
+bool ICACHE_FLASH_ATTR busMasterQueue(BusMaster *master, uint8_t address, const uint8_t *dataBuffer, uint8_t nCount);
+uint8_t ICACHE_FLASH_ATTR busMasterPoll(BusMaster *master, uint32_t now, uint8_t *frameBuffer);
+uint8_t ICACHE_FLASH_ATTR busMasterReceive(BusMaster *master, const uint8_t *dataBuffer, uint8_t nCount, uint32_t now);
+bool ICACHE_FLASH_ATTR busSlaveReceive(uint8_t address, const uint8_t *dataBuffer, uint8_t nCount);
+uint8_t ICACHE_FLASH_ATTR busSlaveReply(uint8_t address, const uint8_t *dataBuffer, uint8_t nCount, uint8_t *frameBuffer);
+void ICACHE_FLASH_ATTR busPrintStats(BusMaster *master);
+
+#endif /* JUSTSLIP_INCLUDE_BUS_H_ */
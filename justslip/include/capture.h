@@ -0,0 +1,86 @@
+/*
+* esp-just-slip - capture.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_CAPTURE_H_
+#define JUSTSLIP_INCLUDE_CAPTURE_H_
+
+#include "slipport.h"
+
+//
+// Capture of raw wire bytes of a serial link
+//
+// Chunks of bytes as they were read from or written to the port are kept
+// with their time and direction, before any decoding, so a misbehaving link
+// can be replayed through the decoder later.
+//
+// File: header, then records back to back, little endian
+//   header (CAPTURE_HEADER_SIZE bytes): "SLCP", version (2 bytes),
+//     0 (2 bytes), time of capture start [us since 1970] (8 bytes), 0 if unknown
+//   record: flags (1 byte, CAPTURE_TX or 0 for received bytes),
+//     time since previous record or since capture start [us] (LEB128, up to 5 bytes),
+//     number of bytes (LEB128, up to 3 bytes), bytes
+//
+// Stream over a UART (e.g. ESP8266 debug output on UART1): each record with CRC16
+// appended as by appendCrc16, SLIP encoded, with SLIP_END before and after,
+// so text printed on the same UART ends up in frames that fail the check.
+//
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_SIZE 16
+#define CAPTURE_TX 0x01
+// largest record of nCount bytes
+#define CAPTURE_MAX_RECORD(nCount) (1 + 5 + 3 + (nCount))
+
+//
+// record found by captureParse(), data points into the buffer parsed
+//
+typedef struct {
+	uint8_t flags;
+	uint32_t delta;
+	uint16_t nCount;
+	const uint8_t *data;
+} CaptureRecord;
+
+//
+// time - when previous record was made [us]
+//
+typedef struct {
+	uint32_t time;
+} Capture;
+
+
+uint16_t ICACHE_FLASH_ATTR captureHeader(uint8_t *dataBuffer, uint64_t startTime);
+bool ICACHE_FLASH_ATTR captureCheckHeader(const uint8_t *dataBuffer, uint32_t nSize, uint64_t *startTime);
+void ICACHE_FLASH_ATTR captureInit(Capture *capture, uint32_t now);
+uint16_t ICACHE_FLASH_ATTR captureRecord(Capture *capture, uint8_t flags, uint32_t now,
+	const uint8_t *data, uint16_t nCount, uint8_t *dataBuffer);
+uint32_t ICACHE_FLASH_ATTR captureParse(const uint8_t *dataBuffer, uint32_t nSize, CaptureRecord *record);
+
+#endif /* JUSTSLIP_INCLUDE_CAPTURE_H_ */
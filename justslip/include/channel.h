@@ -0,0 +1,104 @@
+/*
+* esp-just-slip - channel.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_CHANNEL_H_
+#define JUSTSLIP_INCLUDE_CHANNEL_H_
+
+#include "slipport.h"
+
+//
+// Channel multiplexing over one serial link
+//
+// Each frame starts with one byte of channel id followed by the payload:
+//   payload -> channelQueue() ... channelNext() -> appendCrc16() -> SLIP encode
+// or, to build the payload right in the queue, channelSlot() -> channelCommit()
+//   SLIP decode -> checkCrc16() -> dataBuffer[0] is channel id, payload follows
+//
+// Frames wait in per channel queues. channelNext() picks the next frame:
+// - strict priority - a channel with lower priority value always goes first,
+//   so a command waits for at most the one frame already on the wire
+// - weighted round robin between channels of the same priority,
+//   a channel gets up to weight frames per round
+//
+// Queueing delay of each channel is counted in ChannelStats.
+//
+#define CHANNEL_COUNT 4
+#define CHANNEL_QUEUE_LENGTH 4
+// channel id and crc16 must still fit into SLIP_BUFFER_SIZE (64)
+#define CHANNEL_MAX_PAYLOAD 61
+
+// default assignment of channels, see channelInit()
+#define CHANNEL_CONTROL 0
+#define CHANNEL_TELEMETRY 1
+#define CHANNEL_LOG 2
+#define CHANNEL_BULK 3
+
+//
+// nSent - frames handed over by channelNext()
+// nDropped - frames rejected by channelQueue() because queue was full
+// delaySum / delayMax - time frames spent in queue [us]
+//
+typedef struct {
+	uint32_t nSent;
+	uint32_t nDropped;
+	uint32_t delaySum;
+	uint32_t delayMax;
+} ChannelStats;
+
+typedef struct {
+	uint8_t priority;
+	uint8_t weight;
+	uint8_t credit;
+	uint8_t nHead;
+	uint8_t nCount;
+	uint8_t length[CHANNEL_QUEUE_LENGTH];
+	uint32_t queued[CHANNEL_QUEUE_LENGTH];
+	uint8_t frames[CHANNEL_QUEUE_LENGTH][CHANNEL_MAX_PAYLOAD];
+	ChannelStats stats;
+} Channel;
+
+// nLast - channel that sent last, round robin continues after it
+typedef struct {
+	Channel channel[CHANNEL_COUNT];
+	uint8_t nLast;
+} ChannelMux;
+
+
+void ICACHE_FLASH_ATTR channelInit(ChannelMux *mux);
+void ICACHE_FLASH_ATTR channelConfig(ChannelMux *mux, uint8_t id, uint8_t priority, uint8_t weight);
+bool ICACHE_FLASH_ATTR channelQueue(ChannelMux *mux, uint8_t id, const uint8_t *dataBuffer, uint8_t nCount, uint32_t now);
+uint8_t * ICACHE_FLASH_ATTR channelSlot(ChannelMux *mux, uint8_t id);
+bool ICACHE_FLASH_ATTR channelCommit(ChannelMux *mux, uint8_t id, uint8_t nCount, uint32_t now);
+uint8_t ICACHE_FLASH_ATTR channelSpace(ChannelMux *mux, uint8_t id);
+uint8_t ICACHE_FLASH_ATTR channelNext(ChannelMux *mux, uint8_t *dataBuffer, uint32_t now);
+void ICACHE_FLASH_ATTR channelPrintStats(ChannelMux *mux);
+
+#endif /* JUSTSLIP_INCLUDE_CHANNEL_H_ */
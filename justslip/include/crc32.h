@@ -0,0 +1,78 @@
+/*
+* esp-just-slip - crc32.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_CRC32_H_
+#define JUSTSLIP_INCLUDE_CRC32_H_
+
+#include "slipport.h"
+
+//
+// Frame check sequence of selectable strength
+//
+// CRC_16 - CRC-CCITT of crc16.c, as appended by appendCrc16(), fine for short frames
+// CRC_32 - CRC-32 IEEE 802.3 (Ethernet, zip)
+// CRC_32C - CRC-32C Castagnoli, better error detection than CRC_32 for the same cost
+// CRC_NONE - nothing appended, e.g. if application checks frames itself
+//
+// Checksum is appended most significant byte first, like appendCrc16() does.
+//
+// On ESP8266 CRC-32 is calculated with 256 entry tables kept in flash.
+// On x86 host SSE4.2 crc32 instruction (CRC_32C) and PCLMULQDQ (CRC_32)
+// are used if the CPU has them.
+//
+typedef enum {
+	CRC_NONE,
+	CRC_16,
+	CRC_32,
+	CRC_32C
+} CrcMode;
+
+#define CRC_MAX_SIZE 4
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t ICACHE_FLASH_ATTR crc32Data(const uint8_t *data, uint16_t nCount, uint32_t acc);
+uint32_t ICACHE_FLASH_ATTR crc32cData(const uint8_t *data, uint16_t nCount, uint32_t acc);
+void ICACHE_FLASH_ATTR crc32Hardware(bool enable);
+uint8_t ICACHE_FLASH_ATTR crcSize(CrcMode mode);
+const char * ICACHE_FLASH_ATTR crcName(CrcMode mode);
+uint32_t ICACHE_FLASH_ATTR crcUpdate(CrcMode mode, uint32_t acc, const uint8_t *dataBuffer, uint16_t nCount);
+uint16_t ICACHE_FLASH_ATTR appendCrc(CrcMode mode, uint8_t *dataBuffer, uint16_t nCount, uint16_t nSize);
+bool ICACHE_FLASH_ATTR checkCrc(CrcMode mode, const uint8_t *dataBuffer, uint16_t nCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JUSTSLIP_INCLUDE_CRC32_H_ */
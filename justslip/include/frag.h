@@ -0,0 +1,119 @@
+/*
+* esp-just-slip - frag.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_FRAG_H_
+#define JUSTSLIP_INCLUDE_FRAG_H_
+
+#include "slipport.h"
+#include "channel.h"
+#include "slipcodec.h"
+
+//
+// Fragmentation of messages larger than one frame
+//
+// A message of up to 64 KB is sent as a sequence of fragments:
+//   msgId, flags, offset (2 bytes, little endian), payload
+// FRAG_MORE flag is set on all fragments except the last one.
+//
+// fragNext() gives one fragment at a time, so other frames may be sent
+// between fragments, e.g. over a different channel (see channel.h).
+// Build the fragment right in the channel queue, so that payload is copied
+// there once and once more by channelNext(), which puts channel id in front:
+//   while slot = channelSlot(CHANNEL_BULK): fragNext(slot) -> channelCommit(CHANNEL_BULK)
+//   channelNext() -> appendCrc16() -> SLIP encode
+//
+// fragDecodeByte() takes bytes as they come from the link and SLIP decodes
+// payload of each CHANNEL_BULK fragment straight at its offset in the buffer
+// supplied by the caller; only channel id and fragment header are held aside.
+// CRC16 is checked once the frame ends, a damaged fragment is not counted.
+// Frames of other channels are decoded into a frame buffer of the caller.
+//
+// fragReceive() is for fragments already SLIP decoded into a frame buffer,
+// e.g. by a port shared with other traffic; it copies payload to its offset.
+//
+// Fragments must arrive in order, as they do over a serial link; if one is
+// lost the message is dropped and reassembly starts again with the next
+// fragment at offset 0.
+//
+#define FRAG_HEADER 4
+#define FRAG_MORE 0x01
+// fragment payload that fits one channel frame together with header
+#define FRAG_MAX_PAYLOAD (CHANNEL_MAX_PAYLOAD - FRAG_HEADER)
+
+//
+// data - message being sent, not copied, must stay unchanged until sent
+// nCount - size of message
+// nOffset - bytes sent so far
+// msgId - message number, increase it for each message
+// nPayload - payload bytes per fragment
+//
+typedef struct {
+	const uint8_t *data;
+	uint16_t nCount;
+	uint16_t nOffset;
+	uint8_t msgId;
+	uint8_t nPayload;
+	bool done;
+} FragSender;
+
+//
+// buffer / nSize - caller supplied buffer for reassembled message
+// nReceived - bytes of current message received so far
+// msgId - message being reassembled
+// active - a message is being reassembled
+// decoder - SLIP decoder state of fragDecodeByte()
+// head - channel id and fragment header of frame being decoded
+// tail - last two decoded bytes, held back as they are CRC16 once the frame ends
+// nOffset - offset of fragment being decoded
+// bulk / checked - frame is of CHANNEL_BULK / its header was accepted
+//
+typedef struct {
+	uint8_t *buffer;
+	uint16_t nSize;
+	uint16_t nReceived;
+	uint8_t msgId;
+	bool active;
+	SlipDecoder decoder;
+	uint8_t head[1 + FRAG_HEADER];
+	uint8_t tail[2];
+	uint16_t nOffset;
+	bool bulk;
+	bool checked;
+} FragReassembler;
+
+
+void ICACHE_FLASH_ATTR fragSenderInit(FragSender *sender, uint8_t msgId, const uint8_t *data, uint16_t nCount, uint8_t nPayload);
+uint8_t ICACHE_FLASH_ATTR fragNext(FragSender *sender, uint8_t *dataBuffer);
+void ICACHE_FLASH_ATTR fragReassemblerInit(FragReassembler *reassembler, uint8_t *buffer, uint16_t nSize);
+uint16_t ICACHE_FLASH_ATTR fragReceive(FragReassembler *reassembler, const uint8_t *dataBuffer, uint8_t nCount);
+uint16_t ICACHE_FLASH_ATTR fragDecodeByte(FragReassembler *reassembler, uint8_t dataByte, uint8_t *frameBuffer, uint16_t nSize, uint8_t *id);
+
+#endif /* JUSTSLIP_INCLUDE_FRAG_H_ */
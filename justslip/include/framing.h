@@ -0,0 +1,90 @@
+/*
+* esp-just-slip - framing.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_FRAMING_H_
+#define JUSTSLIP_INCLUDE_FRAMING_H_
+
+#include "slipport.h"
+#include "slipcodec.h"
+
+//
+// Framing engine - how frames are delimited on the wire
+//
+// FRAMING_SLIP - RFC 1055, default, compatible with the Arduino sketches
+//   SLIP_END / SLIP_ESC in data are sent as two bytes, worst case 2n + 1
+//
+// FRAMING_COBS - Consistent Overhead Byte Stuffing
+//   data is split into blocks of up to 254 non zero bytes, each preceded
+//   by a code byte, 0x00 ends the frame, worst case n + n / 254 + 2
+//
+// FRAMING_HDLC - HDLC / PPP style byte stuffing
+//   HDLC_FLAG ends the frame, HDLC_FLAG / HDLC_ESC in data are sent
+//   as HDLC_ESC followed by the byte XOR HDLC_XOR, worst case 2n + 1
+//
+typedef enum {
+	FRAMING_SLIP,
+	FRAMING_COBS,
+	FRAMING_HDLC
+} FramingMode;
+
+#define COBS_DELIMITER 0x00
+#define COBS_MAX_BLOCK 0xFF
+
+#define HDLC_FLAG 0x7E
+#define HDLC_ESC 0x7D
+#define HDLC_XOR 0x20
+
+// size of buffer that will hold any encoded frame of nCount bytes
+#define FRAMING_MAX_ENCODED(nCount) (2 * (nCount) + 1)
+
+//
+// state of frame decoder, one per link
+//
+// frame - SLIP decoder state, escape flag is also used by HDLC, see slipcodec.h
+// nBlock - COBS: bytes left in current block, 0 if next byte is a code
+// zero - COBS: block ended with an implied zero, appended once the next block starts
+//
+typedef struct {
+	FramingMode mode;
+	SlipDecoder frame;
+	uint8_t nBlock;
+	bool zero;
+} FramingDecoder;
+
+
+void ICACHE_FLASH_ATTR framingDecoderInit(FramingDecoder *decoder, FramingMode mode);
+void ICACHE_FLASH_ATTR framingDecoderGap(FramingDecoder *decoder, uint32_t now, uint32_t gap);
+uint16_t ICACHE_FLASH_ATTR framingMaxEncoded(FramingMode mode, uint16_t nCount);
+uint16_t ICACHE_FLASH_ATTR framingEncode(FramingMode mode, const uint8_t *srcBuffer, uint16_t nCount, uint8_t *dstBuffer);
+uint16_t ICACHE_FLASH_ATTR framingDecodeByte(FramingDecoder *decoder, uint8_t dataByte, uint8_t *dataBuffer, uint16_t nSize);
+const char * ICACHE_FLASH_ATTR framingName(FramingMode mode);
+
+#endif /* JUSTSLIP_INCLUDE_FRAMING_H_ */
@@ -37,34 +37,57 @@
 
 #include "driver/uart.h"
 #include "softuart.h"
+#include "framing.h"
+#include "crc32.h"
+#include "rs.h"
+#include "pacer.h"
+#include "slipstream.h"
+#include "slipvec.h"
+#include "slipwire.h"
+
+#define SLIP_BUFFER_SIZE 64
 
 //
-// source https://en.wikipedia.org/wiki/Serial_Line_Internet_Protocol
-//
-// SLIP_END - Frame End - distinguishes datagram boundaries in the byte stream
-// SLIP_ESC - Frame Escape
-//
-// If the END byte occurs in the data to be sent, the two byte sequence ESC, ESC_END is sent instead
-// If the ESC byte occurs in the data, the two byte sequence ESC, ESC_ESC is sent.
+// serial link with selectable framing, see framing.h
 //
-// SLIP_ESC_END - Transposed Frame End
-// SLIP_ESC_ESC - Transposed Frame Escape
+// softuart - software UART used by the link, NULL for hardware UART0
+// decoder - framing mode and state of frame being received
+// crc - check appended on send and verified on receive, CRC_NONE by default
+// fec - Reed-Solomon parity added after crc, fec.nParity 0 if not used
+// nCorrected - bytes repaired by fec so far
+// pacer - token bucket of frames sent, pacer.rate 0 if not paced
 //
-#define SLIP_END 0xC0
-#define SLIP_ESC 0xDB
-#define SLIP_ESC_END 0xDC
-#define SLIP_ESC_ESC 0xDD
-
-#define SLIP_BUFFER_SIZE 64
+typedef struct {
+	Softuart *softuart;
+	FramingDecoder decoder;
+	CrcMode crc;
+	RsCodec fec;
+	uint32_t nCorrected;
+	Pacer pacer;
+} SlipLink;
 
 
 uint8_t ICACHE_FLASH_ATTR slipDecodeSerial(Softuart *softuart, uint8_t *dataBuffer);
 uint8_t ICACHE_FLASH_ATTR slipDecodeSerialUart0(uint8_t *dataBuffer);
+void ICACHE_FLASH_ATTR slipStreamSerial(Softuart *softuart, SlipStream *stream);
+void ICACHE_FLASH_ATTR slipStreamSerialUart0(SlipStream *stream);
 void ICACHE_FLASH_ATTR slipEncodeSerial(Softuart *softuart, uint8_t *dataBuffer, uint8_t nCount);
 void ICACHE_FLASH_ATTR slipEncodeSerialUart0(uint8_t *dataBuffer, uint8_t nCount);
+void ICACHE_FLASH_ATTR slipEncodeSerialv(Softuart *softuart, const SlipSegment *segments, uint8_t nSegments, CrcMode crc);
+void ICACHE_FLASH_ATTR slipEncodeSerialUart0v(const SlipSegment *segments, uint8_t nSegments, CrcMode crc);
+void ICACHE_FLASH_ATTR slipSendWire(Softuart *softuart, const SlipWire *frame);
+void ICACHE_FLASH_ATTR slipSendWireUart0(const SlipWire *frame);
 uint8_t ICACHE_FLASH_ATTR readKeyboard(uint8_t *dataBuffer);
 uint8_t ICACHE_FLASH_ATTR appendCrc16(uint8_t *dataBuffer, uint8_t nCount);
 bool ICACHE_FLASH_ATTR checkCrc16(uint8_t *dataBuffer, uint8_t nCount);
 void ICACHE_FLASH_ATTR printBuffer(uint8_t *dataBuffer, uint8_t nCount);
+void ICACHE_FLASH_ATTR slipLinkInit(SlipLink *link, Softuart *softuart, FramingMode mode);
+void ICACHE_FLASH_ATTR slipLinkCrc(SlipLink *link, CrcMode mode);
+void ICACHE_FLASH_ATTR slipLinkFec(SlipLink *link, uint8_t nParity);
+void ICACHE_FLASH_ATTR slipLinkPace(SlipLink *link, uint32_t rate, uint16_t burst);
+bool ICACHE_FLASH_ATTR slipLinkReady(SlipLink *link);
+uint8_t ICACHE_FLASH_ATTR slipLinkReceive(SlipLink *link, uint8_t *dataBuffer);
+void ICACHE_FLASH_ATTR slipLinkSend(SlipLink *link, uint8_t *dataBuffer, uint8_t nCount);
+void ICACHE_FLASH_ATTR slipCaptureUart1(bool enable);
 
 #endif /* JUSTSLIP_INCLUDE_JUSTSLIP_H_ */
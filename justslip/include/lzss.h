@@ -0,0 +1,77 @@
+/*
+* esp-just-slip - lzss.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_LZSS_H_
+#define JUSTSLIP_INCLUDE_LZSS_H_
+
+#include "slipport.h"
+
+//
+// LZSS per-frame compression (heatshrink style bit stream)
+//
+// Compressed frame = one flag byte followed by the payload:
+//
+// COMPRESS_FLAG_RAW - payload is sent as is (frame did not compress)
+// COMPRESS_FLAG_LZSS - payload is a stream of tokens, MSB first:
+//   1 + 8 bits - literal byte
+//   0 + LZSS_WINDOW_BITS + LZSS_LENGTH_BITS - back reference (distance - 1, length - LZSS_MIN_MATCH)
+//   the stream is padded with zero bits to a byte boundary
+//
+// COMPRESS_FLAG_LZSS_DICT - as above, back references may also point into the dictionary
+//
+// The window is the frame itself, optionally preceded by a preset dictionary
+// (sample telemetry) set with lzssSetDictionary() on both ends of the link.
+// Frames decompress independently, so a lost frame does not affect the following ones.
+// The codec uses LZSS_RAM_SIZE bytes of static memory.
+//
+#define COMPRESS_FLAG_RAW 0x00
+#define COMPRESS_FLAG_LZSS 0x01
+#define COMPRESS_FLAG_LZSS_DICT 0x02
+
+#define LZSS_WINDOW_BITS 8
+#define LZSS_LENGTH_BITS 4
+#define LZSS_MIN_MATCH 2
+#define LZSS_MAX_MATCH (LZSS_MIN_MATCH + (1 << LZSS_LENGTH_BITS) - 1)
+// number of earlier positions checked for a match, bounds cycles per byte
+#define LZSS_MAX_CHAIN 16
+
+// largest payload accepted by compressFrame(), flag byte must still fit in uint8_t count
+#define LZSS_MAX_FRAME 254
+// frames that do not fit the window together with the dictionary are compressed without it
+#define LZSS_MAX_DICTIONARY 128
+#define LZSS_RAM_SIZE (256 + 2 * LZSS_MAX_FRAME + LZSS_MAX_DICTIONARY)
+
+
+void ICACHE_FLASH_ATTR lzssSetDictionary(const uint8_t *dictionary, uint8_t nCount);
+uint8_t ICACHE_FLASH_ATTR compressFrame(const uint8_t *srcBuffer, uint8_t nCount, uint8_t *dstBuffer);
+uint8_t ICACHE_FLASH_ATTR decompressFrame(const uint8_t *srcBuffer, uint8_t nCount, uint8_t *dstBuffer, uint8_t nSize);
+
+#endif /* JUSTSLIP_INCLUDE_LZSS_H_ */
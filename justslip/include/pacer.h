@@ -0,0 +1,108 @@
+/*
+* esp-just-slip - pacer.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_PACER_H_
+#define JUSTSLIP_INCLUDE_PACER_H_
+
+#include "slipport.h"
+
+//
+// Token bucket pacing of frames sent over a link
+//
+// The bucket fills at rate bytes per second up to burst bytes.
+// A frame may go out while the bucket is not empty and takes
+// its wire bytes out of it, so the bucket may drop below zero
+// by at most one frame. Over time no more than rate bytes per second
+// are sent, with bursts of up to burst bytes.
+//   if pacerReady() -> SLIP encode -> pacerCharge(wire bytes)
+//
+// Adaptive mode follows the receiver: it reports its cumulative counters
+// of frames lost and bytes dropped on input buffer overflow.
+// On any new loss the rate is cut by a quarter, on a clean report
+// it grows by 1/16, within minRate .. maxRate.
+//
+// Report (CRC16 appended as by appendCrc16):
+//   PACER_REPORT_MAGIC (4 bytes), lost (4 bytes, little endian), overflow (4 bytes, little endian)
+//
+// It shares the link with application frames, so it is taken only if it has
+// exactly PACER_REPORT_SIZE bytes and starts with all of PACER_REPORT_MAGIC.
+// A diag frame of user_main.c has the same size, its packet number would
+// have to be negative to look like the magic.
+// slipd -r sends one periodically, see host/slipd.c.
+//
+#define PACER_REPORT_MAGIC 0x6E, 0x91, 0x3C, 0xFB
+#define PACER_REPORT_MAGIC_SIZE 4
+#define PACER_REPORT_SIZE (PACER_REPORT_MAGIC_SIZE + 8)
+
+//
+// nFrames / nBytes - frames and wire bytes sent
+// nHeld - calls to pacerReady() that had to wait
+// nSlower / nFaster - rate changes on reports from receiver
+//
+typedef struct {
+	uint32_t nFrames;
+	uint32_t nBytes;
+	uint32_t nHeld;
+	uint32_t nSlower;
+	uint32_t nFaster;
+} PacerStats;
+
+//
+// rate - bytes per second, 0 if link is not paced
+// burst - size of bucket [bytes]
+// tokens - content of bucket [1/256 byte]
+// time - when bucket was last filled [us]
+// minRate / maxRate - range of adaptive mode, maxRate 0 if rate is fixed
+// nLost / nOverflow - counters of last report from receiver
+//
+typedef struct {
+	uint32_t rate;
+	uint32_t burst;
+	int32_t tokens;
+	uint32_t time;
+	uint32_t minRate;
+	uint32_t maxRate;
+	uint32_t nLost;
+	uint32_t nOverflow;
+	PacerStats stats;
+} Pacer;
+
+
+void ICACHE_FLASH_ATTR pacerInit(Pacer *pacer, uint32_t rate, uint16_t burst, uint32_t now);
+void ICACHE_FLASH_ATTR pacerAdapt(Pacer *pacer, uint32_t minRate, uint32_t maxRate);
+bool ICACHE_FLASH_ATTR pacerReady(Pacer *pacer, uint32_t now);
+void ICACHE_FLASH_ATTR pacerCharge(Pacer *pacer, uint16_t nBytes);
+void ICACHE_FLASH_ATTR pacerFeedback(Pacer *pacer, uint32_t nLost, uint32_t nOverflow);
+uint8_t ICACHE_FLASH_ATTR pacerMakeReport(uint8_t *dataBuffer, uint32_t nLost, uint32_t nOverflow);
+bool ICACHE_FLASH_ATTR pacerReport(Pacer *pacer, const uint8_t *dataBuffer, uint8_t nCount);
+void ICACHE_FLASH_ATTR pacerPrintStats(Pacer *pacer);
+
+#endif /* JUSTSLIP_INCLUDE_PACER_H_ */
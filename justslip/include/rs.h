@@ -0,0 +1,69 @@
+/*
+* esp-just-slip - rs.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_RS_H_
+#define JUSTSLIP_INCLUDE_RS_H_
+
+#include "slipport.h"
+
+//
+// Reed-Solomon forward error correction over GF(256)
+//
+// nParity bytes appended to a frame correct up to nParity / 2 bytes
+// in error anywhere in the frame, parity included. Single bit errors
+// from Softuart timing jitter cost one byte each.
+//
+// Apply after appendCrc16() so that a frame the code could not repair
+// is still caught by the CRC check:
+//   payload -> appendCrc16() -> rsEncode() -> SLIP encode
+//   SLIP decode -> rsDecode() -> checkCrc16()
+//
+// Field tables take 766 bytes of RAM, shared by all codecs.
+//
+#define RS_MAX_PARITY 16
+// frame with parity may not be longer than that
+#define RS_MAX_LENGTH 255
+
+//
+// nParity - parity bytes per frame, even, 2 .. RS_MAX_PARITY
+// generator - generator polynomial, highest power first
+//
+typedef struct {
+	uint8_t nParity;
+	uint8_t generator[RS_MAX_PARITY + 1];
+} RsCodec;
+
+
+void ICACHE_FLASH_ATTR rsInit(RsCodec *codec, uint8_t nParity);
+uint8_t ICACHE_FLASH_ATTR rsEncode(const RsCodec *codec, uint8_t *dataBuffer, uint8_t nCount);
+uint8_t ICACHE_FLASH_ATTR rsDecode(const RsCodec *codec, uint8_t *dataBuffer, uint8_t nCount, uint8_t *nCorrected);
+
+#endif /* JUSTSLIP_INCLUDE_RS_H_ */
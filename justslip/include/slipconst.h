@@ -0,0 +1,274 @@
+/*
+* esp-just-slip - slipconst.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_SLIPCONST_H_
+#define JUSTSLIP_INCLUDE_SLIPCONST_H_
+
+#ifndef __cplusplus
+#error "slipconst.h is C++ only, include slipwire.h from C"
+#endif
+
+#include "slipcodec.h"
+#include "slipwire.h"
+
+//
+// Compile time CRC and SLIP encoding (C++11 constexpr)
+//
+// CRC-32 tables of crc32.c are generated by SLIP_CONST_CRC32_TABLE(), see crctable.cpp.
+// SLIP_CONST_WIRE(bytes...) turns a constant payload into a SlipWire initializer:
+// CRC16 of crc16.c appended, bytes escaped as by slipEncodeByte(), SLIP_END added.
+//
+//   const SlipWire pingFrame ICACHE_RODATA_ATTR = SLIP_CONST_WIRE(0x50, 0x01);
+//
+// Functions mirror crc16_add(), crc32.c tables and slipEncodeFrame() step by step.
+// static_assert checks of them against check values of the runtime code
+// are at the end of this file, so a change to either side that makes them
+// differ stops the build.
+//
+
+//
+// CRC-16 of crc16.c, one byte, same steps as crc16_add()
+//
+constexpr uint16_t slipConstCrc16Step4(uint16_t acc)
+{
+	return acc ^ ((acc & 0xff00) >> 5);
+}
+
+constexpr uint16_t slipConstCrc16Step3(uint16_t acc)
+{
+	return slipConstCrc16Step4(acc ^ ((acc >> 8) >> 4));
+}
+
+constexpr uint16_t slipConstCrc16Step2(uint16_t acc)
+{
+	return slipConstCrc16Step3((uint16_t) (acc ^ ((acc & 0xff00) << 4)));
+}
+
+constexpr uint16_t slipConstCrc16Add(uint8_t dataByte, uint16_t acc)
+{
+	return slipConstCrc16Step2((uint16_t) (((acc ^ dataByte) >> 8) | ((acc ^ dataByte) << 8)));
+}
+
+
+//
+// CRC-16 of bytes given as arguments, as crc16_data()
+//
+constexpr uint16_t slipConstCrc16(uint16_t acc)
+{
+	return acc;
+}
+
+template <typename... Bytes>
+constexpr uint16_t slipConstCrc16(uint16_t acc, uint8_t dataByte, Bytes... rest)
+{
+	return slipConstCrc16(slipConstCrc16Add(dataByte, acc), rest...);
+}
+
+
+//
+// CRC-16 of a string, e.g. check value of "123456789"
+//
+constexpr uint16_t slipConstCrc16String(uint16_t acc, const char *text)
+{
+	return *text == 0 ? acc : slipConstCrc16String(slipConstCrc16Add((uint8_t) *text, acc), text + 1);
+}
+
+
+//
+// entry of reflected CRC-32 table, value shifted out one bit at a time
+//
+constexpr uint32_t slipConstCrc32Entry(uint32_t poly, uint32_t value, uint8_t nBits = 8)
+{
+	return nBits == 0 ? value : slipConstCrc32Entry(poly, (value & 1) ? (value >> 1) ^ poly : value >> 1, nBits - 1);
+}
+
+
+//
+// reflected CRC-32 of a string, acc kept inverted as during calculation
+//
+constexpr uint32_t slipConstCrc32String(uint32_t poly, uint32_t acc, const char *text)
+{
+	return *text == 0 ? ~acc : slipConstCrc32String(poly,
+		slipConstCrc32Entry(poly, (acc ^ (uint8_t) *text) & 0xFF) ^ (acc >> 8), text + 1);
+}
+
+
+// 256 entries of reflected CRC-32 table of poly, as an array initializer
+#define SLIP_CONST_CRC32_ROW(poly, n) \
+	slipConstCrc32Entry(poly, (n) + 0), slipConstCrc32Entry(poly, (n) + 1), \
+	slipConstCrc32Entry(poly, (n) + 2), slipConstCrc32Entry(poly, (n) + 3), \
+	slipConstCrc32Entry(poly, (n) + 4), slipConstCrc32Entry(poly, (n) + 5), \
+	slipConstCrc32Entry(poly, (n) + 6), slipConstCrc32Entry(poly, (n) + 7), \
+	slipConstCrc32Entry(poly, (n) + 8), slipConstCrc32Entry(poly, (n) + 9), \
+	slipConstCrc32Entry(poly, (n) + 10), slipConstCrc32Entry(poly, (n) + 11), \
+	slipConstCrc32Entry(poly, (n) + 12), slipConstCrc32Entry(poly, (n) + 13), \
+	slipConstCrc32Entry(poly, (n) + 14), slipConstCrc32Entry(poly, (n) + 15)
+
+#define SLIP_CONST_CRC32_TABLE(poly) { \
+	SLIP_CONST_CRC32_ROW(poly, 0x00), SLIP_CONST_CRC32_ROW(poly, 0x10), \
+	SLIP_CONST_CRC32_ROW(poly, 0x20), SLIP_CONST_CRC32_ROW(poly, 0x30), \
+	SLIP_CONST_CRC32_ROW(poly, 0x40), SLIP_CONST_CRC32_ROW(poly, 0x50), \
+	SLIP_CONST_CRC32_ROW(poly, 0x60), SLIP_CONST_CRC32_ROW(poly, 0x70), \
+	SLIP_CONST_CRC32_ROW(poly, 0x80), SLIP_CONST_CRC32_ROW(poly, 0x90), \
+	SLIP_CONST_CRC32_ROW(poly, 0xA0), SLIP_CONST_CRC32_ROW(poly, 0xB0), \
+	SLIP_CONST_CRC32_ROW(poly, 0xC0), SLIP_CONST_CRC32_ROW(poly, 0xD0), \
+	SLIP_CONST_CRC32_ROW(poly, 0xE0), SLIP_CONST_CRC32_ROW(poly, 0xF0) }
+
+
+//
+// byte nPos of the bytes given as arguments
+//
+constexpr uint8_t slipConstByte(uint16_t nPos)
+{
+	return 0;
+}
+
+template <typename... Bytes>
+constexpr uint8_t slipConstByte(uint16_t nPos, uint8_t dataByte, Bytes... rest)
+{
+	return nPos == 0 ? dataByte : slipConstByte(nPos - 1, rest...);
+}
+
+
+//
+// number of wire bytes of data byte, as returned by slipEncodeByte()
+//
+constexpr uint8_t slipConstEscaped(uint8_t dataByte)
+{
+	return (dataByte == SLIP_END || dataByte == SLIP_ESC) ? 2 : 1;
+}
+
+
+//
+// frame of payload bytes with CRC16 appended, encoded at compile time
+//
+template <uint8_t... bytes>
+struct SlipConstFrame
+{
+	static constexpr uint16_t nPayload = sizeof...(bytes);
+	// payload and CRC16, most significant byte first as appendCrc16() does
+	static constexpr uint16_t nData = nPayload + 2;
+
+	static constexpr uint8_t data(uint16_t nPos)
+	{
+		return nPos < nPayload ? slipConstByte(nPos, bytes...)
+			: nPos == nPayload ? (uint8_t) (slipConstCrc16(0, bytes...) >> 8)
+			: (uint8_t) slipConstCrc16(0, bytes...);
+	}
+
+	// wire bytes from data byte nPos on, SLIP_END included
+	static constexpr uint16_t size(uint16_t nPos = 0)
+	{
+		return nPos == nData ? 1 : slipConstEscaped(data(nPos)) + size(nPos + 1);
+	}
+
+	// wire byte n counted from data byte nPos, 0 after SLIP_END
+	static constexpr uint8_t wire(uint16_t n, uint16_t nPos = 0)
+	{
+		return nPos == nData ? (n == 0 ? SLIP_END : 0) : wireOf(n, nPos, data(nPos));
+	}
+
+	static constexpr uint8_t wireOf(uint16_t n, uint16_t nPos, uint8_t dataByte)
+	{
+		return slipConstEscaped(dataByte) == 1
+			? (n == 0 ? dataByte : wire(n - 1, nPos + 1))
+			: (n == 0 ? SLIP_ESC
+			: n == 1 ? (dataByte == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC)
+			: wire(n - 2, nPos + 1));
+	}
+
+	// wire bytes 4 * nWord to 4 * nWord + 3, first one in the lowest bits
+	static constexpr uint32_t word(uint16_t nWord)
+	{
+		return (uint32_t) wire(4 * nWord) | ((uint32_t) wire(4 * nWord + 1) << 8)
+			| ((uint32_t) wire(4 * nWord + 2) << 16) | ((uint32_t) wire(4 * nWord + 3) << 24);
+	}
+};
+
+
+//
+// list of word indexes 0 .. n - 1 to expand SlipWire initializer with
+//
+template <uint16_t... n>
+struct SlipConstIndex
+{
+};
+
+template <uint16_t nCount, uint16_t... n>
+struct SlipConstMakeIndex : SlipConstMakeIndex<nCount - 1, nCount - 1, n...>
+{
+};
+
+template <uint16_t... n>
+struct SlipConstMakeIndex<0, n...>
+{
+	typedef SlipConstIndex<n...> type;
+};
+
+
+template <uint8_t... bytes, uint16_t... n>
+constexpr SlipWire slipConstWire(SlipConstIndex<n...>)
+{
+	return SlipWire { SlipConstFrame<bytes...>::size(), { SlipConstFrame<bytes...>::word(n)... } };
+}
+
+
+//
+// SlipWire initializer of payload bytes, fails to compile if frame does not fit
+//
+template <uint8_t... bytes>
+constexpr SlipWire slipConstWire()
+{
+	static_assert(SlipConstFrame<bytes...>::size() <= SLIP_WIRE_MAX, "frame too long for SlipWire, raise SLIP_WIRE_MAX");
+	return slipConstWire<bytes...>(typename SlipConstMakeIndex<SLIP_WIRE_WORDS>::type());
+}
+
+#define SLIP_CONST_WIRE(...) slipConstWire<__VA_ARGS__>()
+
+
+//
+// checks against the runtime code
+// check values of "123456789" for crc16_data(), crc32Data() and crc32cData(),
+// table entries as in the tables crc32.c was written with,
+// wire bytes as given by appendCrc16() and slipEncodeFrame()
+//
+static_assert(slipConstCrc16String(0, "123456789") == 0x2189, "CRC-16 differs from crc16_data()");
+static_assert(slipConstCrc32String(0xEDB88320, 0xFFFFFFFF, "123456789") == 0xCBF43926, "CRC-32 differs from crc32Data()");
+static_assert(slipConstCrc32String(0x82F63B78, 0xFFFFFFFF, "123456789") == 0xE3069283, "CRC-32C differs from crc32cData()");
+static_assert(slipConstCrc32Entry(0xEDB88320, 1) == 0x77073096 && slipConstCrc32Entry(0xEDB88320, 255) == 0x2D02EF8D,
+	"CRC-32 table differs");
+static_assert(slipConstCrc32Entry(0x82F63B78, 1) == 0xF26B8303 && slipConstCrc32Entry(0x82F63B78, 255) == 0xAD7D5351,
+	"CRC-32C table differs");
+// 01 C0 DB -> 01 DB DC DB DD F8 28 C0
+static_assert(SlipConstFrame<0x01, 0xC0, 0xDB>::size() == 8 && SlipConstFrame<0x01, 0xC0, 0xDB>::word(0) == 0xDBDCDB01
+	&& SlipConstFrame<0x01, 0xC0, 0xDB>::word(1) == 0xC028F8DD, "SLIP encoding differs from slipEncodeFrame()");
+
+#endif /* JUSTSLIP_INCLUDE_SLIPCONST_H_ */
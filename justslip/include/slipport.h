@@ -0,0 +1,73 @@
+/*
+* esp-just-slip - slipport.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_SLIPPORT_H_
+#define JUSTSLIP_INCLUDE_SLIPPORT_H_
+
+//
+// Minimal portability layer for the parts of justslip that do not touch
+// ESP8266 peripherals (payload transforms, framing, checksums).
+//
+// On the ESP8266 (__ets__ defined by the Makefile) the SDK headers are used.
+// On other platforms the same sources build against the C library,
+// so they may be compiled into host tools and benchmarks unchanged.
+//
+#ifdef __ets__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include <c_types.h>
+#include <osapi.h>
+#ifdef __cplusplus
+}
+#endif
+
+#else
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#define ICACHE_FLASH_ATTR
+#define ICACHE_RODATA_ATTR
+
+#define os_printf printf
+#define os_memcpy memcpy
+#define os_memmove memmove
+#define os_memset memset
+#define os_memcmp memcmp
+#define os_sprintf sprintf
+
+#endif
+
+#endif /* JUSTSLIP_INCLUDE_SLIPPORT_H_ */
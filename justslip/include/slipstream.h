@@ -0,0 +1,111 @@
+/*
+* esp-just-slip - slipstream.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_SLIPSTREAM_H_
+#define JUSTSLIP_INCLUDE_SLIPSTREAM_H_
+
+#include "slipport.h"
+#include "crc32.h"
+
+//
+// Streaming SLIP decoder for frames larger than RAM
+//
+// slipDecodeByte() / slipDecodeSpan() of slipcodec.h keep the whole frame in
+// dataBuffer before it is delivered. SlipStream hands decoded payload to the
+// application in chunks of up to SLIP_STREAM_CHUNK bytes as they come in,
+// so a frame of any size (e.g. a firmware image) can be hashed, written to
+// flash or forwarded with constant memory:
+//   begin(context) - first byte of a new frame received
+//   data(context, chunk, nCount) - next nCount decoded bytes of the frame
+//   end(context, status, nTotal) - frame complete or dropped, see SlipStreamStatus
+//
+// The last crcSize(crc) bytes of a frame are the check value appended by the
+// sender as by appendCrc(). They are held back, never passed to data(), and
+// compared to the check value calculated over the payload on SLIP_END.
+// Payload already passed to data() of a frame that ends with status other
+// than SLIP_STREAM_OK must be discarded by the application.
+//
+// Callbacks run from slipStreamFeed(), in the context of the caller.
+//
+#define SLIP_STREAM_CHUNK 64
+
+//
+// SLIP_STREAM_OK - all payload delivered and the check value matches
+// SLIP_STREAM_BAD_CRC - check value does not match or frame too short to hold it
+// SLIP_STREAM_MALFORMED - invalid escape sequence, rest of frame is skipped
+// SLIP_STREAM_ABORTED - line quiet for too long in the middle of frame, see slipStreamGap()
+//
+typedef enum {
+	SLIP_STREAM_OK,
+	SLIP_STREAM_BAD_CRC,
+	SLIP_STREAM_MALFORMED,
+	SLIP_STREAM_ABORTED
+} SlipStreamStatus;
+
+typedef void (*SlipStreamBegin)(void *context);
+typedef void (*SlipStreamData)(void *context, const uint8_t *chunk, uint16_t nCount);
+typedef void (*SlipStreamEnd)(void *context, SlipStreamStatus status, uint32_t nTotal);
+
+//
+// crc - check value expected at the end of each frame, CRC_NONE if none
+// begin / data / end - application callbacks, begin and end may be NULL
+// context - passed to the callbacks
+// acc - check value of payload delivered so far
+// nTotal - payload bytes delivered so far
+// time - when bytes were fed last, see slipStreamGap()
+// chunk / nChunk - decoded bytes not delivered yet, the last ones may be check value
+// inFrame - a frame is being received
+// escape - SLIP_ESC received, next byte is escaped
+// discard - frame dropped, bytes are skipped until SLIP_END
+//
+typedef struct {
+	CrcMode crc;
+	SlipStreamBegin begin;
+	SlipStreamData data;
+	SlipStreamEnd end;
+	void *context;
+	uint32_t acc;
+	uint32_t nTotal;
+	uint32_t time;
+	uint8_t chunk[SLIP_STREAM_CHUNK + CRC_MAX_SIZE];
+	uint8_t nChunk;
+	bool inFrame;
+	bool escape;
+	bool discard;
+} SlipStream;
+
+
+void ICACHE_FLASH_ATTR slipStreamInit(SlipStream *stream, CrcMode crc, SlipStreamBegin begin,
+	SlipStreamData data, SlipStreamEnd end, void *context);
+bool ICACHE_FLASH_ATTR slipStreamGap(SlipStream *stream, uint32_t now, uint32_t gap);
+void ICACHE_FLASH_ATTR slipStreamFeed(SlipStream *stream, const uint8_t *wire, uint16_t nCount);
+
+#endif /* JUSTSLIP_INCLUDE_SLIPSTREAM_H_ */
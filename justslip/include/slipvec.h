@@ -0,0 +1,75 @@
+/*
+* esp-just-slip - slipvec.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_SLIPVEC_H_
+#define JUSTSLIP_INCLUDE_SLIPVEC_H_
+
+#include "slipport.h"
+#include "crc32.h"
+
+//
+// Scatter-gather SLIP encoding
+//
+// A frame is given as a list of segments, e.g. protocol header, payload and
+// a constant trailer, that lie anywhere in memory. slipEncodeVector() escapes
+// them one after another with a single running check value appended at the end,
+// as appendCrc() would over the same bytes put together, so no buffer
+// to assemble the frame is needed:
+//   SlipSegment frame[] = { { &header, sizeof(header) }, { payload, nCount }, { trailer, 4 } };
+//   slipEncodeSerialUart0v(frame, 3, CRC_16);
+//
+// Segments may be constants kept in flash (ICACHE_RODATA_ATTR). On ESP8266 flash
+// can only be read 32 bits at a time from aligned addresses, so such segments
+// are read word by word. Bytes go out in pieces of up to 2 * SLIP_VEC_CHUNK + 1
+// wire bytes through the write callback, e.g. to UART0 or Softuart.
+//
+#define SLIP_VEC_CHUNK 64
+
+// ESP8266 flash mapped by the cache (irom0), byte reads from there fail
+#define SLIP_VEC_IN_FLASH(address) ((uint32_t) (address) >= 0x40200000 && (uint32_t) (address) < 0x40300000)
+
+//
+// data - start of segment, in RAM or in flash
+// nCount - number of bytes of segment
+//
+typedef struct {
+	const void *data;
+	uint16_t nCount;
+} SlipSegment;
+
+typedef void (*SlipVecWrite)(void *context, const uint8_t *wire, uint16_t nCount);
+
+
+uint16_t ICACHE_FLASH_ATTR slipVectorEncodedSize(const SlipSegment *segments, uint8_t nSegments, CrcMode crc);
+uint16_t ICACHE_FLASH_ATTR slipEncodeVector(const SlipSegment *segments, uint8_t nSegments, CrcMode crc,
+	SlipVecWrite write, void *context);
+
+#endif /* JUSTSLIP_INCLUDE_SLIPVEC_H_ */
@@ -0,0 +1,84 @@
+/*
+* esp-just-slip - slipwire.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_SLIPWIRE_H_
+#define JUSTSLIP_INCLUDE_SLIPWIRE_H_
+
+#include "slipport.h"
+
+//
+// SLIP frame encoded ahead of time
+//
+// Fixed frames, e.g. pings, acknowledgements and mode switch commands, are
+// escaped, have CRC16 appended as by appendCrc16() and SLIP_END added
+// at compile time, see slipconst.h. Sending one is then a copy of its wire bytes
+// to the port, without appendCrc16() and the escape loop.
+//
+// Wire bytes are kept in 32 bit words, first byte in the lowest bits, so a frame
+// kept in flash with ICACHE_RODATA_ATTR is read with the aligned loads ESP8266 needs.
+//
+// largest frame in wire bytes, SLIP_END included
+#define SLIP_WIRE_MAX 16
+#define SLIP_WIRE_WORDS (SLIP_WIRE_MAX / 4)
+
+//
+// nWire - number of wire bytes, SLIP_END included
+// wire - wire bytes, 4 in each word, unused bytes 0
+//
+typedef struct {
+	uint32_t nWire;
+	uint32_t wire[SLIP_WIRE_WORDS];
+} SlipWire;
+
+
+//
+// copy wire bytes of a frame encoded ahead of time to wireBuffer, reading it in words
+//
+// *frame - pointer to frame, in RAM or in flash
+// *wireBuffer - pointer to buffer of SLIP_WIRE_MAX bytes
+//
+// returned value - number of wire bytes
+//
+static inline uint16_t slipWireCopy(const SlipWire *frame, uint8_t *wireBuffer)
+{
+	uint16_t i, nWire = (uint16_t) frame->nWire;
+	uint32_t word = 0;
+
+	for (i = 0; i < nWire; i++)
+	{
+		if ((i & 3) == 0)
+			word = frame->wire[i / 4];
+		wireBuffer[i] = (uint8_t) (word >> (8 * (i & 3)));
+	}
+	return nWire;
+}
+
+#endif /* JUSTSLIP_INCLUDE_SLIPWIRE_H_ */
@@ -0,0 +1,57 @@
+/*
+* esp-just-slip - whiten.h
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef JUSTSLIP_INCLUDE_WHITEN_H_
+#define JUSTSLIP_INCLUDE_WHITEN_H_
+
+#include "slipport.h"
+
+//
+// Escape avoiding payload whitening
+//
+// Every SLIP_END / SLIP_ESC in a frame costs an extra byte on the wire.
+// whitenFrame() XORs the frame with the key out of 0 .. WHITEN_KEYS - 1
+// that leaves the fewest of them and sends the key as the first byte.
+// As each data byte turns into SLIP_END or SLIP_ESC for at most two keys,
+// the best key never leaves more than 2 * nCount / WHITEN_KEYS of them.
+//
+// Apply after appendCrc16() so that the checksum is covered as well:
+//   payload -> appendCrc16() -> whitenFrame() -> SLIP encode
+//   SLIP decode -> unwhitenFrame() -> checkCrc16() -> payload
+//
+#define WHITEN_KEY_BITS 4
+#define WHITEN_KEYS (1 << WHITEN_KEY_BITS)
+
+
+uint8_t ICACHE_FLASH_ATTR whitenFrame(const uint8_t *srcBuffer, uint8_t nCount, uint8_t *dstBuffer);
+uint8_t ICACHE_FLASH_ATTR unwhitenFrame(const uint8_t *srcBuffer, uint8_t nCount, uint8_t *dstBuffer);
+
+#endif /* JUSTSLIP_INCLUDE_WHITEN_H_ */
@@ -36,6 +36,90 @@
 #include "softuart.h"
 #include "justslip.h"
 #include "crc16.h"
+#include "capture.h"
+
+// wire bytes collected before they go out as one capture record
+#define SLIP_CAPTURE_CHUNK 64
+
+//
+// capture of wire bytes streamed over UART1, see slipCaptureUart1()
+//
+// enabled - bytes are captured
+// flags / time - direction of bytes collected and when the first of them came
+//
+static struct {
+	bool enabled;
+	Capture capture;
+	uint8_t flags;
+	uint32_t time;
+	uint8_t nCount;
+	uint8_t data[SLIP_CAPTURE_CHUNK];
+} slipCapture;
+
+
+//
+// send collected wire bytes as one record over UART1
+//
+static void ICACHE_FLASH_ATTR slipCaptureFlush(void)
+{
+	uint8_t record[CAPTURE_MAX_RECORD(SLIP_CAPTURE_CHUNK) + 2];
+	uint8_t wire[SLIP_MAX_ENCODED(sizeof(record)) + 1];
+	uint16_t nCount;
+
+	if (slipCapture.nCount == 0)
+		return;
+	nCount = captureRecord(&slipCapture.capture, slipCapture.flags, slipCapture.time,
+		slipCapture.data, slipCapture.nCount, record);
+	nCount = appendCrc(CRC_16, record, nCount, sizeof(record));
+	wire[0] = SLIP_END;
+	uart1_tx_buffer(wire, 1 + slipEncodeFrame(record, nCount, wire + 1));
+	slipCapture.nCount = 0;
+}
+
+
+//
+// collect wire bytes of the link for capture
+//
+// flags - CAPTURE_TX for bytes sent, 0 for bytes received
+// *data - pointer to wire bytes
+// nCount - number of wire bytes
+//
+static void ICACHE_FLASH_ATTR slipCaptureAdd(uint8_t flags, const uint8_t *data, uint16_t nCount)
+{
+	if (!slipCapture.enabled)
+		return;
+	if (slipCapture.nCount > 0 && slipCapture.flags != flags)
+		slipCaptureFlush();
+	while (nCount > 0)
+	{
+		if (slipCapture.nCount == 0)
+		{
+			slipCapture.flags = flags;
+			slipCapture.time = system_get_time();
+		}
+		slipCapture.data[slipCapture.nCount++] = *data++;
+		nCount--;
+		if (slipCapture.nCount == SLIP_CAPTURE_CHUNK)
+			slipCaptureFlush();
+	}
+}
+
+
+//
+// stream wire bytes of the link over UART1 next to debug output,
+// record them with "slipcap record" on the host, see capture.h
+// UART1 has to be faster than the link, e.g. uart_init(..., BIT_RATE_921600)
+//
+// enable - start or stop capture
+//
+void ICACHE_FLASH_ATTR slipCaptureUart1(bool enable)
+{
+	if (!enable)
+		slipCaptureFlush();
+	else if (!slipCapture.enabled)
+		captureInit(&slipCapture.capture, system_get_time());
+	slipCapture.enabled = enable;
+}
 
 
 //
@@ -44,61 +128,30 @@
 // return number of bytes read until SLIP_END
 //
 // *softuart - pointer to software UART
-// *dataBuffer - pointer to data buffer to store received data
+// *dataBuffer - pointer to data buffer of SLIP_BUFFER_SIZE bytes to store received data
 //
 // returned value - number of bytes read to dataBuffer
 //
 uint8_t ICACHE_FLASH_ATTR slipDecodeSerial(Softuart *softuart, uint8_t *dataBuffer)
 {
-	uint8_t dataByte;
-	static uint8_t previousDataByte = 0;
-	static uint8_t nPos = 0;
+	static SlipDecoder decoder;
+	uint16_t nCount;
 
+	if (Softuart_Available(softuart))
+		slipDecoderGap(&decoder, system_get_time(), SLIP_GAP_US);
 	while (Softuart_Available(softuart))
 	{
-		dataByte = Softuart_Read(softuart);
-		if (dataByte == SLIP_END)
-		{
-			if (nPos > 0)
-			{
-				previousDataByte = 0;
-				uint8_t result = nPos;
-				nPos = 0;
-				return result;
-			}
-			else
-			{
-				os_printf("Orphan SLIP_END received!\r\n");
-				return 0;
-			}
-		}
-		else if (dataByte == SLIP_ESC)
-		{
-			previousDataByte = SLIP_ESC;
-			return 0;
-		}
-		else if (dataByte == SLIP_ESC_END && previousDataByte == SLIP_ESC)
-		{
-			previousDataByte = 0;
-			dataBuffer[nPos++] = SLIP_END;
-		}
-		else if (dataByte == SLIP_ESC_ESC && previousDataByte == SLIP_ESC)
-		{
-			previousDataByte = 0;
-			dataBuffer[nPos++] = SLIP_ESC;
-		}
-		else
-		{
-			dataBuffer[nPos++] = dataByte;
-		}
-		if (nPos == SLIP_BUFFER_SIZE - 2)
+		uint8_t dataByte = Softuart_Read(softuart);
+
+		slipCaptureAdd(0, &dataByte, 1);
+		nCount = slipDecodeByte(&decoder, dataByte, dataBuffer, SLIP_BUFFER_SIZE);
+		if (nCount > 0)
 		{
-			// purge buffer in case of overflow
-			nPos = 0;
-			previousDataByte = 0;
-			os_printf("Input buffer purged because of overflow!\r\n");
+			slipCaptureFlush();
+			return nCount;
 		}
 	}
+	slipCaptureFlush();
 	return 0;
 }
 
@@ -108,66 +161,84 @@ uint8_t ICACHE_FLASH_ATTR slipDecodeSerial(Softuart *softuart, uint8_t *dataBuff
 // decode data and store in dataBuffer
 // return number of bytes read until SLIP_END
 //
-// *dataBuffer - pointer to data buffer to store received data
+// *dataBuffer - pointer to data buffer of SLIP_BUFFER_SIZE bytes to store received data
 //
 // returned value - number of bytes read to dataBuffer
 //
 uint8_t ICACHE_FLASH_ATTR slipDecodeSerialUart0(uint8_t *dataBuffer)
 {
-	uint8_t dataByte;
-	static uint8_t previousDataByte = 0;
-	static uint8_t nPos = 0;
+	static SlipDecoder decoder;
+	uint8_t *rxData;
+	uint16_t nCount, nUsed;
 
-	int c;
-	while ((c = uart0_rx_one_char()) != -1)
+	if (uart0_rx_peek(&rxData) > 0)
+		slipDecoderGap(&decoder, system_get_time(), SLIP_GAP_US);
+	// decode straight from UART0 receive buffer, one contiguous span at a time
+	while ((nCount = uart0_rx_peek(&rxData)) > 0)
 	{
-		dataByte = (uint8_t) c;
-		if (dataByte == SLIP_END)
-		{
-			if (nPos > 0)
-			{
-				previousDataByte = 0;
-				uint8_t result = nPos;
-				nPos = 0;
-				return result;
-			}
-			else
-			{
-				os_printf("Orphan SLIP_END received!\r\n");
-				return 0;
-			}
-		}
-		else if (dataByte == SLIP_ESC)
-		{
-			previousDataByte = SLIP_ESC;
-			return 0;
-		}
-		else if (dataByte == SLIP_ESC_END && previousDataByte == SLIP_ESC)
-		{
-			previousDataByte = 0;
-			dataBuffer[nPos++] = SLIP_END;
-		}
-		else if (dataByte == SLIP_ESC_ESC && previousDataByte == SLIP_ESC)
+		nCount = slipDecodeSpan(&decoder, rxData, nCount, &nUsed, dataBuffer, SLIP_BUFFER_SIZE);
+		slipCaptureAdd(0, rxData, nUsed);
+		uart0_rx_skip(nUsed);
+		if (nCount > 0)
 		{
-			previousDataByte = 0;
-			dataBuffer[nPos++] = SLIP_ESC;
-		}
-		else
-		{
-			dataBuffer[nPos++] = dataByte;
-		}
-		if (nPos == SLIP_BUFFER_SIZE - 2)
-		{
-			// purge buffer in case of overflow
-			nPos = 0;
-			previousDataByte = 0;
-			os_printf("Input buffer purged because of overflow!\r\n");
+			slipCaptureFlush();
+			return nCount;
 		}
 	}
+	slipCaptureFlush();
 	return 0;
 }
 
 
+//
+// read SLIP encoded data from software serial port
+// and feed it to stream decoder, see slipstream.h
+// decoded payload is passed to callbacks of stream as it comes in
+//
+// *softuart - pointer to software UART
+// *stream - pointer to stream decoder set up with slipStreamInit()
+//
+void ICACHE_FLASH_ATTR slipStreamSerial(Softuart *softuart, SlipStream *stream)
+{
+	uint8_t dataByte;
+
+	if (Softuart_Available(softuart))
+		slipStreamGap(stream, system_get_time(), SLIP_GAP_US);
+	while (Softuart_Available(softuart))
+	{
+		dataByte = Softuart_Read(softuart);
+		slipCaptureAdd(0, &dataByte, 1);
+		slipStreamFeed(stream, &dataByte, 1);
+	}
+	slipCaptureFlush();
+}
+
+
+//
+// read SLIP encoded data from UART0 serial port
+// and feed it to stream decoder, see slipstream.h
+// decoded payload is passed to callbacks of stream as it comes in
+//
+// *stream - pointer to stream decoder set up with slipStreamInit()
+//
+void ICACHE_FLASH_ATTR slipStreamSerialUart0(SlipStream *stream)
+{
+	uint8_t *rxData;
+	uint16_t nCount;
+
+	if (uart0_rx_peek(&rxData) > 0)
+		slipStreamGap(stream, system_get_time(), SLIP_GAP_US);
+	// feed straight from UART0 receive buffer, one contiguous span at a time
+	while ((nCount = uart0_rx_peek(&rxData)) > 0)
+	{
+		slipCaptureAdd(0, rxData, nCount);
+		slipStreamFeed(stream, rxData, nCount);
+		uart0_rx_skip(nCount);
+	}
+	slipCaptureFlush();
+}
+
+
 //
 // SLIP encode values from dataBuffer
 // and send them over software serial port
@@ -178,22 +249,23 @@ uint8_t ICACHE_FLASH_ATTR slipDecodeSerialUart0(uint8_t *dataBuffer)
 //
 void ICACHE_FLASH_ATTR slipEncodeSerial(Softuart *softuart, uint8_t *dataBuffer, uint8_t nCount)
 {
-	int i;
+	uint8_t wireBuffer[2];
+	uint8_t i, n, nWire;
+
+	// on RS485 keep the driver on for the whole frame
+	Softuart_BeginFrame(softuart);
 	for (i = 0; i < nCount; i++)
-		switch (dataBuffer[i])
-		{
-			case SLIP_END:
-				Softuart_Putchar(softuart, (char) SLIP_ESC);
-				Softuart_Putchar(softuart, (char) SLIP_ESC_END);
-			break;
-			case SLIP_ESC:
-				Softuart_Putchar(softuart, (char) SLIP_ESC);
-				Softuart_Putchar(softuart, (char) SLIP_ESC_ESC);
-			break;
-			default:
-				Softuart_Putchar(softuart, (char) dataBuffer[i]);
-		}
+	{
+		nWire = slipEncodeByte(dataBuffer[i], wireBuffer);
+		for (n = 0; n < nWire; n++)
+			Softuart_Putchar(softuart, (char) wireBuffer[n]);
+		slipCaptureAdd(CAPTURE_TX, wireBuffer, nWire);
+	}
 	Softuart_Putchar(softuart, (char) SLIP_END);
+	Softuart_EndFrame(softuart);
+	wireBuffer[0] = SLIP_END;
+	slipCaptureAdd(CAPTURE_TX, wireBuffer, 1);
+	slipCaptureFlush();
 }
 
 
@@ -206,22 +278,113 @@ void ICACHE_FLASH_ATTR slipEncodeSerial(Softuart *softuart, uint8_t *dataBuffer,
 //
 void ICACHE_FLASH_ATTR slipEncodeSerialUart0(uint8_t *dataBuffer, uint8_t nCount)
 {
-	int i;
+	uint8_t wireBuffer[2];
+	uint8_t i, nWire;
+
 	for (i = 0; i < nCount; i++)
-		switch (dataBuffer[i])
-		{
-			case SLIP_END:
-				uart0_tx_one_char((uint8) SLIP_ESC);
-				uart0_tx_one_char((uint8) SLIP_ESC_END);
-			break;
-			case SLIP_ESC:
-				uart0_tx_one_char((uint8) SLIP_ESC);
-				uart0_tx_one_char((uint8) SLIP_ESC_ESC);
-			break;
-			default:
-				uart0_tx_one_char((uint8) dataBuffer[i]);
-		}
+	{
+		nWire = slipEncodeByte(dataBuffer[i], wireBuffer);
+		uart0_tx_buffer(wireBuffer, nWire);
+		slipCaptureAdd(CAPTURE_TX, wireBuffer, nWire);
+	}
 	uart0_tx_one_char((uint8) SLIP_END);
+	wireBuffer[0] = SLIP_END;
+	slipCaptureAdd(CAPTURE_TX, wireBuffer, 1);
+	slipCaptureFlush();
+}
+
+
+//
+// write callbacks of slipEncodeVector(), wire bytes go to the port and to capture
+//
+static void ICACHE_FLASH_ATTR slipWriteUart0(void *context, const uint8_t *wire, uint16_t nCount)
+{
+	uart0_tx_buffer((uint8 *) wire, nCount);
+	slipCaptureAdd(CAPTURE_TX, wire, nCount);
+}
+
+
+static void ICACHE_FLASH_ATTR slipWriteSoftuart(void *context, const uint8_t *wire, uint16_t nCount)
+{
+	Softuart *softuart = (Softuart *) context;
+	uint16_t i;
+
+	for (i = 0; i < nCount; i++)
+		Softuart_Putchar(softuart, (char) wire[i]);
+	slipCaptureAdd(CAPTURE_TX, wire, nCount);
+}
+
+
+//
+// SLIP encode a frame given as segments, e.g. header, payload and trailer,
+// with check value appended and send it over software serial port
+// segments are escaped straight to the port, see slipvec.h
+//
+// *softuart - pointer to software UART
+// *segments - pointer to list of segments
+// nSegments - number of segments
+// crc - check value over all segments to append, CRC_16 gives the same bytes as appendCrc16()
+//
+void ICACHE_FLASH_ATTR slipEncodeSerialv(Softuart *softuart, const SlipSegment *segments, uint8_t nSegments, CrcMode crc)
+{
+	// on RS485 keep the driver on for the whole frame
+	Softuart_BeginFrame(softuart);
+	slipEncodeVector(segments, nSegments, crc, slipWriteSoftuart, softuart);
+	Softuart_EndFrame(softuart);
+	slipCaptureFlush();
+}
+
+
+//
+// SLIP encode a frame given as segments, e.g. header, payload and trailer,
+// with check value appended and send it over UART0 serial port
+// segments are escaped straight to the port, see slipvec.h
+//
+// *segments - pointer to list of segments
+// nSegments - number of segments
+// crc - check value over all segments to append, CRC_16 gives the same bytes as appendCrc16()
+//
+void ICACHE_FLASH_ATTR slipEncodeSerialUart0v(const SlipSegment *segments, uint8_t nSegments, CrcMode crc)
+{
+	slipEncodeVector(segments, nSegments, crc, slipWriteUart0, NULL);
+	slipCaptureFlush();
+}
+
+
+//
+// send a frame encoded at compile time over software serial port, see slipwire.h
+//
+// *softuart - pointer to software UART
+// *frame - pointer to frame, e.g. in flash
+//
+void ICACHE_FLASH_ATTR slipSendWire(Softuart *softuart, const SlipWire *frame)
+{
+	uint8_t wireBuffer[SLIP_WIRE_MAX];
+	uint16_t i, nWire = slipWireCopy(frame, wireBuffer);
+
+	Softuart_BeginFrame(softuart);
+	for (i = 0; i < nWire; i++)
+		Softuart_Putchar(softuart, (char) wireBuffer[i]);
+	Softuart_EndFrame(softuart);
+	slipCaptureAdd(CAPTURE_TX, wireBuffer, nWire);
+	slipCaptureFlush();
+}
+
+
+//
+// send a frame encoded at compile time over UART0 serial port, see slipwire.h
+// wire bytes go to the TX FIFO in one go, without appendCrc16() and escaping
+//
+// *frame - pointer to frame, e.g. in flash
+//
+void ICACHE_FLASH_ATTR slipSendWireUart0(const SlipWire *frame)
+{
+	uint8_t wireBuffer[SLIP_WIRE_MAX];
+	uint16_t nWire = slipWireCopy(frame, wireBuffer);
+
+	uart0_tx_buffer(wireBuffer, nWire);
+	slipCaptureAdd(CAPTURE_TX, wireBuffer, nWire);
+	slipCaptureFlush();
 }
 
 
@@ -289,3 +452,212 @@ void ICACHE_FLASH_ATTR printBuffer(uint8_t *dataBuffer, uint8_t nCount)
 	os_printf("\r\n");
 }
 
+
+
+//
+// initialise serial link
+//
+// *link - pointer to link state
+// *softuart - pointer to software UART, NULL to use UART0
+// mode - framing used on the link, FRAMING_SLIP for compatibility with slipEncode / slipDecode
+//
+void ICACHE_FLASH_ATTR slipLinkInit(SlipLink *link, Softuart *softuart, FramingMode mode)
+{
+	link->softuart = softuart;
+	framingDecoderInit(&link->decoder, mode);
+	link->crc = CRC_NONE;
+	link->fec.nParity = 0;
+	link->nCorrected = 0;
+	pacerInit(&link->pacer, 0, 0, system_get_time());
+}
+
+
+//
+// select check of frames sent and received over the link
+// both ends of the link must use the same one
+//
+// *link - pointer to link state
+// mode - CRC_NONE to leave frames unchanged, CRC_16, or CRC_32 / CRC_32C for long frames
+//
+void ICACHE_FLASH_ATTR slipLinkCrc(SlipLink *link, CrcMode mode)
+{
+	link->crc = mode;
+}
+
+
+//
+// add Reed-Solomon parity to frames sent over the link and repair received ones
+// use together with slipLinkCrc() to catch frames with too many errors to repair
+//
+// *link - pointer to link state
+// nParity - parity bytes per frame, corrects up to nParity / 2 bytes, 0 to switch off
+//
+void ICACHE_FLASH_ATTR slipLinkFec(SlipLink *link, uint8_t nParity)
+{
+	if (nParity == 0)
+		link->fec.nParity = 0;
+	else
+		rsInit(&link->fec, nParity);
+}
+
+
+//
+// limit rate of frames sent over the link with a token bucket
+// use pacerAdapt(&link->pacer, ...) to let the rate follow reports of the peer
+//
+// *link - pointer to link state
+// rate - bytes per second on the wire, 0 to send without pacing
+// burst - bytes that may be sent in one go after the link was idle
+//
+void ICACHE_FLASH_ATTR slipLinkPace(SlipLink *link, uint32_t rate, uint16_t burst)
+{
+	pacerInit(&link->pacer, rate, burst, system_get_time());
+}
+
+
+//
+// check if the link may take the next frame now
+//
+// *link - pointer to link state
+//
+// returned value - true if slipLinkSend() may be called
+//
+bool ICACHE_FLASH_ATTR slipLinkReady(SlipLink *link)
+{
+	return pacerReady(&link->pacer, system_get_time());
+}
+
+
+//
+// repair received frame, then verify and remove its check value
+//
+// returned value - number of data bytes, 0 if frame could not be repaired or check failed
+//
+static uint8_t ICACHE_FLASH_ATTR slipLinkCheck(SlipLink *link, uint8_t *dataBuffer, uint8_t nCount)
+{
+	uint8_t nCorrected;
+
+	if (link->fec.nParity > 0)
+	{
+		nCount = rsDecode(&link->fec, dataBuffer, nCount, &nCorrected);
+		if (nCount == 0)
+		{
+			os_printf("Frame dropped - too many errors to correct!\r\n");
+			return 0;
+		}
+		link->nCorrected += nCorrected;
+	}
+	if (link->crc == CRC_NONE)
+		return nCount;
+	if (!checkCrc(link->crc, dataBuffer, nCount))
+	{
+		os_printf("Frame dropped - crc check failed!\r\n");
+		return 0;
+	}
+	return nCount - crcSize(link->crc);
+}
+
+
+//
+// read encoded data from serial link
+// decode data and store in dataBuffer
+// return number of bytes read until frame delimiter
+//
+// *link - pointer to link state
+// *dataBuffer - pointer to data buffer of SLIP_BUFFER_SIZE bytes to store received data
+//
+// returned value - number of bytes read to dataBuffer
+//
+uint8_t ICACHE_FLASH_ATTR slipLinkReceive(SlipLink *link, uint8_t *dataBuffer)
+{
+	uint8_t nCount;
+
+	if (link->softuart)
+	{
+		if (Softuart_Available(link->softuart))
+			framingDecoderGap(&link->decoder, system_get_time(), SLIP_GAP_US);
+		while (Softuart_Available(link->softuart))
+		{
+			uint8_t dataByte = Softuart_Read(link->softuart);
+
+			slipCaptureAdd(0, &dataByte, 1);
+			nCount = framingDecodeByte(&link->decoder, dataByte, dataBuffer, SLIP_BUFFER_SIZE);
+			if (nCount > 0 && (nCount = slipLinkCheck(link, dataBuffer, nCount)) > 0)
+			{
+				slipCaptureFlush();
+				return nCount;
+			}
+		}
+	}
+	else
+	{
+		uint8_t *rxData;
+		int c;
+
+		if (uart0_rx_peek(&rxData) > 0)
+			framingDecoderGap(&link->decoder, system_get_time(), SLIP_GAP_US);
+		while ((c = uart0_rx_one_char()) != -1)
+		{
+			uint8_t dataByte = (uint8_t) c;
+
+			slipCaptureAdd(0, &dataByte, 1);
+			nCount = framingDecodeByte(&link->decoder, dataByte, dataBuffer, SLIP_BUFFER_SIZE);
+			if (nCount > 0 && (nCount = slipLinkCheck(link, dataBuffer, nCount)) > 0)
+			{
+				slipCaptureFlush();
+				return nCount;
+			}
+		}
+	}
+	slipCaptureFlush();
+	return 0;
+}
+
+
+//
+// encode values from dataBuffer using framing of the link
+// and send them over serial link, check value of the link is appended
+// on a paced link check slipLinkReady() first
+//
+// *link - pointer to link state
+// *dataBuffer - pointer to data buffer to read data from
+// nCount - number of bytes to read from dataBuffer, up to SLIP_BUFFER_SIZE less check value and parity
+//
+void ICACHE_FLASH_ATTR slipLinkSend(SlipLink *link, uint8_t *dataBuffer, uint8_t nCount)
+{
+	uint8_t frameBuffer[SLIP_BUFFER_SIZE];
+	uint8_t wireBuffer[FRAMING_MAX_ENCODED(SLIP_BUFFER_SIZE)];
+	uint16_t nWire;
+
+	if (nCount + crcSize(link->crc) + link->fec.nParity > SLIP_BUFFER_SIZE)
+	{
+		os_printf("Unable to send - frame too long!\r\n");
+		return;
+	}
+	if (link->crc != CRC_NONE || link->fec.nParity > 0)
+	{
+		os_memcpy(frameBuffer, dataBuffer, nCount);
+		dataBuffer = frameBuffer;
+	}
+	if (link->crc != CRC_NONE)
+		nCount = appendCrc(link->crc, frameBuffer, nCount, SLIP_BUFFER_SIZE);
+	if (link->fec.nParity > 0)
+		nCount = rsEncode(&link->fec, frameBuffer, nCount);
+	nWire = framingEncode(link->decoder.mode, dataBuffer, nCount, wireBuffer);
+	pacerCharge(&link->pacer, nWire);
+	slipCaptureAdd(CAPTURE_TX, wireBuffer, nWire);
+	slipCaptureFlush();
+	if (link->softuart)
+	{
+		uint16_t i;
+
+		Softuart_BeginFrame(link->softuart);
+		for (i = 0; i < nWire; i++)
+			Softuart_Putchar(link->softuart, (char) wireBuffer[i]);
+		Softuart_EndFrame(link->softuart);
+	}
+	else
+	{
+		uart0_tx_buffer(wireBuffer, nWire);
+	}
+}
@@ -0,0 +1,345 @@
+/*
+* esp-just-slip - lzss.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "lzss.h"
+
+//
+// match index used by the compressor
+// positions are stored + 1 so that 0 means "no earlier occurrence"
+//
+// lzssHead - last position of each byte value
+// lzssPrev - previous position with the same byte value
+// lzssWork - dictionary followed by the frame being compressed
+//
+static uint8_t lzssHead[256];
+static uint8_t lzssPrev[LZSS_MAX_FRAME];
+static uint8_t lzssWork[LZSS_MAX_FRAME];
+
+static uint8_t lzssDictionary[LZSS_MAX_DICTIONARY];
+static uint8_t lzssDictionaryCount = 0;
+
+typedef struct {
+	uint8_t *buffer;
+	uint8_t nSize;
+	uint8_t nPos;
+	uint8_t nBits;
+	bool overflow;
+} LzssBitWriter;
+
+typedef struct {
+	const uint8_t *buffer;
+	uint16_t nBitsLeft;
+	uint8_t nPos;
+	uint8_t nBits;
+} LzssBitReader;
+
+
+//
+// append nBits of value to the output, MSB first
+// set overflow flag once the output buffer is full
+//
+static void ICACHE_FLASH_ATTR lzssPutBits(LzssBitWriter *writer, uint16_t value, uint8_t nBits)
+{
+	while (nBits-- > 0)
+	{
+		if (writer->nBits == 0)
+		{
+			if (writer->nPos == writer->nSize)
+			{
+				writer->overflow = true;
+				return;
+			}
+			writer->buffer[writer->nPos] = 0;
+		}
+		if ((value >> nBits) & 1)
+			writer->buffer[writer->nPos] |= 0x80 >> writer->nBits;
+		if (++writer->nBits == 8)
+		{
+			writer->nBits = 0;
+			writer->nPos++;
+		}
+	}
+}
+
+
+//
+// read nBits from the input, MSB first
+// caller checks nBitsLeft before reading
+//
+static uint16_t ICACHE_FLASH_ATTR lzssGetBits(LzssBitReader *reader, uint8_t nBits)
+{
+	uint16_t value = 0;
+
+	reader->nBitsLeft -= nBits;
+	while (nBits-- > 0)
+	{
+		value <<= 1;
+		if (reader->buffer[reader->nPos] & (0x80 >> reader->nBits))
+			value |= 1;
+		if (++reader->nBits == 8)
+		{
+			reader->nBits = 0;
+			reader->nPos++;
+		}
+	}
+	return value;
+}
+
+
+//
+// set preset dictionary used by compressFrame() and decompressFrame()
+// both ends of the link have to use the same dictionary
+// the most useful data (e.g. sample telemetry) should be placed at the end
+//
+// *dictionary - pointer to dictionary, copied into internal buffer
+// nCount - number of bytes in dictionary, 0 to remove it, last LZSS_MAX_DICTIONARY bytes are used
+//
+void ICACHE_FLASH_ATTR lzssSetDictionary(const uint8_t *dictionary, uint8_t nCount)
+{
+	if (nCount > LZSS_MAX_DICTIONARY)
+	{
+		dictionary += nCount - LZSS_MAX_DICTIONARY;
+		nCount = LZSS_MAX_DICTIONARY;
+	}
+	os_memcpy(lzssDictionary, dictionary, nCount);
+	lzssDictionaryCount = nCount;
+}
+
+
+//
+// add position i of lzssWork to the match index
+//
+static void ICACHE_FLASH_ATTR lzssIndex(uint8_t i)
+{
+	lzssPrev[i] = lzssHead[lzssWork[i]];
+	lzssHead[lzssWork[i]] = i + 1;
+}
+
+
+//
+// compress data from srcBuffer into dstBuffer
+// the first byte of dstBuffer is a flag telling how the payload is coded
+// frames that do not get shorter are copied with COMPRESS_FLAG_RAW
+//
+// *srcBuffer - pointer to data buffer to compress
+// nCount - number of bytes in srcBuffer, up to LZSS_MAX_FRAME
+// *dstBuffer - pointer to data buffer to store result, at least nCount + 1 bytes
+//
+// returned value - number of bytes in dstBuffer including flag, 0 on error
+//
+uint8_t ICACHE_FLASH_ATTR compressFrame(const uint8_t *srcBuffer, uint8_t nCount, uint8_t *dstBuffer)
+{
+	LzssBitWriter writer;
+	uint8_t nDictionary = 0;
+	uint8_t nEnd;
+	uint8_t i;
+
+	if (nCount > LZSS_MAX_FRAME)
+	{
+		os_printf("Unable to compress - frame too long!\r\n");
+		return 0;
+	}
+
+	if (lzssDictionaryCount > 0 && lzssDictionaryCount + nCount <= LZSS_MAX_FRAME)
+		nDictionary = lzssDictionaryCount;
+	os_memcpy(lzssWork, lzssDictionary, nDictionary);
+	os_memcpy(lzssWork + nDictionary, srcBuffer, nCount);
+	nEnd = nDictionary + nCount;
+
+	// compressed payload must be shorter than the raw one
+	writer.buffer = dstBuffer + 1;
+	writer.nSize = (nCount > 0) ? nCount - 1 : 0;
+	writer.nPos = 0;
+	writer.nBits = 0;
+	writer.overflow = false;
+
+	os_memset(lzssHead, 0, sizeof(lzssHead));
+	for (i = 0; i < nDictionary; i++)
+		lzssIndex(i);
+
+	while (i < nEnd && !writer.overflow)
+	{
+		uint8_t bestLength = 0;
+		uint8_t bestDistance = 0;
+		uint8_t nAdvance;
+
+		if (nEnd - i >= LZSS_MIN_MATCH)
+		{
+			uint8_t maxLength = (nEnd - i > LZSS_MAX_MATCH) ? LZSS_MAX_MATCH : nEnd - i;
+			uint8_t candidate = lzssHead[lzssWork[i]];
+			uint8_t nChain = LZSS_MAX_CHAIN;
+
+			while (candidate != 0 && nChain-- > 0)
+			{
+				uint8_t j = candidate - 1;
+				uint8_t length = 1;
+
+				while (length < maxLength && lzssWork[j + length] == lzssWork[i + length])
+					length++;
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestDistance = i - j;
+					if (length == maxLength)
+						break;
+				}
+				candidate = lzssPrev[j];
+			}
+		}
+
+		if (bestLength >= LZSS_MIN_MATCH)
+		{
+			lzssPutBits(&writer, 0, 1);
+			lzssPutBits(&writer, bestDistance - 1, LZSS_WINDOW_BITS);
+			lzssPutBits(&writer, bestLength - LZSS_MIN_MATCH, LZSS_LENGTH_BITS);
+			nAdvance = bestLength;
+		}
+		else
+		{
+			lzssPutBits(&writer, 1, 1);
+			lzssPutBits(&writer, lzssWork[i], 8);
+			nAdvance = 1;
+		}
+
+		// index every position covered by this token
+		while (nAdvance-- > 0)
+			lzssIndex(i++);
+	}
+
+	if (writer.overflow || nCount == 0)
+	{
+		dstBuffer[0] = COMPRESS_FLAG_RAW;
+		os_memcpy(dstBuffer + 1, srcBuffer, nCount);
+		return nCount + 1;
+	}
+	dstBuffer[0] = (nDictionary > 0) ? COMPRESS_FLAG_LZSS_DICT : COMPRESS_FLAG_LZSS;
+	return 1 + writer.nPos + ((writer.nBits > 0) ? 1 : 0);
+}
+
+
+//
+// decompress frame prepared by compressFrame()
+//
+// *srcBuffer - pointer to data buffer with flag byte and payload
+// nCount - number of bytes in srcBuffer
+// *dstBuffer - pointer to data buffer to store decompressed data
+// nSize - size of dstBuffer
+//
+// returned value - number of bytes in dstBuffer, 0 if frame is corrupt or does not fit
+//
+uint8_t ICACHE_FLASH_ATTR decompressFrame(const uint8_t *srcBuffer, uint8_t nCount, uint8_t *dstBuffer, uint8_t nSize)
+{
+	LzssBitReader reader;
+	uint8_t nDictionary = 0;
+	uint8_t nPos = 0;
+	bool corrupt = false;
+
+	if (nCount == 0)
+		return 0;
+
+	if (srcBuffer[0] == COMPRESS_FLAG_RAW)
+	{
+		if (nCount - 1 > nSize)
+		{
+			os_printf("Unable to decompress - buffer too small!\r\n");
+			return 0;
+		}
+		os_memcpy(dstBuffer, srcBuffer + 1, nCount - 1);
+		return nCount - 1;
+	}
+	if (srcBuffer[0] == COMPRESS_FLAG_LZSS_DICT)
+	{
+		if (lzssDictionaryCount == 0)
+		{
+			os_printf("Unable to decompress - dictionary not set!\r\n");
+			return 0;
+		}
+		nDictionary = lzssDictionaryCount;
+	}
+	else if (srcBuffer[0] != COMPRESS_FLAG_LZSS)
+	{
+		os_printf("Unable to decompress - unknown flag %x!\r\n", srcBuffer[0]);
+		return 0;
+	}
+
+	reader.buffer = srcBuffer + 1;
+	reader.nBitsLeft = (uint16_t) (nCount - 1) * 8;
+	reader.nPos = 0;
+	reader.nBits = 0;
+
+	// anything shorter than a literal is padding
+	while (reader.nBitsLeft >= 1 + 8)
+	{
+		if (lzssGetBits(&reader, 1))
+		{
+			if (nPos == nSize)
+			{
+				corrupt = true;
+				break;
+			}
+			dstBuffer[nPos++] = (uint8_t) lzssGetBits(&reader, 8);
+		}
+		else
+		{
+			uint16_t distance;
+			uint8_t length;
+
+			if (reader.nBitsLeft < LZSS_WINDOW_BITS + LZSS_LENGTH_BITS)
+			{
+				corrupt = true;
+				break;
+			}
+			distance = lzssGetBits(&reader, LZSS_WINDOW_BITS) + 1;
+			length = lzssGetBits(&reader, LZSS_LENGTH_BITS) + LZSS_MIN_MATCH;
+			if (distance > nPos + nDictionary || length > nSize - nPos)
+			{
+				corrupt = true;
+				break;
+			}
+			// byte by byte, source and destination may overlap
+			// distances beyond the start of the frame point into the dictionary
+			while (length-- > 0)
+			{
+				if (distance > nPos)
+					dstBuffer[nPos] = lzssDictionary[nDictionary + nPos - distance];
+				else
+					dstBuffer[nPos] = dstBuffer[nPos - distance];
+				nPos++;
+			}
+		}
+	}
+	if (corrupt)
+	{
+		os_printf("Unable to decompress - frame corrupt!\r\n");
+		return 0;
+	}
+	return nPos;
+}
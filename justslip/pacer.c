@@ -0,0 +1,223 @@
+/*
+* esp-just-slip - pacer.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pacer.h"
+
+// tokens are kept in 1/256 of a byte
+#define PACER_SCALE 256
+
+static const uint8_t pacerReportMagic[PACER_REPORT_MAGIC_SIZE] = { PACER_REPORT_MAGIC };
+
+
+//
+// set up pacer with full bucket
+//
+// *pacer - pointer to pacer state
+// rate - bytes per second, 0 to send without pacing
+// burst - size of bucket [bytes], at least one frame
+// now - current time [us], e.g. system_get_time()
+//
+void ICACHE_FLASH_ATTR pacerInit(Pacer *pacer, uint32_t rate, uint16_t burst, uint32_t now)
+{
+	os_memset(pacer, 0, sizeof(Pacer));
+	pacer->rate = rate;
+	pacer->burst = burst;
+	pacer->tokens = (int32_t) burst * PACER_SCALE;
+	pacer->time = now;
+}
+
+
+//
+// let rate follow reports of the receiver, see pacerFeedback()
+//
+// *pacer - pointer to pacer state
+// minRate / maxRate - range of rate [bytes per second], maxRate 0 to keep rate fixed
+//
+void ICACHE_FLASH_ATTR pacerAdapt(Pacer *pacer, uint32_t minRate, uint32_t maxRate)
+{
+	pacer->minRate = minRate;
+	pacer->maxRate = maxRate;
+}
+
+
+//
+// fill bucket for the time passed since last call
+//
+static void ICACHE_FLASH_ATTR pacerFill(Pacer *pacer, uint32_t now)
+{
+	uint32_t elapsed = now - pacer->time;
+	int32_t full = (int32_t) pacer->burst * PACER_SCALE;
+	uint64_t added;
+
+	pacer->time = now;
+	// fits 64 bits for any rate below 16 MB/s
+	added = (uint64_t) pacer->rate * PACER_SCALE * elapsed / 1000000;
+	if (added >= (uint64_t) (full - pacer->tokens))
+		pacer->tokens = full;
+	else
+		pacer->tokens += (int32_t) added;
+}
+
+
+//
+// check if the next frame may be sent now
+//
+// *pacer - pointer to pacer state
+// now - current time [us]
+//
+// returned value - true if bucket is not empty or link is not paced
+//
+bool ICACHE_FLASH_ATTR pacerReady(Pacer *pacer, uint32_t now)
+{
+	if (pacer->rate == 0)
+		return true;
+	pacerFill(pacer, now);
+	if (pacer->tokens >= 0)
+		return true;
+	pacer->stats.nHeld++;
+	return false;
+}
+
+
+//
+// take wire bytes of a frame just sent out of bucket
+//
+// *pacer - pointer to pacer state
+// nBytes - number of bytes sent, delimiters and escapes included
+//
+void ICACHE_FLASH_ATTR pacerCharge(Pacer *pacer, uint16_t nBytes)
+{
+	pacer->stats.nFrames++;
+	pacer->stats.nBytes += nBytes;
+	if (pacer->rate > 0)
+		pacer->tokens -= (int32_t) nBytes * PACER_SCALE;
+}
+
+
+//
+// adjust rate to counters reported by the receiver
+// additive increase / multiplicative decrease, only in adaptive mode
+//
+// *pacer - pointer to pacer state
+// nLost - frames lost so far, as counted by receiver
+// nOverflow - bytes dropped so far because receiver input buffer was full
+//
+void ICACHE_FLASH_ATTR pacerFeedback(Pacer *pacer, uint32_t nLost, uint32_t nOverflow)
+{
+	bool loss = (nLost != pacer->nLost) || (nOverflow != pacer->nOverflow);
+	uint32_t step;
+
+	pacer->nLost = nLost;
+	pacer->nOverflow = nOverflow;
+	if (pacer->maxRate == 0 || pacer->rate == 0)
+		return;
+
+	if (loss)
+	{
+		pacer->rate -= pacer->rate / 4;
+		if (pacer->rate < pacer->minRate)
+			pacer->rate = pacer->minRate;
+		pacer->stats.nSlower++;
+	}
+	else if (pacer->rate < pacer->maxRate)
+	{
+		step = pacer->rate / 16;
+		pacer->rate += (step > 0) ? step : 1;
+		if (pacer->rate > pacer->maxRate)
+			pacer->rate = pacer->maxRate;
+		pacer->stats.nFaster++;
+	}
+}
+
+
+static void ICACHE_FLASH_ATTR pacerPut32(uint8_t *dataBuffer, uint32_t value)
+{
+	dataBuffer[0] = (uint8_t) value;
+	dataBuffer[1] = (uint8_t) (value >> 8);
+	dataBuffer[2] = (uint8_t) (value >> 16);
+	dataBuffer[3] = (uint8_t) (value >> 24);
+}
+
+
+static uint32_t ICACHE_FLASH_ATTR pacerGet32(const uint8_t *dataBuffer)
+{
+	return dataBuffer[0] | (dataBuffer[1] << 8) | ((uint32_t) dataBuffer[2] << 16) | ((uint32_t) dataBuffer[3] << 24);
+}
+
+
+//
+// prepare report of receiver counters to be sent back to the peer
+//
+// *dataBuffer - pointer to data buffer of at least PACER_REPORT_SIZE bytes, plus 2 for crc16
+// nLost - frames lost so far
+// nOverflow - bytes dropped so far on input buffer overflow, e.g. Softuart buffer_overflow events
+//
+// returned value - number of bytes stored in dataBuffer
+//
+uint8_t ICACHE_FLASH_ATTR pacerMakeReport(uint8_t *dataBuffer, uint32_t nLost, uint32_t nOverflow)
+{
+	os_memcpy(dataBuffer, pacerReportMagic, PACER_REPORT_MAGIC_SIZE);
+	pacerPut32(dataBuffer + PACER_REPORT_MAGIC_SIZE, nLost);
+	pacerPut32(dataBuffer + PACER_REPORT_MAGIC_SIZE + 4, nOverflow);
+	return PACER_REPORT_SIZE;
+}
+
+
+//
+// take report of the peer out of received frames
+//
+// *pacer - pointer to pacer state
+// *dataBuffer - pointer to received frame, crc16 already checked and removed
+// nCount - number of bytes of frame
+//
+// returned value - true if frame was a report, it is not for the application then
+//
+bool ICACHE_FLASH_ATTR pacerReport(Pacer *pacer, const uint8_t *dataBuffer, uint8_t nCount)
+{
+	if (nCount != PACER_REPORT_SIZE || os_memcmp(dataBuffer, pacerReportMagic, PACER_REPORT_MAGIC_SIZE) != 0)
+		return false;
+	pacerFeedback(pacer, pacerGet32(dataBuffer + PACER_REPORT_MAGIC_SIZE),
+		pacerGet32(dataBuffer + PACER_REPORT_MAGIC_SIZE + 4));
+	return true;
+}
+
+
+//
+// print counters of pacer for diagnostic purposes
+//
+void ICACHE_FLASH_ATTR pacerPrintStats(Pacer *pacer)
+{
+	PacerStats *stats = &pacer->stats;
+
+	os_printf("pacer: rate %u B/s burst %u sent %u frames %u bytes held %u slower %u faster %u\r\n",
+		(unsigned) pacer->rate, (unsigned) pacer->burst, (unsigned) stats->nFrames, (unsigned) stats->nBytes,
+		(unsigned) stats->nHeld, (unsigned) stats->nSlower, (unsigned) stats->nFaster);
+}
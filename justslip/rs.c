@@ -0,0 +1,286 @@
+/*
+* esp-just-slip - rs.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "rs.h"
+
+// GF(256) with primitive polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11D)
+// rsExp is doubled so that sum of two logarithms needs no modulo
+static const uint8_t rsExp[2 * 255] =
+{
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1D, 0x3A, 0x74, 0xE8, 0xCD, 0x87, 0x13, 0x26,
+	0x4C, 0x98, 0x2D, 0x5A, 0xB4, 0x75, 0xEA, 0xC9, 0x8F, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xC0,
+	0x9D, 0x27, 0x4E, 0x9C, 0x25, 0x4A, 0x94, 0x35, 0x6A, 0xD4, 0xB5, 0x77, 0xEE, 0xC1, 0x9F, 0x23,
+	0x46, 0x8C, 0x05, 0x0A, 0x14, 0x28, 0x50, 0xA0, 0x5D, 0xBA, 0x69, 0xD2, 0xB9, 0x6F, 0xDE, 0xA1,
+	0x5F, 0xBE, 0x61, 0xC2, 0x99, 0x2F, 0x5E, 0xBC, 0x65, 0xCA, 0x89, 0x0F, 0x1E, 0x3C, 0x78, 0xF0,
+	0xFD, 0xE7, 0xD3, 0xBB, 0x6B, 0xD6, 0xB1, 0x7F, 0xFE, 0xE1, 0xDF, 0xA3, 0x5B, 0xB6, 0x71, 0xE2,
+	0xD9, 0xAF, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0D, 0x1A, 0x34, 0x68, 0xD0, 0xBD, 0x67, 0xCE,
+	0x81, 0x1F, 0x3E, 0x7C, 0xF8, 0xED, 0xC7, 0x93, 0x3B, 0x76, 0xEC, 0xC5, 0x97, 0x33, 0x66, 0xCC,
+	0x85, 0x17, 0x2E, 0x5C, 0xB8, 0x6D, 0xDA, 0xA9, 0x4F, 0x9E, 0x21, 0x42, 0x84, 0x15, 0x2A, 0x54,
+	0xA8, 0x4D, 0x9A, 0x29, 0x52, 0xA4, 0x55, 0xAA, 0x49, 0x92, 0x39, 0x72, 0xE4, 0xD5, 0xB7, 0x73,
+	0xE6, 0xD1, 0xBF, 0x63, 0xC6, 0x91, 0x3F, 0x7E, 0xFC, 0xE5, 0xD7, 0xB3, 0x7B, 0xF6, 0xF1, 0xFF,
+	0xE3, 0xDB, 0xAB, 0x4B, 0x96, 0x31, 0x62, 0xC4, 0x95, 0x37, 0x6E, 0xDC, 0xA5, 0x57, 0xAE, 0x41,
+	0x82, 0x19, 0x32, 0x64, 0xC8, 0x8D, 0x07, 0x0E, 0x1C, 0x38, 0x70, 0xE0, 0xDD, 0xA7, 0x53, 0xA6,
+	0x51, 0xA2, 0x59, 0xB2, 0x79, 0xF2, 0xF9, 0xEF, 0xC3, 0x9B, 0x2B, 0x56, 0xAC, 0x45, 0x8A, 0x09,
+	0x12, 0x24, 0x48, 0x90, 0x3D, 0x7A, 0xF4, 0xF5, 0xF7, 0xF3, 0xFB, 0xEB, 0xCB, 0x8B, 0x0B, 0x16,
+	0x2C, 0x58, 0xB0, 0x7D, 0xFA, 0xE9, 0xCF, 0x83, 0x1B, 0x36, 0x6C, 0xD8, 0xAD, 0x47, 0x8E, 0x01,
+	0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1D, 0x3A, 0x74, 0xE8, 0xCD, 0x87, 0x13, 0x26, 0x4C,
+	0x98, 0x2D, 0x5A, 0xB4, 0x75, 0xEA, 0xC9, 0x8F, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xC0, 0x9D,
+	0x27, 0x4E, 0x9C, 0x25, 0x4A, 0x94, 0x35, 0x6A, 0xD4, 0xB5, 0x77, 0xEE, 0xC1, 0x9F, 0x23, 0x46,
+	0x8C, 0x05, 0x0A, 0x14, 0x28, 0x50, 0xA0, 0x5D, 0xBA, 0x69, 0xD2, 0xB9, 0x6F, 0xDE, 0xA1, 0x5F,
+	0xBE, 0x61, 0xC2, 0x99, 0x2F, 0x5E, 0xBC, 0x65, 0xCA, 0x89, 0x0F, 0x1E, 0x3C, 0x78, 0xF0, 0xFD,
+	0xE7, 0xD3, 0xBB, 0x6B, 0xD6, 0xB1, 0x7F, 0xFE, 0xE1, 0xDF, 0xA3, 0x5B, 0xB6, 0x71, 0xE2, 0xD9,
+	0xAF, 0x43, 0x86, 0x11, 0x22, 0x44, 0x88, 0x0D, 0x1A, 0x34, 0x68, 0xD0, 0xBD, 0x67, 0xCE, 0x81,
+	0x1F, 0x3E, 0x7C, 0xF8, 0xED, 0xC7, 0x93, 0x3B, 0x76, 0xEC, 0xC5, 0x97, 0x33, 0x66, 0xCC, 0x85,
+	0x17, 0x2E, 0x5C, 0xB8, 0x6D, 0xDA, 0xA9, 0x4F, 0x9E, 0x21, 0x42, 0x84, 0x15, 0x2A, 0x54, 0xA8,
+	0x4D, 0x9A, 0x29, 0x52, 0xA4, 0x55, 0xAA, 0x49, 0x92, 0x39, 0x72, 0xE4, 0xD5, 0xB7, 0x73, 0xE6,
+	0xD1, 0xBF, 0x63, 0xC6, 0x91, 0x3F, 0x7E, 0xFC, 0xE5, 0xD7, 0xB3, 0x7B, 0xF6, 0xF1, 0xFF, 0xE3,
+	0xDB, 0xAB, 0x4B, 0x96, 0x31, 0x62, 0xC4, 0x95, 0x37, 0x6E, 0xDC, 0xA5, 0x57, 0xAE, 0x41, 0x82,
+	0x19, 0x32, 0x64, 0xC8, 0x8D, 0x07, 0x0E, 0x1C, 0x38, 0x70, 0xE0, 0xDD, 0xA7, 0x53, 0xA6, 0x51,
+	0xA2, 0x59, 0xB2, 0x79, 0xF2, 0xF9, 0xEF, 0xC3, 0x9B, 0x2B, 0x56, 0xAC, 0x45, 0x8A, 0x09, 0x12,
+	0x24, 0x48, 0x90, 0x3D, 0x7A, 0xF4, 0xF5, 0xF7, 0xF3, 0xFB, 0xEB, 0xCB, 0x8B, 0x0B, 0x16, 0x2C,
+	0x58, 0xB0, 0x7D, 0xFA, 0xE9, 0xCF, 0x83, 0x1B, 0x36, 0x6C, 0xD8, 0xAD, 0x47, 0x8E
+};
+
+static const uint8_t rsLog[256] =
+{
+	0x00, 0x00, 0x01, 0x19, 0x02, 0x32, 0x1A, 0xC6, 0x03, 0xDF, 0x33, 0xEE, 0x1B, 0x68, 0xC7, 0x4B,
+	0x04, 0x64, 0xE0, 0x0E, 0x34, 0x8D, 0xEF, 0x81, 0x1C, 0xC1, 0x69, 0xF8, 0xC8, 0x08, 0x4C, 0x71,
+	0x05, 0x8A, 0x65, 0x2F, 0xE1, 0x24, 0x0F, 0x21, 0x35, 0x93, 0x8E, 0xDA, 0xF0, 0x12, 0x82, 0x45,
+	0x1D, 0xB5, 0xC2, 0x7D, 0x6A, 0x27, 0xF9, 0xB9, 0xC9, 0x9A, 0x09, 0x78, 0x4D, 0xE4, 0x72, 0xA6,
+	0x06, 0xBF, 0x8B, 0x62, 0x66, 0xDD, 0x30, 0xFD, 0xE2, 0x98, 0x25, 0xB3, 0x10, 0x91, 0x22, 0x88,
+	0x36, 0xD0, 0x94, 0xCE, 0x8F, 0x96, 0xDB, 0xBD, 0xF1, 0xD2, 0x13, 0x5C, 0x83, 0x38, 0x46, 0x40,
+	0x1E, 0x42, 0xB6, 0xA3, 0xC3, 0x48, 0x7E, 0x6E, 0x6B, 0x3A, 0x28, 0x54, 0xFA, 0x85, 0xBA, 0x3D,
+	0xCA, 0x5E, 0x9B, 0x9F, 0x0A, 0x15, 0x79, 0x2B, 0x4E, 0xD4, 0xE5, 0xAC, 0x73, 0xF3, 0xA7, 0x57,
+	0x07, 0x70, 0xC0, 0xF7, 0x8C, 0x80, 0x63, 0x0D, 0x67, 0x4A, 0xDE, 0xED, 0x31, 0xC5, 0xFE, 0x18,
+	0xE3, 0xA5, 0x99, 0x77, 0x26, 0xB8, 0xB4, 0x7C, 0x11, 0x44, 0x92, 0xD9, 0x23, 0x20, 0x89, 0x2E,
+	0x37, 0x3F, 0xD1, 0x5B, 0x95, 0xBC, 0xCF, 0xCD, 0x90, 0x87, 0x97, 0xB2, 0xDC, 0xFC, 0xBE, 0x61,
+	0xF2, 0x56, 0xD3, 0xAB, 0x14, 0x2A, 0x5D, 0x9E, 0x84, 0x3C, 0x39, 0x53, 0x47, 0x6D, 0x41, 0xA2,
+	0x1F, 0x2D, 0x43, 0xD8, 0xB7, 0x7B, 0xA4, 0x76, 0xC4, 0x17, 0x49, 0xEC, 0x7F, 0x0C, 0x6F, 0xF6,
+	0x6C, 0xA1, 0x3B, 0x52, 0x29, 0x9D, 0x55, 0xAA, 0xFB, 0x60, 0x86, 0xB1, 0xBB, 0xCC, 0x3E, 0x5A,
+	0xCB, 0x59, 0x5F, 0xB0, 0x9C, 0xA9, 0xA0, 0x51, 0x0B, 0xF5, 0x16, 0xEB, 0x7A, 0x75, 0x2C, 0xD7,
+	0x4F, 0xAE, 0xD5, 0xE9, 0xE6, 0xE7, 0xAD, 0xE8, 0x74, 0xD6, 0xF4, 0xEA, 0xA8, 0x50, 0x58, 0xAF
+};
+
+
+static inline uint8_t rsMul(uint8_t a, uint8_t b)
+{
+	if (a == 0 || b == 0)
+		return 0;
+	return rsExp[rsLog[a] + rsLog[b]];
+}
+
+
+static inline uint8_t rsDiv(uint8_t a, uint8_t b)
+{
+	if (a == 0)
+		return 0;
+	return rsExp[rsLog[a] + 255 - rsLog[b]];
+}
+
+
+//
+// prepare codec for given number of parity bytes
+// generator polynomial is (x - a^0)(x - a^1) ... (x - a^(nParity - 1))
+//
+// *codec - pointer to codec
+// nParity - parity bytes per frame, rounded down to even and limited to 2 .. RS_MAX_PARITY
+//
+void ICACHE_FLASH_ATTR rsInit(RsCodec *codec, uint8_t nParity)
+{
+	uint8_t i, j;
+
+	nParity &= ~1;
+	if (nParity < 2)
+		nParity = 2;
+	if (nParity > RS_MAX_PARITY)
+		nParity = RS_MAX_PARITY;
+	codec->nParity = nParity;
+
+	os_memset(codec->generator, 0, sizeof(codec->generator));
+	codec->generator[0] = 1;
+	for (i = 0; i < nParity; i++)
+	{
+		// multiply by (x + a^i), coefficients from the highest power
+		for (j = i + 1; j > 0; j--)
+			codec->generator[j] ^= rsMul(codec->generator[j - 1], rsExp[i]);
+	}
+}
+
+
+//
+// calculate and append parity to dataBuffer
+// dataBuffer must have room for nParity more bytes
+//
+// *codec - pointer to codec
+// *dataBuffer - pointer to data buffer to calculate and append parity
+// nCount - number of data bytes in dataBuffer
+//
+// returned value - number of bytes in data buffer including parity, 0 if frame is too long
+//
+uint8_t ICACHE_FLASH_ATTR rsEncode(const RsCodec *codec, uint8_t *dataBuffer, uint8_t nCount)
+{
+	uint8_t *parity = dataBuffer + nCount;
+	uint8_t i, j, feedback;
+
+	if (nCount + codec->nParity > RS_MAX_LENGTH)
+	{
+		os_printf("Unable to add parity - frame too long!\r\n");
+		return 0;
+	}
+	os_memset(parity, 0, codec->nParity);
+	// remainder of data * x^nParity divided by generator
+	for (i = 0; i < nCount; i++)
+	{
+		feedback = dataBuffer[i] ^ parity[0];
+		os_memmove(parity, parity + 1, codec->nParity - 1);
+		parity[codec->nParity - 1] = 0;
+		if (feedback != 0)
+			for (j = 0; j < codec->nParity; j++)
+				parity[j] ^= rsMul(codec->generator[j + 1], feedback);
+	}
+	return nCount + codec->nParity;
+}
+
+
+//
+// correct errors in place and strip parity
+//
+// *codec - pointer to codec
+// *dataBuffer - pointer to data buffer with received frame including parity
+// nCount - number of bytes in dataBuffer including parity
+// *nCorrected - number of bytes corrected, may be NULL
+//
+// returned value - number of data bytes, 0 if there are more errors than the code corrects
+//
+uint8_t ICACHE_FLASH_ATTR rsDecode(const RsCodec *codec, uint8_t *dataBuffer, uint8_t nCount, uint8_t *nCorrected)
+{
+	uint8_t syndrome[RS_MAX_PARITY];
+	uint8_t locator[RS_MAX_PARITY + 1], previous[RS_MAX_PARITY + 1], temp[RS_MAX_PARITY + 1];
+	uint8_t evaluator[RS_MAX_PARITY];
+	uint8_t nParity = codec->nParity;
+	uint8_t i, j, nLocator = 0, nShift = 1, nFound = 0;
+	uint8_t discrepancy, lastDiscrepancy = 1, factor;
+	bool clean = true;
+
+	if (nCorrected)
+		*nCorrected = 0;
+	if (nCount <= nParity)
+		return 0;
+
+	// syndromes - received frame evaluated at roots of generator
+	for (i = 0; i < nParity; i++)
+	{
+		uint8_t s = 0;
+		for (j = 0; j < nCount; j++)
+			s = (s ? rsExp[rsLog[s] + i] : 0) ^ dataBuffer[j];
+		syndrome[i] = s;
+		if (s != 0)
+			clean = false;
+	}
+	if (clean)
+		return nCount - nParity;
+
+	// Berlekamp-Massey, locator coefficients from the lowest power
+	os_memset(locator, 0, sizeof(locator));
+	os_memset(previous, 0, sizeof(previous));
+	locator[0] = previous[0] = 1;
+	for (i = 0; i < nParity; i++)
+	{
+		discrepancy = syndrome[i];
+		for (j = 1; j <= nLocator; j++)
+			discrepancy ^= rsMul(locator[j], syndrome[i - j]);
+		if (discrepancy == 0)
+		{
+			nShift++;
+			continue;
+		}
+		factor = rsDiv(discrepancy, lastDiscrepancy);
+		os_memcpy(temp, locator, sizeof(locator));
+		for (j = 0; j + nShift <= nParity; j++)
+			locator[j + nShift] ^= rsMul(factor, previous[j]);
+		if (2 * nLocator <= i)
+		{
+			nLocator = i + 1 - nLocator;
+			os_memcpy(previous, temp, sizeof(previous));
+			lastDiscrepancy = discrepancy;
+			nShift = 1;
+		}
+		else
+			nShift++;
+	}
+	if (2 * nLocator > nParity)
+		return 0;
+
+	// evaluator = syndrome * locator mod x^nParity
+	for (i = 0; i < nParity; i++)
+	{
+		evaluator[i] = 0;
+		for (j = 0; j <= i && j <= nLocator; j++)
+			evaluator[i] ^= rsMul(locator[j], syndrome[i - j]);
+	}
+
+	// Chien search for error positions, Forney for error values
+	for (j = 0; j < nCount; j++)
+	{
+		// byte j stands at power nCount - 1 - j, test locator at its inverse
+		uint8_t power = nCount - 1 - j;
+		uint8_t inverse = rsExp[(255 - power) % 255];
+		uint8_t x = 1, value = 0, omega = 0, derivative = 0;
+
+		for (i = 0; i <= nLocator; i++)
+		{
+			value ^= rsMul(locator[i], x);
+			if (i & 1)
+				derivative ^= rsMul(locator[i], rsMul(x, rsExp[power]));
+			x = rsMul(x, inverse);
+		}
+		if (value != 0)
+			continue;
+
+		x = 1;
+		for (i = 0; i < nParity; i++)
+		{
+			omega ^= rsMul(evaluator[i], x);
+			x = rsMul(x, inverse);
+		}
+		if (derivative == 0)
+			return 0;
+		// error value X * omega(X^-1) / locator'(X^-1)
+		dataBuffer[j] ^= rsMul(rsExp[power], rsDiv(omega, derivative));
+		nFound++;
+	}
+	if (nFound != nLocator)
+		return 0;
+
+	if (nCorrected)
+		*nCorrected = nFound;
+	return nCount - nParity;
+}
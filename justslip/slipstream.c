@@ -0,0 +1,206 @@
+/*
+* esp-just-slip - slipstream.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "slipstream.h"
+#include "slipcodec.h"
+
+
+//
+// set up stream decoder, no frame in progress
+//
+// *stream - pointer to stream decoder
+// crc - check value appended by the sender to each frame, CRC_NONE if none
+// begin - called when a frame starts, may be NULL
+// data - called with each chunk of decoded payload
+// end - called when a frame completes or is dropped, may be NULL
+// *context - passed to callbacks, e.g. state of flash writer
+//
+void ICACHE_FLASH_ATTR slipStreamInit(SlipStream *stream, CrcMode crc, SlipStreamBegin begin,
+	SlipStreamData data, SlipStreamEnd end, void *context)
+{
+	os_memset(stream, 0, sizeof(SlipStream));
+	stream->crc = crc;
+	stream->begin = begin;
+	stream->data = data;
+	stream->end = end;
+	stream->context = context;
+}
+
+
+//
+// pass decoded bytes on to data(), except the last ones that may be check value
+//
+static void ICACHE_FLASH_ATTR slipStreamFlush(SlipStream *stream)
+{
+	uint8_t nCrc = crcSize(stream->crc);
+	uint8_t nReady;
+
+	if (stream->nChunk <= nCrc)
+		return;
+	nReady = stream->nChunk - nCrc;
+	stream->acc = crcUpdate(stream->crc, stream->acc, stream->chunk, nReady);
+	stream->nTotal += nReady;
+	stream->data(stream->context, stream->chunk, nReady);
+	os_memmove(stream->chunk, stream->chunk + nReady, nCrc);
+	stream->nChunk = nCrc;
+}
+
+
+//
+// report end of frame in progress and get ready for the next one
+//
+static void ICACHE_FLASH_ATTR slipStreamFinish(SlipStream *stream, SlipStreamStatus status)
+{
+	if (stream->end)
+		stream->end(stream->context, status, stream->nTotal);
+	stream->inFrame = false;
+	stream->escape = false;
+	stream->nChunk = 0;
+}
+
+
+//
+// SLIP_END received - deliver the rest of frame and verify check value
+//
+static void ICACHE_FLASH_ATTR slipStreamEnd(SlipStream *stream)
+{
+	uint8_t i, nCrc = crcSize(stream->crc);
+	uint32_t crc = 0;
+
+	if (stream->discard || !stream->inFrame)
+	{
+		// dropped frame was already reported, empty frame is nothing to report
+		stream->discard = false;
+		stream->escape = false;
+		return;
+	}
+	// SLIP_ESC SLIP_END is not valid
+	if (stream->escape)
+	{
+		slipStreamFinish(stream, SLIP_STREAM_MALFORMED);
+		return;
+	}
+	if (stream->nChunk < nCrc)
+	{
+		slipStreamFinish(stream, SLIP_STREAM_BAD_CRC);
+		return;
+	}
+	slipStreamFlush(stream);
+	for (i = 0; i < nCrc; i++)
+		crc = (crc << 8) | stream->chunk[i];
+	slipStreamFinish(stream, crc == stream->acc ? SLIP_STREAM_OK : SLIP_STREAM_BAD_CRC);
+}
+
+
+//
+// drop frame in progress if the line was quiet for longer than gap,
+// like slipDecoderGap() does, end() is called with SLIP_STREAM_ABORTED
+// call with current time each time received bytes are about to be fed
+//
+// *stream - pointer to stream decoder
+// now - current time [us], e.g. system_get_time() or micros()
+// gap - longest quiet time inside a frame [us], SLIP_GAP_US
+//
+// returned value - true if a partial frame was dropped
+//
+bool ICACHE_FLASH_ATTR slipStreamGap(SlipStream *stream, uint32_t now, uint32_t gap)
+{
+	bool partial = stream->inFrame || stream->discard;
+	bool expired = partial && (uint32_t) (now - stream->time) > gap;
+
+	if (expired)
+	{
+		if (stream->inFrame)
+			slipStreamFinish(stream, SLIP_STREAM_ABORTED);
+		stream->discard = false;
+		stream->escape = false;
+	}
+	stream->time = now;
+	return expired;
+}
+
+
+//
+// decode received bytes, callbacks are called as frames start, fill chunks and end
+// bytes may be fed in pieces of any size, e.g. one at a time or whole UART buffer
+//
+// *stream - pointer to stream decoder
+// *wire - pointer to SLIP encoded bytes received from the link
+// nCount - number of bytes in wire
+//
+void ICACHE_FLASH_ATTR slipStreamFeed(SlipStream *stream, const uint8_t *wire, uint16_t nCount)
+{
+	uint16_t i;
+	uint8_t dataByte;
+
+	for (i = 0; i < nCount; i++)
+	{
+		dataByte = wire[i];
+		if (dataByte == SLIP_END)
+		{
+			slipStreamEnd(stream);
+			continue;
+		}
+		if (stream->discard)
+			continue;
+		if (!stream->inFrame)
+		{
+			stream->inFrame = true;
+			stream->acc = 0;
+			stream->nTotal = 0;
+			if (stream->begin)
+				stream->begin(stream->context);
+		}
+		if (stream->escape)
+		{
+			stream->escape = false;
+			if (dataByte == SLIP_ESC_END)
+				dataByte = SLIP_END;
+			else if (dataByte == SLIP_ESC_ESC)
+				dataByte = SLIP_ESC;
+			else
+			{
+				SLIP_CODEC_LOG("Frame dropped - invalid escape sequence!\r\n");
+				slipStreamFinish(stream, SLIP_STREAM_MALFORMED);
+				stream->discard = true;
+				continue;
+			}
+		}
+		else if (dataByte == SLIP_ESC)
+		{
+			stream->escape = true;
+			continue;
+		}
+		stream->chunk[stream->nChunk++] = dataByte;
+		if (stream->nChunk == SLIP_STREAM_CHUNK + crcSize(stream->crc))
+			slipStreamFlush(stream);
+	}
+}
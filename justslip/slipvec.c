@@ -0,0 +1,141 @@
+/*
+* esp-just-slip - slipvec.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "slipvec.h"
+#include "slipcodec.h"
+
+
+//
+// make nCount bytes of segment starting at srcBuffer readable byte by byte
+// bytes in flash are copied to dstBuffer with aligned 32 bit loads, RAM is used in place
+//
+// returned value - srcBuffer or dstBuffer
+//
+static const uint8_t * ICACHE_FLASH_ATTR slipVectorRead(const uint8_t *srcBuffer, uint8_t *dstBuffer, uint16_t nCount)
+{
+#ifdef __ets__
+	uint32_t address, word = 0;
+	uint16_t i;
+
+	if (SLIP_VEC_IN_FLASH(srcBuffer))
+	{
+		for (i = 0; i < nCount; i++)
+		{
+			address = (uint32_t) (srcBuffer + i);
+			if (i == 0 || (address & 3) == 0)
+				word = *(const uint32_t *) (address & ~3UL);
+			// little endian, byte at lowest address in the lowest bits
+			dstBuffer[i] = (uint8_t) (word >> (8 * (address & 3)));
+		}
+		return dstBuffer;
+	}
+#endif
+	return srcBuffer;
+}
+
+
+//
+// SLIP escape chunk of data bytes, SLIP_END after it if end is set, and pass it on to write
+//
+static uint16_t ICACHE_FLASH_ATTR slipVectorWrite(const uint8_t *chunk, uint8_t nCount, bool end,
+	SlipVecWrite write, void *context)
+{
+	uint8_t wireBuffer[SLIP_MAX_ENCODED(SLIP_VEC_CHUNK)];
+	uint16_t nWire = 0;
+	uint8_t i;
+
+	for (i = 0; i < nCount; i++)
+		nWire += slipEncodeByte(chunk[i], wireBuffer + nWire);
+	if (end)
+		wireBuffer[nWire++] = SLIP_END;
+	write(context, wireBuffer, nWire);
+	return nWire;
+}
+
+
+//
+// write callback that sends nothing, for slipVectorEncodedSize()
+//
+static void ICACHE_FLASH_ATTR slipVectorDiscard(void *context, const uint8_t *wire, uint16_t nCount)
+{
+}
+
+
+//
+// number of wire bytes of frame made of segments with check value appended,
+// SLIP_END included, e.g. to charge a pacer before sending
+//
+// *segments - pointer to list of segments
+// nSegments - number of segments
+// crc - check value to append, CRC_NONE if none
+//
+// returned value - wire bytes slipEncodeVector() sends for the same segments
+//
+uint16_t ICACHE_FLASH_ATTR slipVectorEncodedSize(const SlipSegment *segments, uint8_t nSegments, CrcMode crc)
+{
+	return slipEncodeVector(segments, nSegments, crc, slipVectorDiscard, NULL);
+}
+
+
+//
+// SLIP encode segments as one frame with check value appended, terminated with SLIP_END
+// wire bytes are passed to write in pieces as they are encoded
+//
+// *segments - pointer to list of segments, sent in that order
+// nSegments - number of segments
+// crc - check value calculated over all segments and appended as by appendCrc(), CRC_NONE if none
+// write - called with each piece of wire bytes
+// *context - passed to write, e.g. Softuart to send on
+//
+// returned value - number of wire bytes sent
+//
+uint16_t ICACHE_FLASH_ATTR slipEncodeVector(const SlipSegment *segments, uint8_t nSegments, CrcMode crc,
+	SlipVecWrite write, void *context)
+{
+	uint8_t chunk[SLIP_VEC_CHUNK];
+	const uint8_t *data;
+	uint16_t nPos, nWire = 0;
+	uint8_t s, i, n, nCrc = crcSize(crc);
+	uint32_t acc = 0;
+
+	for (s = 0; s < nSegments; s++)
+		for (nPos = 0; nPos < segments[s].nCount; nPos += n)
+		{
+			n = (segments[s].nCount - nPos < SLIP_VEC_CHUNK) ? segments[s].nCount - nPos : SLIP_VEC_CHUNK;
+			data = slipVectorRead((const uint8_t *) segments[s].data + nPos, chunk, n);
+			acc = crcUpdate(crc, acc, data, n);
+			nWire += slipVectorWrite(data, n, false, write, context);
+		}
+	// check value most significant byte first, then SLIP_END
+	for (i = 0; i < nCrc; i++)
+		chunk[i] = (uint8_t) (acc >> (8 * (nCrc - 1 - i)));
+	return nWire + slipVectorWrite(chunk, nCrc, true, write, context);
+}
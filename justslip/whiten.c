@@ -0,0 +1,97 @@
+/*
+* esp-just-slip - whiten.c
+*
+* Copyright (c) 2014-2015, Krzysztof Budzynski <krzychb at gazeta dot pl>
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+*
+* * Redistributions of source code must retain the above copyright notice,
+* this list of conditions and the following disclaimer.
+* * Redistributions in binary form must reproduce the above copyright
+* notice, this list of conditions and the following disclaimer in the
+* documentation and/or other materials provided with the distribution.
+* * The name of Krzysztof Budzynski or krzychb may not be used
+* to endorse or promote products derived from this software without
+* specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "whiten.h"
+#include "framing.h"
+
+// keys are 0 .. WHITEN_KEYS - 1, so key = byte XOR special byte when the upper bits match
+#define WHITEN_KEY_MASK (WHITEN_KEYS - 1)
+
+
+//
+// XOR data from srcBuffer with the key that leaves fewest bytes to escape
+// store key followed by whitened data in dstBuffer
+//
+// *srcBuffer - pointer to data buffer to read data from
+// nCount - number of bytes in srcBuffer, up to 254
+// *dstBuffer - pointer to data buffer of at least nCount + 1 bytes
+//
+// returned value - number of bytes in dstBuffer including key
+//
+uint8_t ICACHE_FLASH_ATTR whitenFrame(const uint8_t *srcBuffer, uint8_t nCount, uint8_t *dstBuffer)
+{
+	// number of bytes that would need escaping for each key
+	uint8_t nEscapes[WHITEN_KEYS];
+	uint8_t i, key = 0;
+
+	os_memset(nEscapes, 0, sizeof(nEscapes));
+	for (i = 0; i < nCount; i++)
+	{
+		if ((srcBuffer[i] & ~WHITEN_KEY_MASK) == (SLIP_END & ~WHITEN_KEY_MASK))
+			nEscapes[(srcBuffer[i] ^ SLIP_END) & WHITEN_KEY_MASK]++;
+		if ((srcBuffer[i] & ~WHITEN_KEY_MASK) == (SLIP_ESC & ~WHITEN_KEY_MASK))
+			nEscapes[(srcBuffer[i] ^ SLIP_ESC) & WHITEN_KEY_MASK]++;
+	}
+	// on a tie lower key wins, so frames with nothing to escape are sent as is
+	for (i = 1; i < WHITEN_KEYS; i++)
+		if (nEscapes[i] < nEscapes[key])
+			key = i;
+
+	dstBuffer[0] = key;
+	for (i = 0; i < nCount; i++)
+		dstBuffer[i + 1] = srcBuffer[i] ^ key;
+	return nCount + 1;
+}
+
+
+//
+// restore data prepared by whitenFrame()
+//
+// *srcBuffer - pointer to data buffer with key followed by whitened data
+// nCount - number of bytes in srcBuffer including key
+// *dstBuffer - pointer to data buffer of at least nCount - 1 bytes, may be the same as srcBuffer
+//
+// returned value - number of bytes in dstBuffer, 0 if key is not valid
+//
+uint8_t ICACHE_FLASH_ATTR unwhitenFrame(const uint8_t *srcBuffer, uint8_t nCount, uint8_t *dstBuffer)
+{
+	uint8_t i, key;
+
+	if (nCount == 0 || srcBuffer[0] >= WHITEN_KEYS)
+	{
+		os_printf("Unable to unwhiten - invalid key!\r\n");
+		return 0;
+	}
+	key = srcBuffer[0];
+	for (i = 1; i < nCount; i++)
+		dstBuffer[i - 1] = srcBuffer[i] ^ key;
+	return nCount - 1;
+}
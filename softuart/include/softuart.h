@@ -1,7 +1,12 @@
 #ifndef SOFTUART_H_
 #define SOFTUART_H_
 
+#ifdef __ets__
 #include "user_interface.h"
+#else
+//types for host simulation
+#include "softuart_hal.h"
+#endif
 
 #define SOFTUART_MAX_RX_BUFF 64 
 
@@ -27,13 +32,32 @@ typedef struct {
 	uint8_t pin_rs485_tx_enable;
 	//wether or not this softuart is rs485 and controlls rs485 tx enable pin
 	uint8_t is_rs485;
+	//tx enable is held for a whole frame, see Softuart_BeginFrame
+	uint8_t rs485_hold;
+	//take 3 samples per bit and vote, see Softuart_EnableOversampling
+	uint8_t oversampling;
+	//bytes dropped because stop bit was low
+	volatile uint32_t framing_errors;
+	//bits with samples that did not agree, only counted when oversampling
+	volatile uint32_t noise_errors;
 	volatile softuart_buffer_t buffer;
 	uint16_t bit_time;
 } Softuart;
 
 
+void Softuart_SetPinRx(Softuart *s, uint8_t gpio_id);
+void Softuart_SetPinTx(Softuart *s, uint8_t gpio_id);
+void Softuart_EnableRs485(Softuart *s, uint8_t gpio_id);
+void Softuart_Init(Softuart *s, uint16_t baudrate);
+void Softuart_EnableOversampling(Softuart *s, uint8_t enable);
 BOOL Softuart_Available(Softuart *s);
 void Softuart_Intr_Handler(Softuart *s);
+uint8_t Softuart_Read(Softuart *s);
+void Softuart_Putchar(Softuart *s, char data);
+void Softuart_Puts(Softuart *s, const char *c);
+void Softuart_BeginFrame(Softuart *s);
+void Softuart_EndFrame(Softuart *s);
+uint8_t Softuart_Readline(Softuart *s, char* Buffer, uint8_t MaxLen);
 
 
 //define mapping from pin to functio mode
@@ -0,0 +1,97 @@
+#ifndef SOFTUART_HAL_H_
+#define SOFTUART_HAL_H_
+
+//Hardware access of softuart.c
+//
+//On ESP8266 (__ets__) these are the SDK calls.
+//Elsewhere they go to functions of a simulator, e.g. host/softsim.c,
+//that keeps a virtual clock and drives / samples a virtual GPIO line,
+//so the bit timing of Softuart_Putchar and Softuart_Intr_Handler
+//runs unchanged on a PC.
+
+#ifdef __ets__
+
+#include "ets_sys.h"
+#include "osapi.h"
+#include "gpio.h"
+#include "os_type.h"
+#include "user_interface.h"
+
+//drive / sample a pin
+#define SOFTUART_PIN_SET(gpio_id, level) GPIO_OUTPUT_SET(GPIO_ID_PIN(gpio_id), level)
+#define SOFTUART_PIN_GET(gpio_id) GPIO_INPUT_GET(GPIO_ID_PIN(gpio_id))
+//time in us and busy wait
+#define SOFTUART_TIME() system_get_time()
+#define SOFTUART_DELAY_US(us) os_delay_us(us)
+//gpio interrupt status, acknowledge, enable / disable for a pin
+#define SOFTUART_INTR_STATUS() GPIO_REG_READ(GPIO_STATUS_ADDRESS)
+#define SOFTUART_INTR_CLEAR(status) GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, status)
+#define SOFTUART_INTR_PIN(gpio_id, state) gpio_pin_intr_state_set(GPIO_ID_PIN(gpio_id), state)
+
+#else
+
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint8_t uint8;
+typedef int BOOL;
+#define BIT(nr) (1UL << (nr))
+
+//messages of Softuart_Init, printed or not by the simulator
+int softuart_hal_printf(const char *format, ...);
+#define os_printf softuart_hal_printf
+
+void softuart_hal_pin_set(uint8_t gpio_id, uint8_t level);
+uint8_t softuart_hal_pin_get(uint8_t gpio_id);
+uint32_t softuart_hal_time(void);
+void softuart_hal_delay_us(uint32_t us);
+uint32_t softuart_hal_intr_status(void);
+void softuart_hal_intr_pin(uint8_t gpio_id, uint8_t state);
+
+#define SOFTUART_PIN_SET(gpio_id, level) softuart_hal_pin_set(gpio_id, level)
+#define SOFTUART_PIN_GET(gpio_id) softuart_hal_pin_get(gpio_id)
+#define SOFTUART_TIME() softuart_hal_time()
+#define SOFTUART_DELAY_US(us) softuart_hal_delay_us(us)
+#define SOFTUART_INTR_STATUS() softuart_hal_intr_status()
+#define SOFTUART_INTR_CLEAR(status)
+#define SOFTUART_INTR_PIN(gpio_id, state) softuart_hal_intr_pin(gpio_id, state)
+
+//pin multiplexer and interrupt setup of Softuart_Init have nothing to do,
+//the simulator calls Softuart_Intr_Handler itself on edges of rx line
+#define GPIO_PIN_INTR_DISABLE 0
+#define PIN_FUNC_SELECT(mux, func)
+#define PIN_PULLUP_EN(mux)
+#define PIN_PULLUP_DIS(mux)
+#define GPIO_ID_PIN(gpio_id) (gpio_id)
+#define GPIO_DIS_OUTPUT(gpio_id)
+#define gpio_init()
+#define gpio_register_set(reg, value)
+#define ETS_GPIO_INTR_DISABLE()
+#define ETS_GPIO_INTR_ENABLE()
+#define ETS_GPIO_INTR_ATTACH(handler, arg)
+
+//non zero so pins count as set up
+#define PERIPHS_IO_MUX_GPIO0_U 1
+#define PERIPHS_IO_MUX_U0TXD_U 1
+#define PERIPHS_IO_MUX_GPIO2_U 1
+#define PERIPHS_IO_MUX_U0RXD_U 1
+#define PERIPHS_IO_MUX_GPIO4_U 1
+#define PERIPHS_IO_MUX_GPIO5_U 1
+#define PERIPHS_IO_MUX_MTDI_U 1
+#define PERIPHS_IO_MUX_MTCK_U 1
+#define PERIPHS_IO_MUX_MTMS_U 1
+#define PERIPHS_IO_MUX_MTDO_U 1
+#define FUNC_GPIO0 0
+#define FUNC_GPIO1 0
+#define FUNC_GPIO2 0
+#define FUNC_GPIO3 0
+#define FUNC_GPIO4 0
+#define FUNC_GPIO5 0
+#define FUNC_GPIO12 0
+#define FUNC_GPIO13 0
+#define FUNC_GPIO14 0
+#define FUNC_GPIO15 0
+
+#endif
+
+#endif /* SOFTUART_HAL_H_ */
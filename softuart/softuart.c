@@ -1,8 +1,4 @@
-#include "ets_sys.h"
-#include "osapi.h"
-#include "gpio.h"
-#include "os_type.h"
-#include "user_interface.h"
+#include "softuart_hal.h"
 #include "softuart.h"
 
 //array of pointers to instances
@@ -92,15 +88,39 @@ void Softuart_EnableRs485(Softuart *s, uint8_t gpio_id)
 	PIN_PULLUP_DIS(softuart_reg[gpio_id].gpio_mux_name);
 	
 	//set low for tx idle (so other bus participants can send)
-	GPIO_OUTPUT_SET(GPIO_ID_PIN(gpio_id), 0);
+	SOFTUART_PIN_SET(gpio_id, 0);
 	
 	os_printf("SOFTUART RS485 init done\r\n");
 }
 
+// Take 3 samples per bit and store the value of at least 2 of them
+// Call after Softuart_Init, costs a quarter of bit time more in interrupt per byte
+void Softuart_EnableOversampling(Softuart *s, uint8_t enable)
+{
+	s->oversampling = enable ? 1 : 0;
+}
+
+// Wait until offset us after start_time and read rx pin
+static inline uint8_t Softuart_SampleAt(Softuart *s, unsigned start_time, unsigned offset)
+{
+	while ((0x7FFFFFFF & SOFTUART_TIME()) < (start_time + offset))
+	{
+		//If system timer overflow, escape from while loop
+		if ((0x7FFFFFFF & SOFTUART_TIME()) < start_time){break;}
+	}
+	return SOFTUART_PIN_GET(s->pin_rx.gpio_id) ? 1 : 0;
+}
+
 void Softuart_Init(Softuart *s, uint16_t baudrate)
 {
 	//disable rs485
 	s->is_rs485 = 0;
+	s->rs485_hold = 0;
+
+	//one sample per bit, clear error counters
+	s->oversampling = 0;
+	s->framing_errors = 0;
+	s->noise_errors = 0;
 
 	if(! _Softuart_Instances_Count) {
 		os_printf("SOFTUART initialize gpio\r\n");
@@ -124,8 +144,8 @@ void Softuart_Init(Softuart *s, uint16_t baudrate)
 		PIN_PULLUP_EN(s->pin_tx.gpio_mux_name);
 		
 		//set high for tx idle
-		GPIO_OUTPUT_SET(GPIO_ID_PIN(s->pin_tx.gpio_id), 1);
-		os_delay_us(100000);
+		SOFTUART_PIN_SET(s->pin_tx.gpio_id, 1);
+		SOFTUART_DELAY_US(100000);
 		
 		os_printf("SOFTUART TX INIT DONE\r\n");
 	}
@@ -168,11 +188,11 @@ void Softuart_Init(Softuart *s, uint16_t baudrate)
 							   GPIO_PIN_SOURCE_SET(GPIO_AS_PIN_SOURCE));
 		
 		//clear interrupt handler status, basically writing a low to the output
-		GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, BIT(s->pin_rx.gpio_id));
+		SOFTUART_INTR_CLEAR(BIT(s->pin_rx.gpio_id));
 
 		//enable interrupt for pin on any edge (rise and fall)
 		//@TODO: should work with ANYEDGE (=3), but complie error
-		gpio_pin_intr_state_set(GPIO_ID_PIN(s->pin_rx.gpio_id), 3);
+		SOFTUART_INTR_PIN(s->pin_rx.gpio_id, 3);
 
 		//globally enable GPIO interrupts
 		ETS_GPIO_INTR_ENABLE();
@@ -192,7 +212,7 @@ void Softuart_Intr_Handler(Softuart *s)
 	uint8_t level, gpio_id;
 // clear gpio status. Say ESP8266EX SDK Programming Guide in  5.1.6. GPIO interrupt handler
 
-    uint32_t gpio_status = GPIO_REG_READ(GPIO_STATUS_ADDRESS);
+    uint32_t gpio_status = SOFTUART_INTR_STATUS();
 	gpio_id = Softuart_Bitcount(gpio_status);
 
 	//if interrupt was by an attached rx pin
@@ -202,70 +222,92 @@ void Softuart_Intr_Handler(Softuart *s)
 		s = _Softuart_GPIO_Instances[gpio_id];
 
 // disable interrupt for GPIO0
-        gpio_pin_intr_state_set(GPIO_ID_PIN(s->pin_rx.gpio_id), GPIO_PIN_INTR_DISABLE);
+        SOFTUART_INTR_PIN(s->pin_rx.gpio_id, GPIO_PIN_INTR_DISABLE);
 
 // Do something, for example, increment whatyouwant indirectly
 		//check level
-		level = GPIO_INPUT_GET(GPIO_ID_PIN(s->pin_rx.gpio_id));
+		level = SOFTUART_PIN_GET(s->pin_rx.gpio_id);
 		if(!level) {
 			//pin is low
 			//therefore we have a start bit
 
 			//wait till start bit is half over so we can sample the next one in the center
-			os_delay_us(s->bit_time/2);	
+			SOFTUART_DELAY_US(s->bit_time/2);	
 
-			//now sample bits
+			//now sample bits, stop bit is the 9th one
 			unsigned i;
 			unsigned d = 0;
-			unsigned start_time = 0x7FFFFFFF & system_get_time();
+			unsigned start_time = 0x7FFFFFFF & SOFTUART_TIME();
+			uint8_t bit = 0;
 
-			for(i = 0; i < 8; i ++ )
+			for(i = 0; i <= 8; i ++ )
 			{
-				while ((0x7FFFFFFF & system_get_time()) < (start_time + (s->bit_time*(i+1))))
+				if(s->oversampling)
+				{
+					//samples a quarter of bit before and after the center
+					//a glitch or a shifted edge hits only one of them
+					uint8_t early = Softuart_SampleAt(s, start_time, s->bit_time*(i+1) - s->bit_time/4);
+					uint8_t center = Softuart_SampleAt(s, start_time, s->bit_time*(i+1));
+					uint8_t late = Softuart_SampleAt(s, start_time, s->bit_time*(i+1) + s->bit_time/4);
+
+					bit = (early + center + late) >= 2;
+					if(early != center || center != late)
+					{
+						s->noise_errors++;
+					}
+				}
+				else
 				{
-					//If system timer overflow, escape from while loop
-					if ((0x7FFFFFFF & system_get_time()) < start_time){break;}
+					bit = Softuart_SampleAt(s, start_time, s->bit_time*(i+1));
 				}
-				//shift d to the right
-				d >>= 1;
 
-				//read bit
-				if(GPIO_INPUT_GET(GPIO_ID_PIN(s->pin_rx.gpio_id))) {
+				if(i < 8)
+				{
+					//shift d to the right
+					d >>= 1;
+
 					//if high, set msb of 8bit to 1
-					d |= 0x80;
+					if(bit) {
+						d |= 0x80;
+					}
 				}
 			}
 
-			//store byte in buffer
-
-			// if buffer full, set the overflow flag and return
-			uint8 next = (s->buffer.receive_buffer_tail + 1) % SOFTUART_MAX_RX_BUFF;
-			if (next != s->buffer.receive_buffer_head)
+			//stop bit must be high, otherwise byte is garbage, e.g. out of sync
+			if(!bit)
 			{
-			  // save new data in buffer: tail points to where byte goes
-			  s->buffer.receive_buffer[s->buffer.receive_buffer_tail] = d; // save new byte
-			  s->buffer.receive_buffer_tail = next;
-			} 
-			else 
-			{
-			  s->buffer.buffer_overflow = 1;
+				s->framing_errors++;
 			}
+			else
+			{
+				//store byte in buffer
 
-			//wait for stop bit
-			os_delay_us(s->bit_time);	
+				// if buffer full, set the overflow flag and return
+				uint8 next = (s->buffer.receive_buffer_tail + 1) % SOFTUART_MAX_RX_BUFF;
+				if (next != s->buffer.receive_buffer_head)
+				{
+				  // save new data in buffer: tail points to where byte goes
+				  s->buffer.receive_buffer[s->buffer.receive_buffer_tail] = d; // save new byte
+				  s->buffer.receive_buffer_tail = next;
+				}
+				else
+				{
+				  s->buffer.buffer_overflow = 1;
+				}
+			}
 
 			//done
 		}
 
 		//clear interrupt
-        GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, gpio_status);
+        SOFTUART_INTR_CLEAR(gpio_status);
 
 // Reactivate interrupts for GPIO0
-        gpio_pin_intr_state_set(GPIO_ID_PIN(s->pin_rx.gpio_id), 3);
+        SOFTUART_INTR_PIN(s->pin_rx.gpio_id, 3);
 	} else {
 		//clear interrupt, no matter from which pin
 		//otherwise, this interrupt will be called again forever
-        GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, gpio_status);
+        SOFTUART_INTR_CLEAR(gpio_status);
 	}
 }
 
@@ -306,41 +348,63 @@ static inline u8 chbit(u8 data, u8 bit)
 void Softuart_Putchar(Softuart *s, char data)
 {
 	unsigned i;
-	unsigned start_time = 0x7FFFFFFF & system_get_time();
+	unsigned start_time = 0x7FFFFFFF & SOFTUART_TIME();
 
-	//if rs485 set tx enable
-	if(s->is_rs485 == 1)
+	//if rs485 set tx enable, unless it is held for the whole frame
+	if(s->is_rs485 == 1 && s->rs485_hold == 0)
 	{
-		GPIO_OUTPUT_SET(GPIO_ID_PIN(s->pin_rs485_tx_enable), 1);
+		SOFTUART_PIN_SET(s->pin_rs485_tx_enable, 1);
 	}
 
 	//Start Bit
-	GPIO_OUTPUT_SET(GPIO_ID_PIN(s->pin_tx.gpio_id), 0);
+	SOFTUART_PIN_SET(s->pin_tx.gpio_id, 0);
 	for(i = 0; i <= 8; i ++ )
 	{
-		while ((0x7FFFFFFF & system_get_time()) < (start_time + (s->bit_time*(i+1))))
+		while ((0x7FFFFFFF & SOFTUART_TIME()) < (start_time + (s->bit_time*(i+1))))
 		{
 			//If system timer overflow, escape from while loop
-			if ((0x7FFFFFFF & system_get_time()) < start_time){break;}
+			if ((0x7FFFFFFF & SOFTUART_TIME()) < start_time){break;}
 		}
-		GPIO_OUTPUT_SET(GPIO_ID_PIN(s->pin_tx.gpio_id), chbit(data,1<<i));
+		SOFTUART_PIN_SET(s->pin_tx.gpio_id, chbit(data,1<<i));
 	}
 
 	// Stop bit
-	while ((0x7FFFFFFF & system_get_time()) < (start_time + (s->bit_time*9)))
+	while ((0x7FFFFFFF & SOFTUART_TIME()) < (start_time + (s->bit_time*9)))
 	{
 		//If system timer overflow, escape from while loop
-		if ((0x7FFFFFFF & system_get_time()) < start_time){break;}
+		if ((0x7FFFFFFF & SOFTUART_TIME()) < start_time){break;}
 	}
-	GPIO_OUTPUT_SET(GPIO_ID_PIN(s->pin_tx.gpio_id), 1);
+	SOFTUART_PIN_SET(s->pin_tx.gpio_id, 1);
 
 	// Delay after byte, for new sync
-	os_delay_us(s->bit_time*6);
+	SOFTUART_DELAY_US(s->bit_time*6);
 
-	//if rs485 set tx disable 
+	//if rs485 set tx disable, unless it is held for the whole frame
+	if(s->is_rs485 == 1 && s->rs485_hold == 0)
+	{
+		SOFTUART_PIN_SET(s->pin_rs485_tx_enable, 0);
+	}
+}
+
+// Hold rs485 tx enable from the first to the last byte of a frame
+// so the driver is not switched around every byte
+void Softuart_BeginFrame(Softuart *s)
+{
+	if(s->is_rs485 == 1)
+	{
+		SOFTUART_PIN_SET(s->pin_rs485_tx_enable, 1);
+		s->rs485_hold = 1;
+	}
+}
+
+// Release the bus once the last byte of a frame is out
+// Softuart_Putchar returns after the stop bit, so the line is idle here
+void Softuart_EndFrame(Softuart *s)
+{
 	if(s->is_rs485 == 1)
 	{
-		GPIO_OUTPUT_SET(GPIO_ID_PIN(s->pin_rs485_tx_enable), 0);
+		s->rs485_hold = 0;
+		SOFTUART_PIN_SET(s->pin_rs485_tx_enable, 0);
 	}
 }
 
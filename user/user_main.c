@@ -39,13 +39,24 @@
 #include "driver/uart.h"
 #include "softuart.h"
 #include "justslip.h"
+#include "autobaud.h"
+#include "pacer.h"
 
 //
 // comment define below if you would like to use Softuart
 //
 #define USE_HW_SERIAL
 
-#ifndef USE_HW_SERIAL
+//
+// uncomment define below to stream wire bytes of the link over UART1
+// for "slipcap record", UART1 then runs at 921600 bps
+//
+// #define CAPTURE_LINK
+
+#ifdef USE_HW_SERIAL
+// negotiate the fastest reliable bit rate of UART0 link
+static Autobaud autobaud;
+#else
 Softuart softuart;
 #endif
 
@@ -54,9 +65,16 @@ Softuart softuart;
 static uint8_t inputBuffer[SLIP_BUFFER_SIZE];
 
 #define UART_READ_CB_TIME 10
-#define UART_SEND_CB_TIME 30
+#define UART_SEND_CB_TIME 10
 static os_timer_t uart_read_timer, uart_send_timer;
 
+// diag frames go out as fast as the token bucket allows, not at a fixed timer period
+// start at about one frame per 30 ms, follow loss reports of the peer if it sends them, e.g. slipd -r
+#define DIAG_TX_RATE 500
+#define DIAG_TX_BURST 64
+#define DIAG_TX_MIN_RATE 100
+static Pacer diagPacer;
+
 
 //
 // prepare and send out a buffer with diagnostic data
@@ -70,29 +88,29 @@ void ICACHE_FLASH_ATTR sendDiagBuffer(void)
 	// when calculating % of packets lost
 	// for the first packet received
 	static long packetNumber = 1;
-	uint8_t diagBuffer[SLIP_BUFFER_SIZE];
-
+	uint8_t randomData[8];
 
-	char *srcAddr, *dstAddr;
-
-	// add packet counter to buffer
-	srcAddr = (char *) &packetNumber;
-	dstAddr = (char *) &diagBuffer[0];
-	memcpy(dstAddr, srcAddr, sizeof(packetNumber));
-	packetNumber++;
+	// packet counter and random data go out as they are, no buffer to put them together
+	SlipSegment diagFrame[] =
+	{
+		{ &packetNumber, sizeof(packetNumber) },
+		{ randomData, sizeof(randomData) }
+	};
 
 	int i;
-	// add some random data to the buffer
+	// add some random data
 	for (i = 0; i < 8; i++)
 		// http://esp8266-re.foogod.com/wiki/Random_Number_Generator
-		diagBuffer[4 + i] = * (uint8_t *) 0x3FF20E44;
+		randomData[i] = * (uint8_t *) 0x3FF20E44;
 
-	uint8_t nCount = appendCrc16(diagBuffer, 4 + 8);
+	// crc16 appended the same as by appendCrc16()
+	pacerCharge(&diagPacer, slipVectorEncodedSize(diagFrame, 2, CRC_16));
 #ifdef USE_HW_SERIAL
-	slipEncodeSerialUart0(diagBuffer, nCount);
+	slipEncodeSerialUart0v(diagFrame, 2, CRC_16);
 #else
-	slipEncodeSerial(&softuart, diagBuffer, nCount);
+	slipEncodeSerialv(&softuart, diagFrame, 2, CRC_16);
 #endif
+	packetNumber++;
 }
 
 
@@ -154,10 +172,34 @@ void ICACHE_FLASH_ATTR uart_read_cb(void *arg)
 	uint8_t nCount;
 
 #ifdef USE_HW_SERIAL
+	static uint32_t rxOverflows = 0;
+
+	autobaudPoll(&autobaud);
+	// bytes dropped by a full rx ring explain frames that fail crc check
+	if (uart0_rx_overflows() != rxOverflows)
+	{
+		rxOverflows = uart0_rx_overflows();
+		os_printf("UART0 rx ring overflows %u\r\n", (unsigned) rxOverflows);
+	}
 	nCount = slipDecodeSerialUart0(inputBuffer);
+	// control frames of baud rate negotiation are not printed
+	if (nCount > 0 && autobaudFrame(&autobaud, inputBuffer, nCount))
+		nCount = 0;
 #else
+	static uint32_t framingErrors = 0;
+
 	nCount = slipDecodeSerial(&softuart, inputBuffer);
+	// bytes dropped by Softuart explain frames that fail crc check
+	if (softuart.framing_errors != framingErrors)
+	{
+		framingErrors = softuart.framing_errors;
+		os_printf("Softuart framing errors %u, noisy bits %u\r\n",
+			(unsigned) framingErrors, (unsigned) softuart.noise_errors);
+	}
 #endif
+	// loss reports of the peer set pace of diag frames
+	if (nCount > 2 && checkCrc16(inputBuffer, nCount) && pacerReport(&diagPacer, inputBuffer, nCount - 2))
+		nCount = 0;
 	if (nCount > 0)
 		printDiagBuffer(inputBuffer, nCount);
 }
@@ -168,7 +210,15 @@ void ICACHE_FLASH_ATTR uart_read_cb(void *arg)
 //
 void ICACHE_FLASH_ATTR uart_send_cb(void *arg)
 {
-	sendDiagBuffer();
+#ifdef USE_HW_SERIAL
+	// hold data while link probes bit rates
+	if (autobaudBusy(&autobaud))
+		return;
+	// no faster than the wire at the negotiated bit rate
+	diagPacer.maxRate = autobaudRate(&autobaud) / 10;
+#endif
+	while (pacerReady(&diagPacer, system_get_time()))
+		sendDiagBuffer();
 }
 
 
@@ -184,10 +234,17 @@ void ICACHE_FLASH_ATTR user_init(void)
 	// set bit rate for UART1 = 0 to direct output of os_printf() to UART0
 	//
 
+#ifdef CAPTURE_LINK
+#define DEBUG_BIT_RATE BIT_RATE_921600
+#else
+#define DEBUG_BIT_RATE BIT_RATE_115200
+#endif
+
 #ifdef USE_HW_SERIAL
-	uart_init(BIT_RATE_57600, BIT_RATE_115200);
+	// UART0 starts at AUTOBAUD_BASE_RATE = BIT_RATE_57600 and then goes as fast as the link allows
+	uart_init(AUTOBAUD_BASE_RATE, DEBUG_BIT_RATE);
 #else
-	uart_init(BIT_RATE_115200, BIT_RATE_115200);
+	uart_init(BIT_RATE_115200, DEBUG_BIT_RATE);
 #endif
 
 	// enable os_printf() to go to the debug output of UART0 or UART1
@@ -196,11 +253,22 @@ void ICACHE_FLASH_ATTR user_init(void)
 	os_printf("\r\n");
 	os_printf("ESP8255 Slip Transmit / Receive (esp-just-slip)\r\n");
 
+#ifdef CAPTURE_LINK
+	slipCaptureUart1(true);
+#endif
+
 #ifndef USE_HW_SERIAL
 	// initialise software UART connected to GIPIO14 (Tx) and GPIO12 (Rx)
 	Softuart_SetPinRx(&softuart, 14);  // LoLin D5
 	Softuart_SetPinTx(&softuart, 12);  // LoLin D6
 	Softuart_Init(&softuart, 57600);
+	// vote on 3 samples per bit, a single glitch does not flip a bit
+	Softuart_EnableOversampling(&softuart, 1);
+#endif
+
+#ifdef USE_HW_SERIAL
+	autobaudInit(&autobaud, AUTOBAUD_LEADER);
+	autobaudStart(&autobaud);
 #endif
 
 	// UART reading
@@ -208,6 +276,10 @@ void ICACHE_FLASH_ATTR user_init(void)
 	os_timer_setfn(&uart_read_timer, (os_timer_func_t *)uart_read_cb, (void *)0);
 	os_timer_arm(&uart_read_timer, UART_READ_CB_TIME, 1);
 
+	// at most 5760 bytes per second of 57600 bps, UART0 follows the negotiated bit rate
+	pacerInit(&diagPacer, DIAG_TX_RATE, DIAG_TX_BURST, system_get_time());
+	pacerAdapt(&diagPacer, DIAG_TX_MIN_RATE, 57600 / 10);
+
 	// UART writing
 	os_timer_disarm(&uart_send_timer);
 	os_timer_setfn(&uart_send_timer, (os_timer_func_t *)uart_send_cb, (void *)0);